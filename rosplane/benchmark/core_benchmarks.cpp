@@ -0,0 +1,200 @@
+/**
+ * @file core_benchmarks.cpp
+ *
+ * Time per call of the estimation, control, path following and path management algorithms, run
+ * on their own with the default parameters and no ROS2 node. Build with ROSPLANE_BUILD_BENCHMARKS
+ * and compare the results between changes to the hot paths of the autopilot.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "rosplane/controller_successive_loop_core.hpp"
+#include "rosplane/controller_total_energy_core.hpp"
+#include "rosplane/estimator_continuous_discrete_core.hpp"
+#include "rosplane/path_follower_example_core.hpp"
+#include "rosplane/path_manager_example_core.hpp"
+
+namespace
+{
+
+using namespace rosplane;
+
+constexpr float kTs = 0.01f;        /**< Time step of the algorithms (s) */
+constexpr float kAirspeed = 15.0f;  /**< Airspeed of the aircraft (m/s) */
+constexpr float kAltitude = 100.0f; /**< Commanded altitude of the aircraft (m) */
+
+/**
+ * @brief Estimator in level flight at constant speed. With gps_new set, every call has a new GPS
+ * fix to fuse, otherwise the position filter only propagates.
+ */
+void BM_EstimatorContinuousDiscrete(benchmark::State & state)
+{
+  bool gps_new = state.range(0) != 0;
+
+  ParamManager params;
+  EstimatorContinuousDiscreteCore estimator(CoreContext{params});
+  estimator.set_origin(40.0, -111.0, 1400.0);
+  estimator.set_baro_calibration(86000.0f);
+
+  EstimatorCore::Input input{};
+  input.accel_z = -9.8f;
+  input.static_pres = 1.225f * 9.8f * kAltitude;
+  input.diff_pres = 0.5f * 1.225f * kAirspeed * kAirspeed;
+  input.gps_h = kAltitude;
+  input.gps_Vg = kAirspeed;
+  input.status_armed = true;
+  input.armed_init = true;
+  input.Ts = kTs;
+
+  EstimatorCore::Output output;
+  for (auto _ : state) {
+    input.stamp += kTs;
+    input.gps_new = gps_new;
+    if (gps_new) {
+      input.gps_epoch++;
+      input.gps_n += kAirspeed * kTs;
+      input.gps_stamp = input.stamp;
+    }
+    estimator.estimate(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK(BM_EstimatorContinuousDiscrete)->ArgName("gps_new")->Arg(0)->Arg(1);
+
+/**
+ * @brief Altitude of the aircraft that keeps the state machine of the controllers in a zone,
+ * with the default alt_toz of 5 m and alt_hz of 10 m.
+ */
+float zone_altitude(AltZones zone)
+{
+  switch (zone) {
+    case AltZones::TAKE_OFF:
+      return 2.0f;
+    case AltZones::CLIMB:
+      return kAltitude / 2.0f;
+    default:
+      return kAltitude;
+  }
+}
+
+/**
+ * @brief Controller in straight flight at the altitude of one of the altitude zones. The
+ * controller is stepped into the zone before the timing starts.
+ */
+template<typename Controller>
+void BM_Controller(benchmark::State & state)
+{
+  AltZones zone = static_cast<AltZones>(state.range(0));
+
+  ParamManager params;
+  Controller controller(CoreContext{params});
+
+  ControllerCore::Input input{};
+  input.Ts = kTs;
+  input.h = zone_altitude(zone);
+  input.va = kAirspeed;
+  input.va_c = kAirspeed;
+  input.h_c = kAltitude;
+  input.chi_c = 0.1f;
+
+  ControllerCore::Output output;
+  controller.control(input, output);
+  while (output.current_zone != zone) {
+    controller.control(input, output);
+  }
+
+  for (auto _ : state) {
+    controller.control(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Controller, ControllerSucessiveLoopCore)
+  ->ArgName("zone")
+  ->Arg(static_cast<int>(AltZones::TAKE_OFF))
+  ->Arg(static_cast<int>(AltZones::CLIMB))
+  ->Arg(static_cast<int>(AltZones::ALTITUDE_HOLD));
+BENCHMARK_TEMPLATE(BM_Controller, ControllerTotalEnergyCore)
+  ->ArgName("zone")
+  ->Arg(static_cast<int>(AltZones::TAKE_OFF))
+  ->Arg(static_cast<int>(AltZones::CLIMB))
+  ->Arg(static_cast<int>(AltZones::ALTITUDE_HOLD));
+
+/**
+ * @brief Path follower off to the side of a line east, or outside of an orbit about the origin.
+ */
+void BM_PathFollowerExample(benchmark::State & state)
+{
+  PathType type = static_cast<PathType>(state.range(0));
+
+  ParamManager params;
+  PathFollowerExampleCore follower(CoreContext{params});
+
+  PathFollowerCore::Input input{};
+  input.p_type = type;
+  input.va_d = kAirspeed;
+  input.r_path[2] = -kAltitude;
+  input.q_path[1] = 1.0f;
+  input.c_orbit[2] = -kAltitude;
+  input.rho_orbit = 50.0f;
+  input.lam_orbit = 1;
+  input.pn = 70.0f;
+  input.pe = 20.0f;
+  input.h = kAltitude;
+  input.va = kAirspeed;
+  input.chi = 0.5f;
+  input.psi = 0.5f;
+
+  PathFollowerCore::Output output;
+  for (auto _ : state) {
+    follower.update(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK(BM_PathFollowerExample)
+  ->ArgName("type")
+  ->Arg(static_cast<int>(PathType::LINE))
+  ->Arg(static_cast<int>(PathType::ORBIT));
+
+/**
+ * @brief Path manager on the first leg of a square mission, with fillets between the legs or
+ * with the course given at each waypoint for Dubins paths.
+ */
+void BM_PathManagerExample(benchmark::State & state)
+{
+  bool use_chi = state.range(0) != 0;
+
+  ParamManager params;
+  PathManagerExampleCore manager(CoreContext{params});
+
+  PathManagerCore::Input input{};
+  input.h = kAltitude;
+
+  std::vector<PathManagerCore::Waypoint> waypoints;
+  const float corners[4][2] = {{0.0f, 0.0f}, {500.0f, 0.0f}, {500.0f, 500.0f}, {0.0f, 500.0f}};
+  for (int i = 0; i < 4; ++i) {
+    PathManagerCore::Waypoint waypoint;
+    waypoint.w[0] = corners[i][0];
+    waypoint.w[1] = corners[i][1];
+    waypoint.w[2] = -kAltitude;
+    waypoint.chi_d = i * M_PI_2_F;
+    waypoint.use_chi = use_chi;
+    waypoint.va_d = kAirspeed;
+    waypoints.push_back(waypoint);
+  }
+  manager.add_waypoints(waypoints, input);
+
+  input.pn = 10.0f;
+  PathManagerCore::Output output;
+  for (auto _ : state) {
+    manager.manage(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK(BM_PathManagerExample)->ArgName("use_chi")->Arg(0)->Arg(1);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -2,7 +2,7 @@
  * @file controller_base.h
  *
  * Base class definition for autopilot controller in chapter 6 of UAVbook, see http://uavbook.byu.edu/doku.php
- * Implements ROS2 functionality and support for control algorithm.
+ * Implements ROS2 functionality and runs a control algorithm from controller_core.hpp.
  *
  * @author Ian Reid <iyr27@byu.edu>
  */
@@ -11,11 +11,19 @@
 #define CONTROLLER_BASE_H
 
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
 
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rosflight_msgs/msg/command.hpp>
 
 #include "param_manager.hpp"
+#include "rosplane/controller_core.hpp"
+#include "rosplane/latency_histogram.hpp"
+#include "rosplane/loop_timing_probe.hpp"
+#include "rosplane/telemetry_gate.hpp"
 #include "rosplane_msgs/msg/controller_commands.hpp"
 #include "rosplane_msgs/msg/controller_internals.hpp"
 #include "rosplane_msgs/msg/state.hpp"
@@ -25,90 +33,50 @@ using namespace std::chrono_literals;
 
 namespace rosplane
 {
-/**
- * This defines the different portions of the control algorithm.
- */
-enum class AltZones
-{
-  TAKE_OFF, /**< In the take off zone where the aircraft gains speed and altitude */
-  CLIMB, /**< In the climb zone the aircraft proceeds to commanded altitude without course change. */
-  ALTITUDE_HOLD /**< In the altitude hold zone the aircraft keeps altitude and follows commanded course */
-};
 
 /**
- * This class implements all of the basic functionality of a controller interfacing with ROS2.
+ * This class implements all of the basic functionality of a controller interfacing with ROS2. The
+ * control algorithm itself is a ControllerCore, which the node feeds from its subscriptions and
+ * timers and whose outputs it publishes.
  */
 
 class ControllerBase : public rclcpp::Node
 {
 public:
   /**
-   * Constructor for ROS2 setup and parameter initialization.
-   */
-  ControllerBase();
-
-  /**
-   * Gets the current phi_c value from the current private command message.
-   *
-   * @return The latest phi_c value in the controller commands message, as received by the
-   * ROS callback.
+   * Builds the control algorithm the node runs, from the parameters, logger and clock of the node.
    */
-  float get_phi_c() { return controller_commands_.phi_c; }
+  using CoreFactory = std::function<std::unique_ptr<ControllerCore>(const CoreContext &)>;
 
   /**
-   * Gets the current theta_c value from the current private command message.
-   *
-   * @return The latest theta_c value in the controller commands message, as received by the
-   * ROS callback.
+   * Constructor for ROS2 setup and parameter initialization.
+   * @param options Options of the node.
+   * @param make_controller Builds the control algorithm. It is called once the parameters of the
+   * node are declared.
    */
-  float get_theta_c() { return controller_commands_.theta_c; };
+  ControllerBase(const rclcpp::NodeOptions & options, const CoreFactory & make_controller);
 
 protected:
-  /**
-   * This struct holds all of the inputs to the control algorithm.
-   */
-  struct Input
-  {
-    float Ts;     /**< time step */
-    float h;      /**< altitude */
-    float va;     /**< airspeed */
-    float phi;    /**< roll angle */
-    float theta;  /**< pitch angle */
-    float chi;    /**< course angle */
-    float p;      /**< body frame roll rate */
-    float q;      /**< body frame pitch rate */
-    float r;      /**< body frame yaw rate */
-    float va_c;   /**< commanded airspeed (m/s) */
-    float h_c;    /**< commanded altitude (m) */
-    float chi_c;  /**< commanded course (rad) */
-    float phi_ff; /**< feed forward term for orbits (rad) */
-  };
-
-  /**
-   * This struct holds all of the outputs of the control algorithm.
-   */
-  struct Output
-  {
-    float theta_c;         /**< The commanded pitch angle from the altitude control loop */
-    float phi_c;           /**< The commanded roll angle from the course control loop */
-    float delta_e;         /**< The commanded elevator deflection */
-    float delta_a;         /**< The commanded aileron deflection */
-    float delta_r;         /**< The commanded rudder deflection */
-    float delta_t;         /**< The commanded throttle deflection */
-    AltZones current_zone; /**< The current altitude zone for the control */
-  };
-
   /**
    * Parameter manager object. Contains helper functions to interface parameters with ROS.
   */
   ParamManager params_;
 
   /**
-   * Interface for control algorithm.
-   * @param input Inputs to the control algorithm.
-   * @param output Outputs of the controller, including selected intermediate values and final control efforts.
+   * The control algorithm. It is declared after params_, so it is destroyed before the parameters
+   * its handles point into.
+   */
+  std::unique_ptr<ControllerCore> controller_;
+
+  /**
+   * Handles to the parameters declared by this class.
    */
-  virtual void control(const Input & input, Output & output) = 0;
+  ParamHandle<double> controller_output_frequency_;
+  ParamHandle<bool> state_triggered_control_;
+  ParamHandle<double> state_timeout_;
+  ParamHandle<double> controller_overrun_factor_;
+  ParamHandle<std::string> controller_overrun_policy_;
+  ParamHandle<int64_t> controller_internals_decimation_;
 
 private:
   /**
@@ -121,6 +89,17 @@ private:
    */
   rclcpp::Publisher<rosplane_msgs::msg::ControllerInternals>::SharedPtr controller_internals_pub_;
 
+  /**
+   * Decides on which control ticks the controller internals are built, since they are only used for
+   * tuning.
+   */
+  TelemetryGate controller_internals_gate_;
+
+  /**
+   * This publisher publishes the latency diagnostics.
+   */
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
+
   /**
    * This subscriber subscribes to the commands the controller uses to calculate control effort.
    */
@@ -136,6 +115,22 @@ private:
    */
   rclcpp::TimerBase::SharedPtr timer_;
 
+  /**
+   * This timer controls how often the latency diagnostics are published.
+   */
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+
+  /**
+   * Latency from the IMU sample the state was computed from to the actuator commands, which is the
+   * end to end latency of the autopilot.
+   */
+  LatencyHistogram imu_to_actuator_latency_;
+
+  /**
+   * Timing of the control loop, measured around the calls to control.
+   */
+  LoopTimingProbe control_timing_;
+
   /**
    * Period of the timer that controlls how often commands are published.
    */
@@ -161,16 +156,67 @@ private:
    */
   bool command_recieved_;
 
+  bool state_recieved_;           /**< True once a state is in vehicle_state_ */
+  rclcpp::Time last_state_time_;  /**< Time the last state was received */
+  rclcpp::Time last_state_stamp_; /**< Header stamp of the last state */
+
+  /**
+   * What is done with a time step longer than controller_overrun_factor periods.
+   */
+  enum class OverrunPolicy
+  {
+    SCALE, /**< Cut the step down to the bound */
+    SKIP   /**< Drop the missed time and use one nominal period */
+  };
+  OverrunPolicy overrun_policy_; /**< Parsed from controller_overrun_policy */
+
+  bool last_tick_valid_;                            /**< True once last_tick_ holds a timer tick */
+  std::chrono::steady_clock::time_point last_tick_; /**< Steady time of the last timer tick */
+
   /**
-   * Convert from deflection angle in radians to pwm.
+   * Bounds a measured time step before it is integrated over. A step that is not positive is
+   * replaced with the nominal period, and one shorter than the nominal period divided by
+   * controller_overrun_factor is lengthened to that bound, unless the controller is triggered by
+   * the state, whose steps come from the state stamps. A step more than controller_overrun_factor
+   * periods long means ticks were missed. With controller_overrun_policy set to "scale" the step
+   * is cut down to that bound, and with "skip" the missed time is dropped and the step is one
+   * nominal period.
+   * @param Ts Measured time step, in seconds.
+   * @return The time step to run the control loops with, in seconds.
    */
-  void convert_to_pwm(Output & output);
+  double bound_time_step(double Ts);
+
+  /**
+   * Parses controller_overrun_policy into overrun_policy_, so it is not compared as a string on
+   * every control update.
+   */
+  void update_overrun_policy();
 
   /**
    * Calls the control function and publishes outputs and intermediate values to the command and controller internals
    * topics.
+   * @param Ts Measured time step since the last control update, in seconds. It is bounded with
+   * bound_time_step before it is passed to the control loops.
+   */
+  void actuator_controls_publish(double Ts);
+
+  /**
+   * Runs the controller at the rate set by controller_output_frequency. When the controller is
+   * triggered by the state instead, this only checks that the state has not gone stale.
+   */
+  void timer_callback();
+
+  /**
+   * Publishes neutral control surfaces and zero throttle, for when the state driving the controller
+   * has gone stale and the control loops can no longer be closed. A timer driven controller keeps
+   * running on the last state, as it did before the state could trigger it.
+   */
+  void failsafe_publish();
+
+  /**
+   * Publishes the latency and loop timing diagnostics over the time since the last call.
    */
-  void actuator_controls_publish();
+  void diagnostics_publish();
 
   /**
    * Callback for new set of controller commands published to the controller_commands_sub_.
@@ -11,9 +11,14 @@
 #ifndef ESTIMATOR_ROS_H
 #define ESTIMATOR_ROS_H
 
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 
+#include <Eigen/Geometry>
 #include <ament_index_cpp/get_package_share_directory.hpp>
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <geometry_msgs/msg/twist_stamped.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rosflight_msgs/msg/airspeed.hpp>
@@ -23,11 +28,17 @@
 #include <sensor_msgs/msg/nav_sat_fix.hpp>
 #include <yaml-cpp/yaml.h>
 
+#include "geodesy.hpp"
 #include "param_manager.hpp"
+#include "rosplane/estimator_core.hpp"
+#include "rosplane/latency_histogram.hpp"
+#include "rosplane/loop_timing_probe.hpp"
+#include "rosplane/seqlock.hpp"
+#include "rosplane/spsc_queue.hpp"
+#include "rosplane/streaming_statistics.hpp"
+#include "rosplane/telemetry_gate.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 
-#define EARTH_RADIUS 6378145.0f
-
 using std::placeholders::_1;
 using namespace std::chrono_literals;
 
@@ -37,62 +48,58 @@ namespace rosplane
 class EstimatorROS : public rclcpp::Node
 {
 public:
-  EstimatorROS();
+  /**
+   * Builds the estimation algorithm the node runs, from the parameters, logger and clock of the
+   * node.
+   */
+  using CoreFactory = std::function<std::unique_ptr<EstimatorCore>(const CoreContext &)>;
 
-protected:
-  struct Input
-  {
-    float gyro_x;
-    float gyro_y;
-    float gyro_z;
-    float accel_x;
-    float accel_y;
-    float accel_z;
-    float static_pres;
-    float diff_pres;
-    bool gps_new;
-    float gps_n;
-    float gps_e;
-    float gps_h;
-    float gps_Vg;
-    float gps_course;
-    bool status_armed;
-    bool armed_init;
-  };
+  /**
+   * @param options: Options of the node
+   * @param make_estimator: Builds the estimation algorithm. It is called once the parameters of the
+   * node are declared.
+   */
+  EstimatorROS(const rclcpp::NodeOptions & options, const CoreFactory & make_estimator);
 
-  struct Output
-  {
-    float pn;
-    float pe;
-    float h;
-    float va;
-    float alpha;
-    float beta;
-    float phi;
-    float theta;
-    float psi;
-    float chi;
-    float p;
-    float q;
-    float r;
-    float Vg;
-    float wn;
-    float we;
-  };
+protected:
+  ParamManager params_;
 
-  bool baro_init_; /**< Initial barometric pressure */
+  /**
+   * The estimation algorithm. Declared after params_, so it is destroyed before the parameters it
+   * holds handles to.
+   */
+  std::unique_ptr<EstimatorCore> estimator_;
 
-  virtual void estimate(const Input & input, Output & output) = 0;
+  /**
+   * Handles to the parameters used at the sensor or estimator rate. Only the parameter callback
+   * thread reads these, in update_settings, since the sensor callbacks and the estimator run on
+   * other threads.
+   */
+  ParamHandle<double> estimator_update_frequency_;
+  ParamHandle<double> rho_;
+  ParamHandle<double> gravity_;
+  ParamHandle<double> gps_ground_speed_threshold_;
+  ParamHandle<double> baro_measurement_gate_;
+  ParamHandle<double> airspeed_measurement_gate_;
+  ParamHandle<int64_t> baro_calibration_count_;
+  ParamHandle<bool> imu_triggered_estimation_;
+  ParamHandle<double> imu_watchdog_timeout_;
+  ParamHandle<bool> imu_coning_sculling_compensation_;
+  ParamHandle<bool> exact_geodesy_;
+  ParamHandle<int64_t> state_derived_fields_decimation_;
 
-  ParamManager params_;
-  bool gps_init_;
-  double init_lat_ = 0.0; /**< Initial latitude in degrees */
-  double init_lon_ = 0.0; /**< Initial longitude in degrees */
-  float init_alt_ = 0.0;  /**< Initial altitude in meters above MSL  */
-  float init_static_;     /**< Initial static pressure (mbar)  */
+  /**
+   * @brief Copies the origin and baro calibration the estimator was seeded with into the sensor
+   * input, which carries them to the estimator from then on. Must be called before the node spins,
+   * and again whenever the estimator is seeded.
+   */
+  void load_references();
 
 private:
+  LocalFrame gnss_frame_; /**< Local frame at the initial GNSS fix, rebuilt when it changes */
+  TelemetryGate derived_fields_gate_; /**< Picks the states the display fields are computed for */
   rclcpp::Publisher<rosplane_msgs::msg::State>::SharedPtr vehicle_state_pub_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
   rclcpp::Subscription<sensor_msgs::msg::NavSatFix>::SharedPtr gnss_fix_sub_;
   rclcpp::Subscription<geometry_msgs::msg::TwistStamped>::SharedPtr
     gnss_vel_sub_; //used in conjunction with the gnss_fix_sub_
@@ -103,24 +110,125 @@ private:
 
   std::string param_filepath_ = "estimator_params.yaml";
 
-  void update();
+  static constexpr double TIMER_STEP_BOUND = 3.0; /**< Largest ratio of a timer step to nominal */
+
+  /**
+   * One coherent set of the parameters used at the sensor or estimator rate. It is rebuilt when the
+   * parameters change, and each callback reads from a copy taken when it starts.
+   */
+  struct Settings
+  {
+    double estimator_update_frequency;       /**< Nominal rate of the estimator (Hz) */
+    double rho;                              /**< Air density (kg/m^3) */
+    double gravity;                          /**< Gravitational acceleration (m/s^2) */
+    double gps_ground_speed_threshold;       /**< Slowest ground speed the GPS course is used at */
+    double baro_measurement_gate;            /**< Largest change in barometer altitude per sample */
+    double airspeed_measurement_gate;        /**< Largest change in airspeed per sample */
+    int64_t baro_calibration_count;          /**< Samples averaged for the barometer calibration */
+    bool imu_triggered_estimation;           /**< Run the estimator on each IMU sample */
+    double imu_watchdog_timeout;             /**< Time without IMU before the timer runs (s) */
+    bool imu_coning_sculling_compensation;   /**< Compensate the IMU integral for coning */
+    bool exact_geodesy;                      /**< Convert GNSS fixes exactly through ECEF */
+    int64_t state_derived_fields_decimation; /**< Fill in the display fields every Nth state */
+  };
+
+  SeqLock<Settings> settings_snapshot_; /**< Latest settings, stored by update_settings */
+  Settings settings_;                    /**< Settings of the current update, only used by update */
+
+  /**
+   * @brief Rebuilds the settings from the parameters. Must only be called from the thread that
+   * changes the parameters.
+   */
+  void update_settings();
+
+  /**
+   * @brief Runs the estimator on the current input and publishes the estimated state.
+   *
+   * @param Ts The time since the last estimate, in seconds. Zero takes it from the IMU samples
+   * integrated for this estimate, or the nominal period when there are none.
+   */
+  void update(double Ts);
+
+  /**
+   * @brief Timer callback. Runs the estimator at the nominal rate, unless the estimator is
+   * triggered by the IMU. In that case the timer only runs the estimator when the IMU is stale.
+   * The time step is measured on the steady clock, and kept within a factor of
+   * TIMER_STEP_BOUND of the nominal period.
+   */
+  void timerCallback();
+
+  /**
+   * @brief Publishes the latency from the IMU sample to the published state and the timing of the
+   * estimator loop, over the time since the last call.
+   */
+  void diagnosticsCallback();
   void gnssFixCallback(const sensor_msgs::msg::NavSatFix::SharedPtr msg);
   void gnssVelCallback(const geometry_msgs::msg::TwistStamped::SharedPtr msg);
   void imuCallback(const sensor_msgs::msg::Imu::SharedPtr msg);
-  void baroAltCallback(const rosflight_msgs::msg::Barometer::SharedPtr msg);
+
   /**
-   * @brief This saves parameters to the param file for later use.
+   * @brief Adds an IMU sample to the integral that is consumed on the next estimator update.
    *
-   * @param param_name The name of the parameter.
-   * @param param_val The value of the parameter.
+   * @param gyro The angular rate measurement, in rad/s.
+   * @param accel The specific force measurement, in m/s^2.
+   * @param dt The time since the previous sample, in seconds. Samples with a dt of zero are not
+   * integrated, but are used if no other samples arrive before the next update.
    */
-  void saveParameter(std::string param_name, double param_val);
+  void accumulateImuSample(const Eigen::Vector3f & gyro, const Eigen::Vector3f & accel,
+                           double dt);
+
+  /**
+   * @brief Sets the IMU fields of the input to the mean rate and specific force over all of the
+   * samples since the last update, and resets the integral.
+   *
+   * @return The time covered by the integrated samples, in seconds, 0 if there were none.
+   */
+  double consumeImuSamples();
+  void baroAltCallback(const rosflight_msgs::msg::Barometer::SharedPtr msg);
   void airspeedCallback(const rosflight_msgs::msg::Airspeed::SharedPtr msg);
   void statusCallback(const rosflight_msgs::msg::Status::SharedPtr msg);
 
   rclcpp::TimerBase::SharedPtr update_timer_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
   std::chrono::microseconds update_period_;
   bool params_initialized_;
+  bool imu_stamp_init_;                   /**< True once an IMU stamp is in last_imu_stamp_ */
+  rclcpp::Time last_imu_stamp_;           /**< Header stamp of the last IMU message */
+  std::atomic<int64_t> last_imu_time_ns_; /**< Node clock time of the last IMU message (ns) */
+
+  bool last_tick_valid_;                            /**< True once last_tick_ holds a timer tick */
+  std::chrono::steady_clock::time_point last_tick_; /**< Steady time of the last timer tick */
+
+  /**
+   * Integrated IMU increments since the last estimator update. The coning and sculling terms are
+   * only accumulated when imu_coning_sculling_compensation is set.
+   */
+  struct ImuIntegral
+  {
+    Eigen::Vector3f delta_angle = Eigen::Vector3f::Zero();    /**< Integrated angular rate (rad) */
+    Eigen::Vector3f delta_velocity = Eigen::Vector3f::Zero(); /**< Integrated accel (m/s) */
+    Eigen::Vector3f coning = Eigen::Vector3f::Zero();         /**< Coning correction (rad) */
+    Eigen::Vector3f sculling = Eigen::Vector3f::Zero();       /**< Sculling correction (m/s) */
+    double dt = 0.0;                                          /**< Integrated time (s) */
+  };
+  ImuIntegral imu_integral_;
+
+  /**
+   * Raw IMU sample, passed from the IMU callback to the estimator update.
+   */
+  struct ImuSample
+  {
+    Eigen::Vector3f gyro;
+    Eigen::Vector3f accel;
+    double dt;                           /**< Time since the previous sample (s), 0 if unknown */
+    builtin_interfaces::msg::Time stamp; /**< Header stamp of the sample */
+  };
+  SpscQueue<ImuSample> imu_samples_;
+  builtin_interfaces::msg::Time latest_imu_stamp_; /**< Stamp of the newest consumed IMU sample */
+  LatencyHistogram imu_to_state_latency_;
+  LoopTimingProbe estimate_timing_; /**< Timing of the calls to estimate */
+  Eigen::Vector3f latest_gyro_ = Eigen::Vector3f::Zero();  /**< Last gyro sample (rad/s) */
+  Eigen::Vector3f latest_accel_ = Eigen::Vector3f::Zero(); /**< Last accel sample (m/s^2) */
   std::string gnss_fix_topic_ = "navsat_compat/fix";
   std::string gnss_vel_topic_ = "navsat_compat/vel";
   std::string imu_topic_ = "imu/data";
@@ -128,10 +236,16 @@ private:
   std::string airspeed_topic_ = "airspeed";
   std::string status_topic_ = "status";
 
-  bool gps_new_;
-  bool armed_first_time_;                 /**< Arm before starting estimation  */
-  int baro_count_;                        /**< Used to grab the first set of baro measurements */
-  std::vector<float> init_static_vector_; /**< Used to grab the first set of baro measurements */
+  std::atomic<bool> armed_first_time_; /**< Arm before starting estimation  */
+  int baro_count_;                     /**< Used to grab the first set of baro measurements */
+
+  /**
+   * Statistics of the baro calibration samples. The quartiles are used to reject calibrations
+   * with outliers.
+   */
+  RunningStatistics baro_calibration_stats_;
+  P2Quantile baro_calibration_q1_{0.25};
+  P2Quantile baro_calibration_q3_{0.75};
 
   /**
    * This declares each parameter as a parameter so that the ROS2 parameter system can recognize each parameter.
@@ -158,7 +272,19 @@ private:
   rcl_interfaces::msg::SetParametersResult
   parametersCallback(const std::vector<rclcpp::Parameter> & parameters);
 
-  Input input_;
+  /**
+   * The sensor callbacks run in their own callback group, so they are never blocked by the
+   * estimator. They write to sensor_input_ and publish it through input_snapshot_, and the
+   * estimator update takes a consistent copy of it into input_. The IMU callback can trigger the
+   * update, so it runs in the estimator group with the timer instead. Its samples are passed
+   * through imu_samples_, so that the update can integrate every one of them.
+   */
+  rclcpp::CallbackGroup::SharedPtr sensor_callback_group_;
+  rclcpp::CallbackGroup::SharedPtr estimator_callback_group_;
+  EstimatorCore::Input sensor_input_;            /**< Written only by the sensor callbacks */
+  SeqLock<EstimatorCore::Input> input_snapshot_; /**< Latest sensor_input_, for the estimator */
+  EstimatorCore::Input input_;                   /**< Input to the estimator, only used by update */
+  uint32_t last_gps_epoch_;                      /**< GPS epoch of the last estimator input */
 };
 
 } // namespace rosplane
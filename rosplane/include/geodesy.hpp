@@ -0,0 +1,94 @@
+/**
+ * @file geodesy.hpp
+ *
+ * Conversion from geodetic coordinates (latitude, longitude, altitude) to the local NED frame the
+ * autopilot works in, shared by the estimator and the path planner.
+ */
+
+#ifndef GEODESY_H
+#define GEODESY_H
+
+#include <array>
+#include <cstddef>
+
+namespace rosplane
+{
+
+/**
+ * Local north-east-down frame with its origin at a geodetic point on the WGS84 ellipsoid. All of
+ * the trigonometry of the origin is done once when the frame is built, so converting a point only
+ * takes a few multiplies in the default tangent plane mode.
+ */
+class LocalFrame
+{
+public:
+  enum class Mode
+  {
+    TANGENT_PLANE, /**< Flat earth around the origin, scaled by the radii of curvature there */
+    ECEF           /**< Exact, through earth-centered earth-fixed coordinates */
+  };
+
+  /**
+   * @brief Builds a frame at latitude, longitude and altitude zero.
+   */
+  LocalFrame();
+
+  /**
+   * @param lat: Latitude of the origin (deg)
+   * @param lon: Longitude of the origin (deg)
+   * @param alt: Altitude of the origin above the ellipsoid (m)
+   * @param mode: How points are converted. The tangent plane is within a meter of the exact
+   * conversion out to about 3 km from the origin, use ECEF for larger areas.
+   */
+  LocalFrame(double lat, double lon, double alt, Mode mode = Mode::TANGENT_PLANE);
+
+  /**
+   * @return True if the frame was built with the given origin and mode, so it does not need to be
+   * rebuilt.
+   */
+  bool has_origin(double lat, double lon, double alt, Mode mode = Mode::TANGENT_PLANE) const
+  {
+    return lat == lat0_ && lon == lon0_ && alt == alt0_ && mode == mode_;
+  }
+
+  /**
+   * @brief Converts a geodetic point to the local frame.
+   *
+   * @param lla: Latitude (deg), longitude (deg) and altitude (m) of the point
+   * @return North, east and down position of the point (m)
+   */
+  std::array<double, 3> lla_to_ned(const std::array<double, 3> & lla) const;
+
+  /**
+   * @brief Converts an array of geodetic points to the local frame. The mode is checked once for
+   * the whole array, and the tangent plane loop has no branches, so it can be vectorized.
+   *
+   * @param lla: Latitude (deg), longitude (deg) and altitude (m) of each point
+   * @param ned: Filled with the north, east and down position of each point (m). May be the same
+   * array as lla.
+   * @param count: Number of points
+   */
+  void lla_to_ned(const std::array<double, 3> * lla, std::array<double, 3> * ned,
+                  std::size_t count) const;
+
+private:
+  /**
+   * @return The earth-centered earth-fixed position of a geodetic point (m).
+   */
+  static std::array<double, 3> lla_to_ecef(double lat, double lon, double alt);
+
+  double lat0_; /**< Latitude of the origin (deg) */
+  double lon0_; /**< Longitude of the origin (deg) */
+  double alt0_; /**< Altitude of the origin (m) */
+  Mode mode_;
+
+  double north_scale_; /**< Meters north per degree of latitude at the origin */
+  double east_scale_;  /**< Meters east per degree of longitude at the origin */
+
+  std::array<double, 3> ecef0_;       /**< Earth-centered earth-fixed position of the origin (m) */
+  std::array<double, 9> ecef_to_ned_; /**< Row-major rotation from ECEF to NED at the origin */
+};
+
+} // namespace rosplane
+
+#endif // GEODESY_H
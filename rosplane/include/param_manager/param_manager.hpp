@@ -9,6 +9,12 @@
 #ifndef PARAM_MANAGER_H
 #define PARAM_MANAGER_H
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <variant>
 
 #include <rclcpp/rclcpp.hpp>
@@ -16,63 +22,209 @@
 namespace rosplane
 {
 
+/**
+ * Value of a parameter stored in a ParamManager object.
+ */
+using ParamValue = std::variant<double, bool, int64_t, std::string>;
+
+/**
+ * Parameter values read from a ROS2 parameter file, by parameter name. The values are kept as the
+ * text in the file, and converted to the declared type of the parameter when it is declared.
+ */
+using ParamOverrides = std::map<std::string, std::string>;
+
+/**
+ * Read-only handle to a parameter value stored in a ParamManager object. Reading through a handle
+ * does not perform a string lookup, so it is safe to use in high-rate loops. The handle stays valid
+ * for the lifetime of the ParamManager that created it, and always reflects the latest value set
+ * through the ROS2 parameter system.
+ */
+template<typename T>
+class ParamHandle
+{
+public:
+  /**
+   * Default constructor. A default constructed handle must be assigned before it is read.
+   */
+  ParamHandle() = default;
+
+  /**
+   * @return The current value of the parameter
+   */
+  const T & get() const { return *value_; }
+
+  /**
+   * Implicit conversion to the stored type, so a handle can be used in place of the value.
+   */
+  operator const T &() const { return *value_; }
+
+private:
+  friend class ParamManager;
+  explicit ParamHandle(const T * value)
+      : value_{value}
+  {}
+
+  const T * value_ = nullptr;
+};
+
+/**
+ * @brief Replaces the contents of a file, without ever leaving it partially written. The contents
+ * go to a temporary file that is synced to the disk and renamed over the original, and the
+ * directory is synced after the rename, so losing power leaves either the old or the new file.
+ *
+ * @param filepath: Path to the file to replace
+ * @param contents: New contents of the file
+ * @return True if the file was replaced and synced.
+ */
+bool replace_file(const std::string & filepath, const std::string & contents);
+
+/**
+ * Writes parameter values back to a YAML parameter file on a background thread, so the callers
+ * never wait on the file system. Values queued close together are coalesced into a single rewrite
+ * of the file, and each rewrite goes through replace_file, so the file is never left partially
+ * written.
+ */
+class ParamFileWriter
+{
+public:
+  /**
+   * @param filepath: Path to the parameter file
+   * @param node_key: Top level key of the node in the parameter file. Parameters are written under
+   *   node_key/ros__parameters.
+   * @param logger: Logger used to report errors from the background thread
+   */
+  ParamFileWriter(const std::string & filepath, const std::string & node_key,
+                  rclcpp::Logger logger);
+
+  /**
+   * Writes any values that are still queued before returning.
+   */
+  ~ParamFileWriter();
+
+  ParamFileWriter(const ParamFileWriter &) = delete;
+  ParamFileWriter & operator=(const ParamFileWriter &) = delete;
+
+  /**
+   * Queues a value to be written. If the parameter is already queued, only the newest value is
+   * written. Only parameters that are already in the file are updated.
+   */
+  void queue(const std::string & param_name, const ParamValue & value);
+
+private:
+  void run();
+  void write(const std::map<std::string, ParamValue> & values);
+
+  /**
+   * Time to wait after the first queued value for others to coalesce with it.
+   */
+  static constexpr std::chrono::milliseconds coalesce_period_{100};
+
+  std::string filepath_;
+  std::string node_key_;
+  rclcpp::Logger logger_;
+
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::map<std::string, ParamValue> pending_; /**< Values to write, guarded by mutex_ */
+  bool stop_ = false;                         /**< Set to stop the thread, guarded by mutex_ */
+  std::thread thread_;
+};
+
 class ParamManager
 {
 public:
   /**
    * Public constructor
    * 
-   * @param node: the ROS2 node that has this parameter object. Used to poll the ROS2 parameters
+   * @param node: the ROS2 node that has this parameter object. Used to poll the ROS2 parameters.
+   *   Without a node, the parameters only live in this object and are changed with the set
+   *   functions, which is how the algorithms are run outside of ROS (e.g. in benchmarks).
   */
-  ParamManager(rclcpp::Node * node);
+  ParamManager(rclcpp::Node * node = nullptr);
+
+  /**
+   * Copying is disabled, since handles point directly into the storage of this object.
+   */
+  ParamManager(const ParamManager &) = delete;
+  ParamManager & operator=(const ParamManager &) = delete;
+
+  /**
+   * Reads the parameters of every node in a ROS2 parameter file, i.e. the values under
+   * <node>/ros__parameters. A parameter given for more than one node takes the last value.
+   *
+   * @param filepath: Path to the parameter file
+   * @return The values in the file, empty if the file could not be read
+   */
+  static ParamOverrides load_overrides(const std::string & filepath);
+
+  /**
+   * Sets values that replace the defaults of the parameters declared after this call, the same
+   * way a launch file overrides the defaults of a node. Only used without a node, since a node
+   * gets its overrides from ROS2.
+   */
+  void set_overrides(ParamOverrides overrides) { overrides_ = std::move(overrides); }
 
   /**
    * Helper function to access parameter values of type double stored in param_manager object
    * @return Double value of the parameter
   */
-  double get_double(std::string param_name);
+  double get_double(const std::string & param_name);
 
   /**
    * Helper function to access parameter values of type bool stored in param_manager object
    * @return Bool value of the parameter
   */
-  bool get_bool(std::string param_name);
+  bool get_bool(const std::string & param_name);
 
   /**
    * Helper function to access parameter values of type integer stored in param_manager object
    * @return Integer value of the parameter
   */
-  int64_t get_int(std::string param_name);
+  int64_t get_int(const std::string & param_name);
 
   /**
    * Helper function to access parameter values of type string stored in param_manager object
    * @return String value of the parameter
   */
-  std::string get_string(std::string param_name);
+  std::string get_string(const std::string & param_name);
+
+  /**
+   * Helper functions to get a handle to a previously declared parameter. Used when the parameter
+   * was declared elsewhere (e.g. by a parent class) but is needed in a high-rate loop.
+   * @return Handle to the stored value of the parameter
+  */
+  ParamHandle<double> get_double_handle(const std::string & param_name);
+  ParamHandle<bool> get_bool_handle(const std::string & param_name);
+  ParamHandle<int64_t> get_int_handle(const std::string & param_name);
+  ParamHandle<std::string> get_string_handle(const std::string & param_name);
 
   /**
    * Helper function to declare parameters in the param_manager object
    * Inserts a parameter into the parameter object and declares it with the ROS system
+   * @return Handle to the stored value of the parameter
   */
-  void declare_double(std::string param_name, double value);
+  ParamHandle<double> declare_double(const std::string & param_name, double value);
 
   /**
    * Helper function to declare parameters in the param_manager object
    * Inserts a parameter into the parameter object and declares it with the ROS system
+   * @return Handle to the stored value of the parameter
   */
-  void declare_bool(std::string param_name, bool value);
+  ParamHandle<bool> declare_bool(const std::string & param_name, bool value);
 
   /**
    * Helper function to declare parameters in the param_manager object
    * Inserts a parameter into the parameter object and declares it with the ROS system
+   * @return Handle to the stored value of the parameter
   */
-  void declare_int(std::string param_name, int64_t value);
+  ParamHandle<int64_t> declare_int(const std::string & param_name, int64_t value);
 
   /**
    * Helper function to declare parameters in the param_manager object
    * Inserts a parameter into the parameter object and declares it with the ROS system
+   * @return Handle to the stored value of the parameter
   */
-  void declare_string(std::string param_name, std::string value);
+  ParamHandle<std::string> declare_string(const std::string & param_name, std::string value);
 
   /**
    * This sets the parameters with the values in the params_ object from the supplied parameter file, or sets them to
@@ -84,25 +236,25 @@ public:
    * This function sets a previously declared parameter to a new value in both the parameter object
    * and the ROS system.
    */
-  void set_double(std::string param_name, double value);
+  void set_double(const std::string & param_name, double value);
 
   /**
    * This function sets a previously declared parameter to a new value in both the parameter object
    * and the ROS system.
    */
-  void set_bool(std::string param_name, bool value);
+  void set_bool(const std::string & param_name, bool value);
 
   /**
    * This function sets a previously declared parameter to a new value in both the parameter object
    * and the ROS system.
    */
-  void set_int(std::string param_name, int64_t value);
+  void set_int(const std::string & param_name, int64_t value);
 
   /**
    * This function sets a previously declared parameter to a new value in both the parameter object
    * and the ROS system.
    */
-  void set_string(std::string param_name, std::string value);
+  void set_string(const std::string & param_name, std::string value);
 
   /**
    * This function should be called in the parametersCallback function in a containing ROS node.
@@ -113,12 +265,59 @@ public:
   */
   bool set_parameters_callback(const std::vector<rclcpp::Parameter> & parameters);
 
+  /**
+   * Sets the parameter file that the save functions write to, and starts the background writer.
+   *
+   * @param filepath: Path to the parameter file
+   * @param node_key: Top level key of the node in the parameter file
+  */
+  void set_save_file(const std::string & filepath, const std::string & node_key);
+
+  /**
+   * These functions save a value to the parameter file given to set_save_file, without changing
+   * the value used by the node. They return immediately, and the file is written in the background.
+   */
+  void save_double(const std::string & param_name, double value);
+  void save_bool(const std::string & param_name, bool value);
+  void save_int(const std::string & param_name, int64_t value);
+  void save_string(const std::string & param_name, const std::string & value);
+
 private:
   /**
-   * Data structure to hold all of the parameters
+   * Returns a pointer to the stored value of a parameter, or throws if the parameter has not been
+   * declared or has a different type.
+   */
+  template<typename T>
+  const T * get_value_ptr(const std::string & param_name);
+
+  /**
+   * Returns the override of a parameter converted to its declared type, or the default if there
+   * is no override or it can not be converted.
+   */
+  template<typename T>
+  T override_or_default(const std::string & param_name, const T & value);
+
+  /**
+   * Writes the value of a ROS parameter into the params_ object. The type of a stored parameter is
+   * never changed, since that would invalidate any handles to it.
+   * @return True if the parameter was stored, false if the types did not match
+   */
+  bool store_parameter(const rclcpp::Parameter & param);
+
+  /**
+   * Queues a value with the file writer, or reports an error if no save file was set.
+   */
+  void save_parameter(const std::string & param_name, const ParamValue & value);
+
+  /**
+   * Data structure to hold all of the parameters. Elements of a std::map are never moved, so
+   * handles can point directly at the stored values.
   */
-  std::map<std::string, std::variant<double, bool, int64_t, std::string>> params_;
+  std::map<std::string, ParamValue> params_;
   rclcpp::Node * container_node_;
+  rclcpp::Logger logger_;
+  ParamOverrides overrides_; /**< Values used in place of the declared defaults without a node */
+  std::unique_ptr<ParamFileWriter> file_writer_;
 };
 
 } // namespace rosplane
@@ -1,9 +1,16 @@
 #ifndef PATH_FOLLOWER_BASE_H
 #define PATH_FOLLOWER_BASE_H
 
+#include <functional>
+#include <memory>
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <rclcpp/rclcpp.hpp>
 
 #include "param_manager.hpp"
+#include "rosplane/latency_histogram.hpp"
+#include "rosplane/loop_timing_probe.hpp"
+#include "rosplane/path_follower_core.hpp"
 #include "rosplane_msgs/msg/controller_commands.hpp"
 #include "rosplane_msgs/msg/current_path.hpp"
 #include "rosplane_msgs/msg/state.hpp"
@@ -14,48 +21,43 @@ using std::placeholders::_1;
 namespace rosplane
 {
 
-enum class PathType
-{
-  ORBIT,
-  LINE
-};
-
+/**
+ * Path follower node. Feeds the path and state it subscribes to into a PathFollowerCore, and
+ * publishes the resulting commands to the controller.
+ */
 class PathFollowerBase : public rclcpp::Node
 {
 public:
-  PathFollowerBase();
+  /**
+   * Builds the path following algorithm the node runs, from the parameters, logger and clock of
+   * the node.
+   */
+  using CoreFactory = std::function<std::unique_ptr<PathFollowerCore>(const CoreContext &)>;
+
+  /**
+   * @param options: Options of the node
+   * @param make_follower: Builds the path following algorithm. It is called once the parameters of
+   * the node are declared.
+   */
+  PathFollowerBase(const rclcpp::NodeOptions & options, const CoreFactory & make_follower);
   float spin();
 
 protected:
-  struct Input
-  {
-    PathType p_type;
-    float va_d;
-    float r_path[3];
-    float q_path[3];
-    float c_orbit[3];
-    float rho_orbit;
-    int lam_orbit;
-    float pn;  /** position north */
-    float pe;  /** position east */
-    float h;   /** altitude */
-    float va;  /** airspeed */
-    float chi; /** course angle */
-    float psi; /** heading angle */
-  };
-
-  struct Output
-  {
-    double va_c;   /** commanded airspeed (m/s) */
-    double h_c;    /** commanded altitude (m) */
-    double chi_c;  /** commanded course (rad) */
-    double phi_ff; /** feed forward term for orbits (rad) */
-  };
-
-  virtual void follow(const Input & input, Output & output) = 0;
-
   ParamManager params_;
 
+  /**
+   * The path following algorithm. It is declared after params_, so it is destroyed before the
+   * parameters its handles point into.
+   */
+  std::unique_ptr<PathFollowerCore> follower_;
+
+  /**
+   * Handles to the parameters declared by this class.
+   */
+  ParamHandle<double> controller_commands_pub_frequency_;
+  ParamHandle<bool> state_triggered_follow_;
+  ParamHandle<double> state_timeout_;
+
 private:
   /**
    * Subscribes to state from the estimator
@@ -72,16 +74,27 @@ private:
    */
   rclcpp::Publisher<rosplane_msgs::msg::ControllerCommands>::SharedPtr controller_commands_pub_;
 
+  /**
+   * Publishes the latency diagnostics
+   */
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+
   std::chrono::microseconds timer_period_;
   rclcpp::TimerBase::SharedPtr update_timer_;
 
   bool params_initialized_;
   bool state_init_;
   bool current_path_init_;
+  rclcpp::Time last_state_time_;              /**< Time the last state was received */
+  rclcpp::Time last_state_stamp_;             /**< Header stamp of the last state */
+  builtin_interfaces::msg::Time state_origin_; /**< Origin stamp of the last state */
+  LatencyHistogram imu_to_command_latency_;    /**< Latency from the IMU sample to the commands */
+  LoopTimingProbe follow_timing_;              /**< Timing of the calls to follow */
 
   OnSetParametersCallbackHandle::SharedPtr parameter_callback_handle_;
   rosplane_msgs::msg::ControllerCommands controller_commands_;
-  Input input_;
+  PathFollowerCore::Input input_;
 
   /**
    * @brief Sets the timer with the timer period as specified by the ROS2 parameters
@@ -99,10 +112,29 @@ private:
   void current_path_callback(const rosplane_msgs::msg::CurrentPath::SharedPtr msg);
 
   /**
-   * @brief Calculates and publishes the commands messages
+   * @brief Calculates and publishes the commands messages. The caller ticks the loop timing, so
+   * only the timer or the state counts as the period of the loop.
    */
   void update();
 
+  /**
+   * @brief Runs update at the rate set by controller_commands_pub_frequency. When the follower is
+   * triggered by the state and path instead, this only checks that the state has not gone stale.
+   */
+  void timer_callback();
+
+  /**
+   * @brief Checks whether the last state is older than the staleness timeout
+   *
+   * @return True if no state has arrived within state_timeout, which also warns.
+   */
+  bool state_is_stale();
+
+  /**
+   * @brief Publishes the latency and loop timing diagnostics over the time since the last call
+   */
+  void diagnostics_publish();
+
   /**
    * @brief Callback for when ROS2 parameters change.
    * 
@@ -6,13 +6,13 @@
 namespace rosplane
 {
 
+/**
+ * Path follower node that runs the follower in path_follower_example_core.hpp.
+ */
 class PathFollowerExample : public PathFollowerBase
 {
 public:
-  PathFollowerExample();
-
-private:
-  virtual void follow(const Input & input, Output & output);
+  explicit PathFollowerExample(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
 };
 
 } // namespace rosplane
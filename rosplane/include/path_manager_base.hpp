@@ -2,6 +2,7 @@
  * @file path_manager_base.hpp
  *
  * Base class definition for autopilot path follower in chapter 10 of UAVbook, see http://uavbook.byu.edu/doku.php
+ * Implements ROS2 functionality and runs a path manager from path_manager_core.hpp.
  *
  * @author Gary Ellingson <gary.ellingson@byu.edu>
  * adapted by Judd Mehr and Brian Russel for ROSplane software
@@ -10,13 +11,23 @@
 #ifndef PATH_MANAGER_BASE_H
 #define PATH_MANAGER_BASE_H
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <sensor_msgs/msg/fluid_pressure.hpp>
+#include <std_srvs/srv/trigger.hpp>
 
 #include "param_manager.hpp"
+#include "rosplane/latency_histogram.hpp"
+#include "rosplane/loop_timing_probe.hpp"
+#include "rosplane/path_manager_core.hpp"
 #include "rosplane_msgs/msg/current_path.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 #include "rosplane_msgs/msg/waypoint.hpp"
+#include "rosplane_msgs/msg/waypoint_array.hpp"
 
 using std::placeholders::_1;
 using namespace std::chrono_literals;
@@ -26,74 +37,89 @@ namespace rosplane
 class PathManagerBase : public rclcpp::Node
 {
 public:
-  PathManagerBase();
+  /**
+   * Builds the path manager the node runs, from the parameters, logger and clock of the node.
+   */
+  using CoreFactory = std::function<std::unique_ptr<PathManagerCore>(const CoreContext &)>;
 
-protected:
-  struct Waypoint
-  {
-    float w[3];
-    float chi_d;
-    bool use_chi;
-    float va_d;
-  };
-
-  std::vector<Waypoint> waypoints_; /** Vector of waypoints maintained by path_manager */
-  int num_waypoints_;
-  int idx_a_; /** index to the waypoint that was most recently achieved */
-
-  bool temp_waypoint_ = false;
-  int orbit_dir_ = 0;
-
-  struct Input
-  {
-    float pn;  /** position north */
-    float pe;  /** position east */
-    float h;   /** altitude */
-    float chi; /** course angle */
-  };
-
-  struct Output
-  {
-    bool flag;    /** Inicates strait line or orbital path (true is line, false is orbit) */
-    float va_d;   /** Desired airspeed (m/s) */
-    float r[3];   /** Vector to origin of straight line path (m) */
-    float q[3];   /** Unit vector, desired direction of travel for line path */
-    float c[3];   /** Center of orbital path (m) */
-    float rho;    /** Radius of orbital path (m) */
-    int8_t lamda; /** Direction of orbital path (cw is 1, ccw is -1) */
-  };
+  /**
+   * @param options: Options of the node
+   * @param make_manager: Builds the path manager. It is called once the parameters of the node are
+   * declared.
+   */
+  PathManagerBase(const rclcpp::NodeOptions & options, const CoreFactory & make_manager);
 
+protected:
   ParamManager params_; /** Holds the parameters for the path_manager and children */
 
   /**
-   * @brief Manages the current path based on the stored waypoint list
-   * 
-   * @param input: Input object that contains information about the waypoint
-   * @param output: Output object that contains the parameters for the desired type of line, based on the current and next waypoints
+   * The path manager. It is declared after params_, so it is destroyed before the parameters its
+   * handles point into.
+   */
+  std::unique_ptr<PathManagerCore> manager_;
+
+  /**
+   * Handles to the parameters declared by this class.
    */
-  virtual void manage(const Input & input, Output & output) = 0;
+  ParamHandle<double> current_path_pub_frequency_;
+  ParamHandle<int64_t> waypoint_window_size_;
 
 private:
   rclcpp::Subscription<rosplane_msgs::msg::State>::SharedPtr
     vehicle_state_sub_; /**< vehicle state subscription */
   rclcpp::Subscription<rosplane_msgs::msg::Waypoint>::SharedPtr
     new_waypoint_sub_; /**< new waypoint subscription */
+  rclcpp::Subscription<rosplane_msgs::msg::WaypointArray>::SharedPtr
+    new_waypoint_array_sub_; /**< new waypoint batch subscription */
+  rclcpp::Client<std_srvs::srv::Trigger>::SharedPtr
+    next_waypoint_client_; /**< requests the next waypoint from the path_planner */
   rclcpp::Publisher<rosplane_msgs::msg::CurrentPath>::SharedPtr
     current_path_pub_; /**< controller commands publication */
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr
+    diagnostics_pub_; /**< latency diagnostics publication */
 
   rosplane_msgs::msg::State vehicle_state_; /**< vehicle state */
 
   bool params_initialized_;
   bool state_init_;
+  bool waypoint_request_pending_ = false; /**< A request for the next waypoint is in flight */
+  /** When to ask again after the path_planner had no waypoint left to publish */
+  std::chrono::steady_clock::time_point next_waypoint_retry_;
   std::chrono::microseconds timer_period_;
   rclcpp::TimerBase::SharedPtr update_timer_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+  LatencyHistogram imu_to_path_latency_; /**< Latency from the IMU sample to the current path */
+  LoopTimingProbe manage_timing_;        /**< Timing of the calls to manage */
   OnSetParametersCallbackHandle::SharedPtr parameter_callback_handle_;
 
   void vehicle_state_callback(const rosplane_msgs::msg::State &
                                 msg); /** subscribes to the estimated state from the estimator */
   void new_waypoint_callback(const rosplane_msgs::msg::Waypoint &
                                msg); /** subscribes to waypoint messages from the path_planner */
+  void new_waypoint_array_callback(
+    const rosplane_msgs::msg::WaypointArray & msg); /** subscribes to batches of waypoints */
   void current_path_publish();       /** Publishes the current path to the path follower */
+  void diagnostics_publish();        /** Publishes the latency and loop timing diagnostics */
+
+  /**
+   * @brief When waypoint_window_size is set, drops the waypoints before the current leg and asks
+   * the path_planner for the next waypoint until the window is full, so the list stays bounded
+   * however long the mission is
+   */
+  void stream_waypoints();
+
+  /**
+   * @brief Hands waypoint messages to the manager in order. The waypoints between messages with
+   * clear_wp_list set are added as one batch, and each of those messages clears the list.
+   *
+   * @param msgs: The waypoint messages
+   */
+  void add_waypoints(const std::vector<rosplane_msgs::msg::Waypoint> & msgs);
+
+  /**
+   * @return The state of the aircraft, as the path manager takes it.
+   */
+  PathManagerCore::Input state_input() const;
 
   /**
    * @brief Callback that gets triggered when a ROS2 parameter is changed
@@ -3,12 +3,13 @@
 #include <rosflight_msgs/srv/param_file.hpp>
 #include <std_srvs/srv/trigger.hpp>
 
+#include "geodesy.hpp"
 #include "param_manager.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 #include "rosplane_msgs/msg/waypoint.hpp"
+#include "rosplane_msgs/msg/waypoint_array.hpp"
 #include "rosplane_msgs/srv/add_waypoint.hpp"
-
-#define EARTH_RADIUS 6378145.0f
+#include "rosplane_msgs/srv/add_waypoints.hpp"
 
 namespace rosplane
 {
@@ -16,16 +17,17 @@ namespace rosplane
 class PathPlanner : public rclcpp::Node
 {
 public:
-  PathPlanner();
+  explicit PathPlanner(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~PathPlanner();
 
   ParamManager params_; /** Holds the parameters for the path_planner*/
 
 private:
   /**
-   * Publishes waypoint objects
+   * Publishes batches of waypoint objects. Single waypoints and clear commands are published as
+   * batches of one, so everything reaches the path manager in order on one topic.
    */
-  rclcpp::Publisher<rosplane_msgs::msg::Waypoint>::SharedPtr waypoint_publisher_;
+  rclcpp::Publisher<rosplane_msgs::msg::WaypointArray>::SharedPtr waypoint_publisher_;
 
   /**
    * Subscribes to Vehicle state
@@ -52,6 +54,11 @@ private:
    */
   rclcpp::Service<rosplane_msgs::srv::AddWaypoint>::SharedPtr add_waypoint_service_;
 
+  /**
+   * Service handle that adds a batch of waypoints to the waypoint list
+   */
+  rclcpp::Service<rosplane_msgs::srv::AddWaypoints>::SharedPtr add_waypoints_service_;
+
   /**
    * Service handle that loads a list of waypoints (i.e., a mission) from a file
    */
@@ -79,6 +86,17 @@ private:
   bool update_path(const rosplane_msgs::srv::AddWaypoint::Request::SharedPtr & req,
                    const rosplane_msgs::srv::AddWaypoint::Response::SharedPtr & res);
 
+  /**
+   * @brief "add_waypoints" service callback. Adds a batch of waypoints to the end of the vector of waypoint objects and optionally publishes them all in one message.
+   * 
+   * @param req: Pointer to an AddWaypoints service request object
+   * @param req: Pointer to an AddWaypoints service response object
+   * 
+   * @return True
+   */
+  bool add_waypoints(const rosplane_msgs::srv::AddWaypoints::Request::SharedPtr & req,
+                     const rosplane_msgs::srv::AddWaypoints::Response::SharedPtr & res);
+
   /**
    * @brief "clear_path" service callback. Clears all the waypoints internally and sends clear commands to path_manager
    * 
@@ -134,6 +152,13 @@ private:
    */
   void waypoint_publish();
 
+  /**
+   * @brief Publishes the next waypoints in the vector of waypoints in one message
+   * 
+   * @param count: Number of waypoints to publish, limited to the waypoints not yet published
+   */
+  void waypoints_publish(int count);
+
   /**
    * @brief Publishes the number of initial waypoints given by parameter
    */
@@ -147,6 +172,24 @@ private:
    */
   std::array<double, 3> lla2ned(std::array<float, 3> lla);
 
+  /**
+   * @brief Converts the LLA coordinates of some of a list of waypoints to NED coordinates, in one
+   * pass over the batch
+   * 
+   * @param waypoints: List of waypoints, converted in place
+   * @param indices: Indices of the waypoints in the list that are given in LLA
+   */
+  void lla2ned(std::vector<rosplane_msgs::msg::Waypoint> & waypoints,
+               const std::vector<std::size_t> & indices);
+
+  /**
+   * @brief Converts LLA coordinates to NED coordinates in place
+   * 
+   * @param points: Array of [latitude, longitude, altitude], replaced with [north, east, down]
+   * @param count: Number of points in the array
+   */
+  void lla2ned(std::array<double, 3> * points, std::size_t count);
+
   /**
    * @brief This declares each parameter as a parameter so that the ROS2 parameter system can recognize each parameter. It also sets the default parameter, which will then be overridden by a launch script.
    */
@@ -166,6 +209,11 @@ private:
   double initial_lon_;
   double initial_alt_;
 
+  /**
+   * Local frame at the initial GNSS coordinates, rebuilt when they or exact_geodesy change
+   */
+  LocalFrame local_frame_;
+
   /**
    * Vector of waypoints
    */
@@ -0,0 +1,68 @@
+/**
+ * @file realtime_profile.hpp
+ *
+ * Opt-in real-time execution profile for the autopilot processes: scheduling priority, CPU
+ * affinity, memory locking and a pre-faulted stack and heap.
+ */
+
+#ifndef REALTIME_PROFILE_H
+#define REALTIME_PROFILE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include "param_manager.hpp"
+
+namespace rosplane
+{
+
+/**
+ * Settings for running a node's executor thread in real time. The defaults leave the process as
+ * it is started.
+ */
+struct RealtimeProfile
+{
+  int64_t priority = 0;            /**< SCHED_FIFO priority (1-99), 0 keeps the default policy */
+  std::vector<int> cpus;           /**< CPUs to pin the executor thread to, empty for any CPU */
+  bool lock_memory = false;        /**< Lock current and future pages of the process in RAM */
+  int64_t prefault_stack_size = 0; /**< Bytes of the executor thread's stack to fault in */
+  int64_t prefault_heap_size = 0;  /**< Bytes of heap to fault in and keep mapped */
+};
+
+/**
+ * @brief Declares the parameters of the real-time profile.
+ *
+ * The parameters are rt_priority, rt_cpu_affinity (a comma separated list of CPUs), rt_lock_memory,
+ * rt_prefault_stack_size and rt_prefault_heap_size. They are only read at startup.
+ *
+ * @param params: The parameter manager of the node
+ */
+void declare_realtime_parameters(ParamManager & params);
+
+/**
+ * @brief Reads the real-time profile from the parameters declared by declare_realtime_parameters.
+ *
+ * @param node: The node the parameters were declared on
+ * @return The profile. CPUs in rt_cpu_affinity that can't be parsed are skipped with a warning.
+ */
+RealtimeProfile realtime_profile_from_parameters(rclcpp::Node & node);
+
+/**
+ * @brief Applies a real-time profile to the process and the calling thread.
+ *
+ * This must be called from the thread that will spin the executor, before it starts spinning.
+ * Threads created afterwards by a multithreaded executor inherit the priority and affinity. Each
+ * setting that fails, for example for lack of CAP_SYS_NICE or a low RLIMIT_MEMLOCK, is logged and
+ * skipped, so the node can still run without the profile.
+ *
+ * @param profile: The profile to apply
+ * @param logger: Logger for the result of each setting
+ * @return True if every requested setting was applied.
+ */
+bool apply_realtime_profile(const RealtimeProfile & profile, const rclcpp::Logger & logger);
+
+} // namespace rosplane
+
+#endif // REALTIME_PROFILE_H
@@ -0,0 +1,86 @@
+/**
+ * @file algorithm_core.hpp
+ *
+ * Common base of the estimation, control, path following and path management algorithms. The
+ * algorithms only depend on their parameters, a logger and a clock, so they can be run inside the
+ * ROS2 nodes or on their own (e.g. in benchmarks and simulations), without a node or an executor.
+ */
+
+#ifndef ALGORITHM_CORE_H
+#define ALGORITHM_CORE_H
+
+#include <memory>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include "param_manager.hpp"
+
+namespace rosplane
+{
+
+/**
+ * What an algorithm is built with. The ROS2 nodes pass in their own parameters, logger and clock,
+ * so the parameters of the algorithm are visible to the ROS2 parameter system. Outside of ROS the
+ * parameters are given by a ParamManager without a node, and the logger and clock default to a
+ * named logger and the steady clock.
+ */
+struct CoreContext
+{
+  ParamManager & params;
+  rclcpp::Logger logger = rclcpp::get_logger("rosplane");
+  rclcpp::Clock::SharedPtr clock = std::make_shared<rclcpp::Clock>(RCL_STEADY_TIME);
+};
+
+/**
+ * Holds what every algorithm is built with, and gives the algorithms get_logger and get_clock, so
+ * they log the same way the nodes do.
+ */
+class AlgorithmCore
+{
+public:
+  explicit AlgorithmCore(const CoreContext & context)
+      : params_(context.params)
+      , logger_(context.logger)
+      , clock_(context.clock)
+  {}
+
+  virtual ~AlgorithmCore() = default;
+
+  /**
+   * Copying is disabled, since the parameter handles of an algorithm point into its ParamManager.
+   */
+  AlgorithmCore(const AlgorithmCore &) = delete;
+  AlgorithmCore & operator=(const AlgorithmCore &) = delete;
+
+  /**
+   * Rebuilds the gain snapshots of the algorithm from the parameters. The nodes call this after
+   * every successful parameter change, from the parameter callback rather than the algorithm's
+   * loop. Outside of ROS, call it after changing parameters with the set functions of the
+   * ParamManager.
+   */
+  virtual void update_gains() {}
+
+  /**
+   * @return The logger the algorithm reports through.
+   */
+  const rclcpp::Logger & get_logger() const { return logger_; }
+
+  /**
+   * @return The clock the throttled log messages of the algorithm are timed with.
+   */
+  rclcpp::Clock::SharedPtr get_clock() const { return clock_; }
+
+protected:
+  /**
+   * Parameters of the algorithm, owned by the node or whatever else runs the algorithm.
+   */
+  ParamManager & params_;
+
+private:
+  rclcpp::Logger logger_;
+  rclcpp::Clock::SharedPtr clock_;
+};
+
+} // namespace rosplane
+
+#endif // ALGORITHM_CORE_H
@@ -0,0 +1,99 @@
+/**
+ * @file controller_core.hpp
+ *
+ * Base class definition for the control algorithm of the autopilot in chapter 6 of UAVbook, see
+ * http://uavbook.byu.edu/doku.php. The algorithm does not depend on a ROS2 node, the node that
+ * runs it is in controller_base.hpp.
+ */
+
+#ifndef CONTROLLER_CORE_H
+#define CONTROLLER_CORE_H
+
+#include "rosplane/algorithm_core.hpp"
+
+namespace rosplane
+{
+/**
+ * This defines the different portions of the control algorithm.
+ */
+enum class AltZones
+{
+  TAKE_OFF, /**< In the take off zone where the aircraft gains speed and altitude */
+  CLIMB, /**< In the climb zone the aircraft proceeds to commanded altitude without course change. */
+  ALTITUDE_HOLD /**< In the altitude hold zone the aircraft keeps altitude and follows commanded course */
+};
+
+/**
+ * This class defines the interface of a control algorithm, and the scaling of its control efforts.
+ */
+class ControllerCore : public AlgorithmCore
+{
+public:
+  /**
+   * This struct holds all of the inputs to the control algorithm.
+   */
+  struct Input
+  {
+    float Ts;            /**< time step */
+    float h;             /**< altitude */
+    float va;            /**< airspeed */
+    float phi;           /**< roll angle */
+    float theta;         /**< pitch angle */
+    float chi;           /**< course angle */
+    float p;             /**< body frame roll rate */
+    float q;             /**< body frame pitch rate */
+    float r;             /**< body frame yaw rate */
+    float va_c;          /**< commanded airspeed (m/s) */
+    float h_c;           /**< commanded altitude (m) */
+    float chi_c;         /**< commanded course (rad) */
+    float phi_ff;        /**< feed forward term for orbits (rad) */
+    float phi_c;         /**< commanded roll angle, used when the roll is overridden (rad) */
+    float theta_c;       /**< commanded pitch angle, used when the pitch is overridden (rad) */
+    bool roll_override;  /**< use the commanded roll angle phi_c */
+    bool pitch_override; /**< use the commanded pitch angle theta_c */
+  };
+
+  /**
+   * This struct holds all of the outputs of the control algorithm.
+   */
+  struct Output
+  {
+    float theta_c;         /**< The commanded pitch angle from the altitude control loop */
+    float phi_c;           /**< The commanded roll angle from the course control loop */
+    float delta_e;         /**< The commanded elevator deflection */
+    float delta_a;         /**< The commanded aileron deflection */
+    float delta_r;         /**< The commanded rudder deflection */
+    float delta_t;         /**< The commanded throttle deflection */
+    AltZones current_zone; /**< The current altitude zone for the control */
+  };
+
+  /**
+   * Declares the scaling of the control efforts.
+   */
+  explicit ControllerCore(const CoreContext & context);
+
+  /**
+   * Interface for control algorithm.
+   * @param input Inputs to the control algorithm.
+   * @param output Outputs of the controller, including selected intermediate values and final control efforts.
+   */
+  virtual void control(const Input & input, Output & output) = 0;
+
+  /**
+   * Convert from deflection angle in radians to pwm.
+   */
+  void convert_to_pwm(Output & output);
+
+protected:
+  /**
+   * Handles to the parameters declared by this class, so that the controller and its children can
+   * read them without a lookup.
+   */
+  ParamHandle<double> pwm_rad_e_;
+  ParamHandle<double> pwm_rad_a_;
+  ParamHandle<double> pwm_rad_r_;
+};
+
+} // namespace rosplane
+
+#endif // CONTROLLER_CORE_H
@@ -1,16 +1,16 @@
-#ifndef BUILD_CONTROLLER_STATE_MACHINE_H
-#define BUILD_CONTROLLER_STATE_MACHINE_H
+#ifndef BUILD_CONTROLLER_STATE_MACHINE_CORE_H
+#define BUILD_CONTROLLER_STATE_MACHINE_CORE_H
 
-#include "controller_base.hpp"
+#include "rosplane/controller_core.hpp"
 
 namespace rosplane
 {
 
-class ControllerStateMachine : public ControllerBase
+class ControllerStateMachineCore : public ControllerCore
 {
 
 public:
-  ControllerStateMachine();
+  explicit ControllerStateMachineCore(const CoreContext & context);
 
   /**
  * The state machine for the control algorithm for the autopilot.
@@ -64,6 +64,12 @@ protected:
    */
   virtual void altitude_hold_exit() = 0;
 
+  /**
+   * Handles to the altitude zone parameters declared by this class.
+   */
+  ParamHandle<double> alt_toz_;
+  ParamHandle<double> alt_hz_;
+
 private:
   /**
    * Declares the parameters associated to this controller, controller_state_machine, so that ROS2 can see them.
@@ -74,4 +80,4 @@ private:
 
 } // namespace rosplane
 
-#endif //BUILD_CONTROLLER_STATE_MACHINE_H
+#endif //BUILD_CONTROLLER_STATE_MACHINE_CORE_H
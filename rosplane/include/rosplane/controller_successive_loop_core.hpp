@@ -0,0 +1,393 @@
+#ifndef CONTROLLER_EXAMPLE_CORE_H
+#define CONTROLLER_EXAMPLE_CORE_H
+
+#include "rosplane/controller_state_machine_core.hpp"
+#include "rosplane/seqlock.hpp"
+
+namespace rosplane
+{
+
+class ControllerSucessiveLoopCore : public ControllerStateMachineCore
+{
+public:
+  /**
+   * Constructor to declare the parameters and build the first set of gains.
+   */
+  explicit ControllerSucessiveLoopCore(const CoreContext & context);
+
+  /**
+   * Takes the snapshot of the gains for this tick, then runs the state machine.
+   * @param input Inputs to the control algorithm.
+   * @param output Outputs of the controller, including selected intermediate values and final control efforts.
+   */
+  virtual void control(const Input & input, Output & output);
+
+  /**
+   * Rebuilds the gains from the parameters and publishes them to the control loop.
+   */
+  virtual void update_gains();
+
+protected:
+  /**
+   * Gains and limits of the course hold loop.
+   */
+  struct CourseGains
+  {
+    double kp;       /**< Proportional gain */
+    double ki;       /**< Integral gain */
+    double kd;       /**< Derivative gain, on the yaw rate */
+    double max_roll; /**< Largest commanded roll angle (deg) */
+  };
+
+  /**
+   * Gains and limits of the roll hold loop.
+   */
+  struct RollGains
+  {
+    double kp;        /**< Proportional gain */
+    double ki;        /**< Integral gain */
+    double kd;        /**< Derivative gain, on the roll rate */
+    double max_a;     /**< Largest aileron deflection (rad) */
+    double trim_a;    /**< Aileron trim */
+    double pwm_rad_a; /**< Aileron scaling, declared in controller_core */
+  };
+
+  /**
+   * Gains and limits of the pitch hold loop.
+   */
+  struct PitchGains
+  {
+    double kp;        /**< Proportional gain */
+    double ki;        /**< Integral gain */
+    double kd;        /**< Derivative gain, on the pitch rate */
+    double max_e;     /**< Largest elevator deflection (rad) */
+    double trim_e;    /**< Elevator trim */
+    double pwm_rad_e; /**< Elevator scaling, declared in controller_core */
+  };
+
+  /**
+   * Gains and limits of the airspeed with throttle hold loop.
+   */
+  struct AirspeedGains
+  {
+    double kp;     /**< Proportional gain */
+    double ki;     /**< Integral gain */
+    double kd;     /**< Derivative gain */
+    double tau;    /**< Time constant of the dirty derivative */
+    double max_t;  /**< Largest throttle */
+    double trim_t; /**< Throttle trim */
+  };
+
+  /**
+   * Gains and limits of the altitude hold loop.
+   */
+  struct AltitudeGains
+  {
+    double kp;        /**< Proportional gain */
+    double ki;        /**< Integral gain */
+    double kd;        /**< Derivative gain */
+    double tau;       /**< Time constant of the dirty derivative */
+    double max_pitch; /**< Largest commanded pitch angle (deg) */
+    double alt_hz;    /**< Altitude hold zone, declared in controller_state_machine */
+  };
+
+  /**
+   * Gains and limits of the yaw damper.
+   */
+  struct YawDamperGains
+  {
+    double pwo;   /**< Pole of the washout filter */
+    double kr;    /**< Yaw rate gain */
+    double max_r; /**< Largest rudder deflection (rad) */
+  };
+
+  /**
+   * One coherent set of the gains of every loop of the controller. A complete set is rebuilt when
+   * the parameters change, and the control loops read from a copy taken at the start of each tick,
+   * so a tick never runs with some gains from before a change and some from after.
+   */
+  struct Gains
+  {
+    CourseGains course;
+    RollGains roll;
+    PitchGains pitch;
+    AirspeedGains airspeed;
+    AltitudeGains altitude;
+    YawDamperGains yaw_damper;
+    double max_takeoff_throttle; /**< Largest throttle in the take-off zone */
+    double cmd_takeoff_pitch;    /**< Commanded pitch angle in the take-off zone (deg) */
+    bool roll_command_override;  /**< Hold the commanded roll angle instead of the course */
+    bool pitch_command_override; /**< Hold the commanded pitch angle instead of the altitude */
+  };
+
+  /**
+   * This function continually loops while the aircraft is in the take-off zone. The lateral and longitudinal control
+   * for the take-off zone is called in this function.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void take_off(const Input & input, Output & output);
+
+  /**
+   * This function continually loops while the aircraft is in the climb zone. The lateral and longitudinal control
+   * for the climb zone is called in this function.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void climb(const Input & input, Output & output);
+
+  /**
+   * This function continually loops while the aircraft is in the altitude hold zone. The lateral and longitudinal 
+   * control for the altitude hold zone is called in this function.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void altitude_hold(const Input & input, Output & output);
+
+  /**
+   * This function runs when the aircraft exits the take-off zone. Any changes to the controller that need to happen
+   * only once as the aircraft exits take-off mode should be placed here. This sets differentiators and integrators to 0.
+   */
+  virtual void take_off_exit();
+
+  /**
+   * This function runs when the aircraft exits the climb zone. Any changes to the controller that need to happen
+   * only once as the aircraft exits climb mode should be placed here. This sets differentiators and integrators to 0.
+   */
+  virtual void climb_exit();
+
+  /**
+   * This function runs when the aircraft exits the altitude hold zone (usually a crash). Any changes to the controller that 
+   * need to happen only once as the aircraft exits altitude mode should be placed here. This sets differentiators and
+   * integrators to 0.
+   */
+  virtual void altitude_hold_exit();
+
+  /**
+   * This function runs the lateral control loops for the altitude hold zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void alt_hold_lateral_control(const Input & input, Output & output);
+
+  /**
+   * This function runs the longitudinal control loops for the altitude hold zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void alt_hold_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * This function runs the lateral control loops for the climb zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void climb_lateral_control(const Input & input, Output & output);
+
+  /**
+   * This function runs the longitudinal control loops for the climb zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void climb_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * This function runs the lateral control loops for the take-off zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void take_off_lateral_control(const Input & input, Output & output);
+
+  /**
+   * This function runs the longitudinal control loops for the take-off zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void take_off_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * The control loop for moving to and holding a commanded course.
+   * @param chi_c The commanded course angle.
+   * @param chi The current course angle.
+   * @param phi_ff The roll angle feedforward term. This allows for faster convergence.   // TODO add reference to book?
+   * @param r The yaw rate taken from the gyro.
+   * @param Ts The sampling period in seconds.
+   * @return The commanded roll angle, to achieve the course angle.
+   */
+  float course_hold(float chi_c, float chi, float phi_ff, float r, float Ts);
+
+  /**
+   * The difference between the commanded course angle and the current course angle.
+   */
+  float c_error_;
+
+  /**
+   * The integral of the error in course angle.
+   */
+  float c_integrator_;
+
+  /**
+   * The control loop for moving to and holding a commanded roll angle.
+   * @param phi_c The commanded roll angle.
+   * @param phi The current roll angle.
+   * @param p The roll rate taken from the gyro.
+   * @param Ts The sampling period in seconds.
+   * @return The aileron deflection in radians required to achieve the commanded roll angle.
+   */
+  float roll_hold(float phi_c, float phi, float p, float Ts);
+
+  /**
+   * The difference between the commanded roll angle and the current roll angle.
+   */
+  float r_error_;
+
+  /**
+   * The integral of the error in roll angle.
+   */
+  float r_integrator;
+
+  /**
+   * The control loop for moving to and holding a commanded pitch angle.
+   * @param theta_c The commanded pitch angle.
+   * @param theta The current pitch angle.
+   * @param q The pitch rate taken from the gyro.
+   * @param Ts The sampling period in seconds.
+   * @return The elevator deflection in radians required to achieve the commanded pitch.
+   */
+  float pitch_hold(float theta_c, float theta, float q, float Ts);
+
+  /**
+   * The difference between the commanded pitch angle and the current pitch angle.
+   */
+  float p_error_;
+
+  /**
+   * The integral of the error in pitch angle.
+   */
+  float p_integrator_;
+
+  /**
+   * The control loop that calculates the required throttle level to move to and maintain a commanded airspeed.
+   * @param va_c The commanded airspeed.
+   * @param va The current airspeed.
+   * @param Ts The sampling period in seconds.
+   * @return The required throttle between 0 (no throttle) and 1 (full throttle).
+   */
+  float airspeed_with_throttle_hold(float va_c, float va, float Ts);
+
+  /**
+   * The difference between the commanded airspeed and the current airspeed.
+   */
+  float at_error_;
+
+  /**
+   * The integral of the error in airspeed.
+   */
+  float at_integrator_;
+
+  /**
+   * The derivative of the error in airspeed.
+   */
+  float at_differentiator_;
+
+  /**
+   * The control loop that calculates the required pitch angle to command to maintain a commanded altitude.
+   * @param h_c The commanded altitude.
+   * @param h The current altitude.
+   * @param Ts The sampling period in seconds.
+   * @return The commanded pitch angle to maintain and achieve the commanded altitude.
+   */
+  float altitude_hold_control(float h_c, float h, float Ts);
+
+  /**
+   * The difference between the commanded altitude and the current altitude.
+   */
+  float a_error_;
+
+  /**
+   * The integral of the error in altitude.
+   */
+  float a_integrator_;
+
+  /**
+   * The derivative of the error in altitude.
+   */
+  float a_differentiator_;
+
+  //    float cooridinated_turn_hold(float v, const struct params_s &params, float Ts); // TODO implement if you want...
+  //    float ct_error_;
+  //    float ct_integrator_;
+  //    float ct_differentiator_;
+  float yaw_damper(float r, float Ts);
+
+  float delta_r_delay_;
+  float r_delay_;
+
+  /**
+ * Saturate a given value to a maximum or minimum of the limits.
+ * @param value The value to saturate.
+ * @param up_limit The maximum the value can take on.
+ * @param low_limit The minimum the value can take on.
+ * @return The saturated value.
+ */
+
+  float sat(float value, float up_limit, float low_limit);
+
+  float adjust_h_c(float h_c, float h, float max_diff);
+
+  /**
+   * The gains the control loops use in this tick, copied from gains_snapshot_ at its start.
+   */
+  Gains gains_;
+
+  /**
+   * The latest gains, stored by update_gains and loaded by control.
+   */
+  SeqLock<Gains> gains_snapshot_;
+
+  /**
+   * Handles to the parameters declared by this class. update_gains reads the gains through these,
+   * and the control loops read them from gains_.
+   */
+  ParamHandle<bool> roll_command_override_;
+  ParamHandle<bool> pitch_command_override_;
+  ParamHandle<double> max_takeoff_throttle_;
+  ParamHandle<double> c_kp_;
+  ParamHandle<double> c_ki_;
+  ParamHandle<double> c_kd_;
+  ParamHandle<double> max_roll_;
+  ParamHandle<double> cmd_takeoff_pitch_;
+  ParamHandle<double> r_kp_;
+  ParamHandle<double> r_ki_;
+  ParamHandle<double> r_kd_;
+  ParamHandle<double> max_a_;
+  ParamHandle<double> max_r_;
+  ParamHandle<double> trim_a_;
+  ParamHandle<double> p_kp_;
+  ParamHandle<double> p_ki_;
+  ParamHandle<double> p_kd_;
+  ParamHandle<double> max_e_;
+  ParamHandle<double> max_pitch_;
+  ParamHandle<double> trim_e_;
+  ParamHandle<double> tau_;
+  ParamHandle<double> a_t_kp_;
+  ParamHandle<double> a_t_ki_;
+  ParamHandle<double> a_t_kd_;
+  ParamHandle<double> max_t_;
+  ParamHandle<double> trim_t_;
+  ParamHandle<double> a_kp_;
+  ParamHandle<double> a_ki_;
+  ParamHandle<double> a_kd_;
+  ParamHandle<double> y_pwo_;
+  ParamHandle<double> y_kr_;
+
+private:
+  /**
+   * Declares the parameters associated to this controller, controller_successive_loop, so that ROS2 can see them.
+   * Also declares default values before they are set to the values set in the launch script.
+  */
+  void declare_parameters();
+};
+} // namespace rosplane
+
+#endif // CONTROLLER_EXAMPLE_CORE_H
@@ -0,0 +1,185 @@
+#ifndef BUILD_CONTROLLER_TOTAL_ENERGY_CORE_H
+#define BUILD_CONTROLLER_TOTAL_ENERGY_CORE_H
+
+#include "rosplane/controller_successive_loop_core.hpp"
+
+namespace rosplane
+{
+
+class ControllerTotalEnergyCore : public ControllerSucessiveLoopCore
+{
+public:
+  /**
+   * Constructor to declare the parameters and build the first set of gains.
+   */
+  explicit ControllerTotalEnergyCore(const CoreContext & context);
+
+  /**
+   * Takes the snapshot of the energy gains for this tick, then runs the successive loop
+   * controller, which takes the snapshot of the other gains.
+   * @param input Inputs to the control algorithm.
+   * @param output Outputs of the controller, including selected intermediate values and final control efforts.
+   */
+  virtual void control(const Input & input, Output & output);
+
+  /**
+   * Rebuilds the energy gains and the gains of the successive loop controller, and publishes them
+   * to the control loop.
+   */
+  virtual void update_gains();
+
+protected:
+  /**
+   * Gains and limits of the total energy loops. The gains of the other loops are in gains_.
+   */
+  struct EnergyGains
+  {
+    double e_kp;          /**< Proportional gain on the total energy error */
+    double e_ki;          /**< Integral gain on the total energy error */
+    double l_kp;          /**< Proportional gain on the energy balance error */
+    double l_ki;          /**< Integral gain on the energy balance error */
+    double mass;          /**< Mass of the aircraft (kg) */
+    double gravity;       /**< Gravitational acceleration (m/s^2) */
+    double max_alt_error; /**< Largest altitude error used for the potential energy (m) */
+  };
+
+  /**
+   * This function overrides the longitudinal control loops for the take-off zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void take_off_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * This function overrides the longitudinal control loops for the climb zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void climb_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * This function overrides the longitudinal control loops for the altitude hold zone.
+   * @param input The command inputs to the controller such as course and airspeed.
+   * @param output The control efforts calculated and selected intermediate values.
+   */
+  virtual void alt_hold_longitudinal_control(const Input & input, Output & output);
+
+  /**
+   * This function overrides when the aircraft exits the take-off zone. Any changes to the controller that need to happen
+   * only once as the aircraft exits take-off mode should be placed here. This sets differentiators and integrators to 0.
+   */
+  virtual void take_off_exit();
+
+  /**
+   * This function overrides when the aircraft exits the climb zone. Any changes to the controller that need to happen
+   * only once as the aircraft exits climb mode should be placed here. This sets differentiators and integrators to 0.
+   */
+  virtual void climb_exit();
+
+  /**
+   * This function overrides when the aircraft exits the altitude hold zone (usually a crash). Any changes to the controller that 
+   * need to happen only once as the aircraft exits altitude mode should be placed here. This sets differentiators and
+   * integrators to 0.
+   */
+  virtual void altitude_hold_exit();
+
+  /**
+   * This uses the error in total energy to find the necessary throttle to acheive that energy.
+   * @param va_c This is the commanded airspeed.
+   * @param va This is the actual airspeed.
+   * @param h_c This is the commanded altitude.
+   * @param h This is the actual altitude.
+   * @param Ts The sampling period in seconds.
+   * @return The throttle value saturated between 0 and the parameter of max throttle.
+   */
+  float total_energy_throttle(float va_c, float va, float h_c, float h, float Ts);
+
+  /**
+   * This uses the error in the balance of energy to find the necessary elevator deflection to acheive that energy.
+   * @param va_c This is the commanded airspeed.
+   * @param va This is the actual airspeed.
+   * @param h_c This is the commanded altitude.
+   * @param h This is the actual altitude.
+   * @param Ts The sampling period in seconds.
+   * @return The pitch command value saturated between min and max pitch.
+   */
+  float total_energy_pitch(float va_c, float va, float h_c, float h, float Ts);
+
+  /**
+   * This calculates and updates the kinetic energy reference and error, the potential energy error.
+   * @param va_c This is the commanded airspeed.
+   * @param va This is the actual airspeed.
+   * @param h_c This is the commanded altitude.
+   * @param h This is the actual altitude.
+   */
+  void update_energies(float va_c, float va, float h_c, float h);
+
+  /**
+   * This is the integral value for the error in the total energy.
+   */
+  float E_integrator_;
+
+  /**
+   * This is the integral value for the error in the balance of energy.
+   */
+  float L_integrator_;
+
+  /**
+   * This is the current reference (desired) kinetic energy.
+   */
+  float K_ref_;
+
+  /**
+   * This is the current error in the kinetic energy.
+   */
+  float K_error_;
+
+  /**
+   * This is the current error in the potential energy.
+   */
+  float U_error_;
+
+  /**
+   * The previous error in the energy balance.
+   */
+  float L_error_prev_;
+
+  /**
+   * The previous error in the total energy.
+   */
+  float E_error_prev_;
+
+  /**
+   * The energy gains the control loops use in this tick, copied from energy_gains_snapshot_ at
+   * its start.
+   */
+  EnergyGains energy_gains_;
+
+  /**
+   * The latest energy gains, stored by update_gains and loaded by control.
+   */
+  SeqLock<EnergyGains> energy_gains_snapshot_;
+
+private:
+  /**
+   * Declares the parameters associated to this controller, controller_successive_loop, so that ROS2 can see them.
+   * Also declares default values before they are set to the values set in the launch script.
+  */
+  void declare_parameters();
+
+  /**
+   * Handles to the parameters declared by this class, which update_gains reads the gains through.
+   */
+  ParamHandle<double> e_kp_;
+  ParamHandle<double> e_ki_;
+  ParamHandle<double> e_kd_;
+  ParamHandle<double> l_kp_;
+  ParamHandle<double> l_ki_;
+  ParamHandle<double> l_kd_;
+  ParamHandle<double> mass_;
+  ParamHandle<double> gravity_;
+  ParamHandle<double> max_alt_error_;
+};
+} // namespace rosplane
+
+#endif //BUILD_CONTROLLER_TOTAL_ENERGY_CORE_H
@@ -0,0 +1,341 @@
+#ifndef ESTIMATOR_CONTINUOUS_DISCRETE_CORE_H
+#define ESTIMATOR_CONTINUOUS_DISCRETE_CORE_H
+
+#include <condition_variable>
+#include <limits>
+#include <math.h>
+#include <mutex>
+#include <thread>
+
+#include <Eigen/Geometry>
+#include <yaml-cpp/yaml.h>
+
+#include "rosplane/estimator_ekf_core.hpp"
+#include "rosplane/ring_buffer.hpp"
+#include "rosplane/seqlock.hpp"
+
+namespace rosplane
+{
+
+class EstimatorContinuousDiscreteCore : public EstimatorEKFCore
+{
+public:
+  explicit EstimatorContinuousDiscreteCore(const CoreContext & context);
+  ~EstimatorContinuousDiscreteCore();
+
+  void estimate(const Input & input, Output & output) override;
+
+  /**
+   * Rebuilds the gains from the parameters and publishes them to the estimate.
+   */
+  void update_gains() override;
+
+  /**
+   * @brief Seeds the initial position and baro calibration from the saved parameters, and warm
+   * starts the filter from the snapshot if there is a recent one.
+   */
+  void seed_from_parameters() override;
+
+private:
+  /**
+   * One coherent set of the tuning of the filter. A complete set is rebuilt when the parameters
+   * change, and the filter reads from a copy taken at the start of each estimate.
+   */
+  struct Gains
+  {
+    double rho;                         /**< Air density (kg/m^3) */
+    double gravity;                     /**< Gravitational acceleration (m/s^2) */
+    double estimator_update_frequency;  /**< Nominal rate of the estimator (Hz) */
+    double sigma_n_gps;                 /**< Standard deviation of GPS north (m) */
+    double sigma_e_gps;                 /**< Standard deviation of GPS east (m) */
+    double sigma_Vg_gps;                /**< Standard deviation of GPS ground speed (m/s) */
+    double sigma_course_gps;            /**< Standard deviation of GPS course (rad) */
+    double sigma_accel;                 /**< Standard deviation of the accelerometers (m/s^2) */
+    double sigma_pseudo_wind_n;         /**< Variance of the north wind pseudo measurement */
+    double sigma_pseudo_wind_e;         /**< Variance of the east wind pseudo measurement */
+    double lpf_a;                       /**< Low pass filter constant of the IMU */
+    double lpf_a1;                      /**< Low pass filter constant of the pressure sensors */
+    double gps_n_lim;                   /**< Largest accepted GPS north (m) */
+    double gps_e_lim;                   /**< Largest accepted GPS east (m) */
+    double position_update_frequency;   /**< Rate of the position filter, 0 for every update */
+    bool sequential_measurement_update; /**< Apply the measurements one at a time with a gate */
+    double measurement_gate_threshold;  /**< Chi-square gate of the sequential update */
+    double max_estimated_phi;           /**< Largest estimated roll angle (deg) */
+    double max_estimated_theta;         /**< Largest estimated pitch angle (deg) */
+    double estimator_max_buffer;        /**< Margin the estimate is reset to inside the limits */
+    double pos_n_initial_cov;           /**< Initial covariance of north */
+    double pos_e_initial_cov;           /**< Initial covariance of east */
+    double vg_initial_cov;              /**< Initial covariance of ground speed */
+    double chi_initial_cov;             /**< Initial covariance of course (deg) */
+    double wind_n_initial_cov;          /**< Initial covariance of the north wind */
+    double wind_e_initial_cov;          /**< Initial covariance of the east wind */
+    double psi_initial_cov;             /**< Initial covariance of heading (deg) */
+    int64_t position_history_depth;     /**< Position filter snapshots kept for delayed fixes */
+    double filter_snapshot_period;      /**< Time between filter snapshots, 0 for none (s) */
+    bool filter_snapshot_enabled;       /**< Whether a filter snapshot file is set */
+    int64_t num_propagation_steps;      /**< Steps the models are propagated in per estimate */
+  };
+
+  /**
+   * The gains the filter uses in this estimate, copied from gains_snapshot_ at its start.
+   */
+  Gains gains_;
+
+  /**
+   * The latest gains, stored by update_gains and loaded by estimate.
+   */
+  SeqLock<Gains> gains_snapshot_;
+
+  float alpha_;
+  float alpha1_;
+
+  float lpf_gyro_x_;
+  float lpf_gyro_y_;
+  float lpf_gyro_z_;
+  float lpf_static_;
+  float lpf_diff_;
+  float lpf_accel_x_;
+  float lpf_accel_y_;
+  float lpf_accel_z_;
+
+  float phat_;
+  float qhat_;
+  float rhat_;
+  float Vwhat_;
+  float phihat_;
+  float thetahat_;
+  float psihat_; // TODO: link to an inital condiditons param
+
+  double position_Ts_;    /**< Time since the position filter last ran (s) */
+  double last_gps_stamp_; /**< Stamp of the last GPS fix that was fused (s) */
+
+  /**
+   * Snapshot of the position filter, saved each time it runs. The propagation inputs are kept so
+   * that the filter can be rewound to the time of a delayed GPS fix and replayed to the present.
+   */
+  struct PositionHistory
+  {
+    double stamp;                            /**< Time of the snapshot (s) */
+    double Ts;                               /**< Propagation time from the previous snapshot (s) */
+    Eigen::Vector<float, 6> attitude_states; /**< Inputs used for the propagation */
+    Eigen::Vector<float, 7> xhat;            /**< Position state after the update */
+    Eigen::Matrix<float, 7, 7> P;            /**< Position covariance after the update */
+  };
+  RingBuffer<PositionHistory> position_history_;
+
+  /**
+   * @brief Propagates the position filter forward by Ts.
+   *
+   * @param attitude_states The angular rates, roll, pitch and airspeed used by the dynamics.
+   * @param Ts The time to propagate over, in seconds.
+   */
+  void position_propagate(const Eigen::Vector<float, 6> & attitude_states, double Ts);
+
+  /**
+   * @brief Applies the GPS measurements in the input to the current position state.
+   *
+   * @param input The estimator input holding the GPS measurements.
+   * @param vahat The airspeed estimate at the time of the measurements.
+   */
+  void position_measurement_update(const Input & input, float vahat);
+
+  /**
+   * @brief Fuses the GPS fix in the input at the time it was measured. The position filter is
+   * rewound to the newest snapshot at or before the fix, updated, and propagated back to the
+   * present with the saved inputs.
+   *
+   * @param input The estimator input holding the GPS measurements.
+   */
+  void fuse_gps(const Input & input);
+
+  /**
+   * Compact binary checkpoint of the filter, used to warm start the estimator after a restart.
+   */
+  struct FilterSnapshot
+  {
+    uint32_t magic;       /**< Always SNAPSHOT_MAGIC */
+    uint32_t version;     /**< Always SNAPSHOT_VERSION */
+    int64_t wall_time_ns; /**< System clock time the snapshot was taken */
+    float xhat_a[2];
+    float P_a[4];
+    float xhat_p[7];
+    float P_p[49];
+    float lpf[8]; /**< Gyro x, y, z, static pressure, diff pressure and accel x, y, z filters */
+    double init_lat;
+    double init_lon;
+    float init_alt;
+    float init_static;
+  };
+  static constexpr uint32_t SNAPSHOT_MAGIC = 0x52504c45; // "RPLE"
+  static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+  /**
+   * @brief Copies the filter into a snapshot and hands it to the snapshot thread to be written.
+   */
+  void save_filter_snapshot();
+
+  /**
+   * @brief Restores the filter from the snapshot file, if it exists and is recent enough.
+   *
+   * @return True if the filter was restored.
+   */
+  bool restore_filter_snapshot();
+
+  /**
+   * @brief Snapshot thread loop. Writes each snapshot handed to it by save_filter_snapshot to a
+   * temporary file and renames it over the snapshot file, so the estimator never waits on the
+   * file system and the file is never partially written.
+   */
+  void run_snapshot_writer();
+
+  double snapshot_elapsed_; /**< Time since the last snapshot was taken (s) */
+  std::thread snapshot_thread_;
+  std::mutex snapshot_mutex_;
+  std::condition_variable snapshot_cv_;
+  FilterSnapshot pending_snapshot_;   /**< Snapshot to write, guarded by snapshot_mutex_ */
+  std::string snapshot_path_;         /**< File to write it to, guarded by snapshot_mutex_ */
+  bool snapshot_pending_ = false;     /**< Guarded by snapshot_mutex_ */
+  bool snapshot_stop_ = false;        /**< Guarded by snapshot_mutex_ */
+
+  /**
+   * Trig functions of the attitude states. These are shared by all of the attitude models, so each
+   * is only evaluated once per state.
+   */
+  struct AttitudeTrig
+  {
+    float phi = std::numeric_limits<float>::quiet_NaN();   /**< phi the values were evaluated at */
+    float theta = std::numeric_limits<float>::quiet_NaN(); /**< theta the values were evaluated at */
+    float cp;                                              /**< cos(phi) */
+    float sp;                                              /**< sin(phi) */
+    float ct;                                              /**< cos(theta) */
+    float st;                                              /**< sin(theta) */
+    float tt;                                              /**< tan(theta) */
+  };
+  AttitudeTrig attitude_trig_;
+  const AttitudeTrig & attitude_trig(const Eigen::Vector2f & state);
+
+  /**
+   * Trig functions of the course and heading states, shared by all of the position models.
+   */
+  struct PositionTrig
+  {
+    float chi = std::numeric_limits<float>::quiet_NaN(); /**< chi the values were evaluated at */
+    float psi = std::numeric_limits<float>::quiet_NaN(); /**< psi the values were evaluated at */
+    float cchi;                                          /**< cos(chi) */
+    float schi;                                          /**< sin(chi) */
+    float cpsi;                                          /**< cos(psi) */
+    float spsi;                                          /**< sin(psi) */
+  };
+  PositionTrig position_trig_;
+  const PositionTrig & position_trig(const Eigen::Vector<float, 7> & state);
+
+  /**
+   * Values that only depend on the inputs to the position dynamics. The inputs are constant over a
+   * propagation, so these are evaluated once per propagation.
+   */
+  struct PositionInputTrig
+  {
+    Eigen::Vector<float, 6> inputs = Eigen::Vector<float, 6>::Constant(
+      std::numeric_limits<float>::quiet_NaN()); /**< inputs the values were evaluated at */
+    float tphi;                                 /**< tan(phi) */
+    float psidot;                               /**< heading rate (rad/s) */
+  };
+  PositionInputTrig position_input_trig_;
+  const PositionInputTrig & position_input_trig(const Eigen::Vector<float, 6> & inputs);
+
+  // The models used by the attitude and position filters. These are passed to the EKF functions as
+  // functors, so they all use fixed size types.
+  Eigen::Vector2f attitude_dynamics(const Eigen::Vector2f & state,
+                                    const Eigen::Vector3f & angular_rates);
+
+  Eigen::Matrix2f attitude_jacobian(const Eigen::Vector2f & state,
+                                    const Eigen::Vector3f & angular_rates);
+
+  Eigen::Matrix<float, 2, 3> attitude_input_jacobian(const Eigen::Vector2f & state,
+                                                     const Eigen::Vector3f & angular_rates);
+
+  Eigen::Vector3f attitude_measurement_prediction(const Eigen::Vector2f & state,
+                                                  const Eigen::Vector4f & inputs);
+
+  Eigen::Matrix<float, 3, 2> attitude_measurement_jacobian(const Eigen::Vector2f & state,
+                                                           const Eigen::Vector4f & inputs);
+
+  Eigen::Vector<float, 7> position_dynamics(const Eigen::Vector<float, 7> & state,
+                                            const Eigen::Vector<float, 6> & measurements);
+
+  Eigen::Matrix<float, 4, 7> position_jacobian(const Eigen::Vector<float, 7> & state,
+                                               const Eigen::Vector<float, 6> & measurements);
+
+  Eigen::Vector<float, 6> position_measurement_prediction(const Eigen::Vector<float, 7> & state,
+                                                          const Eigen::Vector<float, 1> & input);
+
+  Eigen::Matrix<float, 6, 7>
+  position_measurement_jacobian(const Eigen::Vector<float, 7> & state,
+                                const Eigen::Vector<float, 1> & input);
+
+  Eigen::Vector2f xhat_a_; // 2
+  Eigen::Matrix2f P_a_;    // 2x2
+
+  Eigen::Vector<float, 7> xhat_p_; // 7
+  Eigen::Matrix<float, 7, 7> P_p_; // 7x7
+
+  Eigen::Matrix2f Q_a_; // 2x2
+  Eigen::Matrix3f Q_g_;
+  Eigen::Matrix3f R_accel_;
+
+  Eigen::Matrix<float, 7, 7> Q_p_; // 7x7
+  Eigen::Matrix<float, 6, 6> R_p_; // 6x6
+
+  void check_xhat_a();
+
+  /**
+   * @brief This declares each parameter as a parameter so that the ROS2 parameter system can recognize each parameter.
+   * It also sets the default parameter, which will then be overridden by a launch script.
+   */
+  void declare_parameters();
+
+  /**
+   * @brief Initializes some variables that depend on ROS2 parameters
+   * @param Ts The time step used for the low pass filter coefficients, in seconds.
+  */
+  void update_measurement_model_parameters(double Ts);
+
+  /**
+   * @brief Initializes the covariance matrices and process noise matrices with the ROS2 parameters
+   */
+  void initialize_uncertainties();
+
+  /**
+   * @brief Initializes the state covariance matrix with the ROS2 parameters
+   */
+  void initialize_state_covariances();
+
+  /**
+   * Handles to the parameters used every time the estimator runs. Only update_gains reads them, on
+   * the thread that changes the parameters, and the estimate reads the gains it builds.
+   */
+  ParamHandle<double> sigma_n_gps_;
+  ParamHandle<double> sigma_e_gps_;
+  ParamHandle<double> sigma_Vg_gps_;
+  ParamHandle<double> sigma_course_gps_;
+  ParamHandle<double> sigma_accel_;
+  ParamHandle<double> sigma_pseudo_wind_n_;
+  ParamHandle<double> sigma_pseudo_wind_e_;
+  ParamHandle<double> lpf_a_;
+  ParamHandle<double> lpf_a1_;
+  ParamHandle<double> gps_n_lim_;
+  ParamHandle<double> gps_e_lim_;
+  ParamHandle<double> position_update_frequency_;
+  ParamHandle<int64_t> position_history_depth_;
+  ParamHandle<std::string> filter_snapshot_file_;
+  ParamHandle<double> filter_snapshot_period_;
+  ParamHandle<bool> sequential_measurement_update_;
+  ParamHandle<double> measurement_gate_threshold_;
+  ParamHandle<double> max_estimated_phi_;
+  ParamHandle<double> max_estimated_theta_;
+  ParamHandle<double> estimator_max_buffer_;
+};
+
+} // namespace rosplane
+
+#endif // ESTIMATOR_CONTINUOUS_DISCRETE_CORE_H
@@ -0,0 +1,151 @@
+/**
+ * @file estimator_core.hpp
+ *
+ * Base class definition for the estimation algorithm of the autopilot in chapter 8 of UAVbook, see
+ * http://uavbook.byu.edu/doku.php. The algorithm does not depend on a ROS2 node, the node that
+ * runs it is in estimator_ros.hpp.
+ */
+
+#ifndef ESTIMATOR_CORE_H
+#define ESTIMATOR_CORE_H
+
+#include <cstdint>
+
+#include "rosplane/algorithm_core.hpp"
+
+namespace rosplane
+{
+
+/**
+ * This class defines the interface of an estimation algorithm, and holds the initial position and
+ * barometer calibration the measurements are relative to.
+ */
+class EstimatorCore : public AlgorithmCore
+{
+public:
+  struct Input
+  {
+    float gyro_x;
+    float gyro_y;
+    float gyro_z;
+    float accel_x;
+    float accel_y;
+    float accel_z;
+    float static_pres;
+    float diff_pres;
+    bool gps_new;       /**< True if there is a GPS fix that was not in the last input */
+    uint32_t gps_epoch; /**< Number of GPS fixes received, used to set gps_new */
+    float gps_n;
+    float gps_e;
+    float gps_h;
+    float gps_Vg;
+    float gps_course;
+    bool status_armed;
+    bool armed_init;
+    float Ts;               /**< Time since the last call to estimate, in seconds */
+    double stamp;           /**< Time of the newest IMU sample in the inputs, in seconds */
+    double gps_stamp;       /**< Time the GPS fix was measured, in seconds. Zero if unknown. */
+    bool origin_valid;      /**< True if the origin below is set, see apply_references */
+    double origin_lat;      /**< Latitude of the origin (deg) */
+    double origin_lon;      /**< Longitude of the origin (deg) */
+    float origin_alt;       /**< Altitude of the origin above MSL (m) */
+    bool baro_calibrated;   /**< True if the baro calibration below is set */
+    float baro_calibration; /**< Static pressure at the ground (mbar) */
+  };
+
+  struct Output
+  {
+    float pn;
+    float pe;
+    float h;
+    float va;
+    float alpha;
+    float beta;
+    float phi;
+    float theta;
+    float psi;
+    float chi;
+    float p;
+    float q;
+    float r;
+    float Vg;
+    float wn;
+    float we;
+  };
+
+  /**
+   * Declares the physical constants, the estimator rate and the saved initial values.
+   */
+  explicit EstimatorCore(const CoreContext & context);
+
+  virtual void estimate(const Input & input, Output & output) = 0;
+
+  /**
+   * @brief Seeds the initial position and baro calibration from the saved parameters.
+   */
+  virtual void seed_from_parameters();
+
+  /**
+   * @brief Sets the origin of the local frame the GPS measurements are given in.
+   *
+   * @param lat: Latitude of the origin (deg)
+   * @param lon: Longitude of the origin (deg)
+   * @param alt: Altitude of the origin above MSL (m)
+   */
+  void set_origin(double lat, double lon, float alt);
+
+  /**
+   * @return True once the origin is set, from the first GPS fix or the saved parameters.
+   */
+  bool origin_initialized() const { return gps_init_; }
+  double init_lat() const { return init_lat_; }
+  double init_lon() const { return init_lon_; }
+  float init_alt() const { return init_alt_; }
+
+  /**
+   * @brief Sets the static pressure the barometer measurements are relative to.
+   *
+   * @param init_static: The static pressure at the ground (mbar)
+   */
+  void set_baro_calibration(float init_static);
+
+  /**
+   * @brief Marks the baro calibration as invalid, so the estimator waits for a new one.
+   */
+  void clear_baro_calibration() { baro_init_ = false; }
+
+  /**
+   * @return True once the barometer is calibrated.
+   */
+  bool baro_initialized() const { return baro_init_; }
+  float baro_calibration() const { return init_static_; }
+
+  /**
+   * @brief Sets the origin and baro calibration from the input. The node finds them in its sensor
+   * callbacks and passes them in the input, so they are only ever changed by the thread running
+   * the estimator. A cleared baro calibration is cleared here too, but the origin is never unset.
+   *
+   * @param input: Input holding the origin and baro calibration
+   */
+  void apply_references(const Input & input);
+
+protected:
+  // These are only used by the thread running the estimator, see apply_references.
+  bool baro_init_; /**< Initial barometric pressure */
+  bool gps_init_;
+  double init_lat_ = 0.0;  /**< Initial latitude in degrees */
+  double init_lon_ = 0.0;  /**< Initial longitude in degrees */
+  float init_alt_ = 0.0;   /**< Initial altitude in meters above MSL  */
+  float init_static_ = 0.; /**< Initial static pressure (mbar)  */
+
+  /**
+   * Handles to the parameters declared by this class that are used at the estimator rate.
+   */
+  ParamHandle<double> estimator_update_frequency_;
+  ParamHandle<double> rho_;
+  ParamHandle<double> gravity_;
+};
+
+} // namespace rosplane
+
+#endif // ESTIMATOR_CORE_H
@@ -0,0 +1,312 @@
+#ifndef ESTIMATOR_EKF_CORE_H
+#define ESTIMATOR_EKF_CORE_H
+
+#include <cassert>
+#include <math.h>
+
+#include <Eigen/Geometry>
+#include <yaml-cpp/yaml.h>
+
+#include "rosplane/estimator_core.hpp"
+
+namespace rosplane
+{
+
+/**
+ * Core of the extended Kalman filters used by the estimators. The filter functions are templated on
+ * the size of the state, input and measurement, so all of the matrices involved are fixed size and
+ * live on the stack. The models are passed as functors, so they can be inlined by the compiler.
+ * The state and covariance are updated in place.
+ */
+class EstimatorEKFCore : public EstimatorCore
+{
+public:
+  explicit EstimatorEKFCore(const CoreContext & context);
+
+protected:
+  /**
+   * @brief Updates the state and covariance with a vector of measurements.
+   *
+   * @param x: The state estimate, updated in place
+   * @param inputs: Inputs needed by the measurement model and jacobian
+   * @param measurement_model: Functor (x, inputs) -> measurement prediction of size N_meas
+   * @param y: The measurements
+   * @param measurement_jacobian: Functor (x, inputs) -> N_meas x N_state measurement jacobian
+   * @param R: The measurement covariance
+   * @param P: The state covariance, updated in place
+   */
+  template<int N_state, int N_input, int N_meas, typename MeasurementModel,
+           typename MeasurementJacobian>
+  void measurement_update(Eigen::Vector<float, N_state> & x,
+                          const Eigen::Vector<float, N_input> & inputs,
+                          MeasurementModel && measurement_model,
+                          const Eigen::Vector<float, N_meas> & y,
+                          MeasurementJacobian && measurement_jacobian,
+                          const Eigen::Matrix<float, N_meas, N_meas> & R,
+                          Eigen::Matrix<float, N_state, N_state> & P);
+
+  /**
+   * @brief Propagates the state and covariance forward by Ts, in a number of equal steps.
+   *
+   * @param x: The state estimate, updated in place
+   * @param dynamic_model: Functor (x, inputs) -> time derivative of the state
+   * @param jacobian: Functor (x, inputs) -> N_state x N_state jacobian of the dynamics
+   * @param inputs: Inputs to the dynamics
+   * @param input_jacobian: Functor (x, inputs) -> N_state x N_noise jacobian of the dynamics with
+   * respect to the noisy inputs
+   * @param P: The state covariance, updated in place
+   * @param Q: The process noise covariance
+   * @param Q_g: The covariance of the noise on the inputs
+   * @param Ts: The time to propagate forward
+   * @param steps: The number of steps to propagate in
+   */
+  template<int N_state, int N_input, int N_noise, typename DynamicModel, typename Jacobian,
+           typename InputJacobian>
+  void propagate_model(Eigen::Vector<float, N_state> & x, DynamicModel && dynamic_model,
+                       Jacobian && jacobian, const Eigen::Vector<float, N_input> & inputs,
+                       InputJacobian && input_jacobian, Eigen::Matrix<float, N_state, N_state> & P,
+                       const Eigen::Matrix<float, N_state, N_state> & Q,
+                       const Eigen::Matrix<float, N_noise, N_noise> & Q_g, float Ts, int steps);
+
+  /**
+   * @brief Propagates the state and covariance like propagate_model, for models where only the
+   * first N_dyn rows of the jacobian are non-zero and there is no noise on the inputs. This means
+   * A = [A11 A12; 0 0], so the discrete transition matrix is A_d = [M11 M12; 0 I] and the
+   * covariance can be propagated block-wise, skipping all of the products with the zero and
+   * identity blocks. The result is the same as propagate_model with Q_g = 0.
+   *
+   * @param x: The state estimate, updated in place
+   * @param dynamic_model: Functor (x, inputs) -> time derivative of the state
+   * @param jacobian: Functor (x, inputs) -> the first N_dyn rows of the jacobian of the dynamics
+   * @param inputs: Inputs to the dynamics
+   * @param P: The state covariance, updated in place
+   * @param Q: The process noise covariance
+   * @param Ts: The time to propagate forward
+   * @param steps: The number of steps to propagate in
+   */
+  template<int N_dyn, int N_state, int N_input, typename DynamicModel, typename Jacobian>
+  void propagate_model_structured(Eigen::Vector<float, N_state> & x, DynamicModel && dynamic_model,
+                                  Jacobian && jacobian,
+                                  const Eigen::Vector<float, N_input> & inputs,
+                                  Eigen::Matrix<float, N_state, N_state> & P,
+                                  const Eigen::Matrix<float, N_state, N_state> & Q, float Ts,
+                                  int steps);
+
+  /**
+   * @brief Updates the state and covariance with a vector of measurements with uncorrelated noise,
+   * by applying each measurement as a scalar update. This avoids the matrix inversion done in
+   * measurement_update. Each measurement is gated on its own innovation, so one bad measurement can
+   * be rejected without throwing out the rest.
+   *
+   * The measurement model is linearized once, at the prior. If no measurement is rejected, the
+   * result is the same as measurement_update with a diagonal R.
+   *
+   * @param x: The state estimate, updated in place
+   * @param inputs: Inputs needed by the measurement model and jacobian
+   * @param measurement_model: Functor (x, inputs) -> measurement prediction of size N_meas
+   * @param y: The measurements
+   * @param measurement_jacobian: Functor (x, inputs) -> N_meas x N_state measurement jacobian
+   * @param R_diag: The variance of each measurement (the diagonal of R)
+   * @param P: The state covariance, updated in place
+   * @param gate_threshold: Threshold on the normalized innovation squared of each measurement
+   * @return The number of measurements rejected by the gate
+   */
+  template<int N_state, int N_input, int N_meas, typename MeasurementModel,
+           typename MeasurementJacobian>
+  int sequential_measurement_update(Eigen::Vector<float, N_state> & x,
+                                    const Eigen::Vector<float, N_input> & inputs,
+                                    MeasurementModel && measurement_model,
+                                    const Eigen::Vector<float, N_meas> & y,
+                                    MeasurementJacobian && measurement_jacobian,
+                                    const Eigen::Vector<float, N_meas> & R_diag,
+                                    Eigen::Matrix<float, N_state, N_state> & P,
+                                    float gate_threshold);
+
+  /**
+   * @brief Updates the state and covariance with a single scalar measurement.
+   *
+   * @param measurement: The measured value
+   * @param measurement_prediction: The predicted value of the measurement
+   * @param measurement_variance: The variance of the measurement
+   * @param measurement_jacobian: The row of the measurement jacobian for this measurement
+   * @param x: The state estimate, updated in place
+   * @param P: The state covariance, updated in place
+   * @param gate_threshold: The measurement is rejected if its normalized innovation squared is
+   * larger than this threshold. A threshold of zero or less disables the gate.
+   * @return True if the measurement was applied, false if it was rejected by the gate
+   */
+  template<int N_state>
+  bool single_measurement_update(float measurement, float measurement_prediction,
+                                 float measurement_variance,
+                                 const Eigen::Vector<float, N_state> & measurement_jacobian,
+                                 Eigen::Vector<float, N_state> & x,
+                                 Eigen::Matrix<float, N_state, N_state> & P,
+                                 float gate_threshold = 0.0f);
+
+  /**
+   * Handle to the number of steps used to propagate the model over one estimator period. The child
+   * copies it into its gains, which it passes to the propagation functions.
+   */
+  ParamHandle<int64_t> num_propagation_steps_;
+
+private:
+  virtual void estimate(const Input & input, Output & output) override = 0;
+
+  /**
+   * @brief Declares the parameters used by the EKF with the ROS2 parameter system.
+   */
+  void declare_parameters();
+};
+
+template<int N_state, int N_input, int N_meas, typename MeasurementModel,
+         typename MeasurementJacobian>
+void EstimatorEKFCore::measurement_update(Eigen::Vector<float, N_state> & x,
+                                          const Eigen::Vector<float, N_input> & inputs,
+                                          MeasurementModel && measurement_model,
+                                          const Eigen::Vector<float, N_meas> & y,
+                                          MeasurementJacobian && measurement_jacobian,
+                                          const Eigen::Matrix<float, N_meas, N_meas> & R,
+                                          Eigen::Matrix<float, N_state, N_state> & P)
+{
+  const Eigen::Vector<float, N_meas> h = measurement_model(x, inputs);
+  const Eigen::Matrix<float, N_meas, N_state> C = measurement_jacobian(x, inputs);
+
+  // Find the S_inv to find the Kalman gain.
+  const Eigen::Matrix<float, N_meas, N_meas> S_inv = (R + C * P * C.transpose()).inverse();
+  // Find the Kalman gain.
+  const Eigen::Matrix<float, N_state, N_meas> L = P * C.transpose() * S_inv;
+  // Use a temp to increase readablility.
+  const Eigen::Matrix<float, N_state, N_state> temp =
+    Eigen::Matrix<float, N_state, N_state>::Identity() - L * C;
+
+  // Adjust the covariance with new information.
+  P = temp * P * temp.transpose() + L * R * L.transpose();
+  // Use Kalman gain to optimally adjust estimate.
+  x += L * (y - h);
+}
+
+template<int N_state, int N_input, int N_noise, typename DynamicModel, typename Jacobian,
+         typename InputJacobian>
+void EstimatorEKFCore::propagate_model(Eigen::Vector<float, N_state> & x,
+                                       DynamicModel && dynamic_model, Jacobian && jacobian,
+                                       const Eigen::Vector<float, N_input> & inputs,
+                                       InputJacobian && input_jacobian,
+                                       Eigen::Matrix<float, N_state, N_state> & P,
+                                       const Eigen::Matrix<float, N_state, N_state> & Q,
+                                       const Eigen::Matrix<float, N_noise, N_noise> & Q_g, float Ts,
+                                       int steps)
+{
+  float Tp = Ts / steps;
+
+  for (int _ = 0; _ < steps; _++) {
+
+    // Propagate model by a step.
+    x += dynamic_model(x, inputs) * Tp;
+
+    const Eigen::Matrix<float, N_state, N_state> A = jacobian(x, inputs);
+
+    // Find the second order approx of the matrix exponential.
+    const Eigen::Matrix<float, N_state, N_state> A_d =
+      Eigen::Matrix<float, N_state, N_state>::Identity() + Tp * A + Tp * Tp / 2.0f * A * A;
+
+    const Eigen::Matrix<float, N_state, N_noise> G = input_jacobian(x, inputs);
+
+    // Propagate the covariance.
+    P = A_d * P * A_d.transpose() + (Q + G * Q_g * G.transpose()) * (Tp * Tp);
+  }
+}
+
+template<int N_dyn, int N_state, int N_input, typename DynamicModel, typename Jacobian>
+void EstimatorEKFCore::propagate_model_structured(Eigen::Vector<float, N_state> & x,
+                                                  DynamicModel && dynamic_model,
+                                                  Jacobian && jacobian,
+                                                  const Eigen::Vector<float, N_input> & inputs,
+                                                  Eigen::Matrix<float, N_state, N_state> & P,
+                                                  const Eigen::Matrix<float, N_state, N_state> & Q,
+                                                  float Ts, int steps)
+{
+  static_assert(N_dyn > 0 && N_dyn < N_state, "N_dyn must be between 0 and N_state");
+  constexpr int N_static = N_state - N_dyn;
+
+  float Tp = Ts / steps;
+
+  for (int _ = 0; _ < steps; _++) {
+
+    // Propagate model by a step.
+    x += dynamic_model(x, inputs) * Tp;
+
+    // The non-zero rows of the jacobian, [A11 A12].
+    const Eigen::Matrix<float, N_dyn, N_state> A = jacobian(x, inputs);
+
+    // Find the non-trivial rows of the second order approx of the matrix exponential, [M11 M12].
+    // The top rows of A*A are A11*[A11 A12].
+    Eigen::Matrix<float, N_dyn, N_state> M =
+      Tp * A + Tp * Tp / 2.0f * A.template leftCols<N_dyn>() * A;
+    M.template leftCols<N_dyn>() += Eigen::Matrix<float, N_dyn, N_dyn>::Identity();
+
+    // Propagate the covariance, A_d*P*A_d^T. The bottom right block is unchanged.
+    const Eigen::Matrix<float, N_dyn, N_state> MP = M * P;
+    P.template topLeftCorner<N_dyn, N_dyn>() = MP * M.transpose();
+    P.template topRightCorner<N_dyn, N_static>() = MP.template rightCols<N_static>();
+    P.template bottomLeftCorner<N_static, N_dyn>() =
+      MP.template rightCols<N_static>().transpose();
+
+    P += Q * (Tp * Tp);
+  }
+}
+
+template<int N_state, int N_input, int N_meas, typename MeasurementModel,
+         typename MeasurementJacobian>
+int EstimatorEKFCore::sequential_measurement_update(Eigen::Vector<float, N_state> & x,
+                                                    const Eigen::Vector<float, N_input> & inputs,
+                                                    MeasurementModel && measurement_model,
+                                                    const Eigen::Vector<float, N_meas> & y,
+                                                    MeasurementJacobian && measurement_jacobian,
+                                                    const Eigen::Vector<float, N_meas> & R_diag,
+                                                    Eigen::Matrix<float, N_state, N_state> & P,
+                                                    float gate_threshold)
+{
+  const Eigen::Vector<float, N_meas> h = measurement_model(x, inputs);
+  const Eigen::Matrix<float, N_meas, N_state> C = measurement_jacobian(x, inputs);
+  const Eigen::Vector<float, N_state> x_prior = x;
+
+  int rejected = 0;
+  for (int i = 0; i < N_meas; i++) {
+    // Move the prediction to account for the measurements already applied.
+    float prediction = h(i) + C.row(i).dot(x - x_prior);
+
+    if (!single_measurement_update<N_state>(y(i), prediction, R_diag(i), C.row(i).transpose(), x,
+                                            P, gate_threshold)) {
+      rejected++;
+    }
+  }
+
+  return rejected;
+}
+
+template<int N_state>
+bool EstimatorEKFCore::single_measurement_update(
+  float measurement, float measurement_prediction, float measurement_variance,
+  const Eigen::Vector<float, N_state> & measurement_jacobian, Eigen::Vector<float, N_state> & x,
+  Eigen::Matrix<float, N_state, N_state> & P, float gate_threshold)
+{
+  const Eigen::Vector<float, N_state> PC = P * measurement_jacobian;
+  const float S = measurement_variance + measurement_jacobian.dot(PC);
+  const float innovation = measurement - measurement_prediction;
+
+  // Reject the measurement if the innovation is too unlikely given its covariance.
+  if (gate_threshold > 0.0f && innovation * innovation / S > gate_threshold) {
+    return false;
+  }
+
+  const Eigen::Vector<float, N_state> L = PC / S;
+  // Same as (I - L*C)*P, since P*C^T = L*S.
+  P -= L * PC.transpose();
+  x += L * innovation;
+
+  return true;
+}
+
+} // namespace rosplane
+
+#endif // ESTIMATOR_EKF_CORE_H
@@ -0,0 +1,188 @@
+/**
+ * @file latency_histogram.hpp
+ *
+ * Fixed bucket histogram of the latency from a sensor sample to each stage of the autopilot, and
+ * the diagnostics status that reports it.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <diagnostic_msgs/msg/diagnostic_status.hpp>
+
+namespace rosplane
+{
+
+/**
+ * Histogram of latencies over fixed buckets. Recording is a handful of comparisons and relaxed
+ * atomic increments, so it can be left on in flight and read from another thread. The counts are
+ * for the window since the last call to status(), which resets them.
+ */
+class LatencyHistogram
+{
+public:
+  /** Upper edges of the buckets (ms). Latencies above the last edge go in an overflow bucket. */
+  static constexpr std::array<double, 10> bucket_edges_ms = {0.5,  1.0,  2.0,   5.0,   10.0,
+                                                             20.0, 50.0, 100.0, 200.0, 500.0};
+  static constexpr std::size_t num_buckets = bucket_edges_ms.size() + 1;
+
+  LatencyHistogram()
+  {
+    for (auto & count : counts_) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Records a latency. Negative latencies, from stamps ahead of the local clock, are counted
+   * as zero.
+   *
+   * @param latency: The latency in seconds
+   */
+  void record(double latency)
+  {
+    double latency_ms = latency > 0.0 ? latency * 1e3 : 0.0;
+
+    std::size_t bucket = 0;
+    while (bucket < bucket_edges_ms.size() && latency_ms > bucket_edges_ms[bucket]) {
+      bucket++;
+    }
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    auto latency_us = static_cast<uint64_t>(latency_ms * 1e3);
+    sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+    uint64_t max_us = max_us_.load(std::memory_order_relaxed);
+    while (latency_us > max_us
+           && !max_us_.compare_exchange_weak(max_us, latency_us, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * Summary of the latencies in a window.
+   */
+  struct Window
+  {
+    uint64_t count;
+    double mean_ms;
+    double max_ms;
+  };
+
+  /**
+   * @brief Adds the count, mean, maximum, approximate percentiles and the bucket counts of the
+   * latencies recorded since the last call to the values of a status, and starts a new window.
+   *
+   * @param status: The status to add the values to
+   * @param prefix: Prefix for the keys of the values, to tell apart several histograms in a status
+   * @return A summary of the window.
+   */
+  Window append_values(diagnostic_msgs::msg::DiagnosticStatus & status,
+                       const std::string & prefix = "")
+  {
+    std::array<uint64_t, num_buckets> counts;
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < num_buckets; i++) {
+      counts[i] = counts_[i].exchange(0, std::memory_order_relaxed);
+      total += counts[i];
+    }
+    double sum_ms = sum_us_.exchange(0, std::memory_order_relaxed) * 1e-3;
+
+    Window window;
+    window.count = total;
+    window.mean_ms = total > 0 ? sum_ms / total : 0.0;
+    window.max_ms = max_us_.exchange(0, std::memory_order_relaxed) * 1e-3;
+
+    add_value(status, prefix + "count", std::to_string(total));
+    add_value(status, prefix + "mean_ms", format(window.mean_ms));
+    add_value(status, prefix + "max_ms", format(window.max_ms));
+    add_value(status, prefix + "p50_ms", format(percentile(counts, total, 0.5)));
+    add_value(status, prefix + "p99_ms", format(percentile(counts, total, 0.99)));
+    for (std::size_t i = 0; i < num_buckets; i++) {
+      std::string key = i < bucket_edges_ms.size() ? "le_" + format(bucket_edges_ms[i]) + "_ms"
+                                                   : "gt_" + format(bucket_edges_ms.back()) + "_ms";
+      add_value(status, prefix + key, std::to_string(counts[i]));
+    }
+
+    return window;
+  }
+
+  /**
+   * @brief Summarizes the latencies recorded since the last call, and starts a new window.
+   *
+   * @param name: The name of the status, usually the node and stage
+   * @param hardware_id: The hardware id of the status
+   * @return A status with the values from append_values. The level is STALE if nothing was
+   * recorded in the window.
+   */
+  diagnostic_msgs::msg::DiagnosticStatus status(const std::string & name,
+                                                const std::string & hardware_id)
+  {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = name;
+    status.hardware_id = hardware_id;
+
+    Window window = append_values(status);
+    if (window.count == 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+      status.message = "No samples";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message =
+        "mean " + format(window.mean_ms) + " ms, max " + format(window.max_ms) + " ms";
+    }
+
+    return status;
+  }
+
+  static void add_value(diagnostic_msgs::msg::DiagnosticStatus & status, const std::string & key,
+                        const std::string & value)
+  {
+    diagnostic_msgs::msg::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = value;
+    status.values.push_back(key_value);
+  }
+
+  static std::string format(double value)
+  {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.4g", value);
+    return buffer;
+  }
+
+private:
+  /**
+   * @return The upper edge of the bucket the given percentile falls in, which bounds the
+   * percentile from above. The maximum edge is returned for the overflow bucket.
+   */
+  static double percentile(const std::array<uint64_t, num_buckets> & counts, uint64_t total,
+                           double p)
+  {
+    if (total == 0) {
+      return 0.0;
+    }
+
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < bucket_edges_ms.size(); i++) {
+      cumulative += counts[i];
+      if (cumulative >= p * total) {
+        return bucket_edges_ms[i];
+      }
+    }
+    return bucket_edges_ms.back();
+  }
+
+  std::array<std::atomic<uint64_t>, num_buckets> counts_;
+  std::atomic<uint64_t> sum_us_{0}; /**< Sum of the latencies in the window (us) */
+  std::atomic<uint64_t> max_us_{0}; /**< Largest latency in the window (us) */
+};
+
+} // namespace rosplane
+
+#endif // LATENCY_HISTOGRAM_H
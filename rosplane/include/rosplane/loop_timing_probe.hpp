@@ -0,0 +1,171 @@
+/**
+ * @file loop_timing_probe.hpp
+ *
+ * Timing probe for the periodic loops of the autopilot nodes, which reports whether a loop is
+ * keeping its period.
+ */
+
+#ifndef LOOP_TIMING_PROBE_H
+#define LOOP_TIMING_PROBE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <diagnostic_msgs/msg/diagnostic_status.hpp>
+
+#include "latency_histogram.hpp"
+
+namespace rosplane
+{
+
+/**
+ * Records the period jitter, the execution time of the loop body and the missed deadlines of a
+ * periodic loop. Call tick() at the start of each iteration and wrap the body in measure(). A loop
+ * run by a sensor or message instead of a timer passes the period of its trigger to tick(). All
+ * of the counters are atomic, so status() can be called from another thread, but tick() and
+ * measure() must be called from one thread at a time.
+ */
+class LoopTimingProbe
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param period: The nominal period of the loop (s)
+   */
+  explicit LoopTimingProbe(double period = 0.0)
+      : period_ns_(static_cast<int64_t>(period * 1e9))
+      , last_tick_valid_(false)
+  {}
+
+  /**
+   * @brief Sets the nominal period the jitter and deadlines are measured against, for when the
+   * rate of the loop changes.
+   *
+   * @param period: The nominal period of the loop (s)
+   */
+  void set_period(double period)
+  {
+    period_ns_.store(static_cast<int64_t>(period * 1e9), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Marks the start of an iteration of the loop, and records how far the time since the last
+   * iteration is from the nominal period. An iteration that starts more than one and a half periods
+   * after the last is counted as a missed deadline.
+   */
+  void tick()
+  {
+    Clock::time_point now = Clock::now();
+    if (last_tick_valid_) {
+      int64_t interval_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_tick_).count();
+      int64_t period_ns = period_ns_.load(std::memory_order_relaxed);
+      int64_t deviation_ns = interval_ns - period_ns;
+      jitter_.record((deviation_ns < 0 ? -deviation_ns : deviation_ns) * 1e-9);
+      if (period_ns > 0 && 2 * interval_ns > 3 * period_ns) {
+        late_starts_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    last_tick_ = now;
+    last_tick_valid_ = true;
+  }
+
+  /**
+   * @brief Marks the start of an iteration like tick(), for a loop whose period is set by whatever
+   * triggers it, such as the interval between the stamps of the messages that run it.
+   *
+   * @param period: The period of the trigger of this iteration (s)
+   */
+  void tick(double period)
+  {
+    set_period(period);
+    tick();
+  }
+
+  /**
+   * @brief Runs the body of the loop and records how long it took. A body that takes longer than
+   * the nominal period is counted as an overrun.
+   *
+   * @param body: Callable with the body of the loop
+   * @return Whatever the body returns.
+   */
+  template<typename Body>
+  decltype(auto) measure(Body && body)
+  {
+    struct Timer
+    {
+      LoopTimingProbe & probe;
+      Clock::time_point start;
+      ~Timer() { probe.record_execution(Clock::now() - start); }
+    } timer{*this, Clock::now()};
+
+    return std::forward<Body>(body)();
+  }
+
+  /**
+   * @brief Summarizes the timing of the loop since the last call, and starts a new window.
+   *
+   * @param name: The name of the status, usually the node and loop
+   * @param hardware_id: The hardware id of the status
+   * @return A status with the jitter and execution time histograms and the missed deadline counts.
+   * The level is WARN if a deadline was missed in the window, and STALE if the loop did not run.
+   */
+  diagnostic_msgs::msg::DiagnosticStatus status(const std::string & name,
+                                                const std::string & hardware_id)
+  {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = name;
+    status.hardware_id = hardware_id;
+
+    uint64_t overruns = overruns_.exchange(0, std::memory_order_relaxed);
+    uint64_t late_starts = late_starts_.exchange(0, std::memory_order_relaxed);
+    double period_ms = period_ns_.load(std::memory_order_relaxed) * 1e-6;
+
+    LatencyHistogram::add_value(status, "period_ms", LatencyHistogram::format(period_ms));
+    LatencyHistogram::add_value(status, "overruns", std::to_string(overruns));
+    LatencyHistogram::add_value(status, "late_starts", std::to_string(late_starts));
+    LatencyHistogram::Window jitter = jitter_.append_values(status, "jitter_");
+    LatencyHistogram::Window execution = execution_.append_values(status, "execution_");
+
+    if (execution.count == 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+      status.message = "Loop did not run";
+      return status;
+    }
+
+    status.level = overruns + late_starts > 0 ? diagnostic_msgs::msg::DiagnosticStatus::WARN
+                                              : diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.message = "execution max " + LatencyHistogram::format(execution.max_ms)
+      + " ms, jitter max " + LatencyHistogram::format(jitter.max_ms) + " ms, "
+      + std::to_string(overruns + late_starts) + " missed deadlines";
+    return status;
+  }
+
+private:
+  void record_execution(Clock::duration execution)
+  {
+    int64_t execution_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(execution).count();
+    execution_.record(execution_ns * 1e-9);
+    int64_t period_ns = period_ns_.load(std::memory_order_relaxed);
+    if (period_ns > 0 && execution_ns > period_ns) {
+      overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<int64_t> period_ns_; /**< Nominal period of the loop (ns) */
+  bool last_tick_valid_;           /**< True once last_tick_ holds the start of an iteration */
+  Clock::time_point last_tick_;    /**< Start of the last iteration */
+
+  LatencyHistogram jitter_;              /**< Deviation of the interval from the period */
+  LatencyHistogram execution_;           /**< Execution time of the body */
+  std::atomic<uint64_t> overruns_{0};    /**< Bodies that took longer than the period */
+  std::atomic<uint64_t> late_starts_{0}; /**< Iterations started over 1.5 periods after the last */
+};
+
+} // namespace rosplane
+
+#endif // LOOP_TIMING_PROBE_H
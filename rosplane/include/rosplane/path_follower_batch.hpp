@@ -0,0 +1,179 @@
+/**
+ * @file path_follower_batch.hpp
+ *
+ * The line and orbit following laws of chapter 10 of UAVbook, evaluated for many aircraft, paths
+ * and gains in one pass. Used by tools that sweep the gains offline or predict the commands of a
+ * fleet. The example path follower uses the single aircraft evaluation.
+ */
+
+#ifndef PATH_FOLLOWER_BATCH_H
+#define PATH_FOLLOWER_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rosplane/path_follower_core.hpp"
+
+namespace rosplane
+{
+
+/**
+ * Evaluates the path following law for N (state, path, gains) tuples. The tuples are stored as a
+ * structure of arrays, and follow() evaluates both the line and the orbit law for every tuple
+ * without branches and selects one, so the loop can be vectorized by the compiler.
+ *
+ * Everything that depends only on the path, such as the course of a line and its normalized
+ * slope, is computed once by prepare_path when the path changes. The same prepared path can be
+ * given to many tuples, for example to sweep the gains on one path.
+ */
+class PathFollowerBatch
+{
+public:
+  /**
+   * The quantities of a path that do not change while it is followed. Both the line and the orbit
+   * fields are always valid, so the law of the other path type never divides by zero.
+   */
+  struct Path
+  {
+    bool line;       /**< Follow the line rather than the orbit */
+    float va_d;      /**< Desired airspeed (m/s) */
+    float r_n;       /**< Origin of the line, north (m) */
+    float r_e;       /**< Origin of the line, east (m) */
+    float r_h;       /**< Altitude of the origin of the line (m) */
+    float chi_q;     /**< Course of the line (rad) */
+    float sin_chi_q; /**< Sine of the course of the line */
+    float cos_chi_q; /**< Cosine of the course of the line */
+    float slope;     /**< Descent of the line per horizontal distance along it */
+    float c_n;       /**< Center of the orbit, north (m) */
+    float c_e;       /**< Center of the orbit, east (m) */
+    float c_h;       /**< Altitude of the orbit (m) */
+    float rho;       /**< Radius of the orbit (m) */
+    float inv_rho;   /**< Inverse of the radius of the orbit (1/m) */
+    float lam;       /**< Direction of the orbit, 1 clockwise and -1 counter clockwise */
+  };
+
+  /**
+   * @brief Computes the quantities of the path in the input that do not depend on the state of the
+   * aircraft. Only the path fields of the input are read.
+   */
+  static Path prepare_path(const PathFollowerCore::Input & input);
+
+  /**
+   * @brief Evaluates the path following law for one aircraft, with only the law of its path type.
+   * For a single aircraft this skips the other law, which follow() evaluates to stay branch free.
+   *
+   * @param path: Path prepared by prepare_path
+   * @param pn: Position north (m)
+   * @param pe: Position east (m)
+   * @param va: Airspeed (m/s)
+   * @param chi: Course (rad)
+   * @param psi: Heading (rad)
+   * @param gains: Gains of the law
+   * @param output: Commands
+   */
+  static void follow_single(const Path & path, float pn, float pe, float va, float chi, float psi,
+                            const PathFollowerCore::Gains & gains,
+                            PathFollowerCore::Output & output);
+
+  explicit PathFollowerBatch(std::size_t size = 0) { resize(size); }
+
+  /**
+   * @brief Sets the number of tuples. The storage is allocated here, so follow() does not allocate.
+   */
+  void resize(std::size_t size);
+
+  std::size_t size() const { return size_; }
+
+  void set_path(std::size_t i, const Path & path);
+
+  /**
+   * @param i: Index of the tuple
+   * @param pn: Position north (m)
+   * @param pe: Position east (m)
+   * @param va: Airspeed (m/s)
+   * @param chi: Course (rad)
+   * @param psi: Heading (rad)
+   */
+  void set_state(std::size_t i, float pn, float pe, float va, float chi, float psi)
+  {
+    pn_[i] = pn;
+    pe_[i] = pe;
+    va_[i] = va;
+    chi_[i] = chi;
+    psi_[i] = psi;
+  }
+
+  void set_gains(std::size_t i, const PathFollowerCore::Gains & gains)
+  {
+    k_path_[i] = gains.k_path;
+    k_orbit_[i] = gains.k_orbit;
+    chi_infty_[i] = gains.chi_infty;
+    gravity_[i] = gains.gravity;
+  }
+
+  /**
+   * @brief Evaluates the path following law for every tuple.
+   */
+  void follow();
+
+  /**
+   * @brief Copies the commands of a tuple from the last call to follow().
+   */
+  void get_output(std::size_t i, PathFollowerCore::Output & output) const
+  {
+    output.va_c = va_c_[i];
+    output.h_c = h_c_[i];
+    output.chi_c = chi_c_[i];
+    output.phi_ff = phi_ff_[i];
+  }
+
+  const float * va_c() const { return va_c_.data(); }
+  const float * h_c() const { return h_c_.data(); }
+  const float * chi_c() const { return chi_c_.data(); }
+  const float * phi_ff() const { return phi_ff_.data(); }
+
+private:
+  std::size_t size_;
+
+  // Paths, as prepared by prepare_path. The path type is an integer the width of a float, so the
+  // selection between the laws vectorizes with the rest of the loop.
+  std::vector<int32_t> line_;
+  std::vector<float> va_d_;
+  std::vector<float> r_n_;
+  std::vector<float> r_e_;
+  std::vector<float> r_h_;
+  std::vector<float> chi_q_;
+  std::vector<float> sin_chi_q_;
+  std::vector<float> cos_chi_q_;
+  std::vector<float> slope_;
+  std::vector<float> c_n_;
+  std::vector<float> c_e_;
+  std::vector<float> c_h_;
+  std::vector<float> rho_;
+  std::vector<float> inv_rho_;
+  std::vector<float> lam_;
+
+  // States
+  std::vector<float> pn_;
+  std::vector<float> pe_;
+  std::vector<float> va_;
+  std::vector<float> chi_;
+  std::vector<float> psi_;
+
+  // Gains
+  std::vector<float> k_path_;
+  std::vector<float> k_orbit_;
+  std::vector<float> chi_infty_;
+  std::vector<float> gravity_;
+
+  // Commands
+  std::vector<float> va_c_;
+  std::vector<float> h_c_;
+  std::vector<float> chi_c_;
+  std::vector<float> phi_ff_;
+};
+
+} // namespace rosplane
+
+#endif // PATH_FOLLOWER_BATCH_H
@@ -0,0 +1,108 @@
+/**
+ * @file path_follower_core.hpp
+ *
+ * Base class definition for the path following algorithm in chapter 10 of UAVbook. The algorithm
+ * does not depend on a ROS2 node, the node that runs it is in path_follower_base.hpp.
+ */
+
+#ifndef PATH_FOLLOWER_CORE_H
+#define PATH_FOLLOWER_CORE_H
+
+#include "rosplane/algorithm_core.hpp"
+#include "rosplane/seqlock.hpp"
+
+namespace rosplane
+{
+
+enum class PathType
+{
+  ORBIT,
+  LINE
+};
+
+class PathFollowerCore : public AlgorithmCore
+{
+public:
+  struct Input
+  {
+    PathType p_type;
+    float va_d;
+    float r_path[3];
+    float q_path[3];
+    float c_orbit[3];
+    float rho_orbit;
+    int lam_orbit;
+    float pn;  /** position north */
+    float pe;  /** position east */
+    float h;   /** altitude */
+    float va;  /** airspeed */
+    float chi; /** course angle */
+    float psi; /** heading angle */
+  };
+
+  struct Output
+  {
+    double va_c;   /** commanded airspeed (m/s) */
+    double h_c;    /** commanded altitude (m) */
+    double chi_c;  /** commanded course (rad) */
+    double phi_ff; /** feed forward term for orbits (rad) */
+  };
+
+  /**
+   * One coherent set of the gains of the path follower. A complete set is rebuilt when the
+   * parameters change, and follow reads from a copy taken at the start of each update.
+   */
+  struct Gains
+  {
+    double chi_infty; /**< Course angle to approach a line from far away (rad) */
+    double k_path;    /**< Gain on the distance to a line */
+    double k_orbit;   /**< Gain on the distance to an orbit */
+    double gravity;   /**< Gravitational acceleration (m/s^2) */
+  };
+
+  /**
+   * Declares the gains and builds the first set of them. Followers that derive from this class
+   * publish their own gains from their constructor.
+   */
+  explicit PathFollowerCore(const CoreContext & context);
+
+  /**
+   * @brief Takes one copy of the gains, then follows the path.
+   *
+   * @param input: The path and the state of the aircraft
+   * @param output: Filled with the commands to the controller
+   */
+  void update(const Input & input, Output & output);
+
+  /**
+   * Rebuilds the gains from the parameters and publishes them to the update loop. This is called
+   * from the parameter callback after every successful change. A follower with gains of its own
+   * can override this, but must call this version too.
+   */
+  virtual void update_gains();
+
+protected:
+  virtual void follow(const Input & input, Output & output) = 0;
+
+  /**
+   * The gains follow uses in this update, copied from gains_snapshot_ at its start.
+   */
+  Gains gains_;
+
+  /**
+   * The latest gains, stored by update_gains and loaded by update.
+   */
+  SeqLock<Gains> gains_snapshot_;
+
+  /**
+   * Handles to the parameters declared by this class. update_gains reads the gains through these.
+   */
+  ParamHandle<double> chi_infty_;
+  ParamHandle<double> k_path_;
+  ParamHandle<double> k_orbit_;
+  ParamHandle<double> gravity_;
+};
+
+} // namespace rosplane
+
+#endif // PATH_FOLLOWER_CORE_H
@@ -0,0 +1,33 @@
+#ifndef PATH_FOLLOWER_EXAMPLE_CORE_H
+#define PATH_FOLLOWER_EXAMPLE_CORE_H
+
+#include "rosplane/path_follower_batch.hpp"
+#include "rosplane/path_follower_core.hpp"
+
+namespace rosplane
+{
+
+class PathFollowerExampleCore : public PathFollowerCore
+{
+public:
+  explicit PathFollowerExampleCore(const CoreContext & context);
+
+private:
+  /**
+   * @brief Follows the path with a batch of one aircraft. The quantities of the path are only
+   * computed again when the path in the input changes.
+   */
+  virtual void follow(const Input & input, Output & output);
+
+  /**
+   * @return Whether the path fields of the two inputs are the same.
+   */
+  static bool same_path(const Input & a, const Input & b);
+
+  PathFollowerBatch::Path prepared_path_; /**< The path being followed, as prepared */
+  Input path_;                            /**< The input prepared_path_ was taken from */
+  bool path_valid_;                       /**< A path has been prepared */
+};
+
+} // namespace rosplane
+#endif // PATH_FOLLOWER_EXAMPLE_CORE_H
@@ -0,0 +1,162 @@
+/**
+ * @file path_manager_core.hpp
+ *
+ * Base class definition for the path management algorithm in chapter 11 of UAVbook, see
+ * http://uavbook.byu.edu/doku.php. The algorithm does not depend on a ROS2 node, the node that
+ * runs it is in path_manager_base.hpp.
+ */
+
+#ifndef PATH_MANAGER_CORE_H
+#define PATH_MANAGER_CORE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "rosplane/algorithm_core.hpp"
+
+namespace rosplane
+{
+
+/**
+ * Keeps the list of waypoints of the mission, and turns it into the current path for the path
+ * follower.
+ */
+class PathManagerCore : public AlgorithmCore
+{
+public:
+  struct Waypoint
+  {
+    float w[3];
+    float chi_d;
+    bool use_chi;
+    float va_d;
+  };
+
+  struct Input
+  {
+    float pn;  /** position north */
+    float pe;  /** position east */
+    float h;   /** altitude */
+    float chi; /** course angle */
+  };
+
+  struct Output
+  {
+    bool flag;    /** Inicates strait line or orbital path (true is line, false is orbit) */
+    float va_d;   /** Desired airspeed (m/s) */
+    float r[3];   /** Vector to origin of straight line path (m) */
+    float q[3];   /** Unit vector, desired direction of travel for line path */
+    float c[3];   /** Center of orbital path (m) */
+    float rho;    /** Radius of orbital path (m) */
+    int8_t lamda; /** Direction of orbital path (cw is 1, ccw is -1) */
+  };
+
+  /**
+   * Declares the parameters of the mission geometry, starting with an empty list of waypoints.
+   */
+  explicit PathManagerCore(const CoreContext & context);
+
+  /**
+   * @brief Manages the current path based on the stored waypoint list
+   * 
+   * @param input: Input object that contains information about the waypoint
+   * @param output: Output object that contains the parameters for the desired type of line, based on the current and next waypoints
+   */
+  virtual void manage(const Input & input, Output & output) = 0;
+
+  /**
+   * @brief Clears the list of waypoints, and notifies the manager
+   */
+  void clear_waypoints();
+
+  /**
+   * @brief Adds waypoints to the end of the list, and notifies the manager once for all of them.
+   * If the list was empty, a temporary waypoint is added first at the position of the aircraft,
+   * to define a line to the first waypoint.
+   *
+   * @param waypoints: The waypoints to add
+   * @param input: State of the aircraft, where the temporary waypoint is placed
+   */
+  void add_waypoints(const std::vector<Waypoint> & waypoints, const Input & input);
+
+  /**
+   * @brief Drops the waypoints that have been passed, to keep the list bounded on a long mission.
+   * The one most recently achieved starts the current leg, so it stays.
+   *
+   * @return Number of waypoints that were removed
+   */
+  int erase_passed_waypoints();
+
+  /**
+   * @return Number of waypoints in the list, including the temporary waypoint.
+   */
+  int num_waypoints() const { return num_waypoints_; }
+
+  /**
+   * @return Index of the waypoint that was most recently achieved.
+   */
+  int current_waypoint() const { return idx_a_; }
+
+  /**
+   * Progress along the mission, as measured by the manager. The distance (m) and time (s) to the
+   * last waypoint are only meaningful while mission_progress_valid is true.
+   */
+  bool mission_progress_valid() const { return mission_progress_valid_; }
+  float distance_to_go() const { return distance_to_go_; }
+  float time_to_go() const { return time_to_go_; }
+
+protected:
+  std::vector<Waypoint> waypoints_; /** Vector of waypoints maintained by path_manager */
+  int num_waypoints_;
+  int idx_a_; /** index to the waypoint that was most recently achieved */
+
+  bool temp_waypoint_ = false;
+  int orbit_dir_ = 0;
+
+  /**
+   * Handles to the parameters declared by this class, so that the path manager and its children can
+   * read them without a lookup.
+   */
+  ParamHandle<double> R_min_;
+  ParamHandle<double> default_altitude_;
+  ParamHandle<double> default_airspeed_;
+
+  /**
+   * @brief Called after waypoints are added to or cleared from the list, so that a manager can
+   * update the geometry it keeps for the mission outside of manage
+   *
+   * @param first_changed: Index of the first waypoint that was added, 0 when the list was cleared
+   */
+  virtual void waypoints_changed(int /*first_changed*/) {}
+
+  /**
+   * @brief Called after waypoints are removed from the front of the list to keep the mission
+   * window bounded, so that a manager can drop the geometry it keeps for them. idx_a_ has already
+   * been moved back by the number of waypoints removed.
+   *
+   * @param count: Number of waypoints that were removed
+   */
+  virtual void waypoints_erased(int /*count*/) {}
+
+  /**
+   * Progress along the mission, reported in the diagnostics. A manager that can measure it sets
+   * mission_progress_valid_ and keeps the distance and time up to date in manage.
+   */
+  bool mission_progress_valid_ = false;
+  float distance_to_go_ = 0.0f; /** Distance along the legs to the last waypoint (m) */
+  float time_to_go_ = 0.0f;     /** Time to the last waypoint at the commanded airspeeds (s) */
+
+private:
+  /**
+   * @brief Adds a waypoint to the end of the list. Does not notify the manager, so that a batch
+   * can be added before it does.
+   *
+   * @param waypoint: The waypoint to add
+   * @param input: State of the aircraft, where the temporary waypoint is placed
+   */
+  void add_waypoint(const Waypoint & waypoint, const Input & input);
+};
+
+} // namespace rosplane
+
+#endif // PATH_MANAGER_CORE_H
@@ -0,0 +1,238 @@
+#ifndef PATH_MANAGER_EXAMPLE_CORE_H
+#define PATH_MANAGER_EXAMPLE_CORE_H
+
+#include <chrono>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "rosplane/path_manager_core.hpp"
+
+#define M_PI_F 3.14159265358979323846f
+#define M_PI_2_F 1.57079632679489661923f
+
+namespace rosplane
+{
+
+enum class FilletState
+{
+  STRAIGHT,
+  TRANSITION,
+  ORBIT
+};
+
+enum class DubinState
+{
+  FIRST,
+  BEFORE_H1,
+  BEFORE_H1_WRONG_SIDE,
+  STRAIGHT,
+  BEFORE_H3,
+  BEFORE_H3_WRONG_SIDE
+};
+
+class PathManagerExampleCore : public PathManagerCore
+{
+public:
+  explicit PathManagerExampleCore(const CoreContext & context);
+
+  /**
+   * @brief Determines the line type and calculates the line parameters to publish to path_follower
+   */
+  virtual void manage(const Input & input, Output & output);
+
+private:
+  std::chrono::time_point<std::chrono::system_clock> start_time_;
+  FilletState fil_state_;
+
+  bool first_;
+
+  /**
+   * @brief Calculates the most convenient orbit direction based on the orientation of the vehicle relative to the orbit center
+   * 
+   * @param pn: North position of the vehicle
+   * @param p3: East position of the vehicle
+   * @param c_n: North position of the orbit center
+   * @param c_e: East position of the orbit center
+   * 
+   * @return Integer value representing the orbit direction (-1 or 1)
+   */
+  int orbit_direction(float pn, float pe, float chi, float c_n, float c_e);
+
+  /**
+   * @brief Increments the indices of the waypoints currently used in the "manage" calculations
+   * 
+   * @param idx_a: Index of the most recently achieved point
+   * @param idx_b: Index of the next target waypoint
+   * @param idx_c: Index of the waypoint after the next target waypoint
+   * @param input: Struct containing the state of the vehicle
+   * @param output: Struct that will contain all of the information about the desired line to pass to the path follower
+   */
+  void increment_indices(int & idx_a, int & idx_b, int & idx_c, const Input & input,
+                         Output & output);
+
+  /**
+   * @brief Manages a straight line segment. Calculates the appropriate line parameters to send to the path follower
+   * 
+   * @param input: Input struct that contains some of the state of the vehicle
+   * @param output: Output struct containing the information about the desired line
+   */
+  void manage_line(const Input & input, Output & output);
+
+  /**
+   * @brief Manages a fillet line segment. Calculates the appropriate line parameters to send to the path follower
+   * 
+   * @param input: Input struct that contains some of the state of the vehicle
+   * @param output: Output struct containing the information about the desired line
+   */
+  void manage_fillet(const Input & input, Output & output);
+
+  /**
+   * @brief Manages a Dubins path segment. Calculates the appropriate line parameters to send to the path follower
+   * 
+   * @param input: Input struct that contains some of the state of the vehicle
+   * @param output: Output struct containing the information about the desired line
+   */
+  void manage_dubins(const Input & input, Output & output);
+
+  DubinState dub_state_;
+
+  struct DubinsPath
+  {
+
+    Eigen::Vector3f ps; /** the start position */
+    float chis;         /** the start course angle */
+    Eigen::Vector3f pe; /** the end position */
+    float chie;         /** the end course angle */
+    float R;            /** turn radius */
+    float L;            /** length of the path */
+    Eigen::Vector3f cs; /** center of the start circle */
+    int lams;           /** direction of the start circle */
+    Eigen::Vector3f ce; /** center of the endcircle */
+    int lame;           /** direction of the end circle */
+    Eigen::Vector3f w1; /** vector defining half plane H1 */
+    Eigen::Vector3f q1; /** unit vector along striaght line path */
+    Eigen::Vector3f w2; /** vector defining half plane H2 */
+    Eigen::Vector3f w3; /** vector defining half plane H3 */
+    Eigen::Vector3f q3; /** unit vector defining direction of half plane H3 */
+  };
+  DubinsPath dubins_path_;
+
+  /**
+   * Geometry of the leg from a waypoint to the next one, and of the turn from it into the leg after
+   * that. It only depends on the waypoints and R_min, so it is computed when the waypoints change
+   * and manage only has to test the half planes against it.
+   */
+  struct Segment
+  {
+    Eigen::Vector3f q;         /** unit vector along the leg */
+    Eigen::Vector3f q_next;    /** unit vector along the next leg */
+    Eigen::Vector3f n;         /** normal of the half plane bisecting the turn into the next leg */
+    float length;              /** length of the leg (m) */
+    float max_r;               /** largest fillet radius that fits the turn into the next leg (m) */
+    Eigen::Vector3f z1;        /** point on the half plane where the fillet begins */
+    Eigen::Vector3f z2;        /** point on the half plane where the fillet ends */
+    Eigen::Vector3f c;         /** center of the fillet */
+    int8_t lamda;              /** direction of the fillet (cw is 1, ccw is -1) */
+    bool dubins_valid;         /** true if the waypoints are far enough apart for a Dubins path */
+    DubinsPath dubins;         /** Dubins path from the waypoint to the next one */
+    float distance_from_start; /** length of the legs before this one (m) */
+    float time_from_start;     /** time to fly the legs before this one (s) */
+  };
+  std::vector<Segment> segments_; /** Segment starting at each waypoint, parallel to waypoints_ */
+  double segments_R_min_;         /** R_min the segments were computed with */
+
+  /**
+   * @brief Updates the segments after waypoints were added to or cleared from the list
+   *
+   * @param first_changed: Index of the first waypoint that was added, 0 when the list was cleared
+   */
+  virtual void waypoints_changed(int first_changed);
+
+  /**
+   * @brief Recomputes the geometry of the segments from the given index to the end of the list, and
+   * the distance and time before each segment
+   *
+   * @param first: Index of the first segment to recompute
+   */
+  void update_segments(int first);
+
+  /**
+   * @brief Drops the segments of the waypoints removed from the front of the mission window
+   *
+   * @param count: Number of waypoints that were removed
+   */
+  virtual void waypoints_erased(int count);
+
+  /**
+   * @brief Removes the first waypoint from the list, along with its segment
+   */
+  void erase_first_waypoint();
+
+  /**
+   * @brief Removes the segments of waypoints that were removed from the front of the list, and
+   * recomputes the segments that wrap back to the new first waypoint
+   *
+   * @param count: Number of waypoints that were removed
+   */
+  void erase_first_segments(int count);
+
+  /**
+   * @brief Updates the distance and time to the last waypoint from the segments
+   *
+   * @param input: Input struct that contains some of the state of the vehicle
+   */
+  void update_mission_progress(const Input & input);
+
+  /**
+   * @brief Starts following the Dubins path of a segment. If the segment is too short for a Dubins
+   * path, the previous path is kept
+   *
+   * @param idx: Index of the segment
+   */
+  void load_dubins_path(int idx);
+
+  /**
+   * @brief Calculates the parameters of a Dubins path
+   * 
+   * @param start_node: Starting waypoint of the Dubins path
+   * @param end_node: Ending waypoint of the Dubins path
+   * @param R: Minimum turning radius R
+   * @param dubins_path: Filled with the parameters of the path
+   *
+   * @return False if the waypoints are closer than 2R, in which case dubins_path is not changed
+   */
+  bool dubins_parameters(const Waypoint start_node, const Waypoint end_node, float R,
+                         DubinsPath & dubins_path);
+
+  /**
+   * @brief Computes the rotation matrix for a rotation in the z plane (normal to the Dubins plane)
+   * 
+   * @param theta: Rotation angle
+   * 
+   * @return 3x3 rotation matrix
+   */
+  Eigen::Matrix3f rotz(float theta);
+
+  /**
+   * @brief Wraps an angle to 2*PI
+   * 
+   * @param in: Angle to wrap
+   * 
+   * @return Angle wrapped to within 2*PI
+   */
+  float mo(float in);
+
+  /**
+   * This declares each parameter as a parameter so that the ROS2 parameter system can recognize each parameter.
+   * It also sets the default parameter, which will then be overridden by a parameter file
+   */
+  void declare_parameters();
+
+  /**
+   * Handle to the orbit_last parameter, read every time the path is managed.
+   */
+  ParamHandle<bool> orbit_last_;
+};
+} // namespace rosplane
+#endif // PATH_MANAGER_EXAMPLE_CORE_H
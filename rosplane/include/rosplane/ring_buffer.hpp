@@ -0,0 +1,99 @@
+/**
+ * @file ring_buffer.hpp
+ *
+ * Fixed capacity ring buffer, for histories that are written at a high rate.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace rosplane
+{
+
+/**
+ * Fixed capacity ring buffer. The storage is allocated when the capacity is set, and adding an
+ * element overwrites the oldest one once the buffer is full, so nothing is allocated while the
+ * buffer is in use. Elements are indexed from the oldest (0) to the newest (size() - 1).
+ */
+template<typename T>
+class RingBuffer
+{
+public:
+  explicit RingBuffer(std::size_t capacity = 0) { reset(capacity); }
+
+  /**
+   * @brief Clears the buffer and reallocates the storage for the given capacity.
+   */
+  void reset(std::size_t capacity)
+  {
+    storage_.assign(capacity, T());
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * @brief Clears the buffer, keeping the storage.
+   */
+  void clear()
+  {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * @brief Makes room for a new element at the back of the buffer, dropping the oldest element if
+   * the buffer is full.
+   *
+   * @return The new element, to be filled in by the caller. It holds whatever was stored in that
+   * slot before.
+   */
+  T & push()
+  {
+    assert(!storage_.empty());
+    std::size_t index = (head_ + size_) % storage_.size();
+    if (size_ < storage_.size()) {
+      size_++;
+    } else {
+      head_ = (head_ + 1) % storage_.size();
+    }
+    return storage_[index];
+  }
+
+  void push(const T & value) { push() = value; }
+
+  /**
+   * @brief Drops the oldest element, which must exist.
+   */
+  void pop_front()
+  {
+    assert(size_ > 0);
+    head_ = (head_ + 1) % storage_.size();
+    size_--;
+  }
+
+  T & operator[](std::size_t i) { return storage_[(head_ + i) % storage_.size()]; }
+  const T & operator[](std::size_t i) const { return storage_[(head_ + i) % storage_.size()]; }
+
+  T & front() { return (*this)[0]; }
+  const T & front() const { return (*this)[0]; }
+  T & back() { return (*this)[size_ - 1]; }
+  const T & back() const { return (*this)[size_ - 1]; }
+
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return storage_.size(); }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == storage_.size(); }
+
+private:
+  std::vector<T> storage_;
+  std::size_t head_; /**< Index of the oldest element in storage_ */
+  std::size_t size_;
+};
+
+} // namespace rosplane
+
+#endif // RING_BUFFER_H
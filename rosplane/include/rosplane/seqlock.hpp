@@ -0,0 +1,72 @@
+/**
+ * @file seqlock.hpp
+ *
+ * Sequence lock, for handing a small struct from one writer thread to reader threads without
+ * blocking either side.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace rosplane
+{
+
+/**
+ * Single writer sequence lock. The writer never waits, and a reader retries its copy if the writer
+ * was in the middle of a store, so the reader always gets a consistent value. Only one thread may
+ * store at a time.
+ */
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock can only hold trivially copyable types");
+
+public:
+  SeqLock()
+      : seq_(0)
+  {
+    std::memset(static_cast<void *>(&data_), 0, sizeof(T));
+  }
+
+  /**
+   * @brief Publishes a new value. Must only be called from the writer thread.
+   */
+  void store(const T & value)
+  {
+    unsigned seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void *>(&data_), &value, sizeof(T));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Returns a copy of the latest published value.
+   */
+  T load() const
+  {
+    T value;
+    unsigned seq_before;
+    unsigned seq_after;
+    do {
+      seq_before = seq_.load(std::memory_order_acquire);
+      std::memcpy(static_cast<void *>(&value), &data_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq_after = seq_.load(std::memory_order_relaxed);
+    } while ((seq_before & 1) || seq_before != seq_after);
+    return value;
+  }
+
+private:
+  std::atomic<unsigned> seq_; /**< Odd while a store is in progress */
+  T data_;
+};
+
+} // namespace rosplane
+
+#endif // SEQLOCK_H
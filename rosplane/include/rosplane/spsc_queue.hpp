@@ -0,0 +1,78 @@
+/**
+ * @file spsc_queue.hpp
+ *
+ * Bounded single producer, single consumer queue, for passing samples between threads without
+ * locking.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace rosplane
+{
+
+/**
+ * Bounded lock-free queue with one producer thread and one consumer thread. The storage is
+ * allocated on construction, so pushing and popping never allocate. If several threads consume,
+ * they must be serialized by the caller.
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+  explicit SpscQueue(std::size_t capacity)
+      : storage_(capacity + 1)
+      , head_(0)
+      , tail_(0)
+  {}
+
+  /**
+   * @brief Adds a value to the back of the queue. Must only be called by the producer.
+   *
+   * @return False if the queue is full, in which case the value is dropped.
+   */
+  bool push(const T & value)
+  {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t next = increment(tail);
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    storage_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Removes the value at the front of the queue. Must only be called by the consumer.
+   *
+   * @return False if the queue is empty.
+   */
+  bool pop(T & value)
+  {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = storage_[head];
+    head_.store(increment(head), std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const { return storage_.size() - 1; }
+
+private:
+  std::size_t increment(std::size_t i) const { return (i + 1) % storage_.size(); }
+
+  std::vector<T> storage_;
+  alignas(64) std::atomic<std::size_t> head_; /**< Next slot to pop, owned by the consumer */
+  alignas(64) std::atomic<std::size_t> tail_; /**< Next slot to push, owned by the producer */
+};
+
+} // namespace rosplane
+
+#endif // SPSC_QUEUE_H
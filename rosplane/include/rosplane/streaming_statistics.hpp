@@ -0,0 +1,182 @@
+/**
+ * @file streaming_statistics.hpp
+ *
+ * Constant memory statistics over a stream of samples, for calibrations that run on sensor
+ * callbacks.
+ */
+
+#ifndef STREAMING_STATISTICS_H
+#define STREAMING_STATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace rosplane
+{
+
+/**
+ * Running count, mean, variance, minimum and maximum of a stream of samples, using Welford's
+ * algorithm.
+ */
+class RunningStatistics
+{
+public:
+  RunningStatistics() { reset(); }
+
+  void reset()
+  {
+    count_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    min_ = std::numeric_limits<double>::infinity();
+    max_ = -std::numeric_limits<double>::infinity();
+  }
+
+  void add(double x)
+  {
+    count_++;
+    double delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+    min_ = std::min(min_, x);
+    max_ = std::max(max_, x);
+  }
+
+  std::size_t count() const { return count_; }
+  double mean() const { return mean_; }
+  double variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+  double stddev() const { return std::sqrt(variance()); }
+  double min() const { return min_; }
+  double max() const { return max_; }
+
+private:
+  std::size_t count_;
+  double mean_;
+  double m2_; /**< Sum of squared differences from the mean */
+  double min_;
+  double max_;
+};
+
+/**
+ * Streaming estimate of a single quantile with the P-squared algorithm (Jain and Chlamtac, 1985).
+ * Five markers are kept, so the memory used does not depend on the number of samples.
+ */
+class P2Quantile
+{
+public:
+  /**
+   * @param p: The quantile to estimate, between 0 and 1
+   */
+  explicit P2Quantile(double p)
+      : p_(p)
+  {
+    reset();
+  }
+
+  void reset() { count_ = 0; }
+
+  void add(double x)
+  {
+    // The first five samples initialize the markers.
+    if (count_ < 5) {
+      q_[count_++] = x;
+      if (count_ == 5) {
+        std::sort(q_, q_ + 5);
+        for (int i = 0; i < 5; i++) {
+          n_[i] = i;
+        }
+        np_[0] = 0.0;
+        np_[1] = 2.0 * p_;
+        np_[2] = 4.0 * p_;
+        np_[3] = 2.0 + 2.0 * p_;
+        np_[4] = 4.0;
+        dn_[0] = 0.0;
+        dn_[1] = p_ / 2.0;
+        dn_[2] = p_;
+        dn_[3] = (1.0 + p_) / 2.0;
+        dn_[4] = 1.0;
+      }
+      return;
+    }
+    count_++;
+
+    // Find the cell the sample falls in, extending the extreme markers if needed.
+    int k;
+    if (x < q_[0]) {
+      q_[0] = x;
+      k = 0;
+    } else if (x >= q_[4]) {
+      q_[4] = std::max(q_[4], x);
+      k = 3;
+    } else {
+      k = 0;
+      while (x >= q_[k + 1]) {
+        k++;
+      }
+    }
+
+    for (int i = k + 1; i < 5; i++) {
+      n_[i]++;
+    }
+    for (int i = 0; i < 5; i++) {
+      np_[i] += dn_[i];
+    }
+
+    // Move the middle markers toward their desired positions.
+    for (int i = 1; i < 4; i++) {
+      double d = np_[i] - n_[i];
+      if ((d >= 1.0 && n_[i + 1] - n_[i] > 1) || (d <= -1.0 && n_[i - 1] - n_[i] < -1)) {
+        int step = d > 0.0 ? 1 : -1;
+        double q = parabolic(i, step);
+        if (q_[i - 1] < q && q < q_[i + 1]) {
+          q_[i] = q;
+        } else {
+          q_[i] += step * (q_[i + step] - q_[i]) / (n_[i + step] - n_[i]);
+        }
+        n_[i] += step;
+      }
+    }
+  }
+
+  /**
+   * @return The current estimate of the quantile, or NaN if no samples were added
+   */
+  double value() const
+  {
+    if (count_ == 0) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (count_ < 5) {
+      // Too few samples for the markers, so use the nearest sample of the sorted set.
+      double sorted[5];
+      std::copy(q_, q_ + count_, sorted);
+      std::sort(sorted, sorted + count_);
+      return sorted[static_cast<std::size_t>(std::lround(p_ * (count_ - 1)))];
+    }
+    return q_[2];
+  }
+
+  std::size_t count() const { return count_; }
+
+private:
+  double parabolic(int i, int d) const
+  {
+    return q_[i]
+      + d / static_cast<double>(n_[i + 1] - n_[i - 1])
+      * ((n_[i] - n_[i - 1] + d) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i])
+         + (n_[i + 1] - n_[i] - d) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+  }
+
+  double p_;
+  std::size_t count_;
+  double q_[5];  /**< Marker heights */
+  long n_[5];    /**< Marker positions */
+  double np_[5]; /**< Desired marker positions */
+  double dn_[5]; /**< Desired position increments */
+};
+
+} // namespace rosplane
+
+#endif // STREAMING_STATISTICS_H
@@ -0,0 +1,72 @@
+/**
+ * @file telemetry_gate.hpp
+ *
+ * Policy for the debug and introspection telemetry of the autopilot nodes, which is only built
+ * when someone is listening, and then only as often as it is asked for.
+ */
+
+#ifndef TELEMETRY_GATE_H
+#define TELEMETRY_GATE_H
+
+#include <cstdint>
+
+#include <rclcpp/rclcpp.hpp>
+
+namespace rosplane
+{
+
+/**
+ * Decides on each tick of a loop whether a debug topic should be built and published. A message is
+ * published on every Nth tick, where N is the decimation, and only while the topic has
+ * subscribers, so tuning tools get their data without the flight loops paying for it the rest of
+ * the time. Flight-critical topics must not go through a gate.
+ */
+class TelemetryGate
+{
+public:
+  /**
+   * @brief Counts a tick of the loop and checks if the message should be built on it.
+   *
+   * @param decimation: Publish on every decimation-th tick, 1 for every tick and 0 or less to never
+   * publish
+   * @return True if the message is due this tick.
+   */
+  bool due(int64_t decimation)
+  {
+    if (decimation <= 0) {
+      count_ = 0;
+      return false;
+    }
+    if (++count_ < decimation) {
+      return false;
+    }
+    count_ = 0;
+    return true;
+  }
+
+  /**
+   * @brief Counts a tick of the loop and checks if the message should be built and published on it.
+   * The decimation only counts ticks while the topic has subscribers, so the first tick after a
+   * tool subscribes publishes.
+   *
+   * @param publisher: The publisher of the debug topic
+   * @param decimation: Publish on every decimation-th tick, 1 for every tick and 0 or less to never
+   * publish
+   * @return True if the message is due this tick and has at least one subscriber.
+   */
+  bool should_publish(const rclcpp::PublisherBase & publisher, int64_t decimation)
+  {
+    if (publisher.get_subscription_count() == 0) {
+      count_ = decimation - 1;
+      return false;
+    }
+    return due(decimation);
+  }
+
+private:
+  int64_t count_ = 0; /**< Ticks since the last message was published */
+};
+
+} // namespace rosplane
+
+#endif // TELEMETRY_GATE_H
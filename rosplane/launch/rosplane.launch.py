@@ -2,7 +2,8 @@ import os
 import sys
 import launch.actions
 from launch import LaunchDescription
-from launch_ros.actions import Node
+from launch_ros.actions import ComposableNodeContainer, Node
+from launch_ros.descriptions import ComposableNode
 from ament_index_python.packages import get_package_share_directory
 
 
@@ -14,6 +15,7 @@ def generate_launch_description():
     control_type = "default"
     aircraft = "anaconda" # Default aircraft
     use_params = 'false'
+    single_container = 'false'
 
     for arg in sys.argv:
         if arg.startswith("control_type:="):
@@ -25,12 +27,18 @@ def generate_launch_description():
         if arg.startswith("seed_estimator:="):
             use_params = arg.split(":=")[1].lower()
 
+        if arg.startswith("single_container:="):
+            single_container = arg.split(":=")[1].lower()
+
     autopilot_params = os.path.join(
         rosplane_dir,
         'params',
         aircraft + '_autopilot_params.yaml'
     )
 
+    if single_container == 'true':
+        return generate_container_description(autopilot_params, control_type, use_params)
+
     return LaunchDescription([
         launch.actions.DeclareLaunchArgument(
             'command_publisher_remap',
@@ -80,3 +88,74 @@ def generate_launch_description():
             arguments = [use_params]
         )
     ])
+
+
+def generate_container_description(autopilot_params, control_type, use_params):
+    # Load every node into one multithreaded container, so messages between the nodes are passed
+    # within the process instead of being serialized.
+    intra_process = [{'use_intra_process_comms': True}]
+
+    if control_type == "total_energy":
+        controller_plugin = 'rosplane::ControllerTotalEnergy'
+    else:
+        controller_plugin = 'rosplane::ControllerSucessiveLoop'
+
+    return LaunchDescription([
+        launch.actions.DeclareLaunchArgument(
+            'command_publisher_remap',
+            default_value='/command',
+        ),
+        launch.actions.DeclareLaunchArgument(
+            'controller_command_publisher_remap',
+            default_value='/controller_command',
+        ),
+        ComposableNodeContainer(
+            name='rosplane_container',
+            namespace='',
+            package='rclcpp_components',
+            executable='component_container_mt',
+            output='screen',
+            composable_node_descriptions=[
+                ComposableNode(
+                    package='rosplane',
+                    plugin=controller_plugin,
+                    name='autopilot',
+                    parameters=[autopilot_params],
+                    remappings=[
+                        ('/command', launch.substitutions.LaunchConfiguration('command_publisher_remap'))
+                    ],
+                    extra_arguments=intra_process
+                ),
+                ComposableNode(
+                    package='rosplane',
+                    plugin='rosplane::PathFollowerExample',
+                    name='path_follower',
+                    parameters=[autopilot_params],
+                    remappings=[
+                        ('/controller_command', launch.substitutions.LaunchConfiguration('controller_command_publisher_remap'))
+                    ],
+                    extra_arguments=intra_process
+                ),
+                ComposableNode(
+                    package='rosplane',
+                    plugin='rosplane::PathManagerExample',
+                    name='path_manager',
+                    parameters=[autopilot_params],
+                    extra_arguments=intra_process
+                ),
+                ComposableNode(
+                    package='rosplane',
+                    plugin='rosplane::PathPlanner',
+                    name='path_planner',
+                    extra_arguments=intra_process
+                ),
+                ComposableNode(
+                    package='rosplane',
+                    plugin='rosplane::EstimatorContinuousDiscrete',
+                    name='estimator',
+                    parameters=[autopilot_params, {'seed_estimator': use_params == 'true'}],
+                    extra_arguments=intra_process
+                )
+            ]
+        )
+    ])
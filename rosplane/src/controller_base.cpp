@@ -2,16 +2,15 @@
 
 #include <rclcpp/logging.hpp>
 
-#include "controller_successive_loop.hpp"
-#include "controller_total_energy.hpp"
-
 #include "controller_base.hpp"
+#include "realtime_profile.hpp"
 
 namespace rosplane
 {
 
-ControllerBase::ControllerBase()
-    : Node("controller_base")
+ControllerBase::ControllerBase(const rclcpp::NodeOptions & options,
+                               const CoreFactory & make_controller)
+    : Node("controller_base", options)
     , params_(this)
     , params_initialized_(false)
 {
@@ -20,6 +19,8 @@ ControllerBase::ControllerBase()
   actuators_pub_ = this->create_publisher<rosflight_msgs::msg::Command>("command", 10);
   controller_internals_pub_ =
     this->create_publisher<rosplane_msgs::msg::ControllerInternals>("controller_internals", 10);
+  diagnostics_pub_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
 
   // Advertise subscribed topics and set bound callbacks.
   controller_commands_sub_ = this->create_subscription<rosplane_msgs::msg::ControllerCommands>(
@@ -29,6 +30,8 @@ ControllerBase::ControllerBase()
 
   // This flag indicates whether the first set of commands have been received.
   command_recieved_ = false;
+  state_recieved_ = false;
+  last_tick_valid_ = false;
 
   // Set the parameter callback, for when parameters are changed.
   parameter_callback_handle_ = this->add_on_set_parameters_callback(
@@ -38,19 +41,29 @@ ControllerBase::ControllerBase()
   declare_parameters();
   // Set the values for the parameters, from the param file or use the deafault value.
   params_.set_parameters();
+  update_overrun_policy();
+
+  // Build the control algorithm, which declares its own parameters and builds its gains.
+  controller_ = make_controller(CoreContext{params_, this->get_logger(), this->get_clock()});
 
   params_initialized_ = true;
 
   set_timer();
+
+  diagnostics_timer_ =
+    this->create_wall_timer(1s, std::bind(&ControllerBase::diagnostics_publish, this));
 }
 
 void ControllerBase::declare_parameters()
 {
   // Declare default parameters associated with this controller, controller_base
-  params_.declare_double("pwm_rad_e", 1.0);
-  params_.declare_double("pwm_rad_a", 1.0);
-  params_.declare_double("pwm_rad_r", 1.0);
-  params_.declare_double("controller_output_frequency", 100.0);
+  controller_output_frequency_ = params_.declare_double("controller_output_frequency", 100.0);
+  state_triggered_control_ = params_.declare_bool("state_triggered_control", false);
+  state_timeout_ = params_.declare_double("state_timeout", 0.25);
+  controller_overrun_factor_ = params_.declare_double("controller_overrun_factor", 3.0);
+  controller_overrun_policy_ = params_.declare_string("controller_overrun_policy", "scale");
+  controller_internals_decimation_ = params_.declare_int("controller_internals_decimation", 1);
+  declare_realtime_parameters(params_);
 }
 
 void ControllerBase::controller_commands_callback(
@@ -69,13 +82,135 @@ void ControllerBase::vehicle_state_callback(const rosplane_msgs::msg::State::Sha
 
   // Save the message to use in calculations.
   vehicle_state_ = *msg;
+
+  // Take the time step from the state stamps, so the control update follows the estimator rather
+  // than the transport. This is left at zero on the first state, or if the stamps are out of order
+  // or further apart than the staleness timeout.
+  double Ts = 0.0;
+  rclcpp::Time stamp(msg->header.stamp);
+  if (state_recieved_) {
+    double stamp_dt = (stamp - last_state_stamp_).seconds();
+    if (stamp_dt > 0.0 && stamp_dt < state_timeout_) {
+      Ts = stamp_dt;
+    }
+  }
+  last_state_stamp_ = stamp;
+  last_state_time_ = this->get_clock()->now();
+  state_recieved_ = true;
+
+  if (!state_triggered_control_) {
+    return;
+  }
+
+  // A time step of zero, when the stamps could not give one, falls back to the nominal period.
+  actuator_controls_publish(Ts);
+}
+
+void ControllerBase::timer_callback()
+{
+  // Measure the time since the last tick on the steady clock, so the control loops integrate over
+  // the period the timer actually ran at.
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double Ts = last_tick_valid_ ? std::chrono::duration<double>(now - last_tick_).count() : 0.0;
+  last_tick_ = now;
+  last_tick_valid_ = true;
+
+  if (!state_triggered_control_) {
+    actuator_controls_publish(Ts);
+    return;
+  }
+
+  // The state is driving the controller, the timer only watches for the state going stale.
+  if (state_recieved_) {
+    double time_since_state = (this->get_clock()->now() - last_state_time_).seconds();
+    if (time_since_state > state_timeout_) {
+      RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                                  "State is stale (" << time_since_state
+                                                     << " s since last message). Commanding "
+                                                        "neutral surfaces and zero throttle.");
+      failsafe_publish();
+    }
+  }
+}
+
+double ControllerBase::bound_time_step(double Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double frequency = controller_output_frequency_;
+  double overrun_factor = controller_overrun_factor_;
+  bool state_triggered = state_triggered_control_;
+
+  double nominal_Ts = 1.0 / frequency;
+
+  if (!std::isfinite(Ts) || Ts <= 0.0) {
+    return nominal_Ts;
+  }
+
+  // Ticks that bunch up after a late one would otherwise give steps too short to differentiate
+  // over. The steps of a state triggered controller come from the state stamps, which do not
+  // bunch up and may be much shorter than the nominal period, so they are kept as they are.
+  if (!state_triggered && Ts < nominal_Ts / overrun_factor) {
+    return nominal_Ts / overrun_factor;
+  }
+
+  if (Ts > overrun_factor * nominal_Ts) {
+    bool skip = overrun_policy_ == OverrunPolicy::SKIP;
+    RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                                "Control time step of " << Ts << " s is over " << overrun_factor
+                                                        << " periods, applying the "
+                                                        << (skip ? "skip" : "scale")
+                                                        << " overrun policy.");
+    return skip ? nominal_Ts : overrun_factor * nominal_Ts;
+  }
+
+  return Ts;
+}
+
+void ControllerBase::update_overrun_policy()
+{
+  std::string policy = controller_overrun_policy_;
+  if (policy == "skip") {
+    overrun_policy_ = OverrunPolicy::SKIP;
+  } else {
+    if (policy != "scale") {
+      RCLCPP_WARN_STREAM(this->get_logger(),
+                         "Unknown controller_overrun_policy " << policy << ", using scale.");
+    }
+    overrun_policy_ = OverrunPolicy::SCALE;
+  }
+}
+
+void ControllerBase::failsafe_publish()
+{
+  // Only take over once the controller has started commanding the actuators.
+  if (!command_recieved_) {
+    return;
+  }
+
+  auto actuators = std::make_unique<rosflight_msgs::msg::Command>();
+  actuators->header.stamp = this->get_clock()->now();
+  actuators->ignore = 0;
+  actuators->mode = rosflight_msgs::msg::Command::MODE_PASS_THROUGH;
+  actuators->qx = 0.0f;
+  actuators->qy = 0.0f;
+  actuators->qz = 0.0f;
+  actuators->fx = 0.0f;
+
+  actuators_pub_->publish(std::move(actuators));
 }
 
-void ControllerBase::actuator_controls_publish()
+void ControllerBase::actuator_controls_publish(double Ts)
 {
 
+  // The loop timing is measured against the interval of the state stamps when the state is driving
+  // the controller, and against the timer period otherwise.
+  double nominal_Ts = 1.0 / controller_output_frequency_;
+  control_timing_.tick(state_triggered_control_ && Ts > 0.0 ? Ts : nominal_Ts);
+
   // Assemble inputs for the control algorithm.
-  Input input;
+
+  ControllerCore::Input input;
+  input.Ts = bound_time_step(Ts);
   input.h = -vehicle_state_.position[2];
   input.va = vehicle_state_.va;
   input.phi = vehicle_state_.phi;
@@ -88,63 +223,95 @@ void ControllerBase::actuator_controls_publish()
   input.h_c = controller_commands_.h_c;
   input.chi_c = controller_commands_.chi_c;
   input.phi_ff = controller_commands_.phi_ff;
+  input.phi_c = controller_commands_.phi_c;
+  input.theta_c = controller_commands_.theta_c;
+  input.roll_override = controller_commands_.roll_command_override;
+  input.pitch_override = controller_commands_.pitch_command_override;
 
-  Output output;
+  ControllerCore::Output output;
 
   // If a command was received, begin control.
   if (command_recieved_ == true) {
 
     // Control based off of inputs and parameters.
-    control(input, output);
+    control_timing_.measure([&] { controller_->control(input, output); });
 
     // Convert control outputs to pwm.
-    convert_to_pwm(output);
+    controller_->convert_to_pwm(output);
 
-    rosflight_msgs::msg::Command actuators;
+    auto actuators = std::make_unique<rosflight_msgs::msg::Command>();
 
     // Find the current time, and save as a timestamp.
     rclcpp::Time now = this->get_clock()->now();
 
     // Attach the timestamp.
-    actuators.header.stamp = now;
+    actuators->header.stamp = now;
 
     // Do not ignore any of the actuators.
-    actuators.ignore = 0;
+    actuators->ignore = 0;
 
     // Indicate that commands are for the actuators directly.
-    actuators.mode = rosflight_msgs::msg::Command::MODE_PASS_THROUGH;
+    actuators->mode = rosflight_msgs::msg::Command::MODE_PASS_THROUGH;
 
     // Package control efforts. If the output is infinite replace with 0.
-    actuators.qx = (std::isfinite(output.delta_a)) ? output.delta_a : 0.0f;
-    actuators.qy = (std::isfinite(output.delta_e)) ? output.delta_e : 0.0f;
-    actuators.qz = (std::isfinite(output.delta_r)) ? output.delta_r : 0.0f;
-    actuators.fx = (std::isfinite(output.delta_t)) ? output.delta_t : 0.0f;
+    actuators->qx = (std::isfinite(output.delta_a)) ? output.delta_a : 0.0f;
+    actuators->qy = (std::isfinite(output.delta_e)) ? output.delta_e : 0.0f;
+    actuators->qz = (std::isfinite(output.delta_r)) ? output.delta_r : 0.0f;
+    actuators->fx = (std::isfinite(output.delta_t)) ? output.delta_t : 0.0f;
 
     // Publish actuators.
-    actuators_pub_->publish(actuators);
+    actuators_pub_->publish(std::move(actuators));
+
+    // Trace the latency from the IMU sample the state was computed from, once there is one.
+    rclcpp::Time origin(vehicle_state_.origin_stamp);
+    if (state_recieved_ && origin.nanoseconds() > 0) {
+      imu_to_actuator_latency_.record((now - origin).seconds());
+    }
 
-    // Publish the current control values
-    rosplane_msgs::msg::ControllerInternals controller_internals;
-    controller_internals.header.stamp = now;
-    controller_internals.phi_c = output.phi_c;
-    controller_internals.theta_c = output.theta_c;
+    // Publish the current control values, when a tuning tool is listening for them.
+    if (!controller_internals_gate_.should_publish(*controller_internals_pub_,
+                                                   controller_internals_decimation_)) {
+      return;
+    }
+    auto controller_internals = std::make_unique<rosplane_msgs::msg::ControllerInternals>();
+    controller_internals->header.stamp = now;
+    controller_internals->origin_stamp = vehicle_state_.origin_stamp;
+    controller_internals->phi_c = output.phi_c;
+    controller_internals->theta_c = output.theta_c;
     switch (output.current_zone) {
       case AltZones::TAKE_OFF:
-        controller_internals.alt_zone = controller_internals.ZONE_TAKE_OFF;
+        controller_internals->alt_zone = controller_internals->ZONE_TAKE_OFF;
         break;
       case AltZones::CLIMB:
-        controller_internals.alt_zone = controller_internals.ZONE_CLIMB;
+        controller_internals->alt_zone = controller_internals->ZONE_CLIMB;
         break;
       case AltZones::ALTITUDE_HOLD:
-        controller_internals.alt_zone = controller_internals.ZONE_ALTITUDE_HOLD;
+        controller_internals->alt_zone = controller_internals->ZONE_ALTITUDE_HOLD;
         break;
       default:
         break;
     }
-    controller_internals_pub_->publish(controller_internals);
+    controller_internals_pub_->publish(std::move(controller_internals));
   }
 }
 
+void ControllerBase::diagnostics_publish()
+{
+  // Skip building the diagnostics while nothing is listening. The statistics keep accumulating, so
+  // the first array published covers the whole time since the last one.
+  if (diagnostics_pub_->get_subscription_count() == 0) {
+    return;
+  }
+
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = this->get_clock()->now();
+  msg->status.push_back(imu_to_actuator_latency_.status(
+    std::string(this->get_name()) + ": IMU to actuator latency", this->get_name()));
+  msg->status.push_back(control_timing_.status(
+    std::string(this->get_name()) + ": control loop timing", this->get_name()));
+  diagnostics_pub_->publish(std::move(msg));
+}
+
 rcl_interfaces::msg::SetParametersResult
 ControllerBase::parametersCallback(const std::vector<rclcpp::Parameter> & parameters)
 {
@@ -159,8 +326,11 @@ ControllerBase::parametersCallback(const std::vector<rclcpp::Parameter> & parame
   }
 
   if (params_initialized_ && success) {
+    controller_->update_gains();
+    update_overrun_policy();
+
     std::chrono::microseconds curr_period = std::chrono::microseconds(
-      static_cast<long long>(1.0 / params_.get_double("controller_output_frequency") * 1'000'000));
+      static_cast<long long>(1.0 / controller_output_frequency_ * 1'000'000));
     if (timer_period_ != curr_period) {
       timer_->cancel();
       set_timer();
@@ -173,50 +343,13 @@ ControllerBase::parametersCallback(const std::vector<rclcpp::Parameter> & parame
 void ControllerBase::set_timer()
 {
 
-  double frequency = params_.get_double("controller_output_frequency");
+  double frequency = controller_output_frequency_;
   timer_period_ = std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1'000'000));
+  control_timing_.set_period(1.0 / frequency);
 
-  // Set timer to trigger bound callback (actuator_controls_publish) at the given periodicity.
-  timer_ = this->create_wall_timer(timer_period_,
-                                   std::bind(&ControllerBase::actuator_controls_publish, this));
-}
-
-void ControllerBase::convert_to_pwm(Output & output)
-{
-
-  // Assign parameters from parameters object
-  double pwm_rad_e = params_.get_double("pwm_rad_e");
-  double pwm_rad_a = params_.get_double("pwm_rad_a");
-  double pwm_rad_r = params_.get_double("pwm_rad_r");
-
-  // Multiply each control effort (in radians) by a scaling factor to a pwm.
-  // TODO investigate why this is named "pwm". The actual scaling to pwm happens in rosflight_io.
-  output.delta_e = output.delta_e * pwm_rad_e;
-  output.delta_a = output.delta_a * pwm_rad_a;
-  output.delta_r = output.delta_r * pwm_rad_r;
+  // Set timer to trigger bound callback (timer_callback) at the given periodicity.
+  timer_ =
+    this->create_wall_timer(timer_period_, std::bind(&ControllerBase::timer_callback, this));
 }
 
-} // namespace rosplane
-
-int main(int argc, char * argv[])
-{
-
-  // Initialize ROS2 and then begin to spin control node.
-  rclcpp::init(argc, argv);
-
-  if (strcmp(argv[1], "total_energy") == 0) {
-    auto node = std::make_shared<rosplane::ControllerTotalEnergy>();
-    RCLCPP_INFO_STREAM(node->get_logger(), "Using total energy control.");
-    rclcpp::spin(node);
-  } else if (strcmp(argv[1], "default") == 0) {
-    auto node = std::make_shared<rosplane::ControllerSucessiveLoop>();
-    RCLCPP_INFO_STREAM(node->get_logger(), "Using default control.");
-    rclcpp::spin(node);
-  } else {
-    auto node = std::make_shared<rosplane::ControllerSucessiveLoop>();
-    RCLCPP_INFO_STREAM(node->get_logger(), "Invalid control type, using default control.");
-    rclcpp::spin(node);
-  }
-
-  return 0;
-}
+} // namespace rosplane
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include "rosplane/controller_core.hpp"
+
+namespace rosplane
+{
+
+ControllerCore::ControllerCore(const CoreContext & context)
+    : AlgorithmCore(context)
+{
+  // Declare default parameters associated with this controller, controller_core
+  pwm_rad_e_ = params_.declare_double("pwm_rad_e", 1.0);
+  pwm_rad_a_ = params_.declare_double("pwm_rad_a", 1.0);
+  pwm_rad_r_ = params_.declare_double("pwm_rad_r", 1.0);
+}
+
+void ControllerCore::convert_to_pwm(Output & output)
+{
+
+  // Assign parameters from parameters object
+  double pwm_rad_e = pwm_rad_e_;
+  double pwm_rad_a = pwm_rad_a_;
+  double pwm_rad_r = pwm_rad_r_;
+
+  // Multiply each control effort (in radians) by a scaling factor to a pwm.
+  // TODO investigate why this is named "pwm". The actual scaling to pwm happens in rosflight_io.
+  output.delta_e = output.delta_e * pwm_rad_e;
+  output.delta_a = output.delta_a * pwm_rad_a;
+  output.delta_r = output.delta_r * pwm_rad_r;
+}
+
+} // namespace rosplane
@@ -0,0 +1,32 @@
+#include <cstring>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include "controller_successive_loop.hpp"
+#include "controller_total_energy.hpp"
+#include "realtime_profile.hpp"
+
+int main(int argc, char * argv[])
+{
+
+  // Initialize ROS2 and then begin to spin control node.
+  rclcpp::init(argc, argv);
+
+  std::shared_ptr<rosplane::ControllerBase> node;
+  if (strcmp(argv[1], "total_energy") == 0) {
+    node = std::make_shared<rosplane::ControllerTotalEnergy>();
+    RCLCPP_INFO_STREAM(node->get_logger(), "Using total energy control.");
+  } else if (strcmp(argv[1], "default") == 0) {
+    node = std::make_shared<rosplane::ControllerSucessiveLoop>();
+    RCLCPP_INFO_STREAM(node->get_logger(), "Using default control.");
+  } else {
+    node = std::make_shared<rosplane::ControllerSucessiveLoop>();
+    RCLCPP_INFO_STREAM(node->get_logger(), "Invalid control type, using default control.");
+  }
+
+  rosplane::apply_realtime_profile(rosplane::realtime_profile_from_parameters(*node),
+                                   node->get_logger());
+  rclcpp::spin(node);
+
+  return 0;
+}
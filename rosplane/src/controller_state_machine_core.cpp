@@ -1,9 +1,10 @@
-#include "controller_state_machine.hpp"
+#include "rosplane/controller_state_machine_core.hpp"
 
 namespace rosplane
 {
 
-ControllerStateMachine::ControllerStateMachine()
+ControllerStateMachineCore::ControllerStateMachineCore(const CoreContext & context)
+    : ControllerCore(context)
 {
 
   // Initialize controller in take_off zone.
@@ -16,12 +17,12 @@ ControllerStateMachine::ControllerStateMachine()
   params_.set_parameters();
 }
 
-void ControllerStateMachine::control(const Input & input, Output & output)
+void ControllerStateMachineCore::control(const Input & input, Output & output)
 {
 
   // For readability, declare parameters that will be used in this controller
-  double alt_toz = params_.get_double("alt_toz");
-  double alt_hz = params_.get_double("alt_hz");
+  double alt_toz = alt_toz_;
+  double alt_hz = alt_hz_;
 
   // This state machine changes the controls used based on the zone of flight path the aircraft is currently on.
   switch (current_zone_) {
@@ -90,11 +91,11 @@ void ControllerStateMachine::control(const Input & input, Output & output)
   output.current_zone = current_zone_;
 }
 
-void ControllerStateMachine::declare_parameters()
+void ControllerStateMachineCore::declare_parameters()
 {
   // Declare param with ROS2 and set the default value.
-  params_.declare_double("alt_toz", 5.0);
-  params_.declare_double("alt_hz", 10.0);
+  alt_toz_ = params_.declare_double("alt_toz", 5.0);
+  alt_hz_ = params_.declare_double("alt_hz", 10.0);
 }
 
 } // namespace rosplane
\ No newline at end of file
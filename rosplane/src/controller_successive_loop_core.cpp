@@ -0,0 +1,579 @@
+#include <cmath>
+#include <iostream>
+
+#include "rosplane/controller_successive_loop_core.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+double wrap_within_180(double fixed_heading, double wrapped_heading)
+{
+  // wrapped_heading - number_of_times_to_wrap * 2pi
+  return wrapped_heading - floor((wrapped_heading - fixed_heading) / (2 * M_PI) + 0.5) * 2 * M_PI;
+}
+
+} // namespace
+
+ControllerSucessiveLoopCore::ControllerSucessiveLoopCore(const CoreContext & context)
+    : ControllerStateMachineCore(context)
+{
+  // Initialize course hold, roll hold and pitch hold errors and integrators to zero.
+  c_error_ = 0;
+  c_integrator_ = 0;
+  r_error_ = 0;
+  r_integrator = 0;
+  p_error_ = 0;
+  p_integrator_ = 0;
+
+  // The airspeed, altitude and yaw damper loops start from rest as well.
+  at_error_ = 0;
+  at_integrator_ = 0;
+  at_differentiator_ = 0;
+  a_error_ = 0;
+  a_integrator_ = 0;
+  a_differentiator_ = 0;
+  delta_r_delay_ = 0;
+  r_delay_ = 0;
+
+  // Declare parameters associated with this controller, controller_state_machine
+  declare_parameters();
+  // Set parameters according to the parameters in the launch file, otherwise use the default values
+  params_.set_parameters();
+
+  // Build the first set of gains from the parameters.
+  update_gains();
+}
+
+void ControllerSucessiveLoopCore::control(const Input & input, Output & output)
+{
+  // Take one copy of the gains for the whole tick, so a parameter change can not land partway
+  // through it.
+  gains_ = gains_snapshot_.load();
+
+  ControllerStateMachineCore::control(input, output);
+}
+
+void ControllerSucessiveLoopCore::update_gains()
+{
+  Gains gains;
+
+  gains.course.kp = c_kp_;
+  gains.course.ki = c_ki_;
+  gains.course.kd = c_kd_;
+  gains.course.max_roll = max_roll_;
+
+  gains.roll.kp = r_kp_;
+  gains.roll.ki = r_ki_;
+  gains.roll.kd = r_kd_;
+  gains.roll.max_a = max_a_;
+  gains.roll.trim_a = trim_a_;
+  gains.roll.pwm_rad_a = pwm_rad_a_; // Declared in controller_core
+
+  gains.pitch.kp = p_kp_;
+  gains.pitch.ki = p_ki_;
+  gains.pitch.kd = p_kd_;
+  gains.pitch.max_e = max_e_;
+  gains.pitch.trim_e = trim_e_;
+  gains.pitch.pwm_rad_e = pwm_rad_e_; // Declared in controller_core
+
+  gains.airspeed.kp = a_t_kp_;
+  gains.airspeed.ki = a_t_ki_;
+  gains.airspeed.kd = a_t_kd_;
+  gains.airspeed.tau = tau_;
+  gains.airspeed.max_t = max_t_;
+  gains.airspeed.trim_t = trim_t_;
+
+  gains.altitude.kp = a_kp_;
+  gains.altitude.ki = a_ki_;
+  gains.altitude.kd = a_kd_;
+  gains.altitude.tau = tau_;
+  gains.altitude.max_pitch = max_pitch_;
+  gains.altitude.alt_hz = alt_hz_; // Declared in controller_state_machine
+
+  gains.yaw_damper.pwo = y_pwo_;
+  gains.yaw_damper.kr = y_kr_;
+  gains.yaw_damper.max_r = max_r_;
+
+  gains.max_takeoff_throttle = max_takeoff_throttle_;
+  gains.cmd_takeoff_pitch = cmd_takeoff_pitch_;
+  gains.roll_command_override = roll_command_override_;
+  gains.pitch_command_override = pitch_command_override_;
+
+  gains_snapshot_.store(gains);
+}
+
+void ControllerSucessiveLoopCore::take_off(const Input & input, Output & output)
+{
+  // Run lateral and longitudinal controls.
+  take_off_lateral_control(input, output);
+  take_off_longitudinal_control(input, output);
+}
+
+void ControllerSucessiveLoopCore::take_off_exit()
+{
+  // Put any code that should run as the airplane exits take off mode.
+}
+
+void ControllerSucessiveLoopCore::climb(const Input & input, Output & output)
+{
+  // Run lateral and longitudinal controls.
+  climb_lateral_control(input, output);
+  climb_longitudinal_control(input, output);
+}
+
+void ControllerSucessiveLoopCore::climb_exit()
+{
+  // Reset differentiators, integrators and errors.
+  at_error_ = 0;
+  at_integrator_ = 0;
+  at_differentiator_ = 0;
+  a_error_ = 0;
+  a_integrator_ = 0;
+  a_differentiator_ = 0;
+}
+
+void ControllerSucessiveLoopCore::altitude_hold(const Input & input, Output & output)
+{
+  // Run lateral and longitudinal controls.
+  alt_hold_lateral_control(input, output);
+  alt_hold_longitudinal_control(input, output);
+}
+
+void ControllerSucessiveLoopCore::altitude_hold_exit()
+{
+  // Reset integrators.
+  c_integrator_ = 0;
+}
+
+void ControllerSucessiveLoopCore::alt_hold_lateral_control(const Input & input, Output & output)
+{
+  // For readability, declare parameters here that will be used in this function
+  bool roll_override = gains_.roll_command_override;
+
+  // Set rudder command to zero, can use coordinated_turn_hold if implemented.
+  // Find commanded roll angle in order to achieve commanded course.
+  // Find aileron deflection required to achieve required roll angle.
+  output.delta_r = yaw_damper(input.r, input.Ts); //coordinated_turn_hold(input.beta, params)
+  output.phi_c = course_hold(input.chi_c, input.chi, input.phi_ff, input.r, input.Ts);
+
+  if (roll_override || input.roll_override) {
+    output.phi_c = input.phi_c;
+  }
+
+  output.delta_a = roll_hold(output.phi_c, input.phi, input.p, input.Ts);
+}
+
+void ControllerSucessiveLoopCore::alt_hold_longitudinal_control(const Input & input,
+                                                                Output & output)
+{
+  // For readability, declare parameters here that will be used in this function
+  double alt_hz = gains_.altitude.alt_hz;
+  bool pitch_override = gains_.pitch_command_override;
+
+  // Saturate the altitude command.
+  double adjusted_hc = adjust_h_c(input.h_c, input.h, alt_hz);
+
+  // Control airspeed with throttle loop and altitude with commanded pitch and drive aircraft to commanded pitch.
+  output.delta_t = airspeed_with_throttle_hold(input.va_c, input.va, input.Ts);
+  output.theta_c = altitude_hold_control(adjusted_hc, input.h, input.Ts);
+
+  if (pitch_override || input.pitch_override) {
+    output.theta_c = input.theta_c;
+  }
+
+  output.delta_e = pitch_hold(output.theta_c, input.theta, input.q, input.Ts);
+}
+
+void ControllerSucessiveLoopCore::climb_lateral_control(const Input & input, Output & output)
+{
+  // Maintain straight flight while gaining altitude.
+  output.phi_c = 0;
+  output.delta_a = roll_hold(output.phi_c, input.phi, input.p, input.Ts);
+  output.delta_r = yaw_damper(input.r, input.Ts);
+}
+
+void ControllerSucessiveLoopCore::climb_longitudinal_control(const Input & input, Output & output)
+{
+  // For readability, declare parameters here that will be used in this function
+  double alt_hz = gains_.altitude.alt_hz;
+
+  // Saturate the altitude command.
+  double adjusted_hc = adjust_h_c(input.h_c, input.h, alt_hz);
+
+  // Find the control efforts for throttle and find the commanded pitch angle.
+  output.delta_t = airspeed_with_throttle_hold(input.va_c, input.va, input.Ts);
+  output.theta_c = altitude_hold_control(adjusted_hc, input.h, input.Ts);
+  output.delta_e = pitch_hold(output.theta_c, input.theta, input.q, input.Ts);
+}
+
+void ControllerSucessiveLoopCore::take_off_lateral_control(const Input & input, Output & output)
+{
+  // In the take-off zone maintain level straight flight by commanding a roll angle of 0 and rudder of 0.
+  output.delta_r = 0.0;
+  output.phi_c = 0;
+  output.delta_a = roll_hold(output.phi_c, input.phi, input.p, input.Ts);
+}
+
+void ControllerSucessiveLoopCore::take_off_longitudinal_control(const Input & input,
+                                                                Output & output)
+{
+  // For readability, declare parameters here that will be used in this function
+  double max_takeoff_throttle = gains_.max_takeoff_throttle;
+  double cmd_takeoff_pitch = gains_.cmd_takeoff_pitch;
+
+  // Set throttle to not overshoot altitude.
+  output.delta_t =
+    sat(airspeed_with_throttle_hold(input.va_c, input.va, input.Ts), max_takeoff_throttle, 0);
+
+  // Command a shallow pitch angle to gain altitude.
+  output.theta_c = cmd_takeoff_pitch * M_PI / 180.0;
+  output.delta_e = pitch_hold(output.theta_c, input.theta, input.q, input.Ts);
+}
+
+/// All the following control loops follow this basic outline.
+/*
+    float controller_successive_loop::pid_control(float command_val, float actual_val, float rate, // Not all loops use rate.
+                                          const params_s &params)
+    {
+      // Find the error between the commanded and actual value.
+      float error = commanded_val - actual_val;
+
+      float Ts = 1.0/params.frequency;
+      
+      // Make a note of the previous integrator value.
+      float state_integrator_prev = state_integrator_;
+      // Integrate the error of the state by using the trapezoid method with the stored value for the previous error.
+      state_integrator_ = state_integrator_ + (Ts/2.0)*(error + state_error_);
+
+      // Take the derivative of the error, using a dirty derivative with low pass filter value of tau.
+      state_differentiator_ = (2.0*params.tau - Ts)/(2.0*params.tau + Ts)*state_differentiator_ + (2.0 /
+                       (2.0*params.tau + Ts))*(error - state_error_);
+
+      // Find the control efforts using the gains and calculated values.
+      float up = params.state_kp*error;
+      float ui = params.state_ki*state_integrator_;
+      float ud = params.state_kd*rate; // If the rate is directly measured use it. Otherwise...
+      // float ud = params.state_kd*state_differentiator;
+
+      // Saturate the control effort between a defined max and min value.
+      // Integrator anti-windup, if saturation occurs do not integrate that step.
+      float control_effort = sat(up + ui + ud, max_value, min_value);
+      float control_effort_unsat = up + ui + ud + phi_ff;
+      if (fabs(control_effort - control_effort_unsat) < 0.0001)
+      {
+        state_integrator_ = state_integrator_prev;
+      }
+
+      // Save the error to use for integration and differentiation.
+      // Then return the control effort.
+      state_error_ = error;
+      return control_effort;
+    }
+*/
+
+float ControllerSucessiveLoopCore::course_hold(float chi_c, float chi, float phi_ff, float r,
+                                               float Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double c_kp = gains_.course.kp;
+  double c_ki = gains_.course.ki;
+  double c_kd = gains_.course.kd;
+  double max_roll = gains_.course.max_roll;
+
+  double wrapped_chi_c = wrap_within_180(chi, chi_c);
+
+  float error = wrapped_chi_c - chi;
+
+  float c_integrator_prev = c_integrator_;
+  c_integrator_ = c_integrator_ + (Ts / 2.0) * (error + c_error_);
+
+  float up = c_kp * error;
+  float ui = c_ki * c_integrator_;
+  float ud = c_kd * r;
+
+  float phi_c = sat(up + ui + ud + phi_ff, max_roll * M_PI / 180.0, -max_roll * M_PI / 180.0);
+  float phi_c_unsat = up + ui + ud + phi_ff;
+
+  if (fabs(phi_c - phi_c_unsat) > 0.0001) { // If the controller is saturating don't integrate.
+    c_integrator_ = c_integrator_prev;
+  }
+
+  c_error_ = error;
+  return phi_c;
+}
+
+float ControllerSucessiveLoopCore::roll_hold(float phi_c, float phi, float p, float Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double r_kp = gains_.roll.kp;
+  double r_ki = gains_.roll.ki;
+  double r_kd = gains_.roll.kd;
+  double max_a = gains_.roll.max_a;
+  double trim_a = gains_.roll.trim_a;
+  double pwm_rad_a = gains_.roll.pwm_rad_a;
+
+  float error = phi_c - phi;
+
+  float r_integrator_prev = r_integrator;
+  r_integrator = r_integrator + (Ts / 2.0) * (error + r_error_);
+
+  float up = r_kp * error;
+  float ui = r_ki * r_integrator;
+  float ud = r_kd * p;
+  
+  if (std::isnan(up)) {
+    up = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Proportional control on the roll loop is NAN");
+  }
+  
+  if (std::isnan(ui)) {
+    r_integrator = 0.0;
+    ui = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Integral control on the roll loop is NAN");
+  }
+  
+  if (std::isnan(ud)) {
+    ud = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Derivative control on the roll loop is NAN");
+  }
+
+  float delta_a = sat(trim_a / pwm_rad_a + up + ui - ud, max_a, -max_a);
+  float delta_a_unsat = trim_a / pwm_rad_a + up + ui - ud;
+
+  if (fabs(delta_a - delta_a_unsat) > 0.0001 && fabs(r_ki) > 0.00001) {
+    r_integrator = r_integrator_prev;
+  }
+
+  r_error_ = error;
+  return delta_a;
+}
+
+float ControllerSucessiveLoopCore::pitch_hold(float theta_c, float theta, float q, float Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double p_kp = gains_.pitch.kp;
+  double p_ki = gains_.pitch.ki;
+  double p_kd = gains_.pitch.kd;
+  double max_e = gains_.pitch.max_e;
+  double trim_e = gains_.pitch.trim_e;
+  double pwm_rad_e = gains_.pitch.pwm_rad_e;
+
+  float error = theta_c - theta;
+
+  float p_integrator_prev = p_integrator_;
+  p_integrator_ = p_integrator_ + (Ts / 2.0) * (error + p_error_);
+
+  float up = p_kp * error;
+  float ui = p_ki * p_integrator_;
+  float ud = p_kd * q;
+  
+  if (std::isnan(up)) {
+    up = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Proportional control on the roll loop is NAN");
+  }
+
+  if (std::isnan(ui)) {
+    p_integrator_ = 0.0;
+    ui = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Integral control on the roll loop is NAN");
+  }
+  
+  if (std::isnan(ud)) {
+    ud = 0.0;
+    RCLCPP_WARN(this->get_logger(), "Derivative control on the roll loop is NAN");
+  }
+
+  float delta_e = sat(trim_e / pwm_rad_e + up + ui - ud, max_e, -max_e);
+  float delta_e_unsat = trim_e / pwm_rad_e + up + ui - ud;
+
+  if (fabs(delta_e - delta_e_unsat) > 0.0001 && fabs(p_ki) > 0.00001) {
+    p_integrator_ = p_integrator_prev;
+  }
+
+  p_error_ = error;
+  return -delta_e; // TODO explain subtraction.
+}
+
+float ControllerSucessiveLoopCore::airspeed_with_throttle_hold(float va_c, float va, float Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double tau = gains_.airspeed.tau;
+  double a_t_kp = gains_.airspeed.kp;
+  double a_t_ki = gains_.airspeed.ki;
+  double a_t_kd = gains_.airspeed.kd;
+  double max_t = gains_.airspeed.max_t;
+  double trim_t = gains_.airspeed.trim_t;
+
+  float error = va_c - va;
+
+  float at_integrator_prev = at_integrator_;
+  at_integrator_ = at_integrator_ + (Ts / 2.0) * (error + at_error_);
+  at_differentiator_ = (2.0 * tau - Ts) / (2.0 * tau + Ts) * at_differentiator_
+    + (2.0 / (2.0 * tau + Ts)) * (error - at_error_);
+
+  float up = a_t_kp * error;
+  float ui = a_t_ki * at_integrator_;
+  float ud = a_t_kd * at_differentiator_;
+
+  // Why isn't this one divided by the pwm_rad_t?
+  float delta_t = sat(trim_t + up + ui + ud, max_t, 0);
+  float delta_t_unsat = trim_t + up + ui + ud;
+
+  if (fabs(delta_t - delta_t_unsat) > 0.0001) {
+    at_integrator_ = at_integrator_prev;
+  }
+
+  at_error_ = error;
+  return delta_t;
+}
+
+float ControllerSucessiveLoopCore::altitude_hold_control(float h_c, float h, float Ts)
+{
+  // For readability, declare parameters here that will be used in this function
+  double alt_hz = gains_.altitude.alt_hz;
+  double tau = gains_.altitude.tau;
+  double a_kp = gains_.altitude.kp;
+  double a_ki = gains_.altitude.ki;
+  double a_kd = gains_.altitude.kd;
+  double max_pitch = gains_.altitude.max_pitch;
+
+  float error = h_c - h;
+
+  float a_integrator_prev = a_integrator_;
+  if (-alt_hz + .01 < error && error < alt_hz - .01) {
+    a_integrator_ = a_integrator_ + (Ts / 2.0) * (error + a_error_);
+  } else {
+    a_integrator_ = 0.0;
+  }
+
+  a_differentiator_ = (2.0 * tau - Ts) / (2.0 * tau + Ts) * a_differentiator_
+    + (2.0 / (2.0 * tau + Ts)) * (error - a_error_);
+
+  float up = a_kp * error;
+  float ui = a_ki * a_integrator_;
+  float ud = a_kd * a_differentiator_;
+
+  float theta_c = sat(up + ui + ud, max_pitch * M_PI / 180.0, -max_pitch * M_PI / 180.0);
+  float theta_c_unsat = up + ui + ud;
+  if (fabs(theta_c - theta_c_unsat) > 0.0001) {
+    a_integrator_ = a_integrator_prev;
+  }
+
+  a_error_ = error;
+  return theta_c;
+}
+
+float ControllerSucessiveLoopCore::yaw_damper(float r, float Ts)
+{
+  float y_pwo = gains_.yaw_damper.pwo;
+  float y_kr = gains_.yaw_damper.kr;
+  float max_r = gains_.yaw_damper.max_r;
+
+  float n0 = 0.0;
+  float n1 = 1.0;
+  float d0 = y_pwo;
+  float d1 = 1.0;
+
+  float b0 = -y_kr * (2.0 * n1 - Ts * n0) / (2.0 * d1 + Ts * d0);
+  float b1 = y_kr * (2.0 * n1 + Ts * n0) / (2.0 * d1 + Ts * d0);
+  float a0 = y_kr * (2.0 * d1 - Ts * d0) / (2.0 * d1 + Ts * d0);
+
+  float delta_r = -sat(a0 * delta_r_delay_ + b1 * r + b0 * r_delay_, max_r, -max_r);
+
+  r_delay_ = r;
+  delta_r_delay_ = delta_r;
+
+  return delta_r;
+}
+
+//float controller_successive_loop::cooridinated_turn_hold(float v, const params_s &params)
+//{
+//    //todo finish this if you want...
+//    return 0;
+//}
+
+// TODO: Add some error handling here.
+float ControllerSucessiveLoopCore::sat(float value, float up_limit, float low_limit)
+{
+  // Set to upper limit if larger than that limit.
+  // Set to lower limit if smaller than that limit.
+  // Otherwise, do not change the value.
+
+  if (up_limit < 0.0) {
+    RCLCPP_WARN_ONCE(this->get_logger(),
+                     "WARNING: Upper limit in saturation function is negative.");
+  }
+
+  float rVal;
+  if (value > up_limit)
+    rVal = up_limit;
+  else if (value < low_limit)
+    rVal = low_limit;
+  else
+    rVal = value;
+
+  // Return the saturated value.
+  return rVal;
+}
+
+float ControllerSucessiveLoopCore::adjust_h_c(float h_c, float h, float max_diff)
+{
+  double adjusted_h_c;
+
+  // If the error in altitude is larger than the max altitude, adjust it to the max with the correct sign.
+  // Otherwise, proceed as normal.
+  if (abs(h_c - h) > max_diff) {
+    adjusted_h_c = h + copysign(max_diff, h_c - h);
+  } else {
+    adjusted_h_c = h_c;
+  }
+
+  return adjusted_h_c;
+}
+
+void ControllerSucessiveLoopCore::declare_parameters()
+{
+  // Declare param with ROS2 and set the default value.
+  roll_command_override_ = params_.declare_bool("roll_command_override", false);
+  pitch_command_override_ = params_.declare_bool("pitch_command_override", false);
+
+  max_takeoff_throttle_ = params_.declare_double("max_takeoff_throttle", 0.55);
+  c_kp_ = params_.declare_double("c_kp", 2.37);
+  c_ki_ = params_.declare_double("c_ki", .4);
+  c_kd_ = params_.declare_double("c_kd", .0);
+  max_roll_ = params_.declare_double("max_roll", 25.0);
+  cmd_takeoff_pitch_ = params_.declare_double("cmd_takeoff_pitch", 5.0);
+
+  r_kp_ = params_.declare_double("r_kp", .06);
+  r_ki_ = params_.declare_double("r_ki", .0);
+  r_kd_ = params_.declare_double("r_kd", .04);
+  max_a_ = params_.declare_double("max_a", .15);
+  max_r_ = params_.declare_double("max_r", 1.0);
+  trim_a_ = params_.declare_double("trim_a", 0.0);
+
+  p_kp_ = params_.declare_double("p_kp", -.15);
+  p_ki_ = params_.declare_double("p_ki", .0);
+  p_kd_ = params_.declare_double("p_kd", -.05);
+  max_e_ = params_.declare_double("max_e", .15);
+  max_pitch_ = params_.declare_double("max_pitch", 20.0);
+  trim_e_ = params_.declare_double("trim_e", 0.02);
+
+  tau_ = params_.declare_double("tau", 50.0);
+  a_t_kp_ = params_.declare_double("a_t_kp", .05);
+  a_t_ki_ = params_.declare_double("a_t_ki", .005);
+  a_t_kd_ = params_.declare_double("a_t_kd", 0.0);
+  max_t_ = params_.declare_double("max_t", 1.0);
+  trim_t_ = params_.declare_double("trim_t", 0.5);
+
+  a_kp_ = params_.declare_double("a_kp", 0.015);
+  a_ki_ = params_.declare_double("a_ki", 0.003);
+  a_kd_ = params_.declare_double("a_kd", 0.0);
+
+  y_pwo_ = params_.declare_double("y_pwo", .6349);
+  y_kr_ = params_.declare_double("y_kr", .85137);
+}
+
+} // namespace rosplane
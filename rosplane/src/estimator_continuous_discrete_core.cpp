@@ -0,0 +1,1055 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include "rosplane/estimator_continuous_discrete_core.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+float radians(float degrees) { return M_PI * degrees / 180.0; }
+
+double wrap_within_180(double fixed_heading, double wrapped_heading)
+{
+  // wrapped_heading - number_of_times_to_wrap * 2pi
+  return wrapped_heading - floor((wrapped_heading - fixed_heading) / (2 * M_PI) + 0.5) * 2 * M_PI;
+}
+
+} // namespace
+
+EstimatorContinuousDiscreteCore::EstimatorContinuousDiscreteCore(const CoreContext & context)
+    : EstimatorEKFCore(context)
+    , xhat_a_(Eigen::Vector2f::Zero())
+    , P_a_(Eigen::Matrix2f::Identity())
+    , xhat_p_(Eigen::Vector<float, 7>::Zero())
+    , P_p_(Eigen::Matrix<float, 7, 7>::Identity())
+    , Q_a_(Eigen::Matrix2f::Identity())
+    , Q_g_(Eigen::Matrix3f::Identity())
+    , R_accel_(Eigen::Matrix3f::Identity())
+    , Q_p_(Eigen::Matrix<float, 7, 7>::Identity())
+    , R_p_(Eigen::Matrix<float, 6, 6>::Zero())
+{
+  phat_ = 0;
+  qhat_ = 0;
+  rhat_ = 0;
+  phihat_ = 0;
+  thetahat_ = 0;
+  psihat_ = 0;
+  Vwhat_ = 0;
+
+  lpf_gyro_x_ = 0.0;
+  lpf_gyro_y_ = 0.0;
+  lpf_gyro_z_ = 0.0;
+  lpf_static_ = 0.0;
+  lpf_diff_ = 0.0;
+  lpf_accel_x_ = 0.0;
+  lpf_accel_y_ = 0.0;
+  lpf_accel_z_ = 0.0;
+
+  alpha_ = 0.0f;
+
+  position_Ts_ = 0.0;
+  last_gps_stamp_ = 0.0;
+  snapshot_elapsed_ = 0.0;
+
+  // Declare and set parameters with the ROS2 system
+  declare_parameters();
+  params_.set_parameters();
+
+  // Build the first set of gains from the parameters.
+  update_gains();
+  gains_ = gains_snapshot_.load();
+
+  // Initialize covariance matrices from ROS2 parameters
+  initialize_uncertainties();
+
+  // Inits R matrix and alpha values with ROS2 parameters, at the nominal estimator period
+  double frequency = gains_.estimator_update_frequency;
+  update_measurement_model_parameters(1.0 / frequency);
+
+  snapshot_thread_ = std::thread(&EstimatorContinuousDiscreteCore::run_snapshot_writer, this);
+
+  // When loaded as a component there are no command line arguments, so seeding is a parameter.
+  if (params_.get_bool("seed_estimator")) {
+    seed_from_parameters();
+  }
+}
+
+void EstimatorContinuousDiscreteCore::seed_from_parameters()
+{
+  EstimatorCore::seed_from_parameters();
+
+  if (restore_filter_snapshot()) {
+    RCLCPP_INFO_STREAM(get_logger(), "Warm started the filter from the saved snapshot.");
+  }
+}
+
+EstimatorContinuousDiscreteCore::~EstimatorContinuousDiscreteCore()
+{
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    snapshot_stop_ = true;
+  }
+  snapshot_cv_.notify_one();
+  snapshot_thread_.join();
+}
+
+void EstimatorContinuousDiscreteCore::update_gains()
+{
+  Gains gains;
+  gains.rho = rho_;
+  gains.gravity = gravity_;
+  gains.estimator_update_frequency = estimator_update_frequency_;
+  gains.sigma_n_gps = sigma_n_gps_;
+  gains.sigma_e_gps = sigma_e_gps_;
+  gains.sigma_Vg_gps = sigma_Vg_gps_;
+  gains.sigma_course_gps = sigma_course_gps_;
+  gains.sigma_accel = sigma_accel_;
+  gains.sigma_pseudo_wind_n = sigma_pseudo_wind_n_;
+  gains.sigma_pseudo_wind_e = sigma_pseudo_wind_e_;
+  gains.lpf_a = lpf_a_;
+  gains.lpf_a1 = lpf_a1_;
+  gains.gps_n_lim = gps_n_lim_;
+  gains.gps_e_lim = gps_e_lim_;
+  gains.position_update_frequency = position_update_frequency_;
+  gains.sequential_measurement_update = sequential_measurement_update_;
+  gains.measurement_gate_threshold = measurement_gate_threshold_;
+  gains.max_estimated_phi = max_estimated_phi_;
+  gains.max_estimated_theta = max_estimated_theta_;
+  gains.estimator_max_buffer = estimator_max_buffer_;
+  gains.pos_n_initial_cov = params_.get_double("pos_n_initial_cov");
+  gains.pos_e_initial_cov = params_.get_double("pos_e_initial_cov");
+  gains.vg_initial_cov = params_.get_double("vg_initial_cov");
+  gains.chi_initial_cov = params_.get_double("chi_initial_cov");
+  gains.wind_n_initial_cov = params_.get_double("wind_n_initial_cov");
+  gains.wind_e_initial_cov = params_.get_double("wind_e_initial_cov");
+  gains.psi_initial_cov = params_.get_double("psi_initial_cov");
+  gains.position_history_depth = position_history_depth_;
+  gains.filter_snapshot_period = filter_snapshot_period_;
+  gains.filter_snapshot_enabled = !filter_snapshot_file_.get().empty();
+  gains.num_propagation_steps = num_propagation_steps_; // Declared in estimator_ekf_core
+
+  // The file name can not go through the sequence lock, so the snapshot thread gets its own copy.
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    snapshot_path_ = filter_snapshot_file_;
+  }
+
+  gains_snapshot_.store(gains);
+}
+
+void EstimatorContinuousDiscreteCore::initialize_state_covariances()
+{
+  // This also runs when the filter is reinitialized during an estimate, so it reads the gains.
+  double pos_n_initial_cov = gains_.pos_n_initial_cov;
+  double pos_e_initial_cov = gains_.pos_e_initial_cov;
+  double vg_initial_cov = gains_.vg_initial_cov;
+  double chi_initial_cov = gains_.chi_initial_cov;
+  double wind_n_initial_cov = gains_.wind_n_initial_cov;
+  double wind_e_initial_cov = gains_.wind_e_initial_cov;
+  double psi_initial_cov = gains_.psi_initial_cov;
+
+  P_p_ = Eigen::Matrix<float, 7, 7>::Identity();
+  P_p_(0, 0) = pos_n_initial_cov;
+  P_p_(1, 1) = pos_e_initial_cov;
+  P_p_(2, 2) = vg_initial_cov;
+  P_p_(3, 3) = radians(chi_initial_cov);
+  P_p_(4, 4) = wind_n_initial_cov;
+  P_p_(5, 5) = wind_e_initial_cov;
+  P_p_(6, 6) = radians(psi_initial_cov);
+}
+
+void EstimatorContinuousDiscreteCore::initialize_uncertainties()
+{
+  double roll_process_noise = params_.get_double("roll_process_noise");
+  double pitch_process_noise = params_.get_double("pitch_process_noise");
+  double gyro_process_noise = params_.get_double("gyro_process_noise");
+  double position_process_noise = params_.get_double("pos_process_noise");
+  double attitude_initial_cov = params_.get_double("attitude_initial_cov");
+
+  P_a_ *= powf(radians(attitude_initial_cov), 2);
+
+  Q_a_(0, 0) = roll_process_noise;
+  Q_a_(1, 1) = pitch_process_noise;
+
+  Q_g_ *= pow(radians(gyro_process_noise), 2);
+
+  Q_p_ *= position_process_noise;
+
+  initialize_state_covariances();
+}
+
+void EstimatorContinuousDiscreteCore::update_measurement_model_parameters(double Ts)
+{
+  // For readability, declare the parameters used in the function here
+  double sigma_n_gps = gains_.sigma_n_gps;
+  double sigma_e_gps = gains_.sigma_e_gps;
+  double sigma_Vg_gps = gains_.sigma_Vg_gps;
+  double sigma_course_gps = gains_.sigma_course_gps;
+  double sigma_accel = gains_.sigma_accel;
+  double sigma_pseudo_wind_n = gains_.sigma_pseudo_wind_n;
+  double sigma_pseudo_wind_e = gains_.sigma_pseudo_wind_e;
+  float lpf_a = gains_.lpf_a;
+  float lpf_a1 = gains_.lpf_a1;
+
+  R_accel_ = Eigen::Matrix3f::Identity() * pow(sigma_accel, 2);
+
+  R_p_(0, 0) = powf(sigma_n_gps, 2);
+  R_p_(1, 1) = powf(sigma_e_gps, 2);
+  R_p_(2, 2) = powf(sigma_Vg_gps, 2);
+  R_p_(3, 3) = powf(sigma_course_gps, 2);
+  R_p_(4, 4) = sigma_pseudo_wind_n;
+  R_p_(5, 5) = sigma_pseudo_wind_e;
+
+  alpha_ = exp(-lpf_a * Ts);
+  alpha1_ = exp(-lpf_a1 * Ts);
+}
+
+void EstimatorContinuousDiscreteCore::estimate(const Input & input, Output & output)
+{
+  // Take one copy of the gains for the whole estimate, so a parameter change can not land partway
+  // through it.
+  gains_ = gains_snapshot_.load();
+
+  // For readability, declare the parameters here
+  double rho = gains_.rho;
+  double gravity = gains_.gravity;
+  double Ts = input.Ts;
+
+  // Inits R matrix and alpha values with ROS2 parameters. The alpha values depend on Ts, which
+  // changes from call to call when the estimator is triggered by the IMU.
+  update_measurement_model_parameters(Ts);
+
+  // The models for the EKF. These are passed to the EKF functions, which can then call them.
+  auto attitude_dynamics_model = [this](const Eigen::Vector2f & state,
+                                        const Eigen::Vector3f & inputs) {
+    return attitude_dynamics(state, inputs);
+  };
+  auto attitude_jacobian_model = [this](const Eigen::Vector2f & state,
+                                        const Eigen::Vector3f & inputs) {
+    return attitude_jacobian(state, inputs);
+  };
+  auto attitude_input_jacobian_model = [this](const Eigen::Vector2f & state,
+                                              const Eigen::Vector3f & inputs) {
+    return attitude_input_jacobian(state, inputs);
+  };
+  auto attitude_measurement_model = [this](const Eigen::Vector2f & state,
+                                           const Eigen::Vector4f & inputs) {
+    return attitude_measurement_prediction(state, inputs);
+  };
+  auto attitude_measurement_jacobian_model = [this](const Eigen::Vector2f & state,
+                                                    const Eigen::Vector4f & inputs) {
+    return attitude_measurement_jacobian(state, inputs);
+  };
+  // low pass filter gyros to estimate angular rates
+  lpf_gyro_x_ = alpha_ * lpf_gyro_x_ + (1 - alpha_) * input.gyro_x;
+  lpf_gyro_y_ = alpha_ * lpf_gyro_y_ + (1 - alpha_) * input.gyro_y;
+  lpf_gyro_z_ = alpha_ * lpf_gyro_z_ + (1 - alpha_) * input.gyro_z;
+
+  float phat = lpf_gyro_x_;
+  float qhat = lpf_gyro_y_;
+  float rhat = lpf_gyro_z_;
+
+  // These states will allow us to propagate our state model for pitch and roll.
+  Eigen::Vector3f angular_rates;
+  angular_rates << phat, qhat, rhat;
+
+  // low pass filter static pressure sensor and invert to esimate altitude
+  lpf_static_ = alpha1_ * lpf_static_ + (1 - alpha1_) * input.static_pres;
+  float hhat = lpf_static_ / rho / gravity;
+
+  if (input.static_pres == 0.0
+      || baro_init_ == false) { // Catch the edge case for if pressure measured is zero.
+    hhat = 0.0;
+  }
+
+  // low pass filter diff pressure sensor and invert to estimate va
+  lpf_diff_ = alpha1_ * lpf_diff_ + (1 - alpha1_) * input.diff_pres;
+
+  // when the plane isn't moving or moving slowly, the noise in the sensor
+  // will cause the differential pressure to go negative. This will catch
+  // those cases.
+  if (lpf_diff_ <= 0)
+    lpf_diff_ = 0.000001;
+
+  float vahat = sqrt(2 / rho * lpf_diff_);
+
+  // low pass filter accelerometers
+  lpf_accel_x_ = alpha_ * lpf_accel_x_ + (1 - alpha_) * input.accel_x;
+  lpf_accel_y_ = alpha_ * lpf_accel_y_ + (1 - alpha_) * input.accel_y;
+  lpf_accel_z_ = alpha_ * lpf_accel_z_ + (1 - alpha_) * input.accel_z;
+
+  // These are the current states that will allow us to predict our measurement.
+  Eigen::Vector4f att_curr_state_info;
+  att_curr_state_info << angular_rates, vahat;
+
+  // The sensor measurements that we can compare to our preditions.
+  Eigen::Vector3f y_att;
+  y_att << lpf_accel_x_, lpf_accel_y_, lpf_accel_z_;
+
+  // ATTITUDE (ROLL AND PITCH) ESTIMATION
+  // Prediction step
+  propagate_model(xhat_a_, attitude_dynamics_model, attitude_jacobian_model, angular_rates,
+                  attitude_input_jacobian_model, P_a_, Q_a_, Q_g_, Ts,
+                  gains_.num_propagation_steps);
+
+  // Measurement update
+  if (gains_.sequential_measurement_update) {
+    int rejected = sequential_measurement_update(
+      xhat_a_, att_curr_state_info, attitude_measurement_model, y_att,
+      attitude_measurement_jacobian_model, Eigen::Vector3f(R_accel_.diagonal()), P_a_,
+      gains_.measurement_gate_threshold);
+    if (rejected > 0) {
+      RCLCPP_DEBUG(get_logger(), "%d accelerometer measurements rejected by gate", rejected);
+    }
+  } else {
+    measurement_update(xhat_a_, att_curr_state_info, attitude_measurement_model, y_att,
+                       attitude_measurement_jacobian_model, R_accel_, P_a_);
+  }
+
+  // Check the estimate for errors
+  check_xhat_a();
+
+  // Store esimate for later use.
+  phihat_ = xhat_a_(0);
+  thetahat_ = xhat_a_(1);
+
+  // Implement continous-discrete EKF to estimate pn, pe, chi, Vg, wn, we
+  // POSITION AND COURSE ESTIMATION
+  // The position filter runs at its own rate, using the latest attitude estimate. Its time step is
+  // the time since it last ran, and it always runs on a new GPS measurement so none are dropped.
+  double position_frequency = gains_.position_update_frequency;
+  position_Ts_ += Ts;
+  bool run_position_filter = input.gps_new || position_frequency <= 0.0
+    || position_Ts_ >= 1.0 / position_frequency - 0.5 * Ts;
+
+  if (run_position_filter) {
+    double position_Ts = position_Ts_;
+    position_Ts_ = 0.0;
+
+    // These are the state that will allow us to propagate our state model for the position state.
+    Eigen::Vector<float, 6> attitude_states;
+    attitude_states << angular_rates, xhat_a_(0), xhat_a_(1), vahat;
+
+    // Prediction step
+    position_propagate(attitude_states, position_Ts);
+
+    // Keep a history of the position filter, so that delayed GPS fixes can be fused at the time
+    // they were measured. The storage is only reallocated when the depth parameter changes.
+    std::size_t history_depth = std::max<int64_t>(gains_.position_history_depth, 1);
+    if (position_history_.capacity() != history_depth) {
+      position_history_.reset(history_depth);
+    }
+    PositionHistory & history = position_history_.push();
+    history.stamp = input.stamp;
+    history.Ts = position_Ts;
+    history.attitude_states = attitude_states;
+    history.xhat = xhat_p_;
+    history.P = P_p_;
+
+    // Measurement updates.
+    // Only update if new GPS information is available.
+    if (input.gps_new) {
+      fuse_gps(input);
+    }
+
+    bool problem = false;
+    int prob_index;
+    for (int i = 0; i < 7; i++) {
+      if (!std::isfinite(xhat_p_(i))) {
+        if (!problem) {
+          problem = true;
+          prob_index = i;
+        }
+        switch (i) {
+          case 0:
+            xhat_p_(i) = input.gps_n;
+            break;
+          case 1:
+            xhat_p_(i) = input.gps_e;
+            break;
+          case 2:
+            xhat_p_(i) = input.gps_Vg;
+            break;
+          case 3:
+            xhat_p_(i) = input.gps_course;
+            break;
+          case 6:
+            xhat_p_(i) = input.gps_course;
+            break;
+          default:
+            xhat_p_(i) = 0;
+        }
+
+        initialize_state_covariances();
+      }
+    }
+    if (problem) {
+      RCLCPP_WARN(get_logger(), "position estimator reinitialized due to non-finite state %d",
+                  prob_index);
+    }
+    if (xhat_p_(6) - xhat_p_(3) > radians(360.0f) || xhat_p_(6) - xhat_p_(3) < radians(-360.0f)) {
+      xhat_p_(6) = fmodf(xhat_p_(6), 2.0 * M_PI);
+    }
+
+    // Keep the history consistent with any corrections made above.
+    position_history_.back().xhat = xhat_p_;
+    position_history_.back().P = P_p_;
+  }
+
+  // Between position filter updates, extrapolate the position along the estimated course.
+  const PositionTrig & pos_trig = position_trig(xhat_p_);
+  float pnhat = xhat_p_(0) + xhat_p_(2) * pos_trig.cchi * position_Ts_;
+  float pehat = xhat_p_(1) + xhat_p_(2) * pos_trig.schi * position_Ts_;
+  float Vghat = xhat_p_(2);
+  float chihat = xhat_p_(3);
+  float wnhat = xhat_p_(4);
+  float wehat = xhat_p_(5);
+  float psihat = xhat_p_(6);
+
+  output.pn = pnhat;
+  output.pe = pehat;
+  output.h = hhat;
+  output.va = vahat;
+  output.alpha = 0;
+  output.beta = 0;
+  output.phi = phihat_;
+  output.theta = thetahat_;
+  output.chi = chihat;
+  output.p = phat;
+  output.q = qhat;
+  output.r = rhat;
+  output.Vg = Vghat;
+  output.wn = wnhat;
+  output.we = wehat;
+  output.psi = psihat;
+
+  // Periodically checkpoint the filter, so that it can be warm started after a restart.
+  double snapshot_period = gains_.filter_snapshot_period;
+  snapshot_elapsed_ += Ts;
+  if (snapshot_period > 0.0 && snapshot_elapsed_ >= snapshot_period
+      && gains_.filter_snapshot_enabled) {
+    snapshot_elapsed_ = 0.0;
+    save_filter_snapshot();
+  }
+}
+
+void EstimatorContinuousDiscreteCore::position_propagate(
+  const Eigen::Vector<float, 6> & attitude_states, double Ts)
+{
+  auto position_dynamics_model = [this](const Eigen::Vector<float, 7> & state,
+                                        const Eigen::Vector<float, 6> & inputs) {
+    return position_dynamics(state, inputs);
+  };
+  auto position_jacobian_model = [this](const Eigen::Vector<float, 7> & state,
+                                        const Eigen::Vector<float, 6> & inputs) {
+    return position_jacobian(state, inputs);
+  };
+
+  // The process noise is added per propagation step, so scale it to keep the same noise per
+  // second as when the position filter runs at the estimator rate.
+  double frequency = gains_.estimator_update_frequency;
+  Eigen::Matrix<float, 7, 7> Q_p = Q_p_ * (1.0 / frequency / Ts);
+
+  if (fabsf(xhat_p_(2)) < 0.01f) {
+    xhat_p_(2) = 0.01; // prevent divide by zero
+  }
+
+  // Only the first 4 states have a non-zero jacobian and the input noise is not modeled, so the
+  // covariance can be propagated block-wise.
+  propagate_model_structured<4>(xhat_p_, position_dynamics_model, position_jacobian_model,
+                                attitude_states, P_p_, Q_p, Ts, gains_.num_propagation_steps);
+
+  // Check wrapping of the heading and course.
+  xhat_p_(3) = wrap_within_180(0.0, xhat_p_(3));
+  xhat_p_(6) = wrap_within_180(0.0, xhat_p_(6));
+  if (xhat_p_(3) > radians(180.0f) || xhat_p_(3) < radians(-180.0f)) {
+    RCLCPP_WARN(get_logger(), "Course estimate not wrapped from -pi to pi");
+    xhat_p_(3) = 0;
+  }
+  if (xhat_p_(6) > radians(180.0f) || xhat_p_(6) < radians(-180.0f)) {
+    RCLCPP_WARN(get_logger(), "Psi estimate not wrapped from -pi to pi");
+    xhat_p_(6) = 0;
+  }
+}
+
+void EstimatorContinuousDiscreteCore::position_measurement_update(const Input & input, float vahat)
+{
+  // For readability, declare the parameters here
+  double gps_n_lim = gains_.gps_n_lim;
+  double gps_e_lim = gains_.gps_e_lim;
+
+  auto position_measurement_model = [this](const Eigen::Vector<float, 7> & state,
+                                           const Eigen::Vector<float, 1> & inputs) {
+    return position_measurement_prediction(state, inputs);
+  };
+  auto position_measurement_jacobian_model = [this](const Eigen::Vector<float, 7> & state,
+                                                    const Eigen::Vector<float, 1> & inputs) {
+    return position_measurement_jacobian(state, inputs);
+  };
+
+  Eigen::Vector<float, 1> pos_curr_state_info;
+  pos_curr_state_info << vahat;
+
+  //wrap course measurement
+  float gps_course = fmodf(input.gps_course, radians(360.0f));
+  gps_course = wrap_within_180(xhat_p_(3), gps_course);
+
+  // Measurements for the postional states.
+  Eigen::Vector<float, 6> y_pos;
+  y_pos << input.gps_n, input.gps_e, input.gps_Vg, gps_course, 0.0, 0.0;
+
+  // Update the state and covariance with based on the predicted and actual measurements.
+  if (gains_.sequential_measurement_update) {
+    int rejected = sequential_measurement_update(
+      xhat_p_, pos_curr_state_info, position_measurement_model, y_pos,
+      position_measurement_jacobian_model, Eigen::Vector<float, 6>(R_p_.diagonal()), P_p_,
+      gains_.measurement_gate_threshold);
+    if (rejected > 0) {
+      RCLCPP_DEBUG(get_logger(), "%d GPS measurements rejected by gate", rejected);
+    }
+  } else {
+    measurement_update(xhat_p_, pos_curr_state_info, position_measurement_model, y_pos,
+                       position_measurement_jacobian_model, R_p_, P_p_);
+  }
+
+  if (xhat_p_(0) > gps_n_lim || xhat_p_(0) < -gps_n_lim) {
+    RCLCPP_WARN(get_logger(), "gps n limit reached");
+    xhat_p_(0) = input.gps_n;
+  }
+  if (xhat_p_(1) > gps_e_lim || xhat_p_(1) < -gps_e_lim) {
+    RCLCPP_WARN(get_logger(), "gps e limit reached");
+    xhat_p_(1) = input.gps_e;
+  }
+}
+
+void EstimatorContinuousDiscreteCore::fuse_gps(const Input & input)
+{
+  // Find the newest history entry at or before the time of the fix. A fix without a stamp, or
+  // stamped after the newest entry, is fused at the current time.
+  std::size_t newest = position_history_.size() - 1;
+  std::size_t index = newest;
+  if (input.gps_stamp > 0.0) {
+    if (input.gps_stamp <= last_gps_stamp_) {
+      RCLCPP_WARN(get_logger(), "GPS fix is older than the last fused fix, dropping it");
+      return;
+    }
+    last_gps_stamp_ = input.gps_stamp;
+
+    while (index > 0 && position_history_[index].stamp > input.gps_stamp) {
+      index--;
+    }
+    if (position_history_[index].stamp > input.gps_stamp) {
+      RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 1000,
+                           "GPS fix is older than the position history, fusing it at the oldest "
+                           "entry. Consider increasing position_history_depth.");
+    }
+  }
+
+  // Rewind the position filter to the time of the fix and apply the update there.
+  PositionHistory & rewind = position_history_[index];
+  xhat_p_ = rewind.xhat;
+  P_p_ = rewind.P;
+  position_measurement_update(input, rewind.attitude_states(5));
+  rewind.xhat = xhat_p_;
+  rewind.P = P_p_;
+
+  // Replay the propagation from the time of the fix back up to the current time.
+  for (std::size_t i = index + 1; i <= newest; i++) {
+    PositionHistory & history = position_history_[i];
+    position_propagate(history.attitude_states, history.Ts);
+    history.xhat = xhat_p_;
+    history.P = P_p_;
+  }
+}
+
+void EstimatorContinuousDiscreteCore::save_filter_snapshot()
+{
+  FilterSnapshot snapshot;
+  snapshot.magic = SNAPSHOT_MAGIC;
+  snapshot.version = SNAPSHOT_VERSION;
+  snapshot.wall_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+  Eigen::Map<Eigen::Vector2f>(snapshot.xhat_a) = xhat_a_;
+  Eigen::Map<Eigen::Matrix2f>(snapshot.P_a) = P_a_;
+  Eigen::Map<Eigen::Vector<float, 7>>(snapshot.xhat_p) = xhat_p_;
+  Eigen::Map<Eigen::Matrix<float, 7, 7>>(snapshot.P_p) = P_p_;
+  float lpf[8] = {lpf_gyro_x_, lpf_gyro_y_, lpf_gyro_z_,  lpf_static_,
+                  lpf_diff_,   lpf_accel_x_, lpf_accel_y_, lpf_accel_z_};
+  std::copy(std::begin(lpf), std::end(lpf), snapshot.lpf);
+  snapshot.init_lat = init_lat_;
+  snapshot.init_lon = init_lon_;
+  snapshot.init_alt = init_alt_;
+  snapshot.init_static = init_static_;
+
+  // If the last snapshot has not been written yet, it is replaced by this one.
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    pending_snapshot_ = snapshot;
+    snapshot_pending_ = true;
+  }
+  snapshot_cv_.notify_one();
+}
+
+bool EstimatorContinuousDiscreteCore::restore_filter_snapshot()
+{
+  std::string filepath = filter_snapshot_file_;
+  double max_age = params_.get_double("filter_snapshot_max_age");
+  if (filepath.empty()) {
+    return false;
+  }
+
+  FilterSnapshot snapshot;
+  std::ifstream fin(filepath, std::ios::binary);
+  if (!fin.read(reinterpret_cast<char *>(&snapshot), sizeof(snapshot))
+      || snapshot.magic != SNAPSHOT_MAGIC || snapshot.version != SNAPSHOT_VERSION) {
+    RCLCPP_WARN_STREAM(get_logger(), "No valid filter snapshot in " << filepath);
+    return false;
+  }
+
+  int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  double age = (now_ns - snapshot.wall_time_ns) * 1e-9;
+  if (age < 0.0 || age > max_age) {
+    RCLCPP_WARN_STREAM(get_logger(),
+                       "Filter snapshot is " << age << " s old, not using it to warm start.");
+    return false;
+  }
+
+  xhat_a_ = Eigen::Map<Eigen::Vector2f>(snapshot.xhat_a);
+  P_a_ = Eigen::Map<Eigen::Matrix2f>(snapshot.P_a);
+  xhat_p_ = Eigen::Map<Eigen::Vector<float, 7>>(snapshot.xhat_p);
+  P_p_ = Eigen::Map<Eigen::Matrix<float, 7, 7>>(snapshot.P_p);
+  lpf_gyro_x_ = snapshot.lpf[0];
+  lpf_gyro_y_ = snapshot.lpf[1];
+  lpf_gyro_z_ = snapshot.lpf[2];
+  lpf_static_ = snapshot.lpf[3];
+  lpf_diff_ = snapshot.lpf[4];
+  lpf_accel_x_ = snapshot.lpf[5];
+  lpf_accel_y_ = snapshot.lpf[6];
+  lpf_accel_z_ = snapshot.lpf[7];
+  phihat_ = xhat_a_(0);
+  thetahat_ = xhat_a_(1);
+
+  // The position states are relative to the origin they were estimated with, so use that origin.
+  init_lat_ = snapshot.init_lat;
+  init_lon_ = snapshot.init_lon;
+  init_alt_ = snapshot.init_alt;
+  init_static_ = snapshot.init_static;
+  gps_init_ = true;
+  baro_init_ = true;
+
+  return true;
+}
+
+void EstimatorContinuousDiscreteCore::run_snapshot_writer()
+{
+  std::unique_lock<std::mutex> lock(snapshot_mutex_);
+  while (true) {
+    snapshot_cv_.wait(lock, [this] { return snapshot_stop_ || snapshot_pending_; });
+    if (!snapshot_pending_) {
+      return;
+    }
+
+    FilterSnapshot snapshot = pending_snapshot_;
+    std::string filepath = snapshot_path_;
+    snapshot_pending_ = false;
+    lock.unlock();
+
+    std::string contents(reinterpret_cast<const char *>(&snapshot), sizeof(snapshot));
+    if (!replace_file(filepath, contents)) {
+      RCLCPP_WARN_STREAM(get_logger(), "Unable to write filter snapshot to " << filepath);
+    }
+
+    lock.lock();
+  }
+}
+
+const EstimatorContinuousDiscreteCore::AttitudeTrig &
+EstimatorContinuousDiscreteCore::attitude_trig(const Eigen::Vector2f & state)
+{
+  // Only evaluate the trig functions if the state has changed since they were last evaluated.
+  if (state(0) != attitude_trig_.phi || state(1) != attitude_trig_.theta) {
+    attitude_trig_.phi = state(0);
+    attitude_trig_.theta = state(1);
+    sincosf(state(0), &attitude_trig_.sp, &attitude_trig_.cp);
+    sincosf(state(1), &attitude_trig_.st, &attitude_trig_.ct);
+    attitude_trig_.tt = attitude_trig_.st / attitude_trig_.ct;
+  }
+
+  return attitude_trig_;
+}
+
+const EstimatorContinuousDiscreteCore::PositionTrig &
+EstimatorContinuousDiscreteCore::position_trig(const Eigen::Vector<float, 7> & state)
+{
+  // Only evaluate the trig functions if the state has changed since they were last evaluated.
+  if (state(3) != position_trig_.chi || state(6) != position_trig_.psi) {
+    position_trig_.chi = state(3);
+    position_trig_.psi = state(6);
+    sincosf(state(3), &position_trig_.schi, &position_trig_.cchi);
+    sincosf(state(6), &position_trig_.spsi, &position_trig_.cpsi);
+  }
+
+  return position_trig_;
+}
+
+const EstimatorContinuousDiscreteCore::PositionInputTrig &
+EstimatorContinuousDiscreteCore::position_input_trig(const Eigen::Vector<float, 6> & inputs)
+{
+  // The inputs are constant over a propagation, so these are evaluated once per propagation.
+  if (inputs != position_input_trig_.inputs) {
+    position_input_trig_.inputs = inputs;
+
+    float q = inputs(1);
+    float r = inputs(2);
+    float phi = inputs(3);
+    float theta = inputs(4);
+
+    float sphi, cphi;
+    sincosf(phi, &sphi, &cphi);
+    position_input_trig_.tphi = sphi / cphi;
+    position_input_trig_.psidot = (q * sphi + r * cphi) / cosf(theta);
+  }
+
+  return position_input_trig_;
+}
+
+Eigen::Vector2f
+EstimatorContinuousDiscreteCore::attitude_dynamics(const Eigen::Vector2f & state,
+                                                   const Eigen::Vector3f & angular_rates)
+{
+  const AttitudeTrig & trig = attitude_trig(state);
+  float cp = trig.cp; // cos(phi)
+  float sp = trig.sp; // sin(phi)
+  float tt = trig.tt; // tan(theta)
+
+  float p = angular_rates(0);
+  float q = angular_rates(1);
+  float r = angular_rates(2);
+
+  Eigen::Vector2f f;
+
+  f(0) = p + (q * sp + r * cp) * tt;
+  f(1) = q * cp - r * sp;
+
+  return f;
+}
+
+Eigen::Vector<float, 7>
+EstimatorContinuousDiscreteCore::position_dynamics(const Eigen::Vector<float, 7> & state,
+                                                   const Eigen::Vector<float, 6> & measurements)
+{
+
+  double gravity = gains_.gravity;
+
+  const PositionTrig & trig = position_trig(state);
+  const PositionInputTrig & input_trig = position_input_trig(measurements);
+
+  float Vg = state(2);
+  float wn = state(4);
+  float we = state(5);
+
+  float va = measurements(5);
+
+  float psidot = input_trig.psidot;
+
+  float Vgdot = va / Vg * psidot * (we * trig.cpsi - wn * trig.spsi);
+
+  // cos(chi - psi)
+  float cchi_psi = trig.cchi * trig.cpsi + trig.schi * trig.spsi;
+
+  Eigen::Vector<float, 7> f = Eigen::Vector<float, 7>::Zero();
+
+  f(0) = state(2) * trig.cchi;
+  f(1) = state(2) * trig.schi;
+  f(2) = Vgdot;
+  f(3) = gravity / state(2) * input_trig.tphi * cchi_psi;
+  f(6) = psidot;
+
+  return f;
+}
+
+Eigen::Matrix2f
+EstimatorContinuousDiscreteCore::attitude_jacobian(const Eigen::Vector2f & state,
+                                                   const Eigen::Vector3f & angular_rates)
+{
+  const AttitudeTrig & trig = attitude_trig(state);
+  float cp = trig.cp; // cos(phi)
+  float sp = trig.sp; // sin(phi)
+  float tt = trig.tt; // tan(theta)
+  float ct = trig.ct; // cos(theta)
+
+  float q = angular_rates(1);
+  float r = angular_rates(2);
+
+  Eigen::Matrix2f A = Eigen::Matrix2f::Zero();
+  A(0, 0) = (q * cp - r * sp) * tt;
+  A(0, 1) = (q * sp + r * cp) / ct / ct;
+  A(1, 0) = -q * sp - r * cp;
+
+  return A;
+}
+
+Eigen::Matrix<float, 4, 7>
+EstimatorContinuousDiscreteCore::position_jacobian(const Eigen::Vector<float, 7> & state,
+                                                   const Eigen::Vector<float, 6> & measurements)
+{
+  double gravity = gains_.gravity;
+
+  const PositionTrig & trig = position_trig(state);
+  const PositionInputTrig & input_trig = position_input_trig(measurements);
+
+  float va = measurements(5);
+
+  float Vg = state(2);
+  float wn = state(4);
+  float we = state(5);
+
+  float psidot = input_trig.psidot;
+
+  float tmp = -psidot * va * (state(4) * trig.cpsi + state(5) * trig.spsi) / state(2);
+
+  float Vgdot = va / Vg * psidot * (wn * trig.cpsi - we * trig.spsi);
+
+  // The wind and heading states (rows 4-6) do not depend on the state, so only the first 4 rows of
+  // the jacobian are kept.
+  Eigen::Matrix<float, 4, 7> A = Eigen::Matrix<float, 4, 7>::Zero();
+  A(0, 2) = trig.cchi;
+  A(0, 3) = -state(2) * trig.schi;
+  A(1, 2) = trig.schi;
+  A(1, 3) = state(2) * trig.cchi;
+  A(2, 2) = -Vgdot / state(2);
+  A(2, 4) = -psidot * va * trig.spsi / state(2);
+  A(2, 5) = psidot * va * trig.cpsi / state(2);
+  A(2, 6) = tmp;
+  A(3, 2) = -gravity / powf(state(2), 2) * input_trig.tphi; // The input phi is phihat_
+
+  return A;
+}
+
+Eigen::Matrix<float, 2, 3>
+EstimatorContinuousDiscreteCore::attitude_input_jacobian(const Eigen::Vector2f & state,
+                                                         const Eigen::Vector3f & angular_rates)
+{
+  const AttitudeTrig & trig = attitude_trig(state);
+  float cp = trig.cp; // cos(phi)
+  float sp = trig.sp; // sin(phi)
+  float tt = trig.tt; // tan(theta)
+
+  Eigen::Matrix<float, 2, 3> G;
+  G << 1, sp * tt, cp * tt, 0.0, cp, -sp;
+
+  return G;
+}
+
+Eigen::Vector3f
+EstimatorContinuousDiscreteCore::attitude_measurement_prediction(const Eigen::Vector2f & state,
+                                                                 const Eigen::Vector4f & inputs)
+{
+  double gravity = gains_.gravity;
+  const AttitudeTrig & trig = attitude_trig(state);
+  float cp = trig.cp; // cos(phi)
+  float sp = trig.sp; // sin(phi)
+  float st = trig.st; // sin(theta)
+  float ct = trig.ct; // cos(theta)
+
+  float p = inputs(0);
+  float q = inputs(1);
+  float r = inputs(2);
+  float va = inputs(3);
+
+  Eigen::Vector3f h = Eigen::Vector3f::Zero();
+  h(0) = q * va * st + gravity * st;
+  h(1) = r * va * ct - p * va * st - gravity * ct * sp;
+  h(2) = -q * va * ct - gravity * ct * cp;
+
+  return h;
+}
+
+Eigen::Vector<float, 6>
+EstimatorContinuousDiscreteCore::position_measurement_prediction(
+  const Eigen::Vector<float, 7> & state, const Eigen::Vector<float, 1> & input)
+{
+  float va = input(0);
+
+  const PositionTrig & trig = position_trig(state);
+
+  Eigen::Vector<float, 6> h = Eigen::Vector<float, 6>::Zero();
+
+  // GPS north
+  h(0) = state(0);
+
+  // GPS east
+  h(1) = state(1);
+
+  // GPS ground speed
+  h(2) = state(2);
+
+  // GPS course
+  h(3) = state(3);
+
+  // Pseudo Measurement north
+  h(4) = va * trig.cpsi + state(4) - state(2) * trig.cchi;
+
+  // Pseudo Measurement east
+  h(5) = va * trig.spsi + state(5) - state(2) * trig.schi;
+
+  // To add a new measurement, simply use the state and any input you need as another entry to h. Be sure to update the measurement jacobian C.
+
+  return h;
+}
+
+Eigen::Matrix<float, 6, 7>
+EstimatorContinuousDiscreteCore::position_measurement_jacobian(
+  const Eigen::Vector<float, 7> & state, const Eigen::Vector<float, 1> & input)
+{
+  float va = input(0);
+
+  const PositionTrig & trig = position_trig(state);
+
+  Eigen::Matrix<float, 6, 7> C = Eigen::Matrix<float, 6, 7>::Zero();
+
+  // GPS north
+  C(0, 0) = 1;
+
+  // GPS east
+  C(1, 1) = 1;
+
+  // GPS ground speed
+  C(2, 2) = 1;
+
+  // GPS course
+  C(3, 3) = 1;
+
+  // Pseudo Measurement north
+  C(4, 2) = -trig.cchi;
+  C(4, 3) = state(2) * trig.schi;
+  C(4, 4) = 1;
+  C(4, 6) = -va * trig.spsi;
+
+  // Pseudo Measurement east
+  C(5, 2) = -trig.schi;
+  C(5, 3) = -state(2) * trig.cchi;
+  C(5, 5) = 1;
+  C(5, 6) = va * trig.cpsi;
+
+  // To add a new measurement use the inputs and the state to add another row to the matrix C. Be sure to update the measurment prediction vector h.
+
+  return C;
+}
+
+Eigen::Matrix<float, 3, 2>
+EstimatorContinuousDiscreteCore::attitude_measurement_jacobian(const Eigen::Vector2f & state,
+                                                               const Eigen::Vector4f & inputs)
+{
+  double gravity = gains_.gravity;
+  const AttitudeTrig & trig = attitude_trig(state);
+  float cp = trig.cp;
+  float sp = trig.sp;
+  float ct = trig.ct;
+  float st = trig.st;
+
+  float p = inputs(0);
+  float q = inputs(1);
+  float r = inputs(2);
+  float va = inputs(3);
+
+  Eigen::Matrix<float, 3, 2> C;
+
+  C << 0.0, q * va * ct + gravity * ct, -gravity * cp * ct,
+    -r * va * st - p * va * ct + gravity * sp * st, gravity * sp * ct, (q * va + gravity * cp) * st;
+
+  return C;
+}
+
+void EstimatorContinuousDiscreteCore::check_xhat_a()
+{
+  double max_phi = gains_.max_estimated_phi;
+  double max_theta = gains_.max_estimated_theta;
+  double buff = gains_.estimator_max_buffer;
+
+  if (xhat_a_(0) > radians(85.0) || xhat_a_(0) < radians(-85.0) || !std::isfinite(xhat_a_(0))) {
+
+    if (!std::isfinite(xhat_a_(0))) {
+      xhat_a_(0) = 0;
+      P_a_ = Eigen::Matrix2f::Identity();
+      P_a_ *= powf(radians(20.0f), 2);
+      RCLCPP_WARN(get_logger(), "attiude estimator reinitialized due to non-finite roll");
+    } else if (xhat_a_(0) > radians(max_phi)) {
+      xhat_a_(0) = radians(max_phi - buff);
+      RCLCPP_WARN(get_logger(), "max roll angle");
+    } else if (xhat_a_(0) < radians(-max_phi)) {
+      xhat_a_(0) = radians(-max_phi + buff);
+      RCLCPP_WARN(get_logger(), "min roll angle");
+    }
+  }
+
+  if (!std::isfinite(xhat_a_(1))) {
+    xhat_a_(1) = 0;
+    P_a_ = Eigen::Matrix2f::Identity();
+    P_a_ *= powf(radians(20.0f), 2);
+    RCLCPP_WARN(get_logger(), "attiude estimator reinitialized due to non-finite pitch");
+  } else if (xhat_a_(1) > radians(max_theta)) {
+    xhat_a_(1) = radians(max_theta - buff);
+    RCLCPP_WARN(get_logger(), "max pitch angle");
+  } else if (xhat_a_(1) < radians(-max_theta)) {
+    xhat_a_(1) = radians(-max_theta + buff);
+    RCLCPP_WARN(get_logger(), "min pitch angle");
+  }
+}
+
+void EstimatorContinuousDiscreteCore::declare_parameters()
+{
+  sigma_n_gps_ = params_.declare_double("sigma_n_gps", .01);
+  sigma_e_gps_ = params_.declare_double("sigma_e_gps", .01);
+  sigma_Vg_gps_ = params_.declare_double("sigma_Vg_gps", .005);
+  sigma_course_gps_ = params_.declare_double("sigma_course_gps", .005 / 20);
+  sigma_accel_ = params_.declare_double("sigma_accel", .0025 * 9.81);
+  sigma_pseudo_wind_n_ = params_.declare_double("sigma_pseudo_wind_n", 0.01);
+  sigma_pseudo_wind_e_ = params_.declare_double("sigma_pseudo_wind_e", 0.01);
+  params_.declare_double("sigma_heading", 0.01);
+  lpf_a_ = params_.declare_double("lpf_a", 50.0);
+  lpf_a1_ = params_.declare_double("lpf_a1", 8.0);
+  gps_n_lim_ = params_.declare_double("gps_n_lim", 10000.);
+  gps_e_lim_ = params_.declare_double("gps_e_lim", 10000.);
+  // Rate of the position filter. At zero it runs every time the estimator does.
+  position_update_frequency_ = params_.declare_double("position_update_frequency", 0.0);
+  // Number of position filter updates kept to fuse delayed GPS fixes at the time they were measured
+  position_history_depth_ = params_.declare_int("position_history_depth", 50);
+  // Start from the saved initial position, baro calibration and filter snapshot
+  params_.declare_bool("seed_estimator", false);
+  // Binary checkpoint of the filter, restored when the estimator is started with seeded values.
+  // An empty file name disables the checkpoints.
+  filter_snapshot_file_ = params_.declare_string("filter_snapshot_file", "");
+  filter_snapshot_period_ = params_.declare_double("filter_snapshot_period", 1.0); // s
+  params_.declare_double("filter_snapshot_max_age", 30.0);                       // s
+  // Applies the accel and GPS measurements one at a time, with a chi-square gate (df = 1) on each
+  sequential_measurement_update_ = params_.declare_bool("sequential_measurement_update", false);
+  measurement_gate_threshold_ = params_.declare_double("measurement_gate_threshold", 6.63); // q = .01
+
+  params_.declare_double("roll_process_noise", 0.0001);     // Radians?, should be already squared
+  params_.declare_double("pitch_process_noise", 0.0000001); // Radians?, already squared
+  params_.declare_double("gyro_process_noise", 0.13);       // Deg, not squared
+  params_.declare_double("pos_process_noise", 0.1);         // already squared
+
+  params_.declare_double("attitude_initial_cov", 5.0); // Deg, not squared
+  params_.declare_double("pos_n_initial_cov", 0.03);
+  params_.declare_double("pos_e_initial_cov", 0.03);
+  params_.declare_double("vg_initial_cov", 0.01);
+  params_.declare_double("chi_initial_cov", 5.0); // Deg
+  params_.declare_double("wind_n_initial_cov", 0.04);
+  params_.declare_double("wind_e_initial_cov", 0.04);
+  params_.declare_double("psi_initial_cov", 5.0); // Deg
+
+  max_estimated_phi_ = params_.declare_double("max_estimated_phi", 85.0);       // Deg
+  max_estimated_theta_ = params_.declare_double("max_estimated_theta", 80.0);   // Deg
+  estimator_max_buffer_ = params_.declare_double("estimator_max_buffer", 3.0); // Deg
+}
+
+} // namespace rosplane
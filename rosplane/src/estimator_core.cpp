@@ -0,0 +1,65 @@
+#include "rosplane/estimator_core.hpp"
+
+namespace rosplane
+{
+
+EstimatorCore::EstimatorCore(const CoreContext & context)
+    : AlgorithmCore(context)
+    , baro_init_(false)
+    , gps_init_(false)
+{
+  // Declare default parameters associated with this estimator, estimator_core
+  estimator_update_frequency_ = params_.declare_double("estimator_update_frequency", 100.0);
+  rho_ = params_.declare_double("rho", 1.225);
+  gravity_ = params_.declare_double("gravity", 9.8);
+  params_.declare_double("baro_calibration_val", 0.0);
+  params_.declare_double("init_lat", 0.0);
+  params_.declare_double("init_lon", 0.0);
+  params_.declare_double("init_alt", 0.0);
+}
+
+void EstimatorCore::seed_from_parameters()
+{
+  double init_lat = params_.get_double("init_lat");
+  double init_long = params_.get_double("init_lon");
+  double init_alt = params_.get_double("init_alt");
+  double init_static = params_.get_double("baro_calibration_val");
+
+  RCLCPP_INFO_STREAM(get_logger(), "Using seeded estimator values.");
+  RCLCPP_INFO_STREAM(get_logger(), "Seeded initial latitude: " << init_lat);
+  RCLCPP_INFO_STREAM(get_logger(), "Seeded initial longitude: " << init_long);
+  RCLCPP_INFO_STREAM(get_logger(), "Seeded initial altitude: " << init_alt);
+  RCLCPP_INFO_STREAM(get_logger(), "Seeded barometer calibration value: " << init_static);
+
+  set_origin(init_lat, init_long, init_alt);
+  set_baro_calibration(init_static);
+}
+
+void EstimatorCore::set_origin(double lat, double lon, float alt)
+{
+  init_lat_ = lat;
+  init_lon_ = lon;
+  init_alt_ = alt;
+  gps_init_ = true;
+}
+
+void EstimatorCore::set_baro_calibration(float init_static)
+{
+  init_static_ = init_static;
+  baro_init_ = true;
+}
+
+void EstimatorCore::apply_references(const Input & input)
+{
+  if (input.origin_valid) {
+    set_origin(input.origin_lat, input.origin_lon, input.origin_alt);
+  }
+
+  if (input.baro_calibrated) {
+    set_baro_calibration(input.baro_calibration);
+  } else {
+    clear_baro_calibration();
+  }
+}
+
+} // namespace rosplane
@@ -0,0 +1,18 @@
+#include "rosplane/estimator_ekf_core.hpp"
+
+namespace rosplane
+{
+
+EstimatorEKFCore::EstimatorEKFCore(const CoreContext & context)
+    : EstimatorCore(context)
+{
+  // The parameters are set by the child, once all of the parameters are declared
+  declare_parameters();
+}
+
+void EstimatorEKFCore::declare_parameters()
+{
+  num_propagation_steps_ = params_.declare_int("num_propagation_steps", 10);
+}
+
+} // namespace rosplane
@@ -0,0 +1,41 @@
+#include <cstring>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include "estimator_continuous_discrete.hpp"
+#include "realtime_profile.hpp"
+
+int main(int argc, char ** argv)
+{
+
+  rclcpp::init(argc, argv);
+
+  char* use_params;
+  if (argc >= 2) {
+    use_params = argv[1];
+  }
+
+  std::shared_ptr<rosplane::EstimatorContinuousDiscrete> estimator_node;
+  if (!strcmp(use_params, "true")) {
+    estimator_node = std::make_shared<rosplane::EstimatorContinuousDiscrete>(use_params);
+  } else if (strcmp(use_params, "false")) // If the string is not true or false print error.
+  {
+    estimator_node = std::make_shared<rosplane::EstimatorContinuousDiscrete>();
+    RCLCPP_WARN(estimator_node->get_logger(),
+                "Invalid option for seeding estimator, defaulting to unseeded.");
+  } else {
+    estimator_node = std::make_shared<rosplane::EstimatorContinuousDiscrete>();
+  }
+
+  // Threads started by the executor inherit the priority and affinity of this thread.
+  rosplane::apply_realtime_profile(rosplane::realtime_profile_from_parameters(*estimator_node),
+                                   estimator_node->get_logger());
+
+  // The sensor callbacks and the estimator are in separate callback groups, which only run in
+  // parallel on a multi-threaded executor.
+  rclcpp::executors::MultiThreadedExecutor executor;
+  executor.add_node(estimator_node);
+  executor.spin();
+
+  return 0;
+}
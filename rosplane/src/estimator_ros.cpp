@@ -1,39 +1,62 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
 
-#include "estimator_continuous_discrete.hpp"
 #include "estimator_ros.hpp"
+#include "realtime_profile.hpp"
 
 namespace rosplane
 {
 
-EstimatorROS::EstimatorROS()
-    : Node("estimator_ros")
+EstimatorROS::EstimatorROS(const rclcpp::NodeOptions & options,
+                           const CoreFactory & make_estimator)
+    : Node("estimator_ros", options)
     , params_(this)
     , params_initialized_(false)
+    , imu_stamp_init_(false)
+    , last_tick_valid_(false)
+    , imu_samples_(512)
+    , last_gps_epoch_(0)
 {
   vehicle_state_pub_ = this->create_publisher<rosplane_msgs::msg::State>("estimated_state", 10);
+  diagnostics_pub_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
+
+  // The sensor callbacks and the estimator update run in separate callback groups, so that the
+  // sensors are still read while the estimator is running. The IMU can trigger the update, so it is
+  // in the estimator group with the timer and every update runs on the same thread.
+  sensor_callback_group_ =
+    this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  estimator_callback_group_ =
+    this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  rclcpp::SubscriptionOptions sensor_options;
+  sensor_options.callback_group = sensor_callback_group_;
+  rclcpp::SubscriptionOptions estimator_options;
+  estimator_options.callback_group = estimator_callback_group_;
 
   gnss_fix_sub_ = this->create_subscription<sensor_msgs::msg::NavSatFix>(
-    gnss_fix_topic_, 10, std::bind(&EstimatorROS::gnssFixCallback, this, std::placeholders::_1));
+    gnss_fix_topic_, 10, std::bind(&EstimatorROS::gnssFixCallback, this, std::placeholders::_1),
+    sensor_options);
   gnss_vel_sub_ = this->create_subscription<geometry_msgs::msg::TwistStamped>(
-    gnss_vel_topic_, 10, std::bind(&EstimatorROS::gnssVelCallback, this, std::placeholders::_1));
+    gnss_vel_topic_, 10, std::bind(&EstimatorROS::gnssVelCallback, this, std::placeholders::_1),
+    sensor_options);
   imu_sub_ = this->create_subscription<sensor_msgs::msg::Imu>(
-    imu_topic_, 10, std::bind(&EstimatorROS::imuCallback, this, std::placeholders::_1));
+    imu_topic_, 10, std::bind(&EstimatorROS::imuCallback, this, std::placeholders::_1),
+    estimator_options);
   baro_sub_ = this->create_subscription<rosflight_msgs::msg::Barometer>(
-    baro_topic_, 10, std::bind(&EstimatorROS::baroAltCallback, this, std::placeholders::_1));
+    baro_topic_, 10, std::bind(&EstimatorROS::baroAltCallback, this, std::placeholders::_1),
+    sensor_options);
   airspeed_sub_ = this->create_subscription<rosflight_msgs::msg::Airspeed>(
-    airspeed_topic_, 10, std::bind(&EstimatorROS::airspeedCallback, this, std::placeholders::_1));
+    airspeed_topic_, 10, std::bind(&EstimatorROS::airspeedCallback, this, std::placeholders::_1),
+    sensor_options);
   status_sub_ = this->create_subscription<rosflight_msgs::msg::Status>(
-    status_topic_, 10, std::bind(&EstimatorROS::statusCallback, this, std::placeholders::_1));
+    status_topic_, 10, std::bind(&EstimatorROS::statusCallback, this, std::placeholders::_1),
+    sensor_options);
 
-  init_static_ = 0;
   baro_count_ = 0;
   armed_first_time_ = false;
-  baro_init_ = false;
-  gps_init_ = false;
 
   // Set the parameter callback, for when parameters are changed.
   parameter_callback_handle_ = this->add_on_set_parameters_callback(
@@ -43,6 +66,14 @@ EstimatorROS::EstimatorROS()
   declare_parameters();
   params_.set_parameters();
 
+  // Build the estimation algorithm, which declares its own parameters and builds its gains.
+  estimator_ = make_estimator(CoreContext{params_, this->get_logger(), this->get_clock()});
+  estimator_update_frequency_ = params_.get_double_handle("estimator_update_frequency");
+  rho_ = params_.get_double_handle("rho");
+  gravity_ = params_.get_double_handle("gravity");
+  update_settings();
+  settings_ = settings_snapshot_.load();
+
   params_initialized_ = true;
 
   std::filesystem::path rosplane_dir = ament_index_cpp::get_package_share_directory("rosplane");
@@ -52,38 +83,78 @@ EstimatorROS::EstimatorROS()
   std::filesystem::path full_path = rosplane_dir / params_dir / params_file;
 
   param_filepath_ = full_path.string();
+  params_.set_save_file(param_filepath_, "estimator");
+
+  sensor_input_ = EstimatorCore::Input();
+  sensor_input_.diff_pres = 0.0; // Initalize the differential_pressure measurement to zero.
+  sensor_input_.static_pres = 0.0; // Initalize the differential_pressure measurement to zero.
+  load_references();
+  input_ = sensor_input_;
 
-  input_.diff_pres = 0.0; // Initalize the differential_pressure measurement to zero.
-  input_.static_pres = 0.0; // Initalize the differential_pressure measurement to zero.
+  last_imu_time_ns_ = this->get_clock()->now().nanoseconds();
 
   set_timer();
+
+  diagnostics_timer_ =
+    this->create_wall_timer(1s, std::bind(&EstimatorROS::diagnosticsCallback, this));
 }
 
 void EstimatorROS::declare_parameters()
 {
-  params_.declare_double("estimator_update_frequency", 100.0);
-  params_.declare_double("rho", 1.225);
-  params_.declare_double("gravity", 9.8);
-  params_.declare_double("gps_ground_speed_threshold",
-                         0.3); // TODO: this is a magic number. What is it determined from?
-  params_.declare_double("baro_measurement_gate",
-                         1.35); // TODO: this is a magic number. What is it determined from?
-  params_.declare_double("airspeed_measurement_gate",
-                         5.0); // TODO: this is a magic number. What is it determined from?
-  params_.declare_int("baro_calibration_count",
-                      100); // TODO: this is a magic number. What is it determined from?
-  params_.declare_double("baro_calibration_val", 0.0);
-  params_.declare_double("init_lat", 0.0);
-  params_.declare_double("init_lon", 0.0);
-  params_.declare_double("init_alt", 0.0);
+  // TODO: these are magic numbers. What are they determined from?
+  gps_ground_speed_threshold_ = params_.declare_double("gps_ground_speed_threshold", 0.3);
+  baro_measurement_gate_ = params_.declare_double("baro_measurement_gate", 1.35);
+  airspeed_measurement_gate_ = params_.declare_double("airspeed_measurement_gate", 5.0);
+  baro_calibration_count_ = params_.declare_int("baro_calibration_count", 100);
+  imu_triggered_estimation_ = params_.declare_bool("imu_triggered_estimation", false);
+  imu_watchdog_timeout_ = params_.declare_double("imu_watchdog_timeout", 0.05);
+  imu_coning_sculling_compensation_ =
+    params_.declare_bool("imu_coning_sculling_compensation", false);
+  // Convert GNSS fixes exactly through ECEF, instead of on the tangent plane at the initial fix
+  exact_geodesy_ = params_.declare_bool("exact_geodesy", false);
+  // Fill in the quaternion and angles in degrees on every Nth state, 0 to never fill them in
+  state_derived_fields_decimation_ = params_.declare_int("state_derived_fields_decimation", 1);
+  declare_realtime_parameters(params_);
+}
+
+void EstimatorROS::update_settings()
+{
+  Settings settings;
+  settings.estimator_update_frequency = estimator_update_frequency_;
+  settings.rho = rho_;
+  settings.gravity = gravity_;
+  settings.gps_ground_speed_threshold = gps_ground_speed_threshold_;
+  settings.baro_measurement_gate = baro_measurement_gate_;
+  settings.airspeed_measurement_gate = airspeed_measurement_gate_;
+  settings.baro_calibration_count = baro_calibration_count_;
+  settings.imu_triggered_estimation = imu_triggered_estimation_;
+  settings.imu_watchdog_timeout = imu_watchdog_timeout_;
+  settings.imu_coning_sculling_compensation = imu_coning_sculling_compensation_;
+  settings.exact_geodesy = exact_geodesy_;
+  settings.state_derived_fields_decimation = state_derived_fields_decimation_;
+
+  settings_snapshot_.store(settings);
+}
+
+void EstimatorROS::load_references()
+{
+  sensor_input_.origin_valid = estimator_->origin_initialized();
+  sensor_input_.origin_lat = estimator_->init_lat();
+  sensor_input_.origin_lon = estimator_->init_lon();
+  sensor_input_.origin_alt = estimator_->init_alt();
+  sensor_input_.baro_calibrated = estimator_->baro_initialized();
+  sensor_input_.baro_calibration = estimator_->baro_calibration();
+  input_snapshot_.store(sensor_input_);
 }
 
 void EstimatorROS::set_timer()
 {
-  double frequency = params_.get_double("estimator_update_frequency");
+  double frequency = estimator_update_frequency_;
 
   update_period_ = std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1'000'000));
-  update_timer_ = this->create_wall_timer(update_period_, std::bind(&EstimatorROS::update, this));
+  estimate_timing_.set_period(1.0 / frequency);
+  update_timer_ = this->create_wall_timer(
+    update_period_, std::bind(&EstimatorROS::timerCallback, this), estimator_callback_group_);
 }
 
 rcl_interfaces::msg::SetParametersResult
@@ -101,8 +172,11 @@ EstimatorROS::parametersCallback(const std::vector<rclcpp::Parameter> & paramete
 
   // Check to see if the timer period was changed. If it was, recreate the timer with the new period
   if (params_initialized_ && success) {
+    estimator_->update_gains();
+    update_settings();
+
     std::chrono::microseconds curr_period = std::chrono::microseconds(
-      static_cast<long long>(1.0 / params_.get_double("estimator_update_frequency") * 1'000'000));
+      static_cast<long long>(1.0 / estimator_update_frequency_ * 1'000'000));
     if (update_period_ != curr_period) {
       update_timer_->cancel();
       set_timer();
@@ -112,12 +186,93 @@ EstimatorROS::parametersCallback(const std::vector<rclcpp::Parameter> & paramete
   return result;
 }
 
-void EstimatorROS::update()
+void EstimatorROS::timerCallback()
+{
+  Settings settings = settings_snapshot_.load();
+  double frequency = settings.estimator_update_frequency;
+
+  // Measure the time since the last tick on the steady clock, so the filter propagates over the
+  // period the timer actually ran at.
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double Ts = last_tick_valid_ ? std::chrono::duration<double>(now - last_tick_).count() : 0.0;
+  last_tick_ = now;
+  last_tick_valid_ = true;
+
+  if (settings.imu_triggered_estimation) {
+    // The IMU is driving the estimator, the timer only steps in if the IMU goes quiet.
+    double time_since_imu =
+      (this->get_clock()->now().nanoseconds() - last_imu_time_ns_.load()) * 1e-9;
+    if (time_since_imu < settings.imu_watchdog_timeout) {
+      return;
+    }
+    RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                                "IMU is stale (" << time_since_imu
+                                                 << " s since last message). Running the "
+                                                    "estimator from the timer.");
+  }
+
+  // A late tick should not propagate the filter over a long gap, and ticks that bunch up after it
+  // should not give steps too short to be useful.
+  double nominal_Ts = 1.0 / frequency;
+  if (!std::isfinite(Ts) || Ts <= 0.0) {
+    Ts = nominal_Ts;
+  }
+  update(std::clamp(Ts, nominal_Ts / TIMER_STEP_BOUND, TIMER_STEP_BOUND * nominal_Ts));
+}
+
+void EstimatorROS::diagnosticsCallback()
+{
+  // Only build the diagnostics when something is listening.
+  if (diagnostics_pub_->get_subscription_count() == 0) {
+    return;
+  }
+
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = this->get_clock()->now();
+  msg->status.push_back(
+    imu_to_state_latency_.status(std::string(this->get_name()) + ": IMU to state latency",
+                                 this->get_name()));
+  msg->status.push_back(estimate_timing_.status(
+    std::string(this->get_name()) + ": estimate loop timing", this->get_name()));
+  diagnostics_pub_->publish(std::move(msg));
+}
+
+void EstimatorROS::update(double Ts)
 {
-  Output output;
+  settings_ = settings_snapshot_.load();
+
+  EstimatorCore::Output output;
+
+  // Take a consistent copy of the latest sensor data. A new GPS fix is detected from the epoch, so
+  // the callbacks never have to wait on the estimator to clear a flag.
+  input_ = input_snapshot_.load();
+  input_.gps_new = input_.gps_epoch != last_gps_epoch_;
+  last_gps_epoch_ = input_.gps_epoch;
+
+  double imu_dt = consumeImuSamples();
+
+  // Stamp the input with the newest IMU sample in it, on the same clock as the GPS fix stamps, so
+  // a delayed fix is matched against the history by the time it was measured.
+  rclcpp::Time imu_stamp(latest_imu_stamp_);
+  input_.stamp =
+    imu_stamp.nanoseconds() > 0 ? imu_stamp.seconds() : this->get_clock()->now().seconds();
+
+  // Fall back to the nominal period when there are no IMU samples to take the time step from. The
+  // loop timing is measured against the period of whichever is running the estimator.
+  double nominal_Ts = 1.0 / settings_.estimator_update_frequency;
+  if (Ts <= 0.0) {
+    Ts = imu_dt > 0.0 ? imu_dt : nominal_Ts;
+    estimate_timing_.tick(Ts);
+  } else {
+    estimate_timing_.tick(nominal_Ts);
+  }
+  input_.Ts = Ts;
+
+  // The origin and baro calibration found by the sensor callbacks come in with the input.
+  estimator_->apply_references(input_);
 
   if (armed_first_time_) {
-    estimate(input_, output);
+    estimate_timing_.measure([&] { estimator_->estimate(input_, output); });
   } else {
     output.pn = output.pe = output.h = 0;
     output.phi = output.theta = output.psi = 0;
@@ -126,88 +281,113 @@ void EstimatorROS::update()
     output.va = 0;
   }
 
-  input_.gps_new = false;
+  auto msg = std::make_unique<rosplane_msgs::msg::State>();
+  rclcpp::Time now = this->get_clock()->now();
+  msg->header.stamp = now;
+  msg->header.frame_id = 1; // Denotes global frame
+  msg->origin_stamp = latest_imu_stamp_;
+
+  msg->position[0] = output.pn;
+  msg->position[1] = output.pe;
+  msg->position[2] = -output.h; // Nominal output is alt. For NED the alt must be inverted.
+  if (estimator_->origin_initialized()) {
+    msg->initial_lat = estimator_->init_lat();
+    msg->initial_lon = estimator_->init_lon();
+    msg->initial_alt = estimator_->init_alt();
+  }
+  msg->va = output.va;
+  msg->alpha = output.alpha;
+  msg->beta = output.beta;
+  msg->phi = output.phi;
+  msg->theta = output.theta;
+  msg->psi = output.psi;
+  msg->chi = output.chi;
+  msg->p = output.p;
+  msg->q = output.q;
+  msg->r = output.r;
+  msg->vg = output.Vg;
+  msg->wn = output.wn;
+  msg->we = output.we;
+  msg->u = output.va * cos(output.theta);
+  msg->v = 0;
+  msg->w = output.va * sin(output.theta);
+
+  // The quaternion and the wrapped angles in degrees are only for displays and logs, so they are
+  // filled in on every Nth state. The rest of the states have quat_valid cleared.
+  msg->quat_valid = derived_fields_gate_.due(settings_.state_derived_fields_decimation);
+  if (msg->quat_valid) {
+    Eigen::Quaternionf q;
+    q = Eigen::AngleAxisf(output.phi, Eigen::Vector3f::UnitX())
+      * Eigen::AngleAxisf(output.theta, Eigen::Vector3f::UnitY())
+      * Eigen::AngleAxisf(output.psi, Eigen::Vector3f::UnitZ());
+
+    msg->quat[0] = q.w();
+    msg->quat[1] = q.x();
+    msg->quat[2] = q.y();
+    msg->quat[3] = q.z();
+
+    msg->psi_deg = fmod(output.psi, 2.0 * M_PI) * 180 / M_PI; //-360 to 360
+    msg->psi_deg += (msg->psi_deg < -180 ? 360 : 0);
+    msg->psi_deg -= (msg->psi_deg > 180 ? 360 : 0);
+    msg->chi_deg = fmod(output.chi, 2.0 * M_PI) * 180 / M_PI; //-360 to 360
+    msg->chi_deg += (msg->chi_deg < -180 ? 360 : 0);
+    msg->chi_deg -= (msg->chi_deg > 180 ? 360 : 0);
+  }
 
-  rosplane_msgs::msg::State msg;
-  msg.header.stamp = this->get_clock()->now();
-  msg.header.frame_id = 1; // Denotes global frame
+  vehicle_state_pub_->publish(std::move(msg));
 
-  msg.position[0] = output.pn;
-  msg.position[1] = output.pe;
-  msg.position[2] = -output.h; // Nominal output is alt. For NED the alt must be inverted.
-  if (gps_init_) {
-    msg.initial_lat = init_lat_;
-    msg.initial_lon = init_lon_;
-    msg.initial_alt = init_alt_;
+  // Trace the latency from the IMU sample the state was computed from, once there is one.
+  rclcpp::Time origin(latest_imu_stamp_);
+  if (origin.nanoseconds() > 0) {
+    imu_to_state_latency_.record((now - origin).seconds());
   }
-  msg.va = output.va;
-  msg.alpha = output.alpha;
-  msg.beta = output.beta;
-  msg.phi = output.phi;
-  msg.theta = output.theta;
-  msg.psi = output.psi;
-  msg.chi = output.chi;
-  msg.p = output.p;
-  msg.q = output.q;
-  msg.r = output.r;
-  msg.vg = output.Vg;
-  msg.wn = output.wn;
-  msg.we = output.we;
-  msg.quat_valid = true;
-
-  Eigen::Quaternionf q;
-  q = Eigen::AngleAxisf(output.phi, Eigen::Vector3f::UnitX())
-    * Eigen::AngleAxisf(output.theta, Eigen::Vector3f::UnitY())
-    * Eigen::AngleAxisf(output.psi, Eigen::Vector3f::UnitZ());
-
-  msg.quat[0] = q.w();
-  msg.quat[1] = q.x();
-  msg.quat[2] = q.y();
-  msg.quat[3] = q.z();
-
-  msg.u = output.va * cos(output.theta);
-  msg.v = 0;
-  msg.w = output.va * sin(output.theta);
-
-  msg.psi_deg = fmod(output.psi, 2.0 * M_PI) * 180 / M_PI; //-360 to 360
-  msg.psi_deg += (msg.psi_deg < -180 ? 360 : 0);
-  msg.psi_deg -= (msg.psi_deg > 180 ? 360 : 0);
-  msg.chi_deg = fmod(output.chi, 2.0 * M_PI) * 180 / M_PI; //-360 to 360
-  msg.chi_deg += (msg.chi_deg < -180 ? 360 : 0);
-  msg.chi_deg -= (msg.chi_deg > 180 ? 360 : 0);
-
-  vehicle_state_pub_->publish(msg);
 }
 
 void EstimatorROS::gnssFixCallback(const sensor_msgs::msg::NavSatFix::SharedPtr msg)
 {
+  // Rename parameter here for clarity
+  bool exact_geodesy = settings_snapshot_.load().exact_geodesy;
+
   bool has_fix = msg->status.status
     >= sensor_msgs::msg::NavSatStatus::STATUS_FIX; // Higher values refer to augmented fixes
   if (!has_fix || !std::isfinite(msg->latitude)) {
-    input_.gps_new = false;
     return;
   }
-  if (!gps_init_ && has_fix) {
-    gps_init_ = true;
-    init_alt_ = msg->altitude;
-    init_lat_ = msg->latitude;
-    init_lon_ = msg->longitude;
-    saveParameter("init_lat", init_lat_);
-    saveParameter("init_lon", init_lon_);
-    saveParameter("init_alt", init_alt_);
+  if (!sensor_input_.origin_valid && has_fix) {
+    sensor_input_.origin_valid = true;
+    sensor_input_.origin_lat = msg->latitude;
+    sensor_input_.origin_lon = msg->longitude;
+    sensor_input_.origin_alt = msg->altitude;
+    input_snapshot_.store(sensor_input_);
+    params_.save_double("init_lat", sensor_input_.origin_lat);
+    params_.save_double("init_lon", sensor_input_.origin_lon);
+    params_.save_double("init_alt", sensor_input_.origin_alt);
   } else {
-    input_.gps_n = EARTH_RADIUS * (msg->latitude - init_lat_) * M_PI / 180.0;
-    input_.gps_e =
-      EARTH_RADIUS * cos(init_lat_ * M_PI / 180.0) * (msg->longitude - init_lon_) * M_PI / 180.0;
-    input_.gps_h = msg->altitude - init_alt_;
-    input_.gps_new = true;
+    // Only rebuild the frame when the origin or the conversion mode changes.
+    LocalFrame::Mode mode =
+      exact_geodesy ? LocalFrame::Mode::ECEF : LocalFrame::Mode::TANGENT_PLANE;
+    double init_lat = sensor_input_.origin_lat;
+    double init_lon = sensor_input_.origin_lon;
+    double init_alt = sensor_input_.origin_alt;
+    if (!gnss_frame_.has_origin(init_lat, init_lon, init_alt, mode)) {
+      gnss_frame_ = LocalFrame(init_lat, init_lon, init_alt, mode);
+    }
+
+    std::array<double, 3> ned =
+      gnss_frame_.lla_to_ned({msg->latitude, msg->longitude, msg->altitude});
+    sensor_input_.gps_n = ned[0];
+    sensor_input_.gps_e = ned[1];
+    sensor_input_.gps_h = -ned[2];
+    sensor_input_.gps_stamp = rclcpp::Time(msg->header.stamp).seconds();
+    sensor_input_.gps_epoch++;
+    input_snapshot_.store(sensor_input_);
   }
 }
 
 void EstimatorROS::gnssVelCallback(const geometry_msgs::msg::TwistStamped::SharedPtr msg)
 {
   // Rename parameter here for clarity
-  double ground_speed_threshold = params_.get_double("gps_ground_speed_threshold");
+  double ground_speed_threshold = settings_snapshot_.load().gps_ground_speed_threshold;
 
   double v_n = msg->twist.linear.x;
   double v_e = msg->twist.linear.y;
@@ -215,93 +395,187 @@ void EstimatorROS::gnssVelCallback(const geometry_msgs::msg::TwistStamped::Share
   double ground_speed = sqrt(v_n * v_n + v_e * v_e);
   double course =
     atan2(v_e, v_n); //Does this need to be in a specific range? All uses seem to accept anything.
-  input_.gps_Vg = ground_speed;
+  sensor_input_.gps_Vg = ground_speed;
   if (ground_speed > ground_speed_threshold)
-    input_.gps_course = course;
+    sensor_input_.gps_course = course;
+  input_snapshot_.store(sensor_input_);
 }
 
 void EstimatorROS::imuCallback(const sensor_msgs::msg::Imu::SharedPtr msg)
 {
-  input_.accel_x = msg->linear_acceleration.x;
-  input_.accel_y = msg->linear_acceleration.y;
-  input_.accel_z = msg->linear_acceleration.z;
+  Eigen::Vector3f gyro(msg->angular_velocity.x, msg->angular_velocity.y,
+                       msg->angular_velocity.z);
+  Eigen::Vector3f accel(msg->linear_acceleration.x, msg->linear_acceleration.y,
+                        msg->linear_acceleration.z);
+
+  Settings settings = settings_snapshot_.load();
+  last_imu_time_ns_ = this->get_clock()->now().nanoseconds();
+
+  // Take the time between samples from the sensor stamps, so it is not affected by transport or
+  // scheduling jitter. This is left at zero on the first message, or if the stamps are out of
+  // order or further apart than the watchdog timeout.
+  double sample_dt = 0.0;
+  rclcpp::Time stamp(msg->header.stamp);
+  if (imu_stamp_init_) {
+    double stamp_dt = (stamp - last_imu_stamp_).seconds();
+    if (stamp_dt > 0.0 && stamp_dt < settings.imu_watchdog_timeout) {
+      sample_dt = stamp_dt;
+    }
+  }
+  last_imu_stamp_ = stamp;
+  imu_stamp_init_ = true;
+
+  if (!imu_samples_.push({gyro, accel, sample_dt, msg->header.stamp})) {
+    RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                         "IMU sample queue is full, dropping samples");
+  }
+
+  if (!settings.imu_triggered_estimation) {
+    return;
+  }
 
-  input_.gyro_x = msg->angular_velocity.x;
-  input_.gyro_y = msg->angular_velocity.y;
-  input_.gyro_z = msg->angular_velocity.z;
+  // This callback is in the same group as the timer, so the update can run here directly. The time
+  // step is taken from the samples it integrates.
+  update(0.0);
+}
+
+void EstimatorROS::accumulateImuSample(const Eigen::Vector3f & gyro, const Eigen::Vector3f & accel,
+                                       double dt)
+{
+  latest_gyro_ = gyro;
+  latest_accel_ = accel;
+
+  if (dt <= 0.0) {
+    return;
+  }
+
+  Eigen::Vector3f d_angle = gyro * dt;
+  Eigen::Vector3f d_velocity = accel * dt;
+
+  // Recursive coning and sculling terms, using the increments accumulated before this sample.
+  // See Savage, "Strapdown Inertial Navigation Integration Algorithm Design", 1998.
+  if (settings_.imu_coning_sculling_compensation) {
+    imu_integral_.coning += 0.5f * imu_integral_.delta_angle.cross(d_angle);
+    imu_integral_.sculling += 0.5f
+      * (imu_integral_.delta_angle.cross(d_velocity)
+         + imu_integral_.delta_velocity.cross(d_angle));
+  }
+
+  imu_integral_.delta_angle += d_angle;
+  imu_integral_.delta_velocity += d_velocity;
+  imu_integral_.dt += dt;
+}
+
+double EstimatorROS::consumeImuSamples()
+{
+  ImuSample sample;
+  while (imu_samples_.pop(sample)) {
+    accumulateImuSample(sample.gyro, sample.accel, sample.dt);
+    latest_imu_stamp_ = sample.stamp;
+  }
+
+  // If no samples were integrated since the last update, use the latest sample as is.
+  Eigen::Vector3f gyro = latest_gyro_;
+  Eigen::Vector3f accel = latest_accel_;
+  double dt = imu_integral_.dt;
+
+  if (imu_integral_.dt > 0.0) {
+    Eigen::Vector3f angle = imu_integral_.delta_angle + imu_integral_.coning;
+    Eigen::Vector3f velocity = imu_integral_.delta_velocity + imu_integral_.sculling;
+
+    if (settings_.imu_coning_sculling_compensation) {
+      // Rotation of the velocity increment over the interval
+      velocity += 0.5f * imu_integral_.delta_angle.cross(imu_integral_.delta_velocity);
+    }
+
+    gyro = angle / imu_integral_.dt;
+    accel = velocity / imu_integral_.dt;
+
+    imu_integral_ = ImuIntegral();
+  }
+
+  input_.gyro_x = gyro.x();
+  input_.gyro_y = gyro.y();
+  input_.gyro_z = gyro.z();
+
+  input_.accel_x = accel.x();
+  input_.accel_y = accel.y();
+  input_.accel_z = accel.z();
+
+  return dt;
 }
 
 void EstimatorROS::baroAltCallback(const rosflight_msgs::msg::Barometer::SharedPtr msg)
 {
   // For readability, declare the parameters here
-  double rho = params_.get_double("rho");
-  double gravity = params_.get_double("gravity");
-  double gate_gain_constant = params_.get_double("baro_measurement_gate");
-  double baro_calib_count = params_.get_int("baro_calibration_count");
+  Settings settings = settings_snapshot_.load();
+  double rho = settings.rho;
+  double gravity = settings.gravity;
+  double gate_gain_constant = settings.baro_measurement_gate;
+  double baro_calib_count = settings.baro_calibration_count;
 
-  if (armed_first_time_ && !baro_init_) {
+  if (armed_first_time_ && !sensor_input_.baro_calibrated) {
     if (baro_count_ < baro_calib_count) {
-      init_static_ += msg->pressure;
-      init_static_vector_.push_back(msg->pressure);
-      input_.static_pres = 0;
+      // Only the running statistics are kept, so any number of samples can be used.
+      baro_calibration_stats_.add(msg->pressure);
+      baro_calibration_q1_.add(msg->pressure);
+      baro_calibration_q3_.add(msg->pressure);
+      sensor_input_.static_pres = 0;
       baro_count_ += 1;
     } else {
-      init_static_ = std::accumulate(init_static_vector_.begin(), init_static_vector_.end(), 0.0)
-        / init_static_vector_.size();
-      baro_init_ = true;
-      saveParameter("baro_calibration_val", init_static_);
+      sensor_input_.baro_calibrated = true;
+      sensor_input_.baro_calibration = baro_calibration_stats_.mean();
+      params_.save_double("baro_calibration_val", sensor_input_.baro_calibration);
 
       //Check that it got a good calibration.
-      std::sort(init_static_vector_.begin(), init_static_vector_.end());
-      float q1 = (init_static_vector_[24] + init_static_vector_[25]) / 2.0;
-      float q3 = (init_static_vector_[74] + init_static_vector_[75]) / 2.0;
+      float q1 = baro_calibration_q1_.value();
+      float q3 = baro_calibration_q3_.value();
       float IQR = q3 - q1;
       float upper_bound = q3 + 2.0 * IQR;
       float lower_bound = q1 - 2.0 * IQR;
-      for (int i = 0; i < baro_calib_count; i++) {
-        if (init_static_vector_[i] > upper_bound) {
-          baro_init_ = false;
-          baro_count_ = 0;
-          init_static_vector_.clear();
-          RCLCPP_WARN(this->get_logger(), "Bad baro calibration. Recalibrating");
-          break;
-        } else if (init_static_vector_[i] < lower_bound) {
-          baro_init_ = false;
-          baro_count_ = 0;
-          init_static_vector_.clear();
-          RCLCPP_WARN(this->get_logger(), "Bad baro calibration. Recalibrating");
-          break;
-        }
+      if (baro_calibration_stats_.max() > upper_bound
+          || baro_calibration_stats_.min() < lower_bound) {
+        sensor_input_.baro_calibrated = false;
+        baro_count_ = 0;
+        baro_calibration_stats_.reset();
+        baro_calibration_q1_.reset();
+        baro_calibration_q3_.reset();
+        RCLCPP_WARN(this->get_logger(), "Bad baro calibration. Recalibrating");
       }
     }
   } else {
-    float static_pres_old = input_.static_pres;
-    input_.static_pres = -msg->pressure + init_static_;
+    float static_pres_old = sensor_input_.static_pres;
+    sensor_input_.static_pres = -msg->pressure + sensor_input_.baro_calibration;
 
     float gate_gain = gate_gain_constant * rho * gravity;
-    if (input_.static_pres < static_pres_old - gate_gain) {
-      input_.static_pres = static_pres_old - gate_gain;
-    } else if (input_.static_pres > static_pres_old + gate_gain) {
-      input_.static_pres = static_pres_old + gate_gain;
+    if (sensor_input_.static_pres < static_pres_old - gate_gain) {
+      sensor_input_.static_pres = static_pres_old - gate_gain;
+    } else if (sensor_input_.static_pres > static_pres_old + gate_gain) {
+      sensor_input_.static_pres = static_pres_old + gate_gain;
     }
   }
+
+  input_snapshot_.store(sensor_input_);
 }
 
 void EstimatorROS::airspeedCallback(const rosflight_msgs::msg::Airspeed::SharedPtr msg)
 {
   // For readability, declare the parameters here
-  double rho = params_.get_double("rho");
-  double gate_gain_constant = params_.get_double("airspeed_measurement_gate");
+  Settings settings = settings_snapshot_.load();
+  double rho = settings.rho;
+  double gate_gain_constant = settings.airspeed_measurement_gate;
 
-  float diff_pres_old = input_.diff_pres;
-  input_.diff_pres = msg->differential_pressure;
+  float diff_pres_old = sensor_input_.diff_pres;
+  sensor_input_.diff_pres = msg->differential_pressure;
 
   float gate_gain = pow(gate_gain_constant, 2) * rho / 2.0;
-  if (input_.diff_pres < diff_pres_old - gate_gain) {
-    input_.diff_pres = diff_pres_old - gate_gain;
-  } else if (input_.diff_pres > diff_pres_old + gate_gain) {
-    input_.diff_pres = diff_pres_old + gate_gain;
+  if (sensor_input_.diff_pres < diff_pres_old - gate_gain) {
+    sensor_input_.diff_pres = diff_pres_old - gate_gain;
+  } else if (sensor_input_.diff_pres > diff_pres_old + gate_gain) {
+    sensor_input_.diff_pres = diff_pres_old + gate_gain;
   }
+
+  input_snapshot_.store(sensor_input_);
 }
 
 void EstimatorROS::statusCallback(const rosflight_msgs::msg::Status::SharedPtr msg)
@@ -310,45 +584,4 @@ void EstimatorROS::statusCallback(const rosflight_msgs::msg::Status::SharedPtr m
     armed_first_time_ = true;
 }
 
-void EstimatorROS::saveParameter(std::string param_name, double param_val)
-{
-
-  YAML::Node param_yaml_file = YAML::LoadFile(param_filepath_);
-
-  if (param_yaml_file["estimator"]["ros__parameters"][param_name]) {
-    param_yaml_file["estimator"]["ros__parameters"][param_name] = param_val;
-  } else {
-    RCLCPP_ERROR_STREAM(this->get_logger(),
-                        "Parameter [" << param_name << "] is not in parameter file.");
-  }
-
-  std::ofstream fout(param_filepath_);
-  fout << param_yaml_file;
-}
-
 } // namespace rosplane
-
-int main(int argc, char ** argv)
-{
-
-  rclcpp::init(argc, argv);
-
-  char* use_params;
-  if (argc >= 2) {
-    use_params = argv[1];
-  }
-
-  if (!strcmp(use_params, "true")) {
-    rclcpp::spin(std::make_shared<rosplane::EstimatorContinuousDiscrete>(use_params));
-  } else if (strcmp(use_params, "false")) // If the string is not true or false print error.
-  {
-    auto estimator_node = std::make_shared<rosplane::EstimatorContinuousDiscrete>();
-    RCLCPP_WARN(estimator_node->get_logger(),
-                "Invalid option for seeding estimator, defaulting to unseeded.");
-    rclcpp::spin(estimator_node);
-  } else {
-    rclcpp::spin(std::make_shared<rosplane::EstimatorContinuousDiscrete>());
-  }
-
-  return 0;
-}
@@ -0,0 +1,93 @@
+#include <cmath>
+
+#include "geodesy.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+constexpr double WGS84_A = 6378137.0;                          // Semi-major axis (m)
+constexpr double WGS84_F = 1.0 / 298.257223563;                // Flattening
+constexpr double WGS84_E2 = WGS84_F * (2.0 - WGS84_F);         // First eccentricity squared
+constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+} // namespace
+
+LocalFrame::LocalFrame()
+    : LocalFrame(0.0, 0.0, 0.0)
+{}
+
+LocalFrame::LocalFrame(double lat, double lon, double alt, Mode mode)
+    : lat0_(lat)
+    , lon0_(lon)
+    , alt0_(alt)
+    , mode_(mode)
+{
+  double sin_lat = std::sin(lat * DEG_TO_RAD);
+  double cos_lat = std::cos(lat * DEG_TO_RAD);
+  double sin_lon = std::sin(lon * DEG_TO_RAD);
+  double cos_lon = std::cos(lon * DEG_TO_RAD);
+
+  // Meridian and prime vertical radii of curvature at the origin.
+  double w = 1.0 - WGS84_E2 * sin_lat * sin_lat;
+  double meridian_radius = WGS84_A * (1.0 - WGS84_E2) / (w * std::sqrt(w));
+  double prime_vertical_radius = WGS84_A / std::sqrt(w);
+
+  north_scale_ = (meridian_radius + alt) * DEG_TO_RAD;
+  east_scale_ = (prime_vertical_radius + alt) * cos_lat * DEG_TO_RAD;
+
+  ecef0_ = lla_to_ecef(lat, lon, alt);
+  ecef_to_ned_ = {-sin_lat * cos_lon, -sin_lat * sin_lon, cos_lat,
+                  -sin_lon,           cos_lon,            0.0,
+                  -cos_lat * cos_lon, -cos_lat * sin_lon, -sin_lat};
+}
+
+std::array<double, 3> LocalFrame::lla_to_ned(const std::array<double, 3> & lla) const
+{
+  std::array<double, 3> ned;
+  lla_to_ned(&lla, &ned, 1);
+  return ned;
+}
+
+void LocalFrame::lla_to_ned(const std::array<double, 3> * lla, std::array<double, 3> * ned,
+                            std::size_t count) const
+{
+  if (mode_ == Mode::TANGENT_PLANE) {
+    for (std::size_t i = 0; i < count; i++) {
+      // Take the short way around when the points are on either side of the antimeridian.
+      double d_lon = lla[i][1] - lon0_;
+      d_lon = d_lon > 180.0 ? d_lon - 360.0 : (d_lon < -180.0 ? d_lon + 360.0 : d_lon);
+
+      double n = (lla[i][0] - lat0_) * north_scale_;
+      double e = d_lon * east_scale_;
+      double d = alt0_ - lla[i][2];
+      ned[i] = {n, e, d};
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < count; i++) {
+    std::array<double, 3> ecef = lla_to_ecef(lla[i][0], lla[i][1], lla[i][2]);
+    double dx = ecef[0] - ecef0_[0];
+    double dy = ecef[1] - ecef0_[1];
+    double dz = ecef[2] - ecef0_[2];
+    ned[i] = {ecef_to_ned_[0] * dx + ecef_to_ned_[1] * dy + ecef_to_ned_[2] * dz,
+              ecef_to_ned_[3] * dx + ecef_to_ned_[4] * dy + ecef_to_ned_[5] * dz,
+              ecef_to_ned_[6] * dx + ecef_to_ned_[7] * dy + ecef_to_ned_[8] * dz};
+  }
+}
+
+std::array<double, 3> LocalFrame::lla_to_ecef(double lat, double lon, double alt)
+{
+  double sin_lat = std::sin(lat * DEG_TO_RAD);
+  double cos_lat = std::cos(lat * DEG_TO_RAD);
+  double prime_vertical_radius = WGS84_A / std::sqrt(1.0 - WGS84_E2 * sin_lat * sin_lat);
+
+  return {(prime_vertical_radius + alt) * cos_lat * std::cos(lon * DEG_TO_RAD),
+          (prime_vertical_radius + alt) * cos_lat * std::sin(lon * DEG_TO_RAD),
+          (prime_vertical_radius * (1.0 - WGS84_E2) + alt) * sin_lat};
+}
+
+} // namespace rosplane
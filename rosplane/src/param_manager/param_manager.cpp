@@ -1,163 +1,340 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <variant>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+
 #include "param_manager.hpp"
 
 namespace rosplane
 {
 
+namespace
+{
+
+/**
+ * @brief Flushes a file or directory to the storage device.
+ *
+ * @return True if the file could be opened and synced.
+ */
+bool sync_to_disk(const std::string & path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool synced = ::fsync(fd) == 0;
+  ::close(fd);
+  return synced;
+}
+
+} // namespace
+
+bool replace_file(const std::string & filepath, const std::string & contents)
+{
+  std::string temp_filepath = filepath + ".tmp";
+  std::ofstream fout(temp_filepath, std::ios::binary | std::ios::trunc);
+  fout.write(contents.data(), contents.size());
+  fout.close();
+  if (!fout || !sync_to_disk(temp_filepath)) {
+    return false;
+  }
+  if (std::rename(temp_filepath.c_str(), filepath.c_str()) != 0) {
+    return false;
+  }
+
+  std::filesystem::path directory = std::filesystem::path(filepath).parent_path();
+  return sync_to_disk(directory.empty() ? "." : directory.string());
+}
+
 ParamManager::ParamManager(rclcpp::Node * node)
     : container_node_{node}
+    , logger_{node ? node->get_logger() : rclcpp::get_logger("param_manager")}
 {}
 
-void ParamManager::declare_double(std::string param_name, double value)
+ParamHandle<double> ParamManager::declare_double(const std::string & param_name, double value)
 {
   // Insert the parameter into the parameter struct
-  params_[param_name] = value;
+  auto & stored = params_[param_name];
+  stored = override_or_default(param_name, value);
   // Declare each of the parameters, making it visible to the ROS2 param system.
-  container_node_->declare_parameter(param_name, value);
+  if (container_node_) {
+    container_node_->declare_parameter(param_name, value);
+  }
+
+  return ParamHandle<double>(std::get_if<double>(&stored));
 }
 
-void ParamManager::declare_bool(std::string param_name, bool value)
+ParamHandle<bool> ParamManager::declare_bool(const std::string & param_name, bool value)
 {
   // Insert the parameter into the parameter struct
-  params_[param_name] = value;
+  auto & stored = params_[param_name];
+  stored = override_or_default(param_name, value);
   // Declare each of the parameters, making it visible to the ROS2 param system.
-  container_node_->declare_parameter(param_name, value);
+  if (container_node_) {
+    container_node_->declare_parameter(param_name, value);
+  }
+
+  return ParamHandle<bool>(std::get_if<bool>(&stored));
 }
 
-void ParamManager::declare_int(std::string param_name, int64_t value)
+ParamHandle<int64_t> ParamManager::declare_int(const std::string & param_name, int64_t value)
 {
   // Insert the parameter into the parameter struct
-  params_[param_name] = value;
+  auto & stored = params_[param_name];
+  stored = override_or_default(param_name, value);
   // Declare each of the parameters, making it visible to the ROS2 param system.
-  container_node_->declare_parameter(param_name, value);
+  if (container_node_) {
+    container_node_->declare_parameter(param_name, value);
+  }
+
+  return ParamHandle<int64_t>(std::get_if<int64_t>(&stored));
 }
 
-void ParamManager::declare_string(std::string param_name, std::string value)
+ParamHandle<std::string> ParamManager::declare_string(const std::string & param_name,
+                                                      std::string value)
 {
   // Insert the parameter into the parameter struct
-  params_[param_name] = value;
+  auto & stored = params_[param_name];
+  stored = override_or_default(param_name, value);
   // Declare each of the parameters, making it visible to the ROS2 param system.
-  container_node_->declare_parameter(param_name, value);
+  if (container_node_) {
+    container_node_->declare_parameter(param_name, value);
+  }
+
+  return ParamHandle<std::string>(std::get_if<std::string>(&stored));
 }
 
-void ParamManager::set_double(std::string param_name, double value)
+void ParamManager::set_double(const std::string & param_name, double value)
 {
   // Check that the parameter is in the parameter struct
-  if (params_.find(param_name) == params_.end()) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(),
+  auto it = params_.find(param_name);
+  if (it == params_.end()) {
+    RCLCPP_ERROR_STREAM(logger_,
                         "Parameter not found in parameter struct: " + param_name);
     return;
   }
 
-  // Set the parameter in the parameter struct
-  params_[param_name] = value;
+  // Set the parameter in the parameter struct, keeping the stored type so handles stay valid
+  if (!std::holds_alternative<double>(it->second)) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "Parameter type does not match declared type: " + param_name);
+    return;
+  }
+  it->second = value;
   // Set the parameter in the ROS2 param system
-  container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  if (container_node_) {
+    container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  }
 }
 
-void ParamManager::set_bool(std::string param_name, bool value)
+void ParamManager::set_bool(const std::string & param_name, bool value)
 {
   // Check that the parameter is in the parameter struct
-  if (params_.find(param_name) == params_.end()) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(),
+  auto it = params_.find(param_name);
+  if (it == params_.end()) {
+    RCLCPP_ERROR_STREAM(logger_,
                         "Parameter not found in parameter struct: " + param_name);
     return;
   }
 
-  // Set the parameter in the parameter struct
-  params_[param_name] = value;
+  // Set the parameter in the parameter struct, keeping the stored type so handles stay valid
+  if (!std::holds_alternative<bool>(it->second)) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "Parameter type does not match declared type: " + param_name);
+    return;
+  }
+  it->second = value;
   // Set the parameter in the ROS2 param system
-  container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  if (container_node_) {
+    container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  }
 }
 
-void ParamManager::set_int(std::string param_name, int64_t value)
+void ParamManager::set_int(const std::string & param_name, int64_t value)
 {
   // Check that the parameter is in the parameter struct
-  if (params_.find(param_name) == params_.end()) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(),
+  auto it = params_.find(param_name);
+  if (it == params_.end()) {
+    RCLCPP_ERROR_STREAM(logger_,
                         "Parameter not found in parameter struct: " + param_name);
     return;
   }
 
-  // Set the parameter in the parameter struct
-  params_[param_name] = value;
+  // Set the parameter in the parameter struct, keeping the stored type so handles stay valid
+  if (!std::holds_alternative<int64_t>(it->second)) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "Parameter type does not match declared type: " + param_name);
+    return;
+  }
+  it->second = value;
   // Set the parameter in the ROS2 param system
-  container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  if (container_node_) {
+    container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  }
 }
 
-void ParamManager::set_string(std::string param_name, std::string value)
+void ParamManager::set_string(const std::string & param_name, std::string value)
 {
   // Check that the parameter is in the parameter struct
-  if (params_.find(param_name) == params_.end()) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(),
+  auto it = params_.find(param_name);
+  if (it == params_.end()) {
+    RCLCPP_ERROR_STREAM(logger_,
                         "Parameter not found in parameter struct: " + param_name);
     return;
   }
 
-  // Set the parameter in the parameter struct
-  params_[param_name] = value;
+  // Set the parameter in the parameter struct, keeping the stored type so handles stay valid
+  if (!std::holds_alternative<std::string>(it->second)) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "Parameter type does not match declared type: " + param_name);
+    return;
+  }
+  it->second = value;
   // Set the parameter in the ROS2 param system
-  container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  if (container_node_) {
+    container_node_->set_parameter(rclcpp::Parameter(param_name, value));
+  }
 }
 
-double ParamManager::get_double(std::string param_name)
+double ParamManager::get_double(const std::string & param_name)
 {
-  try {
-    return std::get<double>(params_[param_name]);
-  } catch (std::bad_variant_access & e) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(), "ERROR GETTING PARAMETER: " + param_name);
-    throw std::runtime_error(e.what());
-  }
+  return *get_value_ptr<double>(param_name);
+}
+
+bool ParamManager::get_bool(const std::string & param_name)
+{
+  return *get_value_ptr<bool>(param_name);
+}
+
+int64_t ParamManager::get_int(const std::string & param_name)
+{
+  return *get_value_ptr<int64_t>(param_name);
+}
+
+std::string ParamManager::get_string(const std::string & param_name)
+{
+  return *get_value_ptr<std::string>(param_name);
 }
 
-bool ParamManager::get_bool(std::string param_name)
+ParamOverrides ParamManager::load_overrides(const std::string & filepath)
 {
+  ParamOverrides overrides;
+  YAML::Node param_yaml_file;
   try {
-    return std::get<bool>(params_[param_name]);
-  } catch (std::bad_variant_access & e) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(), "ERROR GETTING PARAMETER: " + param_name);
-    throw std::runtime_error(e.what());
+    param_yaml_file = YAML::LoadFile(filepath);
+  } catch (const YAML::Exception & e) {
+    RCLCPP_ERROR_STREAM(rclcpp::get_logger("param_manager"),
+                        "Unable to read parameter file " << filepath << ": " << e.what());
+    return overrides;
   }
+
+  for (const auto & node : param_yaml_file) {
+    YAML::Node ros_parameters = node.second["ros__parameters"];
+    if (!ros_parameters.IsMap()) {
+      continue;
+    }
+    for (const auto & param : ros_parameters) {
+      if (param.second.IsScalar()) {
+        overrides[param.first.as<std::string>()] = param.second.Scalar();
+      }
+    }
+  }
+  return overrides;
 }
 
-int64_t ParamManager::get_int(std::string param_name)
+template<typename T>
+T ParamManager::override_or_default(const std::string & param_name, const T & value)
 {
+  auto it = overrides_.find(param_name);
+  if (container_node_ || it == overrides_.end()) {
+    return value;
+  }
+
   try {
-    return std::get<int64_t>(params_[param_name]);
-  } catch (std::bad_variant_access & e) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(), "ERROR GETTING PARAMETER: " + param_name);
-    throw std::runtime_error(e.what());
+    return YAML::Node(it->second).as<T>();
+  } catch (const YAML::Exception &) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "Override does not match declared type, using the default: " + param_name);
+    return value;
   }
 }
 
-std::string ParamManager::get_string(std::string param_name)
+template<typename T>
+const T * ParamManager::get_value_ptr(const std::string & param_name)
 {
-  try {
-    return std::get<std::string>(params_[param_name]);
-  } catch (std::bad_variant_access & e) {
-    RCLCPP_ERROR_STREAM(container_node_->get_logger(), "ERROR GETTING PARAMETER: " + param_name);
-    throw std::runtime_error(e.what());
+  auto it = params_.find(param_name);
+  if (it == params_.end()) {
+    RCLCPP_ERROR_STREAM(logger_, "ERROR GETTING PARAMETER: " + param_name);
+    throw std::runtime_error("Parameter not found in parameter struct: " + param_name);
   }
+
+  const T * value = std::get_if<T>(&it->second);
+  if (value == nullptr) {
+    RCLCPP_ERROR_STREAM(logger_, "ERROR GETTING PARAMETER: " + param_name);
+    throw std::runtime_error("Parameter type does not match declared type: " + param_name);
+  }
+  return value;
+}
+
+ParamHandle<double> ParamManager::get_double_handle(const std::string & param_name)
+{
+  return ParamHandle<double>(get_value_ptr<double>(param_name));
+}
+
+ParamHandle<bool> ParamManager::get_bool_handle(const std::string & param_name)
+{
+  return ParamHandle<bool>(get_value_ptr<bool>(param_name));
+}
+
+ParamHandle<int64_t> ParamManager::get_int_handle(const std::string & param_name)
+{
+  return ParamHandle<int64_t>(get_value_ptr<int64_t>(param_name));
+}
+
+ParamHandle<std::string> ParamManager::get_string_handle(const std::string & param_name)
+{
+  return ParamHandle<std::string>(get_value_ptr<std::string>(param_name));
+}
+
+bool ParamManager::store_parameter(const rclcpp::Parameter & param)
+{
+  auto & stored = params_[param.get_name()];
+  auto type = param.get_type();
+
+  // Only assign to the alternative already held, so the address of the stored value never changes
+  if (type == rclcpp::ParameterType::PARAMETER_DOUBLE && std::holds_alternative<double>(stored))
+    stored = param.as_double();
+  else if (type == rclcpp::ParameterType::PARAMETER_BOOL && std::holds_alternative<bool>(stored))
+    stored = param.as_bool();
+  else if (type == rclcpp::ParameterType::PARAMETER_INTEGER
+           && std::holds_alternative<int64_t>(stored))
+    stored = param.as_int();
+  else if (type == rclcpp::ParameterType::PARAMETER_STRING
+           && std::holds_alternative<std::string>(stored))
+    stored = param.as_string();
+  else
+    return false;
+
+  return true;
 }
 
 void ParamManager::set_parameters()
 {
+  // Without a node there is nothing to poll, the declared defaults are the values.
+  if (!container_node_) {
+    return;
+  }
 
   // Get the parameters from the launch file, if given.
   // If not, use the default value defined at declaration
   for (const auto & [key, value] : params_) {
-    auto type = container_node_->get_parameter(key).get_type();
-    if (type == rclcpp::ParameterType::PARAMETER_DOUBLE)
-      params_[key] = container_node_->get_parameter(key).as_double();
-    else if (type == rclcpp::ParameterType::PARAMETER_BOOL)
-      params_[key] = container_node_->get_parameter(key).as_bool();
-    else if (type == rclcpp::ParameterType::PARAMETER_INTEGER)
-      params_[key] = container_node_->get_parameter(key).as_int();
-    else if (type == rclcpp::ParameterType::PARAMETER_STRING)
-      params_[key] = container_node_->get_parameter(key).as_string();
-    else
-      RCLCPP_ERROR_STREAM(container_node_->get_logger(),
+    if (!store_parameter(container_node_->get_parameter(key)))
+      RCLCPP_ERROR_STREAM(logger_,
                           "Unable to set parameter: " + key
                             + ". Error casting parameter as double, int, string, or bool!");
   }
@@ -171,26 +348,134 @@ bool ParamManager::set_parameters_callback(const std::vector<rclcpp::Parameter>
     // Check if the parameter is in the params object or return an error
     if (params_.find(param.get_name()) == params_.end()) {
       RCLCPP_ERROR_STREAM(
-        container_node_->get_logger(),
+        logger_,
         "One of the parameters given is not a parameter of the controller node. Parameter: "
           + param.get_name());
       return false;
     }
 
-    if (param.get_type() == rclcpp::ParameterType::PARAMETER_DOUBLE)
-      params_[param.get_name()] = param.as_double();
-    else if (param.get_type() == rclcpp::ParameterType::PARAMETER_BOOL)
-      params_[param.get_name()] = param.as_bool();
-    else if (param.get_type() == rclcpp::ParameterType::PARAMETER_INTEGER)
-      params_[param.get_name()] = param.as_int();
-    else if (param.get_type() == rclcpp::ParameterType::PARAMETER_STRING)
-      params_[param.get_name()] = param.as_string();
-    else
-      RCLCPP_ERROR_STREAM(container_node_->get_logger(),
-                          "Unable to determine parameter type in controller. Type is "
-                            + std::to_string(param.get_type()));
+    if (!store_parameter(param)) {
+      RCLCPP_ERROR_STREAM(logger_,
+                          "Parameter type does not match declared type. Parameter: "
+                            + param.get_name()
+                            + ", type: " + std::to_string(param.get_type()));
+      return false;
+    }
   }
   return true;
 }
 
-} // namespace rosplane
\ No newline at end of file
+void ParamManager::set_save_file(const std::string & filepath, const std::string & node_key)
+{
+  // Destroying the old writer flushes anything still queued for the old file
+  file_writer_.reset();
+  file_writer_ =
+    std::make_unique<ParamFileWriter>(filepath, node_key, logger_);
+}
+
+void ParamManager::save_double(const std::string & param_name, double value)
+{
+  save_parameter(param_name, value);
+}
+
+void ParamManager::save_bool(const std::string & param_name, bool value)
+{
+  save_parameter(param_name, value);
+}
+
+void ParamManager::save_int(const std::string & param_name, int64_t value)
+{
+  save_parameter(param_name, value);
+}
+
+void ParamManager::save_string(const std::string & param_name, const std::string & value)
+{
+  save_parameter(param_name, value);
+}
+
+void ParamManager::save_parameter(const std::string & param_name, const ParamValue & value)
+{
+  if (!file_writer_) {
+    RCLCPP_ERROR_STREAM(logger_,
+                        "No parameter file set, unable to save parameter: " + param_name);
+    return;
+  }
+  file_writer_->queue(param_name, value);
+}
+
+ParamFileWriter::ParamFileWriter(const std::string & filepath, const std::string & node_key,
+                                 rclcpp::Logger logger)
+    : filepath_{filepath}
+    , node_key_{node_key}
+    , logger_{logger}
+{
+  thread_ = std::thread(&ParamFileWriter::run, this);
+}
+
+ParamFileWriter::~ParamFileWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queued_.notify_one();
+  thread_.join();
+}
+
+void ParamFileWriter::queue(const std::string & param_name, const ParamValue & value)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_[param_name] = value;
+  }
+  queued_.notify_one();
+}
+
+void ParamFileWriter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queued_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+
+    // Give any related values a chance to be queued, so they go out in the same write
+    queued_.wait_for(lock, coalesce_period_, [this] { return stop_; });
+
+    std::map<std::string, ParamValue> values;
+    values.swap(pending_);
+
+    lock.unlock();
+    write(values);
+    lock.lock();
+  }
+}
+
+void ParamFileWriter::write(const std::map<std::string, ParamValue> & values)
+{
+  YAML::Node param_yaml_file;
+  try {
+    param_yaml_file = YAML::LoadFile(filepath_);
+  } catch (const YAML::Exception & e) {
+    RCLCPP_ERROR_STREAM(logger_, "Unable to read parameter file " << filepath_ << ": " << e.what());
+    return;
+  }
+
+  YAML::Node node_params = param_yaml_file[node_key_]["ros__parameters"];
+  for (const auto & [name, value] : values) {
+    if (!node_params[name]) {
+      RCLCPP_ERROR_STREAM(logger_, "Parameter [" << name << "] is not in parameter file.");
+      continue;
+    }
+    std::visit([&node_params, &name = name](const auto & v) { node_params[name] = v; }, value);
+  }
+
+  std::ostringstream contents;
+  contents << param_yaml_file;
+  if (!replace_file(filepath_, contents.str())) {
+    RCLCPP_ERROR_STREAM(logger_, "Unable to write parameter file " << filepath_);
+  }
+}
+
+} // namespace rosplane
@@ -1,14 +1,14 @@
 #include <rclcpp/logging.hpp>
 
-#include "path_follower_example.hpp"
-
 #include "path_follower_base.hpp"
+#include "realtime_profile.hpp"
 
 namespace rosplane
 {
 
-PathFollowerBase::PathFollowerBase()
-    : Node("path_follower_base")
+PathFollowerBase::PathFollowerBase(const rclcpp::NodeOptions & options,
+                                   const CoreFactory & make_follower)
+    : Node("path_follower_base", options)
     , params_(this)
     , params_initialized_(false)
 {
@@ -20,6 +20,8 @@ PathFollowerBase::PathFollowerBase()
 
   controller_commands_pub_ =
     this->create_publisher<rosplane_msgs::msg::ControllerCommands>("controller_command", 1);
+  diagnostics_pub_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
 
   // Define the callback to handle on_set_parameter_callback events
   parameter_callback_handle_ = this->add_on_set_parameters_callback(
@@ -29,11 +31,17 @@ PathFollowerBase::PathFollowerBase()
   declare_parameters();
   params_.set_parameters();
 
+  // Build the path following algorithm, which declares its gains and builds the first set of them.
+  follower_ = make_follower(CoreContext{params_, this->get_logger(), this->get_clock()});
+
   params_initialized_ = true;
 
   // Now that the parameters have been set and loaded from the launch file, create the timer.
   set_timer();
 
+  diagnostics_timer_ =
+    this->create_wall_timer(1s, std::bind(&PathFollowerBase::diagnostics_publish, this));
+
   state_init_ = false;
   current_path_init_ = false;
 }
@@ -41,33 +49,93 @@ PathFollowerBase::PathFollowerBase()
 void PathFollowerBase::set_timer()
 {
   // Convert the frequency to a period in microseconds
-  double frequency = params_.get_double("controller_commands_pub_frequency");
+  double frequency = controller_commands_pub_frequency_;
   timer_period_ = std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1e6));
+  follow_timing_.set_period(1.0 / frequency);
 
   update_timer_ =
-    this->create_wall_timer(timer_period_, std::bind(&PathFollowerBase::update, this));
+    this->create_wall_timer(timer_period_, std::bind(&PathFollowerBase::timer_callback, this));
+}
+
+void PathFollowerBase::timer_callback()
+{
+  // The state and path are driving the follower, the timer only watches for the state going stale.
+  if (state_triggered_follow_) {
+    state_is_stale();
+    return;
+  }
+
+  follow_timing_.tick(1.0 / controller_commands_pub_frequency_);
+  update();
+}
+
+bool PathFollowerBase::state_is_stale()
+{
+  if (!state_init_) {
+    return false;
+  }
+
+  double time_since_state = (this->get_clock()->now() - last_state_time_).seconds();
+  if (time_since_state <= state_timeout_) {
+    return false;
+  }
+
+  RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                              "State is stale (" << time_since_state
+                                                 << " s since last message). Holding the last "
+                                                    "controller commands.");
+  return true;
 }
 
 void PathFollowerBase::update()
 {
 
-  Output output;
+  PathFollowerCore::Output output;
+
+  // When the state is driving the follower, stop commanding the controller from an old position.
+  // The controller has its own failsafe in that mode.
+  if (state_triggered_follow_ && state_is_stale()) {
+    return;
+  }
 
   if (state_init_ == true && current_path_init_ == true) {
-    follow(input_, output);
-    rosplane_msgs::msg::ControllerCommands msg;
+    follow_timing_.measure([&] { follower_->update(input_, output); });
+    auto msg = std::make_unique<rosplane_msgs::msg::ControllerCommands>();
 
     rclcpp::Time now = this->get_clock()->now();
 
     // Populate the message with the required information
-    msg.header.stamp = now;
-    msg.chi_c = output.chi_c;
-    msg.va_c = output.va_c;
-    msg.h_c = output.h_c;
-    msg.phi_ff = output.phi_ff;
+    msg->header.stamp = now;
+    msg->origin_stamp = state_origin_;
+    msg->chi_c = output.chi_c;
+    msg->va_c = output.va_c;
+    msg->h_c = output.h_c;
+    msg->phi_ff = output.phi_ff;
+
+    controller_commands_pub_->publish(std::move(msg));
+
+    // Trace the latency from the IMU sample the state was computed from, once there is one.
+    rclcpp::Time origin(state_origin_);
+    if (origin.nanoseconds() > 0) {
+      imu_to_command_latency_.record((now - origin).seconds());
+    }
+  }
+}
 
-    controller_commands_pub_->publish(msg);
+void PathFollowerBase::diagnostics_publish()
+{
+  // Only build the diagnostics when something is listening.
+  if (diagnostics_pub_->get_subscription_count() == 0) {
+    return;
   }
+
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = this->get_clock()->now();
+  msg->status.push_back(imu_to_command_latency_.status(
+    std::string(this->get_name()) + ": IMU to controller commands latency", this->get_name()));
+  msg->status.push_back(follow_timing_.status(
+    std::string(this->get_name()) + ": follow loop timing", this->get_name()));
+  diagnostics_pub_->publish(std::move(msg));
 }
 
 void PathFollowerBase::vehicle_state_callback(const rosplane_msgs::msg::State::SharedPtr msg)
@@ -78,10 +146,25 @@ void PathFollowerBase::vehicle_state_callback(const rosplane_msgs::msg::State::S
   input_.chi = msg->chi;
   input_.psi = msg->psi;
   input_.va = msg->va;
+  state_origin_ = msg->origin_stamp;
 
   RCLCPP_DEBUG_STREAM(this->get_logger(), "FROM STATE -- input.chi: " << input_.chi);
 
+  // The follow loop is timed against the interval of the state stamps in the triggered mode. It is
+  // only ticked here, so the updates run by a new path do not show up as jitter.
+  double period = 1.0 / controller_commands_pub_frequency_;
+  rclcpp::Time stamp(msg->header.stamp);
+  if (state_init_ && stamp > last_state_stamp_) {
+    period = (stamp - last_state_stamp_).seconds();
+  }
+  last_state_stamp_ = stamp;
+  last_state_time_ = this->get_clock()->now();
   state_init_ = true;
+
+  if (state_triggered_follow_) {
+    follow_timing_.tick(period);
+    update();
+  }
 }
 
 void PathFollowerBase::current_path_callback(const rosplane_msgs::msg::CurrentPath::SharedPtr msg)
@@ -102,6 +185,10 @@ void PathFollowerBase::current_path_callback(const rosplane_msgs::msg::CurrentPa
   input_.rho_orbit = msg->rho;
   input_.lam_orbit = msg->lamda;
   current_path_init_ = true;
+
+  if (state_triggered_follow_) {
+    update();
+  }
 }
 
 rcl_interfaces::msg::SetParametersResult
@@ -120,7 +207,9 @@ PathFollowerBase::parametersCallback(const std::vector<rclcpp::Parameter> & para
 
   // Check to see if the timer frequency parameter has changed
   if (params_initialized_ && success) {
-    double frequency = params_.get_double("controller_commands_pub_frequency");
+    follower_->update_gains();
+
+    double frequency = controller_commands_pub_frequency_;
 
     std::chrono::microseconds curr_period =
       std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1e6));
@@ -135,20 +224,12 @@ PathFollowerBase::parametersCallback(const std::vector<rclcpp::Parameter> & para
 
 void PathFollowerBase::declare_parameters()
 {
-  params_.declare_double("controller_commands_pub_frequency", 10.0);
-  params_.declare_double("chi_infty", .5);
-  params_.declare_double("k_path", 0.05);
-  params_.declare_double("k_orbit", 4.0);
+  controller_commands_pub_frequency_ =
+    params_.declare_double("controller_commands_pub_frequency", 10.0);
   params_.declare_int("update_rate", 100);
-  params_.declare_double("gravity", 9.81);
+  state_triggered_follow_ = params_.declare_bool("state_triggered_follow", false);
+  state_timeout_ = params_.declare_double("state_timeout", 0.25);
+  declare_realtime_parameters(params_);
 }
 
 } // namespace rosplane
-
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-
-  rclcpp::spin(std::make_shared<rosplane::PathFollowerExample>());
-  return 0;
-}
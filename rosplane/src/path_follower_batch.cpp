@@ -0,0 +1,200 @@
+#include <cmath>
+
+#include "rosplane/path_follower_batch.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+constexpr float kPi = static_cast<float>(M_PI);
+constexpr float kTwoPi = static_cast<float>(2 * M_PI);
+constexpr float kInvTwoPi = static_cast<float>(1 / (2 * M_PI));
+
+/**
+ * @return The angle shifted by a multiple of 2 pi to within pi of the fixed angle.
+ */
+inline float wrap_within_180(float fixed_heading, float wrapped_heading)
+{
+  return wrapped_heading
+    - std::floor((wrapped_heading - fixed_heading) * kInvTwoPi + 0.5f) * kTwoPi;
+}
+
+/**
+ * @brief Line law: approach the line at an angle that shrinks with the distance to it, and descend
+ * along its slope from its origin.
+ */
+inline void follow_line(float pn, float pe, float chi, float r_n, float r_e, float r_h,
+                        float chi_q, float sin_chi_q, float cos_chi_q, float slope, float k_path,
+                        float chi_infty, float & chi_c, float & h_c)
+{
+  float dn = pn - r_n;
+  float de = pe - r_e;
+  float path_error = -sin_chi_q * dn + cos_chi_q * de;
+  float chi_q_wrapped = wrap_within_180(chi, chi_q);
+  chi_c = chi_q_wrapped - chi_infty * (2.0f / kPi) * atanf(k_path * path_error);
+  h_c = r_h - sqrtf(dn * dn + de * de) * slope;
+}
+
+/**
+ * @brief Orbit law: turn toward the orbit in proportion to the normalized distance from it, with a
+ * feed forward of the roll of a coordinated turn at its radius.
+ */
+inline void follow_orbit(float pn, float pe, float va, float chi, float psi, float c_n, float c_e,
+                         float rho, float inv_rho, float lam, float k_orbit, float gravity,
+                         float & chi_c, float & phi_ff)
+{
+  float dn = pn - c_n;
+  float de = pe - c_e;
+  float d = sqrtf(dn * dn + de * de);
+  float varphi = wrap_within_180(chi, atan2f(de, dn));
+  float orbit_error = (d - rho) * inv_rho;
+  chi_c = wrap_within_180(0.0f, varphi + lam * (kPi / 2.0f + atanf(k_orbit * orbit_error)));
+  phi_ff = lam * atanf(va * va / (gravity * rho * cosf(chi - psi)));
+}
+
+} // namespace
+
+void PathFollowerBatch::follow_single(const Path & path, float pn, float pe, float va, float chi,
+                                      float psi, const PathFollowerCore::Gains & gains,
+                                      PathFollowerCore::Output & output)
+{
+  float chi_c;
+  float h_c = path.c_h;
+  float phi_ff = 0.0f;
+  if (path.line) {
+    follow_line(pn, pe, chi, path.r_n, path.r_e, path.r_h, path.chi_q, path.sin_chi_q,
+                path.cos_chi_q, path.slope, gains.k_path, gains.chi_infty, chi_c, h_c);
+  } else {
+    follow_orbit(pn, pe, va, chi, psi, path.c_n, path.c_e, path.rho, path.inv_rho, path.lam,
+                 gains.k_orbit, gains.gravity, chi_c, phi_ff);
+  }
+
+  output.va_c = path.va_d;
+  output.h_c = h_c;
+  output.chi_c = chi_c;
+  output.phi_ff = phi_ff;
+}
+
+PathFollowerBatch::Path PathFollowerBatch::prepare_path(const PathFollowerCore::Input & input)
+{
+  Path path{};
+  path.line = input.p_type == PathType::LINE;
+  path.va_d = input.va_d;
+
+  // Neutral values for the law that is not used, so that it stays finite.
+  path.cos_chi_q = 1.0f;
+  path.rho = 1.0f;
+  path.inv_rho = 1.0f;
+  path.lam = 1.0f;
+
+  if (path.line) {
+    path.r_n = input.r_path[0];
+    path.r_e = input.r_path[1];
+    path.r_h = -input.r_path[2];
+    path.chi_q = atan2f(input.q_path[1], input.q_path[0]);
+    path.sin_chi_q = sinf(path.chi_q);
+    path.cos_chi_q = cosf(path.chi_q);
+    float horizontal = sqrtf(input.q_path[0] * input.q_path[0] + input.q_path[1] * input.q_path[1]);
+    path.slope = horizontal > 0.0f ? input.q_path[2] / horizontal : 0.0f;
+  } else {
+    path.c_n = input.c_orbit[0];
+    path.c_e = input.c_orbit[1];
+    path.c_h = -input.c_orbit[2];
+    path.rho = input.rho_orbit;
+    path.inv_rho = 1.0f / input.rho_orbit;
+    path.lam = static_cast<float>(input.lam_orbit);
+  }
+  return path;
+}
+
+void PathFollowerBatch::resize(std::size_t size)
+{
+  size_ = size;
+  line_.assign(size, 0);
+  for (std::vector<float> * array :
+       {&va_d_, &r_n_, &r_e_, &r_h_, &chi_q_, &sin_chi_q_, &cos_chi_q_, &slope_, &c_n_, &c_e_,
+        &c_h_, &rho_, &inv_rho_, &lam_, &pn_, &pe_, &va_, &chi_, &psi_, &k_path_, &k_orbit_,
+        &chi_infty_, &gravity_, &va_c_, &h_c_, &chi_c_, &phi_ff_}) {
+    array->assign(size, 0.0f);
+  }
+
+  // Paths that have not been set are orbits of unit radius, which keeps every law finite.
+  rho_.assign(size, 1.0f);
+  inv_rho_.assign(size, 1.0f);
+  lam_.assign(size, 1.0f);
+  cos_chi_q_.assign(size, 1.0f);
+}
+
+void PathFollowerBatch::set_path(std::size_t i, const Path & path)
+{
+  line_[i] = path.line;
+  va_d_[i] = path.va_d;
+  r_n_[i] = path.r_n;
+  r_e_[i] = path.r_e;
+  r_h_[i] = path.r_h;
+  chi_q_[i] = path.chi_q;
+  sin_chi_q_[i] = path.sin_chi_q;
+  cos_chi_q_[i] = path.cos_chi_q;
+  slope_[i] = path.slope;
+  c_n_[i] = path.c_n;
+  c_e_[i] = path.c_e;
+  c_h_[i] = path.c_h;
+  rho_[i] = path.rho;
+  inv_rho_[i] = path.inv_rho;
+  lam_[i] = path.lam;
+}
+
+void PathFollowerBatch::follow()
+{
+  const std::size_t n = size_;
+  const int32_t * __restrict line = line_.data();
+  const float * __restrict va_d = va_d_.data();
+  const float * __restrict r_n = r_n_.data();
+  const float * __restrict r_e = r_e_.data();
+  const float * __restrict r_h = r_h_.data();
+  const float * __restrict chi_q = chi_q_.data();
+  const float * __restrict sin_chi_q = sin_chi_q_.data();
+  const float * __restrict cos_chi_q = cos_chi_q_.data();
+  const float * __restrict slope = slope_.data();
+  const float * __restrict c_n = c_n_.data();
+  const float * __restrict c_e = c_e_.data();
+  const float * __restrict c_h = c_h_.data();
+  const float * __restrict rho = rho_.data();
+  const float * __restrict inv_rho = inv_rho_.data();
+  const float * __restrict lam = lam_.data();
+  const float * __restrict pn = pn_.data();
+  const float * __restrict pe = pe_.data();
+  const float * __restrict va = va_.data();
+  const float * __restrict chi = chi_.data();
+  const float * __restrict psi = psi_.data();
+  const float * __restrict k_path = k_path_.data();
+  const float * __restrict k_orbit = k_orbit_.data();
+  const float * __restrict chi_infty = chi_infty_.data();
+  const float * __restrict gravity = gravity_.data();
+  float * __restrict va_c = va_c_.data();
+  float * __restrict h_c = h_c_.data();
+  float * __restrict chi_c = chi_c_.data();
+  float * __restrict phi_ff = phi_ff_.data();
+
+  for (std::size_t i = 0; i < n; ++i) {
+    float chi_c_line;
+    float h_c_line;
+    follow_line(pn[i], pe[i], chi[i], r_n[i], r_e[i], r_h[i], chi_q[i], sin_chi_q[i],
+                cos_chi_q[i], slope[i], k_path[i], chi_infty[i], chi_c_line, h_c_line);
+
+    float chi_c_orbit;
+    float phi_ff_orbit;
+    follow_orbit(pn[i], pe[i], va[i], chi[i], psi[i], c_n[i], c_e[i], rho[i], inv_rho[i], lam[i],
+                 k_orbit[i], gravity[i], chi_c_orbit, phi_ff_orbit);
+
+    bool is_line = line[i] != 0;
+    chi_c[i] = is_line ? chi_c_line : chi_c_orbit;
+    h_c[i] = is_line ? h_c_line : c_h[i];
+    phi_ff[i] = is_line ? 0.0f : phi_ff_orbit;
+    va_c[i] = va_d[i];
+  }
+}
+
+} // namespace rosplane
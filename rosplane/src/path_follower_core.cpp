@@ -0,0 +1,39 @@
+#include "rosplane/path_follower_core.hpp"
+
+namespace rosplane
+{
+
+PathFollowerCore::PathFollowerCore(const CoreContext & context)
+    : AlgorithmCore(context)
+{
+  chi_infty_ = params_.declare_double("chi_infty", .5);
+  k_path_ = params_.declare_double("k_path", 0.05);
+  k_orbit_ = params_.declare_double("k_orbit", 4.0);
+  gravity_ = params_.declare_double("gravity", 9.81);
+  params_.set_parameters();
+
+  // Build the first set of gains from the parameters.
+  update_gains();
+}
+
+void PathFollowerCore::update(const Input & input, Output & output)
+{
+  // Take one copy of the gains for the whole update, so a parameter change can not land partway
+  // through it.
+  gains_ = gains_snapshot_.load();
+
+  follow(input, output);
+}
+
+void PathFollowerCore::update_gains()
+{
+  Gains gains;
+  gains.chi_infty = chi_infty_;
+  gains.k_path = k_path_;
+  gains.k_orbit = k_orbit_;
+  gains.gravity = gravity_;
+
+  gains_snapshot_.store(gains);
+}
+
+} // namespace rosplane
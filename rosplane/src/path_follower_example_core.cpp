@@ -0,0 +1,44 @@
+#include <rclcpp/logging.hpp>
+
+#include "rosplane/path_follower_example_core.hpp"
+
+namespace rosplane
+{
+
+PathFollowerExampleCore::PathFollowerExampleCore(const CoreContext & context)
+    : PathFollowerCore(context)
+    , prepared_path_{}
+    , path_{}
+    , path_valid_(false)
+{}
+
+void PathFollowerExampleCore::follow(const Input & input, Output & output)
+{
+  // If path_type is a line, follow straight line path specified by r and q
+  // Otherwise, follow an orbit path specified by c_orbit, rho_orbit, and lam_orbit
+  if (!path_valid_ || !same_path(input, path_)) {
+    prepared_path_ = PathFollowerBatch::prepare_path(input);
+    path_ = input;
+    path_valid_ = true;
+  }
+
+  PathFollowerBatch::follow_single(prepared_path_, input.pn, input.pe, input.va, input.chi,
+                                   input.psi, gains_, output);
+
+  RCLCPP_DEBUG_STREAM(this->get_logger(), "input.chi: " << input.chi);
+  RCLCPP_DEBUG_STREAM(this->get_logger(), "chi_c: " << output.chi_c);
+}
+
+bool PathFollowerExampleCore::same_path(const Input & a, const Input & b)
+{
+  for (int i = 0; i < 3; ++i) {
+    if (a.r_path[i] != b.r_path[i] || a.q_path[i] != b.q_path[i]
+        || a.c_orbit[i] != b.c_orbit[i]) {
+      return false;
+    }
+  }
+  return a.p_type == b.p_type && a.va_d == b.va_d && a.rho_orbit == b.rho_orbit
+    && a.lam_orbit == b.lam_orbit;
+}
+
+} // namespace rosplane
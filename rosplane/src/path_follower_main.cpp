@@ -0,0 +1,15 @@
+#include <rclcpp/rclcpp.hpp>
+
+#include "path_follower_example.hpp"
+#include "realtime_profile.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  auto node = std::make_shared<rosplane::PathFollowerExample>();
+  rosplane::apply_realtime_profile(rosplane::realtime_profile_from_parameters(*node),
+                                   node->get_logger());
+  rclcpp::spin(node);
+  return 0;
+}
@@ -1,18 +1,17 @@
 #include <iostream>
-#include <limits>
 
 #include <rclcpp/logging.hpp>
 #include <rclcpp/rclcpp.hpp>
 
-#include "path_manager_example.hpp"
-
 #include "path_manager_base.hpp"
+#include "realtime_profile.hpp"
 
 namespace rosplane
 {
 
-PathManagerBase::PathManagerBase()
-    : Node("rosplane_path_manager")
+PathManagerBase::PathManagerBase(const rclcpp::NodeOptions & options,
+                                 const CoreFactory & make_manager)
+    : Node("rosplane_path_manager", options)
     , params_(this)
     , params_initialized_(false)
 {
@@ -20,7 +19,17 @@ PathManagerBase::PathManagerBase()
     "estimated_state", 10, std::bind(&PathManagerBase::vehicle_state_callback, this, _1));
   new_waypoint_sub_ = this->create_subscription<rosplane_msgs::msg::Waypoint>(
     "waypoint_path", 10, std::bind(&PathManagerBase::new_waypoint_callback, this, _1));
+
+  // Subscribe to the batches as transient_local, so a restarted path manager gets the mission back
+  rclcpp::QoS qos_transient_local_10_(10);
+  qos_transient_local_10_.transient_local();
+  new_waypoint_array_sub_ = this->create_subscription<rosplane_msgs::msg::WaypointArray>(
+    "waypoint_path_array", qos_transient_local_10_,
+    std::bind(&PathManagerBase::new_waypoint_array_callback, this, _1));
+  next_waypoint_client_ = this->create_client<std_srvs::srv::Trigger>("publish_next_waypoint");
   current_path_pub_ = this->create_publisher<rosplane_msgs::msg::CurrentPath>("current_path", 10);
+  diagnostics_pub_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
 
   // Set the parameter callback, for when parameters are changed.
   parameter_callback_handle_ = this->add_on_set_parameters_callback(
@@ -30,29 +39,34 @@ PathManagerBase::PathManagerBase()
   declare_parameters();
   params_.set_parameters();
 
+  // Build the path manager, which declares its own parameters.
+  manager_ = make_manager(CoreContext{params_, this->get_logger(), this->get_clock()});
+
   params_initialized_ = true;
 
   // Now that the update rate has been updated in parameters, create the timer
   set_timer();
 
-  num_waypoints_ = 0;
+  diagnostics_timer_ =
+    this->create_wall_timer(1s, std::bind(&PathManagerBase::diagnostics_publish, this));
 
   state_init_ = false;
 }
 
 void PathManagerBase::declare_parameters()
 {
-  params_.declare_double("R_min", 50.0);
-  params_.declare_double("current_path_pub_frequency", 100.0);
-  params_.declare_double("default_altitude", 50.0);
-  params_.declare_double("default_airspeed", 15.0);
+  current_path_pub_frequency_ = params_.declare_double("current_path_pub_frequency", 100.0);
+  // Number of waypoints to hold at once, streamed from the path_planner. 0 holds the whole mission
+  waypoint_window_size_ = params_.declare_int("waypoint_window_size", 0);
+  declare_realtime_parameters(params_);
 }
 
 void PathManagerBase::set_timer()
 {
   // Calculate the period in milliseconds from the frequency
-  double frequency = params_.get_double("current_path_pub_frequency");
+  double frequency = current_path_pub_frequency_;
   timer_period_ = std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1e6));
+  manage_timing_.set_period(1.0 / frequency);
 
   update_timer_ =
     this->create_wall_timer(timer_period_, std::bind(&PathManagerBase::current_path_publish, this));
@@ -74,7 +88,7 @@ PathManagerBase::parametersCallback(const std::vector<rclcpp::Parameter> & param
 
   // If the frequency parameter was changed, restart the timer.
   if (params_initialized_ && success) {
-    double frequency = params_.get_double("current_path_pub_frequency");
+    double frequency = current_path_pub_frequency_;
     std::chrono::microseconds curr_period =
       std::chrono::microseconds(static_cast<long long>(1.0 / frequency * 1e6));
     if (timer_period_ != curr_period) {
@@ -96,82 +110,97 @@ void PathManagerBase::vehicle_state_callback(const rosplane_msgs::msg::State & m
 
 void PathManagerBase::new_waypoint_callback(const rosplane_msgs::msg::Waypoint & msg)
 {
-  double R_min = params_.get_double("R_min");
-  double default_altitude = params_.get_double("default_altitude");
-  orbit_dir_ = 0;
-
-  // If the message contains "clear_wp_list", then clear all waypoints and do nothing else
-  if (msg.clear_wp_list == true) {
-    waypoints_.clear();
-    num_waypoints_ = 0;
-    idx_a_ = 0;
-    return;
-  }
-
-  // If there are currently no waypoints in the list, then add a temporary waypoint as
-  // the current state of the aircraft. This is necessary to define a line for line following.
-  if (waypoints_.size() == 0) {
-    Waypoint temp_waypoint;
-
-    temp_waypoint.w[0] = vehicle_state_.position[0];
-    temp_waypoint.w[1] = vehicle_state_.position[1];
+  add_waypoints({msg});
+}
 
-    if (vehicle_state_.position[2] < -default_altitude) {
+void PathManagerBase::new_waypoint_array_callback(const rosplane_msgs::msg::WaypointArray & msg)
+{
+  add_waypoints(msg.waypoints);
+}
 
-      temp_waypoint.w[2] = vehicle_state_.position[2];
-    } else {
-      temp_waypoint.w[2] = -default_altitude;
+void PathManagerBase::add_waypoints(const std::vector<rosplane_msgs::msg::Waypoint> & msgs)
+{
+  // New waypoints may mean the path_planner has more to stream.
+  next_waypoint_retry_ = std::chrono::steady_clock::time_point();
+
+  PathManagerCore::Input input = state_input();
+  std::vector<PathManagerCore::Waypoint> batch;
+  batch.reserve(msgs.size());
+
+  for (const rosplane_msgs::msg::Waypoint & msg : msgs) {
+    // If the message contains "clear_wp_list", then clear all waypoints and do nothing else
+    if (msg.clear_wp_list == true) {
+      if (!batch.empty()) {
+        manager_->add_waypoints(batch, input);
+        batch.clear();
+      }
+      manager_->clear_waypoints();
+      continue;
     }
 
-    temp_waypoint.chi_d = 0.0; // Doesn't matter, it is never used.
-    temp_waypoint.use_chi = false;
-    temp_waypoint.va_d = msg.va_d; // Use the va_d for the next waypoint.
+    PathManagerCore::Waypoint waypoint;
+    waypoint.w[0] = msg.w[0];
+    waypoint.w[1] = msg.w[1];
+    waypoint.w[2] = msg.w[2];
+    waypoint.chi_d = msg.chi_d;
+    waypoint.use_chi = msg.use_chi;
+    waypoint.va_d = msg.va_d;
+    batch.push_back(waypoint);
+  }
 
-    waypoints_.push_back(temp_waypoint);
-    num_waypoints_++;
-    temp_waypoint_ = true;
+  if (!batch.empty()) {
+    manager_->add_waypoints(batch, input);
   }
+}
+
+PathManagerCore::Input PathManagerBase::state_input() const
+{
+  PathManagerCore::Input input;
+  input.pn = vehicle_state_.position[0]; // position north
+  input.pe = vehicle_state_.position[1]; // position east
+  input.h = -vehicle_state_.position[2]; // altitude
+  input.chi = vehicle_state_.chi;
+  return input;
+}
 
-  // Add a default comparison for the last waypoint for feasiblity check.
-  Waypoint nextwp;
-  Eigen::Vector3f w_existing(std::numeric_limits<double>::infinity(),
-                             std::numeric_limits<double>::infinity(),
-                             std::numeric_limits<double>::infinity());
-  nextwp.w[0] = msg.w[0];
-  nextwp.w[1] = msg.w[1];
-  nextwp.w[2] = msg.w[2];
-  nextwp.chi_d = msg.chi_d;
-  nextwp.use_chi = msg.use_chi;
-  nextwp.va_d = msg.va_d;
-
-  // Save the last waypoint for comparison.
-  if (waypoints_.size() > 0) {
-    Waypoint waypoint = waypoints_.back();
-    w_existing << waypoint.w[0], waypoint.w[1], waypoint.w[2];
+void PathManagerBase::stream_waypoints()
+{
+  // For readability, declare the parameters that will be used in the function here
+  int64_t waypoint_window_size = waypoint_window_size_;
+
+  if (waypoint_window_size <= 0) {
+    return;
   }
-  waypoints_.push_back(nextwp);
-  num_waypoints_++;
 
-  // Warn if too close to the last waypoint.
-  Eigen::Vector3f w_new(msg.w[0], msg.w[1], msg.w[2]);
+  // Drop the waypoints that have been passed.
+  manager_->erase_passed_waypoints();
 
-  if ((w_new - w_existing).norm() < R_min) {
-    RCLCPP_WARN_STREAM(this->get_logger(),
-                       "A waypoint is too close to the next waypoint. Indices: "
-                         << waypoints_.size() - 2 << ", " << waypoints_.size() - 1);
+  // Ask for one waypoint at a time until the window is full. If the path_planner runs out, ask
+  // again every few seconds in case more waypoints were added to it.
+  if (manager_->num_waypoints() >= waypoint_window_size || waypoint_request_pending_
+      || std::chrono::steady_clock::now() < next_waypoint_retry_
+      || !next_waypoint_client_->service_is_ready()) {
+    return;
   }
+
+  waypoint_request_pending_ = true;
+  next_waypoint_client_->async_send_request(
+    std::make_shared<std_srvs::srv::Trigger::Request>(),
+    [this](rclcpp::Client<std_srvs::srv::Trigger>::SharedFuture future) {
+      waypoint_request_pending_ = false;
+      if (!future.get()->success) {
+        next_waypoint_retry_ = std::chrono::steady_clock::now() + 5s;
+      }
+    });
 }
 
 void PathManagerBase::current_path_publish()
 {
+  manage_timing_.tick();
 
-  Input input;
-  input.pn = vehicle_state_.position[0]; // position north
-  input.pe = vehicle_state_.position[1]; // position east
-  input.h = -vehicle_state_.position[2]; // altitude
-  input.chi = vehicle_state_.chi;
+  PathManagerCore::Input input = state_input();
 
-  Output output;
+  PathManagerCore::Output output;
   output.va_d = 0;
   output.r[0] = 0;
   output.r[1] = 0;
@@ -184,39 +213,77 @@ void PathManagerBase::current_path_publish()
   output.c[2] = 0;
 
   if (state_init_ == true) {
-    manage(input, output);
+    manage_timing_.measure([&] { manager_->manage(input, output); });
+    stream_waypoints();
   }
 
-  rosplane_msgs::msg::CurrentPath current_path;
+  auto current_path = std::make_unique<rosplane_msgs::msg::CurrentPath>();
 
   rclcpp::Time now = this->get_clock()->now();
 
   // Populate current_path message
-  current_path.header.stamp = now;
+  current_path->header.stamp = now;
+  current_path->origin_stamp = vehicle_state_.origin_stamp;
   if (output.flag) {
-    current_path.path_type = current_path.LINE_PATH;
+    current_path->path_type = current_path->LINE_PATH;
   } else {
-    current_path.path_type = current_path.ORBIT_PATH;
+    current_path->path_type = current_path->ORBIT_PATH;
   }
-  current_path.va_d = output.va_d;
+  current_path->va_d = output.va_d;
   for (int i = 0; i < 3; i++) {
-    current_path.r[i] = output.r[i];
-    current_path.q[i] = output.q[i];
-    current_path.c[i] = output.c[i];
+    current_path->r[i] = output.r[i];
+    current_path->q[i] = output.q[i];
+    current_path->c[i] = output.c[i];
   }
-  current_path.rho = output.rho;
-  current_path.lamda = output.lamda;
+  current_path->rho = output.rho;
+  current_path->lamda = output.lamda;
 
-  current_path_pub_->publish(current_path);
-}
+  current_path_pub_->publish(std::move(current_path));
 
-} // namespace rosplane
+  // Trace the latency from the IMU sample the state was computed from, once there is one.
+  rclcpp::Time origin(vehicle_state_.origin_stamp);
+  if (state_init_ && origin.nanoseconds() > 0) {
+    imu_to_path_latency_.record((now - origin).seconds());
+  }
+}
 
-int main(int argc, char ** argv)
+void PathManagerBase::diagnostics_publish()
 {
+  // Only build the diagnostics when something is listening.
+  if (diagnostics_pub_->get_subscription_count() == 0) {
+    return;
+  }
 
-  rclcpp::init(argc, argv);
-  rclcpp::spin(std::make_shared<rosplane::PathManagerExample>());
+  auto msg = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+  msg->header.stamp = this->get_clock()->now();
+  msg->status.push_back(imu_to_path_latency_.status(
+    std::string(this->get_name()) + ": IMU to current path latency", this->get_name()));
+  msg->status.push_back(manage_timing_.status(
+    std::string(this->get_name()) + ": manage loop timing", this->get_name()));
+
+  diagnostic_msgs::msg::DiagnosticStatus progress;
+  progress.name = std::string(this->get_name()) + ": mission progress";
+  progress.hardware_id = this->get_name();
+  LatencyHistogram::add_value(progress, "num_waypoints",
+                              std::to_string(manager_->num_waypoints()));
+  if (manager_->mission_progress_valid()) {
+    float distance_to_go = manager_->distance_to_go();
+    float time_to_go = manager_->time_to_go();
+    LatencyHistogram::add_value(progress, "current_waypoint",
+                                std::to_string(manager_->current_waypoint()));
+    LatencyHistogram::add_value(progress, "distance_to_go_m",
+                                LatencyHistogram::format(distance_to_go));
+    LatencyHistogram::add_value(progress, "time_to_go_s", LatencyHistogram::format(time_to_go));
+    progress.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    progress.message = LatencyHistogram::format(distance_to_go) + " m, "
+      + LatencyHistogram::format(time_to_go) + " s to the last waypoint";
+  } else {
+    progress.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+    progress.message = "No mission";
+  }
+  msg->status.push_back(progress);
 
-  return 0;
+  diagnostics_pub_->publish(std::move(msg));
 }
+
+} // namespace rosplane
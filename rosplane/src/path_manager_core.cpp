@@ -0,0 +1,116 @@
+#include <limits>
+
+#include <Eigen/Core>
+#include <rclcpp/logging.hpp>
+
+#include "rosplane/path_manager_core.hpp"
+
+namespace rosplane
+{
+
+PathManagerCore::PathManagerCore(const CoreContext & context)
+    : AlgorithmCore(context)
+    , num_waypoints_(0)
+    , idx_a_(0)
+{
+  R_min_ = params_.declare_double("R_min", 50.0);
+  default_altitude_ = params_.declare_double("default_altitude", 50.0);
+  default_airspeed_ = params_.declare_double("default_airspeed", 15.0);
+}
+
+void PathManagerCore::clear_waypoints()
+{
+  orbit_dir_ = 0;
+
+  waypoints_.clear();
+  num_waypoints_ = 0;
+  idx_a_ = 0;
+
+  waypoints_changed(0);
+}
+
+void PathManagerCore::add_waypoints(const std::vector<Waypoint> & waypoints, const Input & input)
+{
+  orbit_dir_ = 0;
+
+  // Make room for the whole batch, and the temporary waypoint, before adding any of it.
+  waypoints_.reserve(waypoints_.size() + waypoints.size() + 1);
+
+  int first_changed = num_waypoints_;
+  for (const Waypoint & waypoint : waypoints) {
+    add_waypoint(waypoint, input);
+  }
+
+  waypoints_changed(first_changed);
+}
+
+void PathManagerCore::add_waypoint(const Waypoint & waypoint, const Input & input)
+{
+  double R_min = R_min_;
+  double default_altitude = default_altitude_;
+
+  // If there are currently no waypoints in the list, then add a temporary waypoint as
+  // the current state of the aircraft. This is necessary to define a line for line following.
+  if (waypoints_.size() == 0) {
+    Waypoint temp_waypoint;
+
+    temp_waypoint.w[0] = input.pn;
+    temp_waypoint.w[1] = input.pe;
+
+    if (input.h > default_altitude) {
+
+      temp_waypoint.w[2] = -input.h;
+    } else {
+      temp_waypoint.w[2] = -default_altitude;
+    }
+
+    temp_waypoint.chi_d = 0.0; // Doesn't matter, it is never used.
+    temp_waypoint.use_chi = false;
+    temp_waypoint.va_d = waypoint.va_d; // Use the va_d for the next waypoint.
+
+    waypoints_.push_back(temp_waypoint);
+    num_waypoints_++;
+    temp_waypoint_ = true;
+  }
+
+  // Add a default comparison for the last waypoint for feasiblity check.
+  Eigen::Vector3f w_existing(std::numeric_limits<double>::infinity(),
+                             std::numeric_limits<double>::infinity(),
+                             std::numeric_limits<double>::infinity());
+
+  // Save the last waypoint for comparison.
+  if (waypoints_.size() > 0) {
+    const Waypoint & last = waypoints_.back();
+    w_existing << last.w[0], last.w[1], last.w[2];
+  }
+  waypoints_.push_back(waypoint);
+  num_waypoints_++;
+
+  // Warn if too close to the last waypoint.
+  Eigen::Vector3f w_new(waypoint.w[0], waypoint.w[1], waypoint.w[2]);
+
+  if ((w_new - w_existing).norm() < R_min) {
+    RCLCPP_WARN_STREAM(this->get_logger(),
+                       "A waypoint is too close to the next waypoint. Indices: "
+                         << waypoints_.size() - 2 << ", " << waypoints_.size() - 1);
+  }
+}
+
+int PathManagerCore::erase_passed_waypoints()
+{
+  // The temporary waypoint is always the first, so it goes with the waypoints that were passed.
+  int count = idx_a_;
+  if (count <= 0) {
+    return 0;
+  }
+
+  waypoints_.erase(waypoints_.begin(), waypoints_.begin() + count);
+  num_waypoints_ -= count;
+  idx_a_ = 0;
+  temp_waypoint_ = false;
+  waypoints_erased(count);
+
+  return count;
+}
+
+} // namespace rosplane
@@ -0,0 +1,768 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include <rclcpp/logging.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+#include "rosplane/path_manager_example_core.hpp"
+
+namespace rosplane
+{
+
+PathManagerExampleCore::PathManagerExampleCore(const CoreContext & context)
+    : PathManagerCore(context)
+{
+  fil_state_ = FilletState::STRAIGHT;
+  dub_state_ = DubinState::FIRST;
+
+  // Declare the parameters used in this class with the ROS2 system
+  declare_parameters();
+  params_.set_parameters();
+
+  start_time_ = std::chrono::system_clock::now();
+
+  first_ = true;
+  segments_R_min_ = R_min_;
+}
+
+void PathManagerExampleCore::manage(const Input & input, Output & output)
+{
+  // For readability, declare the parameters that will be used in the function here
+  double R_min = R_min_;
+  double default_altitude =
+    default_altitude_; // This is the true altitude not the down position (no need for a negative)
+  double default_airspeed = default_airspeed_;
+
+  // The segments are only out of date here if R_min was changed since they were computed.
+  if (R_min != segments_R_min_) {
+    update_segments(0);
+  }
+
+  if (num_waypoints_ == 0) {
+    auto now = std::chrono::system_clock::now();
+    if (float(std::chrono::system_clock::to_time_t(now)
+              - std::chrono::system_clock::to_time_t(start_time_))
+        >= 10.0) {
+      // TODO: Add check to see if the aircraft has been armed. If not just send the warning once before flight then on the throttle after.
+      RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 5000,
+                                  "No waypoints received, orbiting origin at " << default_altitude
+                                                                               << " meters.");
+      output.flag = false;            // Indicate that the path is an orbit.
+      output.va_d = default_airspeed; // Set to the default_airspeed.
+      output.q[0] = 0.0f;             // initialize the parameters to have a value.
+      output.q[1] = 0.0f;
+      output.q[2] = 0.0f;
+      output.r[0] = 0.0f; // initialize the parameters to have a value.
+      output.r[1] = 0.0f;
+      output.r[2] = 0.0f;
+      output.c[0] =
+        0.0f; // Direcct the center of the orbit to the origin at the default default_altitude.
+      output.c[1] = 0.0f;
+      output.c[2] = -default_altitude;
+      output.rho = R_min; // Make the orbit at the minimum turn radius.
+      output.lamda = 1;   // Orbit in a clockwise manner.
+    }
+  } else if (num_waypoints_ == 1) {
+    // If only a single waypoint is given, orbit it.
+    output.flag = false;
+    output.va_d = waypoints_[0].va_d;
+    output.q[0] = 0.0f; // initialize the parameters to have a value.
+    output.q[1] = 0.0f;
+    output.q[2] = 0.0f;
+    output.r[0] = 0.0f; // initialize the parameters to have a value.
+    output.r[1] = 0.0f;
+    output.r[2] = 0.0f;
+    output.c[0] = waypoints_[0].w[0];
+    output.c[1] = waypoints_[0].w[1];
+    output.c[2] = waypoints_[0].w[2];
+    output.rho = R_min;
+    output.lamda =
+      orbit_direction(input.pn, input.pe, input.chi, output.c[0],
+                      output.c[1]); // Calculate the most conveinent orbit direction of that point.
+  } else {
+    if (waypoints_[idx_a_].use_chi) {
+      manage_dubins(input, output);
+    } else { // If the heading through the point does not matter use the default path following.
+      /** Switch the following for flying directly to waypoints, or filleting corners */
+      //manage_line(input, output); // TODO add ROS param for just line following or filleting?
+      manage_fillet(input, output);
+    }
+  }
+
+  update_mission_progress(input);
+}
+
+void PathManagerExampleCore::manage_line(const Input & input, Output & output)
+{
+  // For readability, declare the parameters that will be used in the function here
+  bool orbit_last = orbit_last_;
+
+  Eigen::Vector3f p;
+  p << input.pn, input.pe, -input.h;
+
+  int idx_b;
+  int idx_c;
+
+  increment_indices(idx_a_, idx_b, idx_c, input, output);
+
+  if (orbit_last && (idx_a_ == num_waypoints_ - 1 || idx_a_ == num_waypoints_ - 2)) {
+    return;
+  }
+
+  const Segment & segment = segments_[idx_a_];
+  Eigen::Vector3f w_im1(waypoints_[idx_a_].w);
+  Eigen::Vector3f w_i(waypoints_[idx_b].w);
+
+  // Fill out data for straight line to the next point.
+  output.flag = true;
+  output.va_d = waypoints_[idx_a_].va_d;
+  output.r[0] = w_im1(0);
+  output.r[1] = w_im1(1);
+  output.r[2] = w_im1(2);
+  output.q[0] = segment.q(0);
+  output.q[1] = segment.q(1);
+  output.q[2] = segment.q(2);
+
+  // If the aircraft passes through the plane that bisects the angle between the waypoint lines, transition.
+  if ((p - w_i).dot(segment.n) > 0.0f) {
+    if (idx_a_ == num_waypoints_ - 1) {
+      idx_a_ = 0;
+    } else {
+      idx_a_++;
+    }
+  }
+}
+
+void PathManagerExampleCore::manage_fillet(const Input & input, Output & output)
+{
+  // For readability, declare the parameters that will be used in the function here
+  bool orbit_last = orbit_last_;
+  double R_min = R_min_;
+
+  if (num_waypoints_ < 3) // Do not attempt to fillet between only 2 points.
+  {
+    manage_line(input, output);
+    return;
+  }
+
+  Eigen::Vector3f p;
+  p << input.pn, input.pe, -input.h;
+
+  // idx_a is the waypoint you are coming from.
+  int idx_b; // Next waypoint.
+  int idx_c; // Waypoint after next.
+
+  increment_indices(idx_a_, idx_b, idx_c, input, output);
+
+  if (orbit_last && idx_a_ == num_waypoints_ - 1) {
+    return;
+  }
+
+  const Segment & segment = segments_[idx_a_];
+  Eigen::Vector3f w_im1(waypoints_[idx_a_].w); // Previous waypoint NED im1 means i-1
+
+  output.va_d = waypoints_[idx_a_].va_d; // Desired airspeed of this leg of the waypoints.
+  output.r[0] = w_im1(0);                // See chapter 11 of the UAV book for more information.
+  output.r[1] = w_im1(1); // This is the point that is a point along the commanded path.
+  output.r[2] = w_im1(2);
+
+  // If max_r (maximum radius possible for angle) is smaller than R_min, do line management.
+  if (R_min > segment.max_r) {
+    // While in the too acute region, publish notice every 10 seconds.
+    RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 5000,
+                                "Too acute an angle, using line management. Values, max_r: "
+                                  << segment.max_r << " R_min: " << R_min);
+    manage_line(input, output);
+    return;
+  }
+
+  switch (fil_state_) {
+    case FilletState::STRAIGHT: {
+      output.flag = true; // Indicate flying a straight path.
+      output.q[0] = segment.q(
+        0); // Fly along vector into the turn the origin of the vector is r (set as previous waypoint above).
+      output.q[1] = segment.q(1);
+      output.q[2] = segment.q(2);
+      output.c[0] = 1; // Fill rest of the data though it is not used.
+      output.c[1] = 1;
+      output.c[2] = 1;
+      output.rho = 1;
+      output.lamda = 1;
+
+      if ((p - segment.z1).dot(segment.q) > 0) {
+        if (segment.q_next == segment.q) // Check if the waypoint is directly between the next two.
+        {
+          if (idx_a_ == num_waypoints_ - 1)
+            idx_a_ = 0;
+          else
+            idx_a_++;
+          break;
+        }
+        fil_state_ = FilletState::TRANSITION; // Check to see if passed through the plane.
+      }
+      break;
+    }
+    case FilletState::TRANSITION: {
+      output.flag = false; // Indicate that aircraft is following an orbit.
+      output.q[0] =
+        segment.q_next(0); // Load the message with the vector that will be follwed after the orbit.
+      output.q[1] = segment.q_next(1);
+      output.q[2] = segment.q_next(2);
+      output.c[0] = segment.c(0); // Load message with the center of the orbit.
+      output.c[1] = segment.c(1);
+      output.c[2] = segment.c(2);
+      output.rho = R_min; // Command the orbit radius to be the minimum acheivable.
+      output.lamda = segment.lamda;
+
+      if (orbit_last && idx_a_ == num_waypoints_ - 2) {
+        idx_a_++;
+        fil_state_ = FilletState::STRAIGHT;
+        break;
+      }
+
+      if ((p - segment.z2).dot(segment.q_next) < 0) { // Check to see if passed through plane.
+        fil_state_ = FilletState::ORBIT;
+      }
+      break;
+    }
+    case FilletState::ORBIT: {
+      output.flag = false; // Indicate that aircraft is following an orbit.
+      output.q[0] =
+        segment.q_next(0); // Load the message with the vector that will be follwed after the orbit.
+      output.q[1] = segment.q_next(1);
+      output.q[2] = segment.q_next(2);
+      output.c[0] = segment.c(0); // Load message with the center of the orbit.
+      output.c[1] = segment.c(1);
+      output.c[2] = segment.c(2);
+      output.rho = R_min; // Command the orbit radius to be the minimum acheivable.
+      output.lamda = segment.lamda; // TODO change this to the orbit_direction.
+      if ((p - segment.z2).dot(segment.q_next) > 0) { // Check to see if passed through plane.
+        if (idx_a_ == num_waypoints_ - 1)
+          idx_a_ = 0;
+        else
+          idx_a_++;
+        fil_state_ = FilletState::STRAIGHT;
+      }
+      break;
+    }
+  }
+}
+
+void PathManagerExampleCore::manage_dubins(const Input & input, Output & output)
+{
+  Eigen::Vector3f p;
+  p << input.pn, input.pe, -input.h;
+
+  output.va_d = waypoints_[idx_a_].va_d;
+  output.r[0] = 0;
+  output.r[1] = 0;
+  output.r[2] = 0;
+  output.q[0] = 0;
+  output.q[1] = 0;
+  output.q[2] = 0;
+  output.c[0] = 0;
+  output.c[1] = 0;
+  output.c[2] = 0;
+
+  switch (dub_state_) {
+    case DubinState::FIRST:
+      load_dubins_path(0);
+      output.flag = false;
+      output.c[0] = dubins_path_.cs(0);
+      output.c[1] = dubins_path_.cs(1);
+      output.c[2] = dubins_path_.cs(2);
+      output.rho = dubins_path_.R;
+      output.lamda = dubins_path_.lams;
+      if ((p - dubins_path_.w1).dot(dubins_path_.q1) >= 0) // start in H1
+      {
+        dub_state_ = DubinState::BEFORE_H1_WRONG_SIDE;
+      } else {
+        dub_state_ = DubinState::BEFORE_H1;
+      }
+      break;
+    case DubinState::BEFORE_H1:
+      output.flag = false;
+      output.c[0] = dubins_path_.cs(0);
+      output.c[1] = dubins_path_.cs(1);
+      output.c[2] = dubins_path_.cs(2);
+      output.rho = dubins_path_.R;
+      output.lamda = dubins_path_.lams;
+      if ((p - dubins_path_.w1).dot(dubins_path_.q1) >= 0) // entering H1
+      {
+        dub_state_ = DubinState::STRAIGHT;
+      }
+      break;
+    case DubinState::BEFORE_H1_WRONG_SIDE:
+      output.flag = false;
+      output.c[0] = dubins_path_.cs(0);
+      output.c[1] = dubins_path_.cs(1);
+      output.c[2] = dubins_path_.cs(2);
+      output.rho = dubins_path_.R;
+      output.lamda = dubins_path_.lams;
+      if ((p - dubins_path_.w1).dot(dubins_path_.q1) < 0) // exit H1
+      {
+        dub_state_ = DubinState::BEFORE_H1;
+      }
+      break;
+    case DubinState::STRAIGHT:
+      output.flag = true;
+      output.r[0] = dubins_path_.w1(0);
+      output.r[1] = dubins_path_.w1(1);
+      output.r[2] = dubins_path_.w1(2);
+      // output.r[0] = dubinspath_.z1(0);
+      // output.r[1] = dubinspath_.z1(1);
+      // output.r[2] = dubinspath_.z1(2);
+      output.q[0] = dubins_path_.q1(0);
+      output.q[1] = dubins_path_.q1(1);
+      output.q[2] = dubins_path_.q1(2);
+      output.rho = 1;
+      output.lamda = 1;
+      if ((p - dubins_path_.w2).dot(dubins_path_.q1) >= 0) // entering H2
+      {
+        if ((p - dubins_path_.w3).dot(dubins_path_.q3) >= 0) // start in H3
+        {
+          dub_state_ = DubinState::BEFORE_H3_WRONG_SIDE;
+        } else {
+          dub_state_ = DubinState::BEFORE_H3;
+        }
+      }
+      break;
+    case DubinState::BEFORE_H3:
+      output.flag = false;
+      output.c[0] = dubins_path_.ce(0);
+      output.c[1] = dubins_path_.ce(1);
+      output.c[2] = dubins_path_.ce(2);
+      output.rho = dubins_path_.R;
+      output.lamda = dubins_path_.lame;
+      if ((p - dubins_path_.w3).dot(dubins_path_.q3) >= 0) // entering H3
+      {
+        // increase the waypoint pointer
+        if (idx_a_ == num_waypoints_ - 1) {
+          idx_a_ = 0;
+        } else if (idx_a_ == num_waypoints_ - 2) {
+          idx_a_++;
+        } else {
+          idx_a_++;
+
+          if (first_) {
+            first_ = false;
+            erase_first_waypoint();
+            idx_a_--;
+          }
+        }
+
+        // start the Dubin's path to the next waypoint configuration, planned with the waypoints
+        load_dubins_path(idx_a_);
+
+        //start new path
+        if ((p - dubins_path_.w1).dot(dubins_path_.q1) >= 0) // start in H1
+        {
+          dub_state_ = DubinState::BEFORE_H1_WRONG_SIDE;
+        } else {
+          dub_state_ = DubinState::BEFORE_H1;
+        }
+      }
+      break;
+    case DubinState::BEFORE_H3_WRONG_SIDE:
+      output.flag = false;
+      output.c[0] = dubins_path_.ce(0);
+      output.c[1] = dubins_path_.ce(1);
+      output.c[2] = dubins_path_.ce(2);
+      output.rho = dubins_path_.R;
+      output.lamda = dubins_path_.lame;
+      if ((p - dubins_path_.w3).dot(dubins_path_.q3) < 0) // exit H3
+      {
+        dub_state_ = DubinState::BEFORE_H1;
+      }
+      break;
+  }
+}
+
+Eigen::Matrix3f PathManagerExampleCore::rotz(float theta)
+{
+  Eigen::Matrix3f R;
+  R << cosf(theta), -sinf(theta), 0, sinf(theta), cosf(theta), 0, 0, 0, 1;
+
+  return R;
+}
+
+float PathManagerExampleCore::mo(float in)
+{
+  float val;
+  if (in > 0)
+    val = fmod(in, 2.0 * M_PI_F);
+  else {
+    float n = floorf(in / 2.0 / M_PI_F);
+    val = in - n * 2.0 * M_PI_F;
+  }
+  return val;
+}
+
+bool PathManagerExampleCore::dubins_parameters(const Waypoint start_node, const Waypoint end_node,
+                                               float R, DubinsPath & dubins_path)
+{
+  float ell = sqrtf((start_node.w[0] - end_node.w[0]) * (start_node.w[0] - end_node.w[0])
+                    + (start_node.w[1] - end_node.w[1]) * (start_node.w[1] - end_node.w[1]));
+  if (ell < 2.0 * R) {
+    return false;
+  } else {
+    dubins_path.ps(0) = start_node.w[0];
+    dubins_path.ps(1) = start_node.w[1];
+    dubins_path.ps(2) = start_node.w[2];
+    dubins_path.chis = start_node.chi_d;
+    dubins_path.pe(0) = end_node.w[0];
+    dubins_path.pe(1) = end_node.w[1];
+    dubins_path.pe(2) = end_node.w[2];
+    dubins_path.chie = end_node.chi_d;
+
+    Eigen::Vector3f crs = dubins_path.ps;
+    crs(0) +=
+      R * (cosf(M_PI_2_F) * cosf(dubins_path.chis) - sinf(M_PI_2_F) * sinf(dubins_path.chis));
+    crs(1) +=
+      R * (sinf(M_PI_2_F) * cosf(dubins_path.chis) + cosf(M_PI_2_F) * sinf(dubins_path.chis));
+    Eigen::Vector3f cls = dubins_path.ps;
+    cls(0) +=
+      R * (cosf(-M_PI_2_F) * cosf(dubins_path.chis) - sinf(-M_PI_2_F) * sinf(dubins_path.chis));
+    cls(1) +=
+      R * (sinf(-M_PI_2_F) * cosf(dubins_path.chis) + cosf(-M_PI_2_F) * sinf(dubins_path.chis));
+    Eigen::Vector3f cre = dubins_path.pe;
+    cre(0) +=
+      R * (cosf(M_PI_2_F) * cosf(dubins_path.chie) - sinf(M_PI_2_F) * sinf(dubins_path.chie));
+    cre(1) +=
+      R * (sinf(M_PI_2_F) * cosf(dubins_path.chie) + cosf(M_PI_2_F) * sinf(dubins_path.chie));
+    Eigen::Vector3f cle = dubins_path.pe;
+    cle(0) +=
+      R * (cosf(-M_PI_2_F) * cosf(dubins_path.chie) - sinf(-M_PI_2_F) * sinf(dubins_path.chie));
+    cle(1) +=
+      R * (sinf(-M_PI_2_F) * cosf(dubins_path.chie) + cosf(-M_PI_2_F) * sinf(dubins_path.chie));
+
+    float theta, theta2;
+    // compute L1
+    theta = atan2f(cre(1) - crs(1), cre(0) - crs(0));
+    float L1 = (crs - cre).norm()
+      + R * mo(2.0 * M_PI_F + mo(theta - M_PI_2_F) - mo(dubins_path.chis - M_PI_2_F))
+      + R * mo(2.0 * M_PI_F + mo(dubins_path.chie - M_PI_2_F) - mo(theta - M_PI_2_F));
+
+    // compute L2
+    ell = (cle - crs).norm();
+    theta = atan2f(cle(1) - crs(1), cle(0) - crs(0));
+    float L2;
+    if (2.0 * R > ell)
+      L2 = 9999.0f;
+    else {
+      theta2 = theta - M_PI_2_F + asinf(2.0 * R / ell);
+      L2 = sqrtf(ell * ell - 4.0 * R * R)
+        + R * mo(2.0 * M_PI_F + mo(theta2) - mo(dubins_path.chis - M_PI_2_F))
+        + R * mo(2.0 * M_PI_F + mo(theta2 + M_PI_F) - mo(dubins_path.chie + M_PI_2_F));
+    }
+
+    // compute L3
+    ell = (cre - cls).norm();
+    theta = atan2f(cre(1) - cls(1), cre(0) - cls(0));
+    float L3;
+    if (2.0 * R > ell)
+      L3 = 9999.0f;
+    else {
+      theta2 = acosf(2.0 * R / ell);
+      L3 = sqrtf(ell * ell - 4 * R * R)
+        + R * mo(2.0 * M_PI_F + mo(dubins_path.chis + M_PI_2_F) - mo(theta + theta2))
+        + R * mo(2.0 * M_PI_F + mo(dubins_path.chie - M_PI_2_F) - mo(theta + theta2 - M_PI_F));
+    }
+
+    // compute L4
+    theta = atan2f(cle(1) - cls(1), cle(0) - cls(0));
+    float L4 = (cls - cle).norm()
+      + R * mo(2.0 * M_PI_F + mo(dubins_path.chis + M_PI_2_F) - mo(theta + M_PI_2_F))
+      + R * mo(2.0 * M_PI_F + mo(theta + M_PI_2_F) - mo(dubins_path.chie + M_PI_2_F));
+
+    // L is the minimum distance
+    int idx = 1;
+    dubins_path.L = L1;
+    if (L2 < dubins_path.L) {
+      dubins_path.L = L2;
+      idx = 2;
+    }
+    if (L3 < dubins_path.L) {
+      dubins_path.L = L3;
+      idx = 3;
+    }
+    if (L4 < dubins_path.L) {
+      dubins_path.L = L4;
+      idx = 4;
+    }
+
+    Eigen::Vector3f e1;
+    //        e1.zero();
+    e1(0) = 1;
+    e1(1) = 0;
+    e1(2) = 0;
+    switch (idx) {
+      case 1:
+        dubins_path.cs = crs;
+        dubins_path.lams = 1;
+        dubins_path.ce = cre;
+        dubins_path.lame = 1;
+        dubins_path.q1 = (cre - crs).normalized();
+        dubins_path.w1 = dubins_path.cs + (rotz(-M_PI_2_F) * dubins_path.q1) * R;
+        dubins_path.w2 = dubins_path.ce + (rotz(-M_PI_2_F) * dubins_path.q1) * R;
+        break;
+      case 2:
+        dubins_path.cs = crs;
+        dubins_path.lams = 1;
+        dubins_path.ce = cle;
+        dubins_path.lame = -1;
+        ell = (cle - crs).norm();
+        theta = atan2f(cle(1) - crs(1), cle(0) - crs(0));
+        theta2 = theta - M_PI_2_F + asinf(2.0 * R / ell);
+        dubins_path.q1 = rotz(theta2 + M_PI_2_F) * e1;
+        dubins_path.w1 = dubins_path.cs + (rotz(theta2) * e1) * R;
+        dubins_path.w2 = dubins_path.ce + (rotz(theta2 + M_PI_F) * e1) * R;
+        break;
+      case 3:
+        dubins_path.cs = cls;
+        dubins_path.lams = -1;
+        dubins_path.ce = cre;
+        dubins_path.lame = 1;
+        ell = (cre - cls).norm();
+        theta = atan2f(cre(1) - cls(1), cre(0) - cls(0));
+        theta2 = acosf(2.0 * R / ell);
+        dubins_path.q1 = rotz(theta + theta2 - M_PI_2_F) * e1;
+        dubins_path.w1 = dubins_path.cs + (rotz(theta + theta2) * e1) * R;
+        dubins_path.w2 = dubins_path.ce + (rotz(theta + theta2 - M_PI_F) * e1) * R;
+        break;
+      case 4:
+        dubins_path.cs = cls;
+        dubins_path.lams = -1;
+        dubins_path.ce = cle;
+        dubins_path.lame = -1;
+        dubins_path.q1 = (cle - cls).normalized();
+        dubins_path.w1 = dubins_path.cs + (rotz(M_PI_2_F) * dubins_path.q1) * R;
+        dubins_path.w2 = dubins_path.ce + (rotz(M_PI_2_F) * dubins_path.q1) * R;
+        break;
+    }
+    dubins_path.w3 = dubins_path.pe;
+    dubins_path.q3 = rotz(dubins_path.chie) * e1;
+    dubins_path.R = R;
+  }
+  return true;
+}
+
+void PathManagerExampleCore::waypoints_changed(int first_changed)
+{
+  // A new waypoint changes the leg into it and the turn after the leg before that, as well as the
+  // leg that wraps back to the first waypoint.
+  update_segments(std::max(first_changed - 2, 0));
+}
+
+void PathManagerExampleCore::update_segments(int first)
+{
+  // For readability, declare the parameters that will be used in the function here
+  double R_min = R_min_;
+
+  segments_.resize(num_waypoints_);
+  segments_R_min_ = R_min;
+  if (num_waypoints_ < 2) {
+    return;
+  }
+
+  for (int idx_a = first; idx_a < num_waypoints_; idx_a++) {
+    int idx_b = idx_a == num_waypoints_ - 1 ? 0 : idx_a + 1;
+    int idx_c = idx_b == num_waypoints_ - 1 ? 0 : idx_b + 1;
+
+    Eigen::Vector3f w_im1(waypoints_[idx_a].w);
+    Eigen::Vector3f w_i(waypoints_[idx_b].w);
+    Eigen::Vector3f w_ip1(waypoints_[idx_c].w);
+    Segment & segment = segments_[idx_a];
+
+    // The vector pointing into the turn (vector pointing from previous waypoint to the next).
+    Eigen::Vector3f q_im1 = w_i - w_im1;
+    segment.length = q_im1.norm();
+    segment.q = q_im1.normalized();
+
+    // The vector pointing out of the turn (vector from next waypoint to the next next waypoint).
+    Eigen::Vector3f q_i = w_ip1 - w_i;
+    float next_length = q_i.norm();
+    segment.q_next = q_i.normalized();
+
+    // Check if the planes were aligned and then handle the normal vector correctly.
+    segment.n = (segment.q + segment.q_next).normalized();
+    if (segment.n.isZero()) {
+      segment.n = segment.q;
+    }
+
+    float varrho = acosf(-segment.q.dot(segment.q_next)); // Angle of the turn.
+
+    // Use varrho to find the distance to bisector from closest waypoint.
+    segment.max_r = std::min(next_length, segment.length) * sinf(varrho / 2.0);
+
+    // Points in the planes where the turn begins and ends, and the center of the orbit between.
+    segment.z1 = w_i - segment.q * (R_min / tanf(varrho / 2.0));
+    segment.z2 = w_i + segment.q_next * (R_min / tanf(varrho / 2.0));
+    segment.c = w_i - (segment.q - segment.q_next).normalized() * (R_min / sinf(varrho / 2.0));
+    segment.lamda =
+      (segment.q(0) * segment.q_next(1) - segment.q(1) * segment.q_next(0)) > 0 ? 1 : -1;
+
+    segment.dubins_valid =
+      dubins_parameters(waypoints_[idx_a], waypoints_[idx_b], R_min, segment.dubins);
+  }
+
+  float distance = 0.0f;
+  float time = 0.0f;
+  for (int idx = 0; idx < num_waypoints_; idx++) {
+    Segment & segment = segments_[idx];
+    segment.distance_from_start = distance;
+    segment.time_from_start = time;
+    distance += segment.length;
+    float va_d = waypoints_[idx].va_d;
+    time += va_d > 0.0f ? segment.length / va_d : 0.0f;
+  }
+}
+
+void PathManagerExampleCore::waypoints_erased(int count)
+{
+  // The waypoints up to the current leg are gone, so there is no first waypoint left to drop.
+  first_ = false;
+  erase_first_segments(count);
+}
+
+void PathManagerExampleCore::erase_first_waypoint()
+{
+  waypoints_.erase(waypoints_.begin());
+  num_waypoints_--;
+  erase_first_segments(1);
+}
+
+void PathManagerExampleCore::erase_first_segments(int count)
+{
+  segments_.erase(segments_.begin(), segments_.begin() + std::min(count, (int) segments_.size()));
+
+  // Only the last two segments lead to or turn through the first waypoint.
+  update_segments(std::max(num_waypoints_ - 2, 0));
+}
+
+void PathManagerExampleCore::update_mission_progress(const Input & input)
+{
+  mission_progress_valid_ = num_waypoints_ >= 2;
+  if (!mission_progress_valid_) {
+    return;
+  }
+
+  // When orbiting the last waypoint there is nothing left to fly.
+  bool orbit_last = orbit_last_;
+  if (orbit_last && idx_a_ == num_waypoints_ - 1) {
+    distance_to_go_ = 0.0f;
+    time_to_go_ = 0.0f;
+    return;
+  }
+
+  Eigen::Vector3f p;
+  p << input.pn, input.pe, -input.h;
+
+  // The rest of the current leg, then the legs from the next waypoint to the last one.
+  int idx_b = idx_a_ == num_waypoints_ - 1 ? 0 : idx_a_ + 1;
+  const Segment & last = segments_[num_waypoints_ - 1];
+  float leg_distance = (Eigen::Vector3f(waypoints_[idx_b].w) - p).norm();
+  float va_d = waypoints_[idx_a_].va_d;
+
+  distance_to_go_ = leg_distance + last.distance_from_start - segments_[idx_b].distance_from_start;
+  time_to_go_ = (va_d > 0.0f ? leg_distance / va_d : 0.0f) + last.time_from_start
+    - segments_[idx_b].time_from_start;
+}
+
+void PathManagerExampleCore::load_dubins_path(int idx)
+{
+  if (!segments_[idx].dubins_valid) {
+    RCLCPP_ERROR(this->get_logger(), "The distance between nodes must be larger than 2R.");
+    return;
+  }
+  dubins_path_ = segments_[idx].dubins;
+}
+
+void PathManagerExampleCore::declare_parameters()
+{
+  orbit_last_ = params_.declare_bool("orbit_last", false);
+}
+
+int PathManagerExampleCore::orbit_direction(float pn, float pe, float chi, float c_n, float c_e)
+{
+  if (orbit_dir_ != 0) {
+    return orbit_dir_;
+  }
+
+  Eigen::Vector3f pos;
+  pos << pn, pe, 0.0;
+
+  Eigen::Vector3f center;
+  center << c_n, c_e, 0.0;
+
+  Eigen::Vector3f d = pos - center;
+
+  Eigen::Vector3f course;
+  course << sinf(chi), cosf(chi), 0.0;
+
+  if (d.cross(course)(2) >= 0) {
+    orbit_dir_ = 1;
+    return 1;
+  }
+
+  orbit_dir_ = -1;
+  return -1;
+}
+
+void PathManagerExampleCore::increment_indices(int & idx_a, int & idx_b, int & idx_c,
+                                               const Input & input, Output & output)
+{
+
+  bool orbit_last = orbit_last_;
+  double R_min = R_min_;
+
+  if (temp_waypoint_ && idx_a_ == 1) {
+    erase_first_waypoint();
+    idx_a_ = 0;
+    idx_b = 1;
+    idx_c = 2;
+    temp_waypoint_ = false;
+    return;
+  }
+
+  if (idx_a == num_waypoints_ - 1) { // The logic for if it is the last waypoint.
+
+    // If it is the last waypoint, and we orbit the last waypoint, construct the command.
+    if (orbit_last) {
+      output.flag = false;
+      output.va_d = waypoints_[idx_a_].va_d;
+      output.c[0] = waypoints_[idx_a_].w[0];
+      output.c[1] = waypoints_[idx_a_].w[1];
+      output.c[2] = waypoints_[idx_a_].w[2];
+      output.r[0] = 0.0;
+      output.r[1] = 0.0;
+      output.r[2] = 0.0;
+      output.q[0] = 0.0;
+      output.q[1] = 0.0;
+      output.q[2] = 0.0;
+      output.rho = R_min;
+      output.lamda = orbit_direction(
+        input.pn, input.pe, input.chi, output.c[0],
+        output.c[1]); // Calculate the most conveinent orbit direction of that point.
+      idx_b = 0;      // reset the path and loop the waypoints again.
+      idx_c = 1;
+      return;
+    }
+
+    idx_b = 0; // reset the path and loop the waypoints again.
+    idx_c = 1;
+  } else if (
+    idx_a
+    == num_waypoints_
+      - 2) { // If the second to last waypoint, appropriately handle the wrapping of waypoints.
+    idx_b = num_waypoints_ - 1;
+    idx_c = 0;
+  } else { // Increment the indices of the waypoints.
+    idx_b = idx_a + 1;
+    idx_c = idx_b + 1;
+  }
+}
+
+} // namespace rosplane
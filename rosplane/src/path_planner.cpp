@@ -1,18 +1,24 @@
+#include <algorithm>
 #include <cmath>
+#include <string>
 
 #include <rclcpp/executors.hpp>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp/service.hpp>
 #include <rclcpp/utilities.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 #include <rosflight_msgs/srv/param_file.hpp>
 #include <std_srvs/srv/trigger.hpp>
 #include <yaml-cpp/yaml.h>
 
+#include "geodesy.hpp"
 #include "param_manager.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 #include "rosplane_msgs/msg/waypoint.hpp"
+#include "rosplane_msgs/msg/waypoint_array.hpp"
 #include "rosplane_msgs/srv/add_waypoint.hpp"
+#include "rosplane_msgs/srv/add_waypoints.hpp"
 
 #include "path_planner.hpp"
 
@@ -22,16 +28,16 @@ using std::placeholders::_2;
 namespace rosplane
 {
 
-PathPlanner::PathPlanner()
-    : Node("path_planner")
+PathPlanner::PathPlanner(const rclcpp::NodeOptions & options)
+    : Node("path_planner", options)
     , params_(this)
 {
 
-  // Make this publisher transient_local so that it publishes the last 10 waypoints to late subscribers
+  // Make this publisher transient_local so that it publishes the last 10 batches to late subscribers
   rclcpp::QoS qos_transient_local_10_(10);
   qos_transient_local_10_.transient_local();
-  waypoint_publisher_ =
-    this->create_publisher<rosplane_msgs::msg::Waypoint>("waypoint_path", qos_transient_local_10_);
+  waypoint_publisher_ = this->create_publisher<rosplane_msgs::msg::WaypointArray>(
+    "waypoint_path_array", qos_transient_local_10_);
 
   next_waypoint_service_ = this->create_service<std_srvs::srv::Trigger>(
     "publish_next_waypoint", std::bind(&PathPlanner::publish_next_waypoint, this, _1, _2));
@@ -39,6 +45,9 @@ PathPlanner::PathPlanner()
   add_waypoint_service_ = this->create_service<rosplane_msgs::srv::AddWaypoint>(
     "add_waypoint", std::bind(&PathPlanner::update_path, this, _1, _2));
 
+  add_waypoints_service_ = this->create_service<rosplane_msgs::srv::AddWaypoints>(
+    "add_waypoints", std::bind(&PathPlanner::add_waypoints, this, _1, _2));
+
   clear_waypoint_service_ = this->create_service<std_srvs::srv::Trigger>(
     "clear_waypoints", std::bind(&PathPlanner::clear_path_callback, this, _1, _2));
 
@@ -60,6 +69,9 @@ PathPlanner::PathPlanner()
   params_.set_parameters();
 
   num_waypoints_published_ = 0;
+  initial_lat_ = 0.0;
+  initial_lon_ = 0.0;
+  initial_alt_ = 0.0;
 
   // Initialize by publishing a clear path command.
   // This makes sure rviz or other vizualization tools don't show stale waypoints if ROSplane is restarted.
@@ -81,10 +93,7 @@ void PathPlanner::publish_initial_waypoints()
                             << num_waypoints_to_publish_at_start << "} available waypoints!");
 
   // Publish the first waypoints as defined by the num_waypoints_to_publish_at_start parameter
-  while (num_waypoints_published_ < num_waypoints_to_publish_at_start
-         && num_waypoints_published_ < (int) wps.size()) {
-    waypoint_publish();
-  }
+  waypoints_publish(num_waypoints_to_publish_at_start - num_waypoints_published_);
 }
 
 void PathPlanner::state_callback(const rosplane_msgs::msg::State & msg)
@@ -121,11 +130,25 @@ bool PathPlanner::publish_next_waypoint(const std_srvs::srv::Trigger::Request::S
 void PathPlanner::waypoint_publish()
 {
   // Publish the next waypoint off the list
-  rosplane_msgs::msg::Waypoint new_waypoint = wps[num_waypoints_published_];
+  waypoints_publish(1);
+}
+
+void PathPlanner::waypoints_publish(int count)
+{
+  count = std::min(count, (int) wps.size() - num_waypoints_published_);
+  if (count <= 0) {
+    return;
+  }
 
-  waypoint_publisher_->publish(new_waypoint);
+  // Publish the next waypoints off the list together
+  rosplane_msgs::msg::WaypointArray new_waypoints;
+  new_waypoints.header.stamp = this->get_clock()->now();
+  new_waypoints.waypoints.assign(wps.begin() + num_waypoints_published_,
+                                 wps.begin() + num_waypoints_published_ + count);
 
-  num_waypoints_published_++;
+  waypoint_publisher_->publish(new_waypoints);
+
+  num_waypoints_published_ += count;
 }
 
 bool PathPlanner::update_path(const rosplane_msgs::srv::AddWaypoint::Request::SharedPtr & req,
@@ -175,6 +198,45 @@ bool PathPlanner::update_path(const rosplane_msgs::srv::AddWaypoint::Request::Sh
   return true;
 }
 
+bool PathPlanner::add_waypoints(const rosplane_msgs::srv::AddWaypoints::Request::SharedPtr & req,
+                                const rosplane_msgs::srv::AddWaypoints::Response::SharedPtr & res)
+{
+  rclcpp::Time now = this->get_clock()->now();
+
+  std::vector<rosplane_msgs::msg::Waypoint> new_waypoints;
+  std::vector<std::size_t> lla_indices;
+  new_waypoints.reserve(req->waypoints.size());
+  for (const rosplane_msgs::msg::Waypoint & waypoint : req->waypoints) {
+    if (waypoint.lla) {
+      lla_indices.push_back(new_waypoints.size());
+    }
+
+    new_waypoints.push_back(waypoint);
+    new_waypoints.back().header.stamp = now;
+    new_waypoints.back().clear_wp_list = false;
+  }
+
+  // Convert the waypoints given in LLA to NED together
+  lla2ned(new_waypoints, lla_indices);
+
+  if (req->publish_now) {
+    // Insert the waypoints in the correct location in the list and publish them
+    wps.insert(wps.begin() + num_waypoints_published_, new_waypoints.begin(),
+               new_waypoints.end());
+    waypoints_publish(new_waypoints.size());
+    res->message = "Adding " + std::to_string(new_waypoints.size())
+      + " waypoints was successful! Waypoints published.";
+  } else {
+    wps.insert(wps.end(), new_waypoints.begin(), new_waypoints.end());
+    res->message = "Adding " + std::to_string(new_waypoints.size()) + " waypoints was successful!";
+  }
+
+  publish_initial_waypoints();
+
+  res->success = true;
+  return true;
+}
+
 bool PathPlanner::clear_path_callback(const std_srvs::srv::Trigger::Request::SharedPtr & req,
                                       const std_srvs::srv::Trigger::Response::SharedPtr & res)
 {
@@ -192,7 +254,11 @@ void PathPlanner::clear_path()
   rosplane_msgs::msg::Waypoint new_waypoint;
   new_waypoint.clear_wp_list = true;
 
-  waypoint_publisher_->publish(new_waypoint);
+  rosplane_msgs::msg::WaypointArray new_waypoints;
+  new_waypoints.header.stamp = this->get_clock()->now();
+  new_waypoints.waypoints.push_back(new_waypoint);
+
+  waypoint_publisher_->publish(new_waypoints);
 
   num_waypoints_published_ = 0;
 }
@@ -244,19 +310,17 @@ bool PathPlanner::load_mission_from_file(const std::string & filename)
     assert(root.IsSequence());
     RCLCPP_INFO_STREAM(this->get_logger(), root);
 
+    wps.reserve(wps.size() + root.size());
+    std::vector<std::size_t> lla_indices;
     for (YAML::const_iterator it = root.begin(); it != root.end(); ++it) {
       YAML::Node wp = it->second;
 
       rosplane_msgs::msg::Waypoint new_wp;
       new_wp.w = wp["w"].as<std::array<float, 3>>();
 
-      // If LLA, convert to NED
+      // If LLA, convert to NED with the rest of the LLA waypoints below
       if (wp["lla"].as<bool>()) {
-        std::array<double, 3> ned = lla2ned(new_wp.w);
-
-        new_wp.w[0] = ned[0];
-        new_wp.w[1] = ned[1];
-        new_wp.w[2] = ned[2];
+        lla_indices.push_back(wps.size());
       }
 
       new_wp.chi_d = wp["chi_d"].as<double>();
@@ -266,6 +330,8 @@ bool PathPlanner::load_mission_from_file(const std::string & filename)
       wps.push_back(new_wp);
     }
 
+    lla2ned(wps, lla_indices);
+
     return true;
   } catch (...) {
     RCLCPP_ERROR_STREAM(this->get_logger(), "Error while parsing mission YAML file! Check inputs");
@@ -275,28 +341,61 @@ bool PathPlanner::load_mission_from_file(const std::string & filename)
 
 std::array<double, 3> PathPlanner::lla2ned(std::array<float, 3> lla)
 {
-  double lat1 = lla[0];
-  double lon1 = lla[1];
-  double alt1 = lla[2];
+  std::array<double, 3> point = {lla[0], lla[1], lla[2]};
+  lla2ned(&point, 1);
+  return point;
+}
+
+void PathPlanner::lla2ned(std::vector<rosplane_msgs::msg::Waypoint> & waypoints,
+                          const std::vector<std::size_t> & indices)
+{
+  if (indices.empty()) {
+    return;
+  }
+
+  std::vector<std::array<double, 3>> points(indices.size());
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    const std::array<float, 3> & w = waypoints[indices[i]].w;
+    points[i] = {w[0], w[1], w[2]};
+  }
+
+  lla2ned(points.data(), points.size());
+
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    std::array<float, 3> & w = waypoints[indices[i]].w;
+    w[0] = points[i][0];
+    w[1] = points[i][1];
+    w[2] = points[i][2];
+  }
+}
 
-  double lat0 = initial_lat_;
-  double lon0 = initial_lon_;
-  double alt0 = initial_alt_;
+void PathPlanner::lla2ned(std::array<double, 3> * points, std::size_t count)
+{
+  // Only rebuild the frame when the origin or the conversion mode changes.
+  LocalFrame::Mode mode = this->get_parameter("exact_geodesy").as_bool()
+    ? LocalFrame::Mode::ECEF
+    : LocalFrame::Mode::TANGENT_PLANE;
+  if (!local_frame_.has_origin(initial_lat_, initial_lon_, initial_alt_, mode)) {
+    local_frame_ = LocalFrame(initial_lat_, initial_lon_, initial_alt_, mode);
+  }
 
-  double n = EARTH_RADIUS * (lat1 - lat0) * M_PI / 180.0;
-  double e = EARTH_RADIUS * cos(lat0 * M_PI / 180.0) * (lon1 - lon0) * M_PI / 180.0;
-  double d = -(alt1 - alt0);
+  local_frame_.lla_to_ned(points, points, count);
 
   // Usually will not be flying exactly at these locations.
   // If the GPS reports (0,0,0), it most likely means there is an error with the GPS
   if (fabs(initial_lat_) == 0.0 || fabs(initial_lon_) == 0.0 || fabs(initial_alt_) == 0.0) {
-    RCLCPP_WARN_STREAM(this->get_logger(),
-                       "NED position set to ["
-                         << n << "," << e << "," << d
-                         << "]! Waypoints may be incorrect. Check GPS health");
+    if (count == 1) {
+      RCLCPP_WARN_STREAM(this->get_logger(),
+                         "NED position set to ["
+                           << points[0][0] << "," << points[0][1] << "," << points[0][2]
+                           << "]! Waypoints may be incorrect. Check GPS health");
+    } else {
+      RCLCPP_WARN_STREAM(this->get_logger(),
+                         "NED positions of " << count
+                                             << " waypoints set from an origin at (0,0,0)! "
+                                                "Waypoints may be incorrect. Check GPS health");
+    }
   }
-
-  return std::array<double, 3>{n, e, d};
 }
 
 rcl_interfaces::msg::SetParametersResult
@@ -319,17 +418,10 @@ PathPlanner::parametersCallback(const std::vector<rclcpp::Parameter> & parameter
 void PathPlanner::declare_parameters()
 {
   params_.declare_int("num_waypoints_to_publish_at_start", 3);
+  // Convert LLA waypoints exactly through ECEF, instead of on the tangent plane at the origin
+  params_.declare_bool("exact_geodesy", false);
 }
 
 } // namespace rosplane
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-
-  auto node = std::make_shared<rosplane::PathPlanner>();
-
-  rclcpp::spin(node);
-
-  return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(rosplane::PathPlanner)
@@ -0,0 +1,14 @@
+#include <rclcpp/rclcpp.hpp>
+
+#include "path_planner.hpp"
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+
+  auto node = std::make_shared<rosplane::PathPlanner>();
+
+  rclcpp::spin(node);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "realtime_profile.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+/**
+ * Touches every page of a block of stack, so the pages are faulted in before the control loop
+ * needs them. It is not inlined, so the block is released when it returns.
+ */
+__attribute__((noinline)) void prefault_stack(std::size_t size, std::size_t page_size)
+{
+  volatile char * stack = static_cast<volatile char *>(alloca(size));
+  for (std::size_t i = 0; i < size; i += page_size) {
+    stack[i] = 0;
+  }
+}
+
+/**
+ * Touches every page of a block of heap and frees it. The allocator is first told to never give
+ * memory back to the system, so the pages stay mapped and later allocations reuse them without
+ * faulting.
+ */
+bool prefault_heap(std::size_t size, std::size_t page_size)
+{
+  if (mallopt(M_TRIM_THRESHOLD, -1) == 0 || mallopt(M_MMAP_MAX, 0) == 0) {
+    return false;
+  }
+
+  char * heap = static_cast<char *>(std::malloc(size));
+  if (heap == nullptr) {
+    return false;
+  }
+  for (std::size_t i = 0; i < size; i += page_size) {
+    heap[i] = 0;
+  }
+  std::free(heap);
+  return true;
+}
+
+} // namespace
+
+void declare_realtime_parameters(ParamManager & params)
+{
+  params.declare_int("rt_priority", 0);
+  params.declare_string("rt_cpu_affinity", "");
+  params.declare_bool("rt_lock_memory", false);
+  params.declare_int("rt_prefault_stack_size", 0);
+  params.declare_int("rt_prefault_heap_size", 0);
+}
+
+RealtimeProfile realtime_profile_from_parameters(rclcpp::Node & node)
+{
+  RealtimeProfile profile;
+  profile.priority = node.get_parameter("rt_priority").as_int();
+  profile.lock_memory = node.get_parameter("rt_lock_memory").as_bool();
+  profile.prefault_stack_size = node.get_parameter("rt_prefault_stack_size").as_int();
+  profile.prefault_heap_size = node.get_parameter("rt_prefault_heap_size").as_int();
+
+  std::stringstream cpus(node.get_parameter("rt_cpu_affinity").as_string());
+  std::string cpu;
+  while (std::getline(cpus, cpu, ',')) {
+    if (cpu.find_first_not_of(" ") == std::string::npos) {
+      continue;
+    }
+    try {
+      profile.cpus.push_back(std::stoi(cpu));
+    } catch (const std::exception &) {
+      RCLCPP_WARN_STREAM(node.get_logger(), "Skipping invalid CPU in rt_cpu_affinity: " << cpu);
+    }
+  }
+
+  return profile;
+}
+
+bool apply_realtime_profile(const RealtimeProfile & profile, const rclcpp::Logger & logger)
+{
+  bool success = true;
+  std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+  // Lock the memory first, so the pages faulted in below stay resident.
+  if (profile.lock_memory) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+      RCLCPP_INFO(logger, "Locked process memory.");
+    } else {
+      RCLCPP_WARN_STREAM(logger, "Failed to lock process memory: " << std::strerror(errno));
+      success = false;
+    }
+  }
+
+  if (profile.prefault_heap_size > 0) {
+    if (prefault_heap(profile.prefault_heap_size, page_size)) {
+      RCLCPP_INFO_STREAM(logger, "Pre-faulted " << profile.prefault_heap_size << " bytes of heap.");
+    } else {
+      RCLCPP_WARN(logger, "Failed to pre-fault the heap.");
+      success = false;
+    }
+  }
+
+  if (profile.prefault_stack_size > 0) {
+    // Leave half of the stack limit for the node itself, faulting in more would overflow it.
+    rlimit stack_limit;
+    if (getrlimit(RLIMIT_STACK, &stack_limit) == 0 && stack_limit.rlim_cur != RLIM_INFINITY
+        && static_cast<rlim_t>(profile.prefault_stack_size) > stack_limit.rlim_cur / 2) {
+      RCLCPP_WARN_STREAM(logger, "rt_prefault_stack_size is over half of the stack limit ("
+                                   << stack_limit.rlim_cur << " bytes), skipping the stack.");
+      success = false;
+    } else {
+      prefault_stack(profile.prefault_stack_size, page_size);
+      RCLCPP_INFO_STREAM(logger,
+                         "Pre-faulted " << profile.prefault_stack_size << " bytes of stack.");
+    }
+  }
+
+  if (!profile.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : profile.cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (result == 0) {
+      RCLCPP_INFO(logger, "Pinned the executor thread to the CPUs in rt_cpu_affinity.");
+    } else {
+      RCLCPP_WARN_STREAM(logger, "Failed to set the CPU affinity: " << std::strerror(result));
+      success = false;
+    }
+  }
+
+  if (profile.priority > 0) {
+    sched_param param;
+    param.sched_priority = static_cast<int>(profile.priority);
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result == 0) {
+      RCLCPP_INFO_STREAM(logger, "Running the executor thread with SCHED_FIFO priority "
+                                   << profile.priority << ".");
+    } else {
+      RCLCPP_WARN_STREAM(logger, "Failed to set SCHED_FIFO priority " << profile.priority << ": "
+                                                                       << std::strerror(result));
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+} // namespace rosplane
@@ -0,0 +1,288 @@
+/**
+ * @file test_estimator_allocations.cpp
+ *
+ * Checks that the continuous discrete estimator does not touch the heap once it is running, with
+ * and without GPS fixes to fuse. Every allocation made by the thread running the test is counted
+ * by replacing the global operator new, including the aligned forms Eigen's fixed size types can
+ * use, and the C allocation functions, including the aligned ones.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <gtest/gtest.h>
+
+#include "rosplane/estimator_continuous_discrete_core.hpp"
+
+// The allocation functions of glibc, which the replacements below forward to.
+extern "C" void * __libc_malloc(std::size_t size);
+extern "C" void * __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void * __libc_realloc(void * ptr, std::size_t size);
+extern "C" void * __libc_memalign(std::size_t alignment, std::size_t size);
+extern "C" void __libc_free(void * ptr);
+
+namespace
+{
+
+thread_local bool counting = false;      /**< Count the allocations of this thread */
+std::atomic<std::size_t> allocations{0}; /**< Allocations counted */
+
+void count_allocation()
+{
+  if (counting) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+} // namespace
+
+extern "C" void * malloc(std::size_t size)
+{
+  count_allocation();
+  return __libc_malloc(size);
+}
+
+extern "C" void * calloc(std::size_t count, std::size_t size)
+{
+  count_allocation();
+  return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, std::size_t size)
+{
+  count_allocation();
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void * memalign(std::size_t alignment, std::size_t size)
+{
+  count_allocation();
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" void * aligned_alloc(std::size_t alignment, std::size_t size)
+{
+  count_allocation();
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void ** ptr, std::size_t alignment, std::size_t size)
+{
+  count_allocation();
+  // The alignment must be a power of two multiple of the size of a pointer.
+  if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void * result = __libc_memalign(alignment, size);
+  if (!result) {
+    return ENOMEM;
+  }
+  *ptr = result;
+  return 0;
+}
+
+extern "C" void free(void * ptr) { __libc_free(ptr); }
+
+void * operator new(std::size_t size)
+{
+  count_allocation();
+  void * ptr = __libc_malloc(size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void * operator new[](std::size_t size) { return operator new(size); }
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+  count_allocation();
+  return __libc_malloc(size == 0 ? 1 : size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t & tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+  count_allocation();
+  void * ptr = __libc_memalign(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return operator new(size, alignment);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+  count_allocation();
+  return __libc_memalign(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment,
+                      const std::nothrow_t & tag) noexcept
+{
+  return operator new(size, alignment, tag);
+}
+
+void operator delete(void * ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void * ptr) noexcept { __libc_free(ptr); }
+void operator delete(void * ptr, std::size_t) noexcept { __libc_free(ptr); }
+void operator delete[](void * ptr, std::size_t) noexcept { __libc_free(ptr); }
+void operator delete(void * ptr, std::align_val_t) noexcept { __libc_free(ptr); }
+void operator delete[](void * ptr, std::align_val_t) noexcept { __libc_free(ptr); }
+void operator delete(void * ptr, std::size_t, std::align_val_t) noexcept { __libc_free(ptr); }
+void operator delete[](void * ptr, std::size_t, std::align_val_t) noexcept { __libc_free(ptr); }
+void operator delete(void * ptr, const std::nothrow_t &) noexcept { __libc_free(ptr); }
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept { __libc_free(ptr); }
+void operator delete(void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+  __libc_free(ptr);
+}
+void operator delete[](void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+  __libc_free(ptr);
+}
+
+namespace
+{
+
+using namespace rosplane;
+
+constexpr float kTs = 0.01f;        /**< Time step of the estimator (s) */
+constexpr float kAirspeed = 15.0f;  /**< Airspeed of the aircraft (m/s) */
+constexpr float kAltitude = 100.0f; /**< Altitude of the aircraft (m) */
+constexpr int kWarmUpSteps = 500;   /**< Estimates run before the allocations are counted */
+constexpr int kCountedSteps = 2000; /**< Estimates the allocations are counted over */
+
+/**
+ * Estimator in level flight at constant speed, as in the benchmarks of the cores.
+ */
+class EstimatorAllocationTest : public ::testing::Test
+{
+protected:
+  EstimatorAllocationTest()
+      : estimator_(CoreContext{params_})
+      , input_{}
+  {
+    estimator_.set_origin(40.0, -111.0, 1400.0);
+    estimator_.set_baro_calibration(86000.0f);
+
+    input_.accel_z = -9.8f;
+    input_.static_pres = 1.225f * 9.8f * kAltitude;
+    input_.diff_pres = 0.5f * 1.225f * kAirspeed * kAirspeed;
+    input_.gps_h = kAltitude;
+    input_.gps_Vg = kAirspeed;
+    input_.status_armed = true;
+    input_.armed_init = true;
+    input_.Ts = kTs;
+  }
+
+  /**
+   * @brief Runs the estimator for a number of steps.
+   *
+   * @param steps: Number of estimates to run
+   * @param gps_new: Give a new GPS fix to fuse with every estimate
+   * @return Number of allocations made during the estimates.
+   */
+  std::size_t run(int steps, bool gps_new)
+  {
+    allocations = 0;
+    counting = true;
+    for (int i = 0; i < steps; ++i) {
+      input_.stamp += kTs;
+      input_.gps_new = gps_new;
+      if (gps_new) {
+        input_.gps_epoch++;
+        input_.gps_n += kAirspeed * kTs;
+        input_.gps_stamp = input_.stamp;
+      }
+      estimator_.estimate(input_, output_);
+    }
+    counting = false;
+    return allocations;
+  }
+
+  ParamManager params_;
+  EstimatorContinuousDiscreteCore estimator_;
+  EstimatorCore::Input input_;
+  EstimatorCore::Output output_;
+};
+
+void * volatile sink; /**< Keeps the allocations of the counter test from being optimized out */
+
+/**
+ * Over-aligned type, so that new goes through the aligned operator new.
+ */
+struct alignas(64) OverAligned
+{
+  float values[16];
+};
+
+TEST(AllocationCounter, CountsAllocations)
+{
+  allocations = 0;
+  counting = true;
+  sink = new int(1);
+  delete static_cast<int *>(sink);
+  sink = std::malloc(16);
+  std::free(sink);
+  counting = false;
+  EXPECT_EQ(allocations, 2u);
+}
+
+TEST(AllocationCounter, CountsAlignedAllocations)
+{
+  allocations = 0;
+  counting = true;
+  sink = new OverAligned();
+  delete static_cast<OverAligned *>(sink);
+  sink = new (std::nothrow) OverAligned();
+  delete static_cast<OverAligned *>(sink);
+  sink = std::aligned_alloc(64, 64);
+  std::free(sink);
+  void * ptr = nullptr;
+  EXPECT_EQ(posix_memalign(&ptr, 64, 64), 0);
+  sink = ptr;
+  std::free(sink);
+  counting = false;
+  EXPECT_EQ(allocations, 4u);
+}
+
+TEST_F(EstimatorAllocationTest, PropagationDoesNotAllocate)
+{
+  run(kWarmUpSteps, false);
+  EXPECT_EQ(run(kCountedSteps, false), 0u);
+}
+
+TEST_F(EstimatorAllocationTest, GpsFusionDoesNotAllocate)
+{
+  run(kWarmUpSteps, true);
+  EXPECT_EQ(run(kCountedSteps, true), 0u);
+}
+
+TEST_F(EstimatorAllocationTest, AlternatingGpsDoesNotAllocate)
+{
+  run(kWarmUpSteps, true);
+  run(kWarmUpSteps, false);
+
+  std::size_t counted = 0;
+  for (int i = 0; i < kCountedSteps / 100; ++i) {
+    counted += run(50, false);
+    counted += run(50, true);
+  }
+  EXPECT_EQ(counted, 0u);
+}
+
+} // namespace
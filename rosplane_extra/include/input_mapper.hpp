@@ -20,7 +20,9 @@ public:
    * @brief Class for input mixing.
    *
    * The input_mapper class is responsible for mixing various input commands, such as controller
-   * commands and RC raw signals.
+   * commands and RC raw signals. The roll and pitch overrides of the angle modes are set in the
+   * mapped controller commands, so the autopilot switches to the RC angles on its next control
+   * tick.
    *
    * This node has the following ROS parameters:
    * Mapping Options:
@@ -56,19 +58,6 @@ public:
   InputMapper();
 
 private:
-  /**
-   * This bool keeps track of whether roll override is enabled.
-   */
-  bool roll_override_;
-  /**
-   * This bool keeps track of whether pitch override is enabled.
-   */
-  bool pitch_override_;
-  /**
-   * Bool value to keep track of whether a parameter change is pending.
-   */
-  bool param_change_pending_;
-
   /**
   * Keeps track of previous time of the last controller command sent for rate control.
   */
@@ -115,30 +104,6 @@ private:
    */
   rosplane_msgs::msg::State::SharedPtr state_msg_;
 
-  /**
-   * Service object for setting parameters of the controller.
-   */
-  rclcpp::Client<rcl_interfaces::srv::SetParameters>::SharedPtr set_param_client_;
-
-  /**
-   * Timer for setting parameters of other nodes without ever blocking execution of this node.
-   *
-   * This timer exists so that waiting for the set param service and response will not block the
-   * execution of the node, which needs to keep running to keep passing inputs around.
-   */
-  rclcpp::TimerBase::SharedPtr set_param_timer_;
-
-  /**
-   * Parameter request object, for setting parameters of other nodes.
-   */
-  rcl_interfaces::srv::SetParameters::Request::SharedPtr set_param_request_;
-
-  /**
-   * FutureAndRequestId result for param set request. Used to obtain the result of the request
-   * and print errors if the service failed.
-   */
-  rclcpp::Client<rcl_interfaces::srv::SetParameters>::SharedFuture set_param_future_;
-
   /**
    * Service for setting input methods to path follower mode.
    */
@@ -156,20 +121,6 @@ private:
    */
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr rc_passthrough_mode_service_;
 
-  /**
-   * Helper function for knowing when to call a ROS service to change roll override.
-   */
-  void set_roll_override(bool roll_override);
-  /**
-   * Helper function for knowing when to call a ROS service to change pitch override.
-   */
-  void set_pitch_override(bool pitch_override);
-
-  /**
-   * Callback for set_param_timer_.
-   */
-  void set_param_timer_callback();
-
   /**
    * This function is called when a new message of type `rosplane_msgs::msg::ControllerCommands` is
    * received.
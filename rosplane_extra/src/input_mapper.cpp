@@ -8,9 +8,6 @@ namespace rosplane
 
 InputMapper::InputMapper()
     : Node("input_mapper")
-    , roll_override_(false)
-    , pitch_override_(false)
-    , param_change_pending_(false)
     , params_(this)
 {
   mapped_controller_commands_pub_ =
@@ -27,12 +24,6 @@ InputMapper::InputMapper()
   state_sub_ = this->create_subscription<rosplane_msgs::msg::State>(
     "estimated_state", 10, std::bind(&InputMapper::state_callback, this, _1));
 
-  set_param_client_ = this->create_client<rcl_interfaces::srv::SetParameters>(
-    "/autopilot/set_parameters", rmw_qos_profile_services_default);
-  set_param_timer_ = this->create_wall_timer(
-    std::chrono::milliseconds(100), std::bind(&InputMapper::set_param_timer_callback, this));
-  set_param_timer_->cancel();
-
   path_follower_mode_service_ = this->create_service<std_srvs::srv::Trigger>(
     "/input_mapper/set_path_follower_mode",
     std::bind(&InputMapper::path_follower_mode_callback, this, _1, _2));
@@ -68,83 +59,6 @@ InputMapper::InputMapper()
     this->add_on_set_parameters_callback(std::bind(&InputMapper::parametersCallback, this, _1));
 }
 
-void InputMapper::set_param_timer_callback()
-{
-  // Check that the service is ready
-  if (!set_param_client_->service_is_ready()) {
-    RCLCPP_INFO(this->get_logger(), "/autopilot/set_parameters service not available, waiting...");
-    return;
-  }
-
-  // Send the request
-  if (set_param_request_ != nullptr) {
-    set_param_future_ = set_param_client_->async_send_request(set_param_request_).share();
-    set_param_request_ = nullptr;
-    return;
-  }
-
-  // Wait for the response
-  if (set_param_future_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
-    return;
-  }
-
-  // Check that the parameter was set successfully
-  for (auto & result : set_param_future_.get()->results) {
-    if (!result.successful) {
-      RCLCPP_ERROR(this->get_logger(), "Failed to set parameter: %s", result.reason.c_str());
-    }
-  }
-
-  set_param_timer_->cancel();
-  param_change_pending_ = false;
-}
-
-void InputMapper::set_roll_override(bool roll_override)
-{
-  // Value hasn't changed, return
-  if (roll_override == roll_override_) {
-    return;
-  }
-  // Previous parameter request is still pending, return
-  if (param_change_pending_) {
-    return;
-  }
-  roll_override_ = roll_override;
-
-  // Contruct the parameter request object
-  auto parameter = rcl_interfaces::msg::Parameter();
-  parameter.name = "roll_command_override";
-  parameter.value.type = rcl_interfaces::msg::ParameterType::PARAMETER_BOOL;
-  parameter.value.bool_value = roll_override;
-  set_param_request_ = std::make_shared<rcl_interfaces::srv::SetParameters::Request>();
-  set_param_request_->parameters.push_back(parameter);
-  set_param_timer_->reset();
-  param_change_pending_ = true;
-}
-
-void InputMapper::set_pitch_override(bool pitch_override)
-{
-  // Value hasn't changed, return
-  if (pitch_override == pitch_override_) {
-    return;
-  }
-  // Previous parameter request is still pending, return
-  if (param_change_pending_) {
-    return;
-  }
-  pitch_override_ = pitch_override;
-
-  // Contruct the parameter request object
-  auto parameter = rcl_interfaces::msg::Parameter();
-  parameter.name = "pitch_command_override";
-  parameter.value.type = rcl_interfaces::msg::ParameterType::PARAMETER_BOOL;
-  parameter.value.bool_value = pitch_override;
-  set_param_request_ = std::make_shared<rcl_interfaces::srv::SetParameters::Request>();
-  set_param_request_->parameters.push_back(parameter);
-  set_param_timer_->reset();
-  param_change_pending_ = true;
-}
-
 void InputMapper::controller_commands_callback(
   const rosplane_msgs::msg::ControllerCommands::SharedPtr msg)
 {
@@ -162,20 +76,21 @@ void InputMapper::controller_commands_callback(
 
   mapped_controller_commands_msg_->header.stamp = this->now();
   mapped_controller_commands_msg_->phi_ff = msg->phi_ff;
+  mapped_controller_commands_msg_->origin_stamp = msg->origin_stamp;
 
   // Aileron channel
   if (aileron_input == "path_follower") {
-    set_roll_override(false);
+    mapped_controller_commands_msg_->roll_command_override = false;
     mapped_controller_commands_msg_->chi_c = msg->chi_c;
   } else if (aileron_input == "rc_course") {
-    set_roll_override(false);
+    mapped_controller_commands_msg_->roll_command_override = false;
     mapped_controller_commands_msg_->chi_c +=
       norm_aileron * params_.get_double("rc_course_rate") * elapsed_time;
     mapped_controller_commands_msg_->chi_c = mapped_controller_commands_msg_->chi_c
       - floor((mapped_controller_commands_msg_->chi_c - state_msg_->chi) / (2 * M_PI) + 0.5) * 2
         * M_PI;
   } else if (aileron_input == "rc_roll_angle") {
-    set_roll_override(true);
+    mapped_controller_commands_msg_->roll_command_override = true;
     mapped_controller_commands_msg_->phi_c =
       norm_aileron * params_.get_double("rc_roll_angle_min_max");
     mapped_controller_commands_msg_->chi_c = state_msg_->chi;
@@ -192,14 +107,14 @@ void InputMapper::controller_commands_callback(
 
   // Elevator channel
   if (elevator_input == "path_follower") {
-    set_pitch_override(false);
+    mapped_controller_commands_msg_->pitch_command_override = false;
     mapped_controller_commands_msg_->h_c = msg->h_c;
   } else if (elevator_input == "rc_altitude") {
-    set_pitch_override(false);
+    mapped_controller_commands_msg_->pitch_command_override = false;
     mapped_controller_commands_msg_->h_c +=
       norm_elevator * params_.get_double("rc_altitude_rate") * elapsed_time;
   } else if (elevator_input == "rc_pitch_angle") {
-    set_pitch_override(true);
+    mapped_controller_commands_msg_->pitch_command_override = true;
     mapped_controller_commands_msg_->theta_c =
       norm_elevator * params_.get_double("rc_pitch_angle_min_max");
     mapped_controller_commands_msg_->h_c = -state_msg_->position[2];
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <chrono>
+
 #include <ament_index_cpp/get_package_share_directory.hpp>
 #include <geometry_msgs/msg/transform_stamped.hpp>
 #include <rclcpp/logging.hpp>
@@ -6,13 +9,13 @@
 #include <tf2_ros/transform_broadcaster.h>
 #include <visualization_msgs/msg/marker.hpp>
 
+#include "rosplane/ring_buffer.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 #include "rosplane_msgs/msg/waypoint.hpp"
+#include "rosplane_msgs/msg/waypoint_array.hpp"
 
 #define SCALE 5.0
 #define TEXT_SCALE 15.0
-#define PATH_PUBLISH_MOD 10
-#define MAX_PATH_HISTORY 10000
 using std::placeholders::_1;
 
 namespace rosplane_gcs
@@ -29,27 +32,38 @@ private:
   rclcpp::Publisher<visualization_msgs::msg::Marker>::SharedPtr rviz_mesh_pub_;
   rclcpp::Publisher<visualization_msgs::msg::Marker>::SharedPtr rviz_aircraft_path_pub_;
   rclcpp::Subscription<rosplane_msgs::msg::Waypoint>::SharedPtr waypoint_sub_;
+  rclcpp::Subscription<rosplane_msgs::msg::WaypointArray>::SharedPtr waypoint_array_sub_;
   rclcpp::Subscription<rosplane_msgs::msg::State>::SharedPtr vehicle_state_sub_;
+  rclcpp::TimerBase::SharedPtr visualization_timer_;
 
   std::unique_ptr<tf2_ros::TransformBroadcaster> aircraft_tf2_broadcaster_;
 
   void new_wp_callback(const rosplane_msgs::msg::Waypoint & wp);
+  void new_wp_array_callback(const rosplane_msgs::msg::WaypointArray & wps);
+  void add_wp(const rosplane_msgs::msg::Waypoint & wp);
+  void clear_wps();
   void state_update_callback(const rosplane_msgs::msg::State & state);
+  void visualization_callback();
   void update_list();
   void update_mesh();
   void update_aircraft_history();
 
   rosplane_msgs::msg::State vehicle_state_;
+  bool state_received_;
 
   // Persistent rviz markers
   visualization_msgs::msg::Marker line_list_;
   std::vector<geometry_msgs::msg::Point> line_points_;
   visualization_msgs::msg::Marker aircraft_;
   visualization_msgs::msg::Marker aircraft_history_;
-  std::vector<geometry_msgs::msg::Point> aircraft_history_points_;
+
+  // Trail of the aircraft, keeping the newest points once it is full. A point is only added once
+  // the aircraft has moved trail_min_distance from the last one.
+  rosplane::RingBuffer<geometry_msgs::msg::Point> aircraft_history_points_;
+  bool aircraft_history_changed_;
+  double trail_min_distance_;
 
   int num_wps_;
-  int i_;
 };
 
 RvizWaypointPublisher::RvizWaypointPublisher()
@@ -66,11 +80,26 @@ RvizWaypointPublisher::RvizWaypointPublisher()
   waypoint_sub_ = this->create_subscription<rosplane_msgs::msg::Waypoint>(
     "waypoint_path", qos_transient_local_20_,
     std::bind(&RvizWaypointPublisher::new_wp_callback, this, _1));
+  waypoint_array_sub_ = this->create_subscription<rosplane_msgs::msg::WaypointArray>(
+    "waypoint_path_array", qos_transient_local_20_,
+    std::bind(&RvizWaypointPublisher::new_wp_array_callback, this, _1));
   vehicle_state_sub_ = this->create_subscription<rosplane_msgs::msg::State>(
     "estimated_state", 10, std::bind(&RvizWaypointPublisher::state_update_callback, this, _1));
 
   aircraft_tf2_broadcaster_ = std::make_unique<tf2_ros::TransformBroadcaster>(*this);
 
+  // The mesh, TF and trail are published at this rate, however fast the state comes in.
+  double visualization_frequency = this->declare_parameter("visualization_frequency", 20.0);
+  trail_min_distance_ = this->declare_parameter("trail_min_distance", 1.0);
+  int64_t trail_length = this->declare_parameter("trail_length", 10000);
+  aircraft_history_points_.reset(std::max<int64_t>(trail_length, 1));
+  aircraft_history_changed_ = false;
+  state_received_ = false;
+
+  visualization_timer_ = this->create_wall_timer(
+    std::chrono::microseconds(static_cast<long long>(1.0 / visualization_frequency * 1'000'000)),
+    std::bind(&RvizWaypointPublisher::visualization_callback, this));
+
   // Initialize aircraft
   aircraft_.header.frame_id = "stl_frame";
   aircraft_.ns = "vehicle";
@@ -95,39 +124,71 @@ RvizWaypointPublisher::RvizWaypointPublisher()
   aircraft_.color.a = 1.0;
 
   num_wps_ = 0;
-  i_ = 0;
 }
 
 RvizWaypointPublisher::~RvizWaypointPublisher() {}
 
 void RvizWaypointPublisher::new_wp_callback(const rosplane_msgs::msg::Waypoint & wp)
 {
-  visualization_msgs::msg::Marker new_marker;
-
   RCLCPP_INFO_STREAM(this->get_logger(), wp.lla);
 
   if (wp.clear_wp_list) {
-    rclcpp::Time now = this->get_clock()->now();
-    // Publish one for each ns
-    new_marker.header.stamp = now;
-    new_marker.header.frame_id = "NED";
-    new_marker.ns = "wp";
-    new_marker.id = 0;
-    new_marker.action = visualization_msgs::msg::Marker::DELETEALL;
-    rviz_wp_pub_->publish(new_marker);
-    new_marker.ns = "text";
-    rviz_wp_pub_->publish(new_marker);
-    new_marker.ns = "wp_path";
-    rviz_wp_pub_->publish(new_marker);
-
-    // Clear line list
-    line_points_.clear();
-
-    num_wps_ = 0;
+    clear_wps();
     return;
   }
 
+  add_wp(wp);
+  update_list();
+  rviz_wp_pub_->publish(line_list_);
+}
+
+void RvizWaypointPublisher::new_wp_array_callback(const rosplane_msgs::msg::WaypointArray & wps)
+{
+  // Add the markers of the whole batch, then publish the line through them once.
+  line_points_.reserve(line_points_.size() + wps.waypoints.size());
+  bool added = false;
+  for (const rosplane_msgs::msg::Waypoint & wp : wps.waypoints) {
+    if (wp.clear_wp_list) {
+      clear_wps();
+      added = false;
+      continue;
+    }
+    add_wp(wp);
+    added = true;
+  }
+
+  if (added) {
+    update_list();
+    rviz_wp_pub_->publish(line_list_);
+  }
+}
+
+void RvizWaypointPublisher::clear_wps()
+{
+  visualization_msgs::msg::Marker new_marker;
+  rclcpp::Time now = this->get_clock()->now();
+  // Publish one for each ns
+  new_marker.header.stamp = now;
+  new_marker.header.frame_id = "NED";
+  new_marker.ns = "wp";
+  new_marker.id = 0;
+  new_marker.action = visualization_msgs::msg::Marker::DELETEALL;
+  rviz_wp_pub_->publish(new_marker);
+  new_marker.ns = "text";
+  rviz_wp_pub_->publish(new_marker);
+  new_marker.ns = "wp_path";
+  rviz_wp_pub_->publish(new_marker);
+
+  // Clear line list
+  line_points_.clear();
+
+  num_wps_ = 0;
+}
+
+void RvizWaypointPublisher::add_wp(const rosplane_msgs::msg::Waypoint & wp)
+{
   // Create marker
+  visualization_msgs::msg::Marker new_marker;
   rclcpp::Time now = this->get_clock()->now();
   new_marker.header.stamp = now;
   new_marker.header.frame_id = "NED";
@@ -152,7 +213,6 @@ void RvizWaypointPublisher::new_wp_callback(const rosplane_msgs::msg::Waypoint &
   new_p.y = wp.w[1];
   new_p.z = wp.w[2];
   line_points_.push_back(new_p);
-  update_list();
 
   // Add Text label to marker
   visualization_msgs::msg::Marker new_text;
@@ -173,7 +233,6 @@ void RvizWaypointPublisher::new_wp_callback(const rosplane_msgs::msg::Waypoint &
   new_text.text = std::to_string(num_wps_);
 
   rviz_wp_pub_->publish(new_marker);
-  rviz_wp_pub_->publish(line_list_);
   rviz_wp_pub_->publish(new_text);
 
   ++num_wps_;
@@ -212,11 +271,12 @@ void RvizWaypointPublisher::update_aircraft_history()
   aircraft_history_.color.g = 0.0f;
   aircraft_history_.color.b = 0.0f;
   aircraft_history_.color.a = 1.0;
-  aircraft_history_.points = aircraft_history_points_;
 
-  // Restrict length of history
-  if (aircraft_history_points_.size() > MAX_PATH_HISTORY) {
-    aircraft_history_points_.erase(aircraft_history_points_.begin());
+  // Copy the trail in order from the oldest point. The marker keeps its storage between
+  // publishes, so this does not allocate once the trail is full.
+  aircraft_history_.points.resize(aircraft_history_points_.size());
+  for (std::size_t i = 0; i < aircraft_history_points_.size(); ++i) {
+    aircraft_history_.points[i] = aircraft_history_points_[i];
   }
 }
 
@@ -240,18 +300,6 @@ void RvizWaypointPublisher::update_mesh()
   t.transform.rotation.z = q.z(); //0.0; //vehicle_state_.quat[2];
   t.transform.rotation.w = q.w(); //1.0; //vehicle_state_.quat[3];
 
-  // Update aircraft history
-  if (i_ % PATH_PUBLISH_MOD == 0) {
-    geometry_msgs::msg::Point new_p;
-    new_p.x = vehicle_state_.position[0];
-    new_p.y = vehicle_state_.position[1];
-    new_p.z = vehicle_state_.position[2];
-    aircraft_history_points_.push_back(new_p);
-    update_aircraft_history();
-
-    rviz_aircraft_path_pub_->publish(aircraft_history_);
-  }
-
   aircraft_tf2_broadcaster_->sendTransform(t);
   rviz_mesh_pub_->publish(aircraft_);
 }
@@ -259,7 +307,40 @@ void RvizWaypointPublisher::update_mesh()
 void RvizWaypointPublisher::state_update_callback(const rosplane_msgs::msg::State & msg)
 {
   vehicle_state_ = msg;
+  state_received_ = true;
+
+  // Extend the trail once the aircraft has moved far enough from its last point.
+  geometry_msgs::msg::Point new_p;
+  new_p.x = vehicle_state_.position[0];
+  new_p.y = vehicle_state_.position[1];
+  new_p.z = vehicle_state_.position[2];
+  if (!aircraft_history_points_.empty()) {
+    const geometry_msgs::msg::Point & last_p = aircraft_history_points_.back();
+    double dx = new_p.x - last_p.x;
+    double dy = new_p.y - last_p.y;
+    double dz = new_p.z - last_p.z;
+    if (dx * dx + dy * dy + dz * dz < trail_min_distance_ * trail_min_distance_) {
+      return;
+    }
+  }
+  aircraft_history_points_.push(new_p);
+  aircraft_history_changed_ = true;
+}
+
+void RvizWaypointPublisher::visualization_callback()
+{
+  if (!state_received_) {
+    return;
+  }
+
   update_mesh();
+
+  // Only republish the trail when it has a new point.
+  if (aircraft_history_changed_) {
+    update_aircraft_history();
+    rviz_aircraft_path_pub_->publish(aircraft_history_);
+    aircraft_history_changed_ = false;
+  }
 }
 
 } // namespace rosplane_gcs
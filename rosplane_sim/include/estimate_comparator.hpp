@@ -0,0 +1,160 @@
+/**
+ * @file estimate_comparator.hpp
+ *
+ * Online comparison of the estimated state with the true state of the simulation, to hold changes
+ * to the estimator to an accuracy budget.
+ */
+
+#ifndef ESTIMATE_COMPARATOR_H
+#define ESTIMATE_COMPARATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "rosplane/ring_buffer.hpp"
+
+namespace rosplane
+{
+
+/**
+ * RMS, largest magnitude and mean (bias) of an error over a sliding window of time. The window is
+ * split into blocks that each keep the sums of their samples, so the memory used is fixed by the
+ * number of blocks. The statistics cover the last window of time, plus the block being filled.
+ */
+class RollingErrorStatistics
+{
+public:
+  /**
+   * @param window: Length of the window (s)
+   * @param blocks: Number of blocks the window is split into
+   */
+  explicit RollingErrorStatistics(double window = 30.0, std::size_t blocks = 10);
+
+  /**
+   * @brief Adds an error at the given time. Times are expected to increase, and an error older
+   * than the newest block starts the statistics over.
+   */
+  void add(double time, double error);
+
+  void reset();
+
+  std::size_t count() const;
+  double rms() const;
+  double max() const;
+  double bias() const;
+
+private:
+  struct Block
+  {
+    double start_time = 0.0;
+    std::size_t count = 0;
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    double max = 0.0; /**< Largest magnitude */
+  };
+
+  double block_length_; /**< (s) */
+  RingBuffer<Block> blocks_;
+};
+
+/**
+ * Matches each estimate to the true state at the same time, linearly interpolated between the two
+ * nearest truth samples, and keeps the rolling statistics of the error of each compared state.
+ * Estimates newer than the newest truth sample wait for the truth to catch up. The buffers are
+ * allocated once, so nothing is allocated as the samples arrive.
+ */
+class EstimateComparator
+{
+public:
+  /**
+   * Indices of the compared states.
+   */
+  enum StateIndex
+  {
+    PN,
+    PE,
+    H,
+    PHI,
+    THETA,
+    CHI,
+    VG,
+    WN,
+    WE,
+    NUM_STATES
+  };
+
+  using Values = std::array<double, NUM_STATES>;
+
+  /**
+   * Names of the compared states, in the order of StateIndex.
+   */
+  static const std::array<const char *, NUM_STATES> state_names;
+
+  /**
+   * @return Whether the state is an angle, which is interpolated and compared across the wrap.
+   */
+  static bool is_angle(int index) { return index == PHI || index == THETA || index == CHI; }
+
+  /**
+   * @param truth_capacity: Number of truth samples kept for the interpolation
+   * @param max_interval: Longest time between two truth samples that are interpolated (s)
+   * @param window: Length of the window of the statistics (s)
+   * @param blocks: Number of blocks the window of the statistics is split into
+   */
+  EstimateComparator(std::size_t truth_capacity = 64, double max_interval = 0.1,
+                     double window = 30.0, std::size_t blocks = 10);
+
+  /**
+   * @brief Adds a sample of the true state, and compares the waiting estimates it brackets.
+   */
+  void add_truth(double time, const Values & truth);
+
+  /**
+   * @brief Adds an estimate, which is compared as soon as there is truth on both sides of it.
+   */
+  void add_estimate(double time, const Values & estimate);
+
+  /**
+   * @brief Clears the samples and the statistics.
+   */
+  void reset();
+
+  const RollingErrorStatistics & statistics(int index) const { return statistics_[index]; }
+
+  /**
+   * @return Number of estimates compared with the truth.
+   */
+  uint64_t matched() const { return matched_; }
+
+  /**
+   * @return Number of estimates that could not be compared. These are older than the truth kept,
+   * fall in a gap in the truth, or were pushed out while waiting for the truth.
+   */
+  uint64_t dropped() const { return dropped_; }
+
+private:
+  struct Sample
+  {
+    double time = 0.0;
+    Values values{};
+  };
+
+  /**
+   * @brief Interpolates the truth at the time of the estimate and adds the error to the statistics.
+   *
+   * @return False if the truth does not reach the time of the estimate yet.
+   */
+  bool compare(const Sample & estimate);
+
+  double max_interval_;
+  RingBuffer<Sample> truth_;
+  RingBuffer<Sample> pending_; /**< Estimates waiting for newer truth */
+  std::array<RollingErrorStatistics, NUM_STATES> statistics_;
+  uint64_t matched_;
+  uint64_t dropped_;
+};
+
+} // namespace rosplane
+
+#endif // ESTIMATE_COMPARATOR_H
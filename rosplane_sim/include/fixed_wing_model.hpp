@@ -0,0 +1,175 @@
+/**
+ * @file fixed_wing_model.hpp
+ *
+ * Nonlinear six degree of freedom model of a fixed-wing aircraft, from chapters 3 and 4 of
+ * UAVbook, see http://uavbook.byu.edu/doku.php. Used by the headless simulation to fly the
+ * autopilot algorithms without Gazebo.
+ */
+
+#ifndef FIXED_WING_MODEL_H
+#define FIXED_WING_MODEL_H
+
+#include <Eigen/Core>
+
+namespace rosplane
+{
+
+/**
+ * Physical and aerodynamic parameters of the aircraft. The defaults are a small aircraft of about
+ * 2.3 kg, which the default gains of the autopilot are tuned for. The air density and gravity
+ * should match the rho and gravity parameters of the estimator.
+ */
+struct FixedWingParams
+{
+  double mass = 2.28; /**< (kg) */
+  double Jx = 0.1147; /**< (kg m^2) */
+  double Jy = 0.0576;
+  double Jz = 0.1712;
+  double Jxz = 0.0015;
+  double rho = 1.225;   /**< Air density (kg/m^3) */
+  double gravity = 9.8; /**< (m/s^2) */
+
+  double S_wing = 0.4962; /**< Wing area (m^2) */
+  double b = 1.4;         /**< Wing span (m) */
+  double c = 0.3304;      /**< Mean chord (m) */
+  double e = 0.9;         /**< Oswald efficiency */
+  double M = 50.0;        /**< Transition rate of the stall model */
+  double alpha0 = 0.3040; /**< Stall angle of attack (rad) */
+
+  double S_prop = 0.0314; /**< Propeller area (m^2) */
+  double C_prop = 1.0;
+  double k_motor = 40.0; /**< Speed of the air leaving the propeller at full throttle (m/s) */
+
+  double C_L_0 = 0.2869;
+  double C_L_alpha = 5.1378;
+  double C_L_q = 1.7102;
+  double C_L_delta_e = 0.5202;
+  double C_D_p = 0.03; /**< Parasitic drag */
+  double C_D_q = 0.0;
+  double C_D_delta_e = 0.01879;
+  double C_m_0 = 0.0362;
+  double C_m_alpha = -0.2627;
+  double C_m_q = -9.7213;
+  double C_m_delta_e = -1.2392;
+  double C_Y_0 = 0.0;
+  double C_Y_beta = -0.2471;
+  double C_Y_p = -0.07278;
+  double C_Y_r = 0.1849;
+  double C_Y_delta_a = -0.02344;
+  double C_Y_delta_r = 0.1591;
+  double C_ell_0 = 0.0;
+  double C_ell_beta = 0.0193;
+  double C_ell_p = -0.5406;
+  double C_ell_r = 0.1929;
+  double C_ell_delta_a = 0.2818;
+  double C_ell_delta_r = 0.00096;
+  double C_n_0 = 0.0;
+  double C_n_beta = 0.08557;
+  double C_n_p = -0.0498;
+  double C_n_r = -0.0572;
+  double C_n_delta_a = 0.0095;
+  double C_n_delta_r = -0.06;
+};
+
+/**
+ * Deflections of the control surfaces (rad) and the throttle setting (0 to 1). The signs follow
+ * UAVbook, where a positive elevator pitches the nose down.
+ */
+struct ControlSurfaces
+{
+  double delta_e = 0.0;
+  double delta_a = 0.0;
+  double delta_r = 0.0;
+  double delta_t = 0.0;
+};
+
+/**
+ * The aircraft, integrated with a fourth order Runge-Kutta step. The state is the NED position,
+ * the body frame velocity, the Euler angles and the body frame angular rates.
+ */
+class FixedWingModel
+{
+public:
+  using State = Eigen::Matrix<double, 12, 1>;
+
+  /**
+   * Indices of the states in the state vector.
+   */
+  enum StateIndex
+  {
+    PN,
+    PE,
+    PD,
+    U,
+    V,
+    W,
+    PHI,
+    THETA,
+    PSI,
+    P,
+    Q,
+    R
+  };
+
+  explicit FixedWingModel(const FixedWingParams & params = FixedWingParams());
+
+  /**
+   * @brief Places the aircraft in straight and level flight.
+   *
+   * @param altitude: Altitude above the origin (m)
+   * @param airspeed: Speed along the body x axis (m/s)
+   * @param heading: (rad)
+   */
+  void reset(double altitude, double airspeed, double heading);
+
+  /**
+   * @brief Integrates the aircraft forward in time, holding the controls and wind constant.
+   *
+   * @param controls: The controls over the step. The throttle is limited to 0 to 1.
+   * @param wind: Wind in the NED frame (m/s)
+   * @param dt: Length of the step (s)
+   */
+  void step(const ControlSurfaces & controls, const Eigen::Vector3d & wind, double dt);
+
+  const State & state() const { return x_; }
+  const FixedWingParams & params() const { return params_; }
+
+  /**
+   * @return Airspeed at the end of the last step (m/s).
+   */
+  double airspeed() const { return airspeed_; }
+
+  /**
+   * @return Specific force in the body frame at the end of the last step, as measured by an
+   * accelerometer (m/s^2).
+   */
+  const Eigen::Vector3d & specific_force() const { return specific_force_; }
+
+  /**
+   * @return Velocity over the ground in the NED frame (m/s).
+   */
+  Eigen::Vector3d ground_velocity() const;
+
+private:
+  /**
+   * @brief Time derivative of the state. Also returns the airspeed and the specific force, from
+   * the aerodynamic and propulsion forces.
+   */
+  State derivatives(const State & x, const ControlSurfaces & controls,
+                    const Eigen::Vector3d & wind, double & airspeed,
+                    Eigen::Vector3d & specific_force) const;
+
+  FixedWingParams params_;
+  State x_;
+  double airspeed_;
+  Eigen::Vector3d specific_force_;
+
+  /**
+   * Combinations of the inertia used by the rotational dynamics, from section 3.3 of UAVbook.
+   */
+  double gamma_[9];
+};
+
+} // namespace rosplane
+
+#endif // FIXED_WING_MODEL_H
@@ -0,0 +1,153 @@
+/**
+ * @file headless_sim.hpp
+ *
+ * Closed loop simulation of the autopilot algorithms without ROS2 or Gazebo. The estimator, path
+ * manager, path follower and controller cores fly the built-in fixed-wing model through synthetic
+ * sensors, stepped on simulated time as fast as the CPU allows. Every run is deterministic in its
+ * configuration, so runs can be repeated and spread over threads.
+ */
+
+#ifndef HEADLESS_SIM_H
+#define HEADLESS_SIM_H
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "fixed_wing_model.hpp"
+#include "param_manager.hpp"
+#include "rosplane/controller_core.hpp"
+#include "rosplane/estimator_core.hpp"
+#include "rosplane/path_follower_core.hpp"
+#include "rosplane/path_manager_core.hpp"
+
+namespace rosplane
+{
+
+enum class ControllerType
+{
+  SUCCESSIVE_LOOP, /**< ControllerSucessiveLoop */
+  TOTAL_ENERGY     /**< ControllerTotalEnergy */
+};
+
+/**
+ * Standard deviations of the synthetic sensors, before the noise scale of the run is applied.
+ */
+struct SensorNoise
+{
+  double gyro = 0.13 * M_PI / 180.0; /**< (rad/s) */
+  double accel = 0.0025 * 9.81;      /**< (m/s^2) */
+  double static_pres = 10.0;         /**< (Pa) */
+  double diff_pres = 2.0;            /**< (Pa) */
+  double gps_n = 0.5;                /**< (m) */
+  double gps_e = 0.5;                /**< (m) */
+  double gps_h = 1.0;                /**< (m) */
+  double gps_Vg = 0.05;              /**< (m/s) */
+};
+
+/**
+ * Everything that defines one run. Two runs with the same configuration give the same results.
+ */
+struct SimConfig
+{
+  uint64_t seed = 0;         /**< Seed of the sensor noise and gusts */
+  double duration = 120.0;   /**< Simulated time of the run, after the release (s) */
+  double dt = 0.01;          /**< Period of the autopilot loop (s) */
+  int model_substeps = 2;    /**< Integration steps of the model in each period */
+  double gps_rate = 10.0;    /**< Rate of the GPS fixes (Hz) */
+  double metrics_start = 10; /**< Time the errors start being counted, after the start up (s) */
+  double settle_time = 2.0;  /**< Time the estimator runs before the aircraft is released (s) */
+
+  ControllerType controller = ControllerType::SUCCESSIVE_LOOP;
+  ParamOverrides params; /**< Values of the autopilot parameters, in place of the defaults */
+
+  double gust_sigma = 0.0;         /**< Standard deviation of the gusts on each axis (m/s) */
+  double gust_time_constant = 2.0; /**< Correlation time of the gusts (s) */
+  double noise_scale = 1.0;        /**< Multiplies every standard deviation in sensor_noise */
+  SensorNoise sensor_noise;
+
+  /**
+   * Steady wind in the NED frame, and the constant bias of the gyros (m/s, rad/s).
+   */
+  Eigen::Vector3d wind = Eigen::Vector3d::Zero();
+  Eigen::Vector3d gyro_bias = Eigen::Vector3d::Zero();
+
+  double initial_altitude = 50.0; /**< (m) */
+  double initial_airspeed = 15.0; /**< (m/s) */
+  double initial_heading = 0.0;   /**< (rad) */
+  std::vector<PathManagerCore::Waypoint> waypoints;
+  FixedWingParams aircraft;
+};
+
+/**
+ * Results of one run. The errors are of the true state of the aircraft, from metrics_start to the
+ * end of the run.
+ */
+struct RunSummary
+{
+  uint64_t seed = 0;
+  bool crashed = false;                     /**< The aircraft hit the ground or diverged */
+  double flight_time = 0.0;                 /**< Simulated time flown (s) */
+  int waypoints_reached = 0;                /**< Number of times the manager moved to a new leg */
+  double rms_altitude_error = 0.0;          /**< From the commanded altitude (m) */
+  double max_altitude_error = 0.0;          /**< (m) */
+  double rms_airspeed_error = 0.0;          /**< From the commanded airspeed (m/s) */
+  double rms_position_estimate_error = 0.0; /**< Horizontal (m) */
+  double max_position_estimate_error = 0.0; /**< Horizontal (m) */
+  double rms_altitude_estimate_error = 0.0; /**< (m) */
+  double rms_roll_estimate_error = 0.0;     /**< (deg) */
+  double rms_pitch_estimate_error = 0.0;    /**< (deg) */
+  double max_roll = 0.0;                    /**< Largest true roll angle (deg) */
+};
+
+class HeadlessSim
+{
+public:
+  /**
+   * @brief Builds the autopilot with the parameters of the configuration, and adds the mission.
+   */
+  explicit HeadlessSim(const SimConfig & config);
+
+  /**
+   * @brief Flies the configured duration, or until the aircraft crashes. The aircraft is held in
+   * its initial state while the estimator settles, since its filters start from zero and the
+   * aircraft starts in the air instead of on the ground.
+   */
+  RunSummary run();
+
+private:
+  /**
+   * @brief Fills the estimator input with the measurements of the sensors at time t.
+   */
+  void measure(double t, EstimatorCore::Input & input);
+
+  /**
+   * @return A sample of the noise of a sensor with the given standard deviation.
+   */
+  double noise(double sigma) { return sigma * config_.noise_scale * normal_(rng_); }
+
+  SimConfig config_;
+  std::mt19937_64 rng_;
+  std::normal_distribution<double> normal_;
+
+  FixedWingModel model_;
+  Eigen::Vector3d gust_; /**< Current gust in the NED frame (m/s) */
+  double next_gps_time_; /**< Time of the next GPS fix (s) */
+  uint32_t gps_epoch_;
+
+  /**
+   * Parameters of the autopilot, declared before the cores so they are destroyed after them.
+   */
+  ParamManager params_;
+  std::unique_ptr<EstimatorCore> estimator_;
+  std::unique_ptr<PathManagerCore> manager_;
+  std::unique_ptr<PathFollowerCore> follower_;
+  std::unique_ptr<ControllerCore> controller_;
+};
+
+} // namespace rosplane
+
+#endif // HEADLESS_SIM_H
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cmath>
+
+#include "estimate_comparator.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+/**
+ * @return The angle wrapped to -pi to pi.
+ */
+double wrap(double angle) { return std::atan2(std::sin(angle), std::cos(angle)); }
+
+} // namespace
+
+RollingErrorStatistics::RollingErrorStatistics(double window, std::size_t blocks)
+    : block_length_(window / std::max<std::size_t>(blocks, 1))
+    , blocks_(std::max<std::size_t>(blocks, 1) + 1)
+{}
+
+void RollingErrorStatistics::add(double time, double error)
+{
+  if (!blocks_.empty() && time < blocks_.back().start_time) {
+    blocks_.clear();
+  }
+  if (blocks_.empty() || time - blocks_.back().start_time >= block_length_) {
+    blocks_.push() = Block{time, 0, 0.0, 0.0, 0.0};
+  }
+
+  Block & block = blocks_.back();
+  block.count++;
+  block.sum += error;
+  block.sum_squares += error * error;
+  block.max = std::max(block.max, std::abs(error));
+}
+
+void RollingErrorStatistics::reset() { blocks_.clear(); }
+
+std::size_t RollingErrorStatistics::count() const
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    count += blocks_[i].count;
+  }
+  return count;
+}
+
+double RollingErrorStatistics::rms() const
+{
+  std::size_t count = 0;
+  double sum_squares = 0.0;
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    count += blocks_[i].count;
+    sum_squares += blocks_[i].sum_squares;
+  }
+  return count > 0 ? std::sqrt(sum_squares / count) : 0.0;
+}
+
+double RollingErrorStatistics::max() const
+{
+  double max = 0.0;
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    max = std::max(max, blocks_[i].max);
+  }
+  return max;
+}
+
+double RollingErrorStatistics::bias() const
+{
+  std::size_t count = 0;
+  double sum = 0.0;
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    count += blocks_[i].count;
+    sum += blocks_[i].sum;
+  }
+  return count > 0 ? sum / count : 0.0;
+}
+
+const std::array<const char *, EstimateComparator::NUM_STATES> EstimateComparator::state_names = {
+  "pn", "pe", "h", "phi", "theta", "chi", "Vg", "wn", "we"};
+
+EstimateComparator::EstimateComparator(std::size_t truth_capacity, double max_interval,
+                                       double window, std::size_t blocks)
+    : max_interval_(max_interval)
+    , truth_(std::max<std::size_t>(truth_capacity, 2))
+    , pending_(std::max<std::size_t>(truth_capacity, 2))
+    , matched_(0)
+    , dropped_(0)
+{
+  statistics_.fill(RollingErrorStatistics(window, blocks));
+}
+
+void EstimateComparator::add_truth(double time, const Values & truth)
+{
+  // Time going backward means the simulation was reset, so the old samples no longer apply.
+  if (!truth_.empty() && time <= truth_.back().time) {
+    if (time < truth_.back().time) {
+      reset();
+    } else {
+      return;
+    }
+  }
+
+  Sample & sample = truth_.push();
+  sample.time = time;
+  sample.values = truth;
+
+  while (!pending_.empty() && compare(pending_.front())) {
+    pending_.pop_front();
+  }
+}
+
+void EstimateComparator::add_estimate(double time, const Values & estimate)
+{
+  Sample sample;
+  sample.time = time;
+  sample.values = estimate;
+
+  // Estimates are compared in order, so a new one waits behind any that are already waiting.
+  if (!pending_.empty() || !compare(sample)) {
+    if (pending_.full()) {
+      dropped_++;
+    }
+    pending_.push(sample);
+  }
+}
+
+void EstimateComparator::reset()
+{
+  truth_.clear();
+  pending_.clear();
+  for (RollingErrorStatistics & statistics : statistics_) {
+    statistics.reset();
+  }
+}
+
+bool EstimateComparator::compare(const Sample & estimate)
+{
+  if (truth_.empty() || estimate.time > truth_.back().time) {
+    return false;
+  }
+  if (estimate.time < truth_.front().time) {
+    dropped_++;
+    return true;
+  }
+
+  // Find the first truth sample at or after the estimate, which has a sample before it unless it
+  // is at the same time.
+  std::size_t low = 0;
+  std::size_t high = truth_.size() - 1;
+  while (low < high) {
+    std::size_t mid = (low + high) / 2;
+    if (truth_[mid].time < estimate.time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  const Sample & after = truth_[low];
+  const Sample & before = low > 0 ? truth_[low - 1] : after;
+  if (after.time - before.time > max_interval_) {
+    dropped_++;
+    return true;
+  }
+
+  double fraction =
+    after.time > before.time ? (estimate.time - before.time) / (after.time - before.time) : 0.0;
+  for (int i = 0; i < NUM_STATES; ++i) {
+    double truth;
+    double error;
+    if (is_angle(i)) {
+      truth = before.values[i] + fraction * wrap(after.values[i] - before.values[i]);
+      error = wrap(estimate.values[i] - truth);
+    } else {
+      truth = before.values[i] + fraction * (after.values[i] - before.values[i]);
+      error = estimate.values[i] - truth;
+    }
+    statistics_[i].add(estimate.time, error);
+  }
+  matched_++;
+  return true;
+}
+
+} // namespace rosplane
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cmath>
+
+#include "fixed_wing_model.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+/**
+ * Rotation from the body frame to the NED frame.
+ */
+Eigen::Matrix3d body_to_ned(double phi, double theta, double psi)
+{
+  double cphi = cos(phi), sphi = sin(phi);
+  double cth = cos(theta), sth = sin(theta);
+  double cpsi = cos(psi), spsi = sin(psi);
+
+  Eigen::Matrix3d R;
+  R << cth * cpsi, sphi * sth * cpsi - cphi * spsi, cphi * sth * cpsi + sphi * spsi,
+    cth * spsi, sphi * sth * spsi + cphi * cpsi, cphi * sth * spsi - sphi * cpsi, -sth,
+    sphi * cth, cphi * cth;
+  return R;
+}
+
+} // namespace
+
+FixedWingModel::FixedWingModel(const FixedWingParams & params)
+    : params_(params)
+{
+  double Jx = params_.Jx;
+  double Jy = params_.Jy;
+  double Jz = params_.Jz;
+  double Jxz = params_.Jxz;
+
+  gamma_[0] = Jx * Jz - Jxz * Jxz;
+  gamma_[1] = Jxz * (Jx - Jy + Jz) / gamma_[0];
+  gamma_[2] = (Jz * (Jz - Jy) + Jxz * Jxz) / gamma_[0];
+  gamma_[3] = Jz / gamma_[0];
+  gamma_[4] = Jxz / gamma_[0];
+  gamma_[5] = (Jz - Jx) / Jy;
+  gamma_[6] = Jxz / Jy;
+  gamma_[7] = ((Jx - Jy) * Jx + Jxz * Jxz) / gamma_[0];
+  gamma_[8] = Jx / gamma_[0];
+
+  reset(0.0, 0.0, 0.0);
+}
+
+void FixedWingModel::reset(double altitude, double airspeed, double heading)
+{
+  x_.setZero();
+  x_(PD) = -altitude;
+  x_(U) = airspeed;
+  x_(PSI) = heading;
+
+  airspeed_ = airspeed;
+  specific_force_ = Eigen::Vector3d(0.0, 0.0, -params_.gravity);
+}
+
+void FixedWingModel::step(const ControlSurfaces & controls, const Eigen::Vector3d & wind,
+                          double dt)
+{
+  ControlSurfaces limited = controls;
+  limited.delta_t = std::clamp(controls.delta_t, 0.0, 1.0);
+
+  double airspeed;
+  Eigen::Vector3d specific_force;
+  State k1 = derivatives(x_, limited, wind, airspeed, specific_force);
+  State k2 = derivatives(x_ + dt / 2.0 * k1, limited, wind, airspeed, specific_force);
+  State k3 = derivatives(x_ + dt / 2.0 * k2, limited, wind, airspeed, specific_force);
+  State k4 = derivatives(x_ + dt * k3, limited, wind, airspeed, specific_force);
+  x_ += dt / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+
+  // Keep the heading within -pi to pi, like the estimator
+  x_(PSI) = atan2(sin(x_(PSI)), cos(x_(PSI)));
+
+  // Evaluate the measured quantities at the new state
+  derivatives(x_, limited, wind, airspeed_, specific_force_);
+}
+
+Eigen::Vector3d FixedWingModel::ground_velocity() const
+{
+  return body_to_ned(x_(PHI), x_(THETA), x_(PSI)) * x_.segment<3>(U);
+}
+
+FixedWingModel::State FixedWingModel::derivatives(const State & x,
+                                                  const ControlSurfaces & controls,
+                                                  const Eigen::Vector3d & wind, double & airspeed,
+                                                  Eigen::Vector3d & specific_force) const
+{
+  const FixedWingParams & a = params_;
+
+  double phi = x(PHI);
+  double theta = x(THETA);
+  double p = x(P);
+  double q = x(Q);
+  double r = x(R);
+  Eigen::Vector3d velocity = x.segment<3>(U);
+  Eigen::Matrix3d R_body_to_ned = body_to_ned(phi, theta, x(PSI));
+
+  // Air relative velocity, angle of attack and sideslip
+  Eigen::Vector3d air_velocity = velocity - R_body_to_ned.transpose() * wind;
+  double Va = std::max(air_velocity.norm(), 0.1);
+  double alpha = atan2(air_velocity(2), air_velocity(0));
+  double beta = asin(std::clamp(air_velocity(1) / Va, -1.0, 1.0));
+  airspeed = air_velocity.norm();
+
+  // Lift blended into a flat plate past the stall, and drag with the induced drag of the wing
+  double e_minus = exp(-a.M * (alpha - a.alpha0));
+  double e_plus = exp(a.M * (alpha + a.alpha0));
+  double sigma = (1.0 + e_minus + e_plus) / ((1.0 + e_minus) * (1.0 + e_plus));
+  double sign_alpha = alpha >= 0.0 ? 1.0 : -1.0;
+  double C_L = (1.0 - sigma) * (a.C_L_0 + a.C_L_alpha * alpha)
+    + sigma * (2.0 * sign_alpha * sin(alpha) * sin(alpha) * cos(alpha));
+  double AR = a.b * a.b / a.S_wing;
+  double C_D = a.C_D_p + pow(a.C_L_0 + a.C_L_alpha * alpha, 2) / (M_PI * a.e * AR);
+
+  double ca = cos(alpha);
+  double sa = sin(alpha);
+  double C_X = -C_D * ca + C_L * sa;
+  double C_X_q = -a.C_D_q * ca + a.C_L_q * sa;
+  double C_X_delta_e = -a.C_D_delta_e * ca + a.C_L_delta_e * sa;
+  double C_Z = -C_D * sa - C_L * ca;
+  double C_Z_q = -a.C_D_q * sa - a.C_L_q * ca;
+  double C_Z_delta_e = -a.C_D_delta_e * sa - a.C_L_delta_e * ca;
+
+  double qbar_S = 0.5 * a.rho * Va * Va * a.S_wing;
+  double c_2Va = a.c / (2.0 * Va);
+  double b_2Va = a.b / (2.0 * Va);
+
+  // Aerodynamic and propulsion forces in the body frame, which are what an accelerometer measures
+  Eigen::Vector3d force;
+  force(0) = qbar_S * (C_X + C_X_q * c_2Va * q + C_X_delta_e * controls.delta_e)
+    + 0.5 * a.rho * a.S_prop * a.C_prop * (pow(a.k_motor * controls.delta_t, 2) - Va * Va);
+  force(1) = qbar_S
+    * (a.C_Y_0 + a.C_Y_beta * beta + a.C_Y_p * b_2Va * p + a.C_Y_r * b_2Va * r
+       + a.C_Y_delta_a * controls.delta_a + a.C_Y_delta_r * controls.delta_r);
+  force(2) = qbar_S * (C_Z + C_Z_q * c_2Va * q + C_Z_delta_e * controls.delta_e);
+  specific_force = force / a.mass;
+
+  double ell = qbar_S * a.b
+    * (a.C_ell_0 + a.C_ell_beta * beta + a.C_ell_p * b_2Va * p + a.C_ell_r * b_2Va * r
+       + a.C_ell_delta_a * controls.delta_a + a.C_ell_delta_r * controls.delta_r);
+  double m = qbar_S * a.c
+    * (a.C_m_0 + a.C_m_alpha * alpha + a.C_m_q * c_2Va * q + a.C_m_delta_e * controls.delta_e);
+  double n = qbar_S * a.b
+    * (a.C_n_0 + a.C_n_beta * beta + a.C_n_p * b_2Va * p + a.C_n_r * b_2Va * r
+       + a.C_n_delta_a * controls.delta_a + a.C_n_delta_r * controls.delta_r);
+
+  // Gravity in the body frame
+  Eigen::Vector3d gravity = R_body_to_ned.transpose() * Eigen::Vector3d(0.0, 0.0, a.gravity);
+
+  State x_dot;
+  x_dot.segment<3>(PN) = R_body_to_ned * velocity;
+  x_dot.segment<3>(U) =
+    Eigen::Vector3d(r * velocity(1) - q * velocity(2), p * velocity(2) - r * velocity(0),
+                    q * velocity(0) - p * velocity(1))
+    + gravity + specific_force;
+
+  double cphi = cos(phi), sphi = sin(phi);
+  double cth = cos(theta), tth = tan(theta);
+  x_dot(PHI) = p + q * sphi * tth + r * cphi * tth;
+  x_dot(THETA) = q * cphi - r * sphi;
+  x_dot(PSI) = (q * sphi + r * cphi) / cth;
+
+  x_dot(P) = gamma_[1] * p * q - gamma_[2] * q * r + gamma_[3] * ell + gamma_[4] * n;
+  x_dot(Q) = gamma_[5] * p * r - gamma_[6] * (p * p - r * r) + m / a.Jy;
+  x_dot(R) = gamma_[7] * p * q - gamma_[1] * q * r + gamma_[4] * ell + gamma_[8] * n;
+
+  return x_dot;
+}
+
+} // namespace rosplane
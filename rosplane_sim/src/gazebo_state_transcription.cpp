@@ -1,11 +1,16 @@
 #include <chrono>
+#include <cmath>
 #include <memory>
+#include <string>
 
 #include <Eigen/Geometry>
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <geometry_msgs/msg/vector3_stamped.hpp>
 #include <nav_msgs/msg/odometry.hpp>
 #include <rclcpp/rclcpp.hpp>
 
+#include "estimate_comparator.hpp"
+#include "rosplane/latency_histogram.hpp"
 #include "rosplane_msgs/msg/state.hpp"
 
 using namespace std::chrono_literals;
@@ -22,6 +27,23 @@ public:
       "/fixedwing/truth/NED", 10, std::bind(&GazeboTranscription::publish_truth, this, _1));
 
     publisher_ = this->create_publisher<rosplane_msgs::msg::State>("state", 10);
+
+    // Compare the estimate with the truth, to measure the accuracy of changes to the estimator.
+    double error_window = this->declare_parameter("error_window_s", 30.0);
+    double error_log_period = this->declare_parameter("error_log_period_s", 10.0);
+    comparator_ = rosplane::EstimateComparator(64, 0.1, error_window, 10);
+
+    estimate_subscription_ = this->create_subscription<State>(
+      "estimated_state", 10, std::bind(&GazeboTranscription::compare_estimate, this, _1));
+    diagnostics_publisher_ =
+      this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
+    diagnostics_timer_ =
+      this->create_wall_timer(1s, std::bind(&GazeboTranscription::publish_error_statistics, this));
+    if (error_log_period > 0.0) {
+      log_timer_ = this->create_wall_timer(
+        std::chrono::duration<double>(error_log_period),
+        std::bind(&GazeboTranscription::log_error_statistics, this));
+    }
   }
 
 private:
@@ -31,6 +53,12 @@ private:
 
   rclcpp::Publisher<State>::SharedPtr publisher_;
 
+  rclcpp::Subscription<State>::SharedPtr estimate_subscription_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_publisher_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+  rclcpp::TimerBase::SharedPtr log_timer_;
+  rosplane::EstimateComparator comparator_;
+
   //TODO insert wind callback.
   double wn_ = 0.0;
   double we_ = 0.0;
@@ -105,8 +133,94 @@ private:
 
     //    state.psi_deg = state.psi * TODO implement the deg into the state.
 
+    // The estimate is stamped with the time of the IMU sample it is for, so the truth is matched to
+    // it by the time of the odometry rather than the time it arrived.
+    state.origin_stamp = msg.header.stamp;
+    comparator_.add_truth(rclcpp::Time(msg.header.stamp).seconds(), compared_values(state));
+
     publisher_->publish(state);
   }
+
+  /**
+   * @return The compared states of a state message, in the order of EstimateComparator::StateIndex.
+   */
+  static rosplane::EstimateComparator::Values compared_values(const State & state)
+  {
+    return {state.position[0], state.position[1], -state.position[2], state.phi, state.theta,
+            state.chi,         state.vg,          state.wn,           state.we};
+  }
+
+  void compare_estimate(const State & msg)
+  {
+    // The estimator sends zeros until it is armed for the first time, which are not estimates.
+    rclcpp::Time stamp(msg.origin_stamp);
+    if (stamp.nanoseconds() == 0) {
+      return;
+    }
+    comparator_.add_estimate(stamp.seconds(), compared_values(msg));
+  }
+
+  /**
+   * @brief Publishes the rolling RMS, largest and mean error of each compared state. The errors are
+   * estimate minus truth, with the angles in degrees.
+   */
+  void publish_error_statistics()
+  {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = std::string(this->get_name()) + ": estimate error";
+    status.hardware_id = this->get_name();
+
+    using rosplane::LatencyHistogram;
+    LatencyHistogram::add_value(status, "matched", std::to_string(comparator_.matched()));
+    LatencyHistogram::add_value(status, "dropped", std::to_string(comparator_.dropped()));
+    for (int i = 0; i < rosplane::EstimateComparator::NUM_STATES; ++i) {
+      const rosplane::RollingErrorStatistics & statistics = comparator_.statistics(i);
+      double scale = rosplane::EstimateComparator::is_angle(i) ? 180.0 / M_PI : 1.0;
+      std::string name = rosplane::EstimateComparator::state_names[i];
+      LatencyHistogram::add_value(status, name + "_rms",
+                                  LatencyHistogram::format(statistics.rms() * scale));
+      LatencyHistogram::add_value(status, name + "_max",
+                                  LatencyHistogram::format(statistics.max() * scale));
+      LatencyHistogram::add_value(status, name + "_bias",
+                                  LatencyHistogram::format(statistics.bias() * scale));
+    }
+
+    if (comparator_.statistics(0).count() == 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+      status.message = "No estimates compared";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = summary();
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray diagnostics_message;
+    diagnostics_message.header.stamp = this->get_clock()->now();
+    diagnostics_message.status.push_back(status);
+    diagnostics_publisher_->publish(diagnostics_message);
+  }
+
+  void log_error_statistics()
+  {
+    if (comparator_.statistics(0).count() > 0) {
+      RCLCPP_INFO(this->get_logger(), "Estimate error: %s", summary().c_str());
+    }
+  }
+
+  /**
+   * @return The RMS errors of the position, altitude and attitude on one line.
+   */
+  std::string summary() const
+  {
+    using rosplane::EstimateComparator;
+    using rosplane::LatencyHistogram;
+    const auto rms = [this](int i) { return comparator_.statistics(i).rms(); };
+    return "RMS position " + LatencyHistogram::format(std::hypot(rms(EstimateComparator::PN),
+                                                                rms(EstimateComparator::PE)))
+      + " m, altitude " + LatencyHistogram::format(rms(EstimateComparator::H)) + " m, roll "
+      + LatencyHistogram::format(rms(EstimateComparator::PHI) * 180.0 / M_PI) + " deg, pitch "
+      + LatencyHistogram::format(rms(EstimateComparator::THETA) * 180.0 / M_PI) + " deg, course "
+      + LatencyHistogram::format(rms(EstimateComparator::CHI) * 180.0 / M_PI) + " deg";
+  }
 };
 
 int main(int argc, char * argv[])
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+
+#include "headless_sim.hpp"
+#include "rosplane/controller_successive_loop_core.hpp"
+#include "rosplane/controller_total_energy_core.hpp"
+#include "rosplane/estimator_continuous_discrete_core.hpp"
+#include "rosplane/path_follower_example_core.hpp"
+#include "rosplane/path_manager_example_core.hpp"
+
+namespace rosplane
+{
+
+namespace
+{
+
+/**
+ * Root mean square and largest magnitude of an error.
+ */
+struct ErrorStatistics
+{
+  double sum_squares = 0.0;
+  double max = 0.0;
+  int64_t count = 0;
+
+  void add(double error)
+  {
+    sum_squares += error * error;
+    max = std::max(max, std::abs(error));
+    count++;
+  }
+
+  double rms() const { return count > 0 ? std::sqrt(sum_squares / count) : 0.0; }
+};
+
+/**
+ * @return The angle wrapped to -pi to pi.
+ */
+double wrap(double angle) { return std::atan2(std::sin(angle), std::cos(angle)); }
+
+constexpr double kRadToDeg = 180.0 / M_PI;
+
+} // namespace
+
+HeadlessSim::HeadlessSim(const SimConfig & config)
+    : config_(config)
+    , rng_(config.seed)
+    , normal_(0.0, 1.0)
+    , model_(config.aircraft)
+    , gust_(Eigen::Vector3d::Zero())
+    , next_gps_time_(0.0)
+    , gps_epoch_(0)
+{
+  model_.reset(config_.initial_altitude, config_.initial_airspeed, config_.initial_heading);
+
+  // The overrides take the place of the defaults as each core declares its parameters, so the
+  // cores are built with the configured values like they are in the nodes.
+  params_.set_overrides(config_.params);
+  CoreContext context{params_, rclcpp::get_logger("headless_sim")};
+
+  estimator_ = std::make_unique<EstimatorContinuousDiscreteCore>(context);
+  manager_ = std::make_unique<PathManagerExampleCore>(context);
+  follower_ = std::make_unique<PathFollowerExampleCore>(context);
+  if (config_.controller == ControllerType::TOTAL_ENERGY) {
+    controller_ = std::make_unique<ControllerTotalEnergyCore>(context);
+  } else {
+    controller_ = std::make_unique<ControllerSucessiveLoopCore>(context);
+  }
+
+  // The measurements are given in the local frame, relative to the calibrated ground pressure.
+  estimator_->set_origin(0.0, 0.0, 0.0);
+  estimator_->set_baro_calibration(101325.0f);
+
+  PathManagerCore::Input state;
+  state.pn = 0.0f;
+  state.pe = 0.0f;
+  state.h = config_.initial_altitude;
+  state.chi = config_.initial_heading;
+  manager_->add_waypoints(config_.waypoints, state);
+}
+
+void HeadlessSim::measure(double t, EstimatorCore::Input & input)
+{
+  const SensorNoise & sigma = config_.sensor_noise;
+  const FixedWingModel::State & x = model_.state();
+  const FixedWingParams & aircraft = model_.params();
+
+  input.gyro_x = x(FixedWingModel::P) + config_.gyro_bias(0) + noise(sigma.gyro);
+  input.gyro_y = x(FixedWingModel::Q) + config_.gyro_bias(1) + noise(sigma.gyro);
+  input.gyro_z = x(FixedWingModel::R) + config_.gyro_bias(2) + noise(sigma.gyro);
+
+  const Eigen::Vector3d & specific_force = model_.specific_force();
+  input.accel_x = specific_force(0) + noise(sigma.accel);
+  input.accel_y = specific_force(1) + noise(sigma.accel);
+  input.accel_z = specific_force(2) + noise(sigma.accel);
+
+  double h = -x(FixedWingModel::PD);
+  double Va = model_.airspeed();
+  input.static_pres = aircraft.rho * aircraft.gravity * h + noise(sigma.static_pres);
+  input.diff_pres = 0.5 * aircraft.rho * Va * Va + noise(sigma.diff_pres);
+
+  input.gps_new = t >= next_gps_time_;
+  if (input.gps_new) {
+    Eigen::Vector3d ground_velocity = model_.ground_velocity();
+    double Vg = std::hypot(ground_velocity(0), ground_velocity(1));
+
+    input.gps_n = x(FixedWingModel::PN) + noise(sigma.gps_n);
+    input.gps_e = x(FixedWingModel::PE) + noise(sigma.gps_e);
+    input.gps_h = h + noise(sigma.gps_h);
+    input.gps_Vg = Vg + noise(sigma.gps_Vg);
+    input.gps_course = std::atan2(ground_velocity(1), ground_velocity(0))
+      + noise(sigma.gps_Vg / std::max(Vg, 1.0));
+    input.gps_epoch = ++gps_epoch_;
+    input.gps_stamp = t;
+    next_gps_time_ += 1.0 / config_.gps_rate;
+  }
+
+  input.status_armed = true;
+  input.armed_init = true;
+  input.Ts = config_.dt;
+  input.stamp = t;
+}
+
+RunSummary HeadlessSim::run()
+{
+  RunSummary summary;
+  summary.seed = config_.seed;
+
+  ErrorStatistics altitude_error;
+  ErrorStatistics airspeed_error;
+  ErrorStatistics position_estimate_error;
+  ErrorStatistics altitude_estimate_error;
+  ErrorStatistics roll_estimate_error;
+  ErrorStatistics pitch_estimate_error;
+
+  EstimatorCore::Input sensors{};
+  EstimatorCore::Output estimate{};
+  PathManagerCore::Output path{};
+  PathFollowerCore::Output commands{};
+  ControllerCore::Output efforts{};
+  ControlSurfaces controls;
+
+  int64_t settle_steps = static_cast<int64_t>(std::llround(config_.settle_time / config_.dt));
+  for (int64_t k = 0; k < settle_steps; ++k) {
+    measure(k * config_.dt, sensors);
+    estimator_->estimate(sensors, estimate);
+  }
+  double release_time = settle_steps * config_.dt;
+
+  int current_waypoint = manager_->current_waypoint();
+  double gust_decay = std::exp(-config_.dt / config_.gust_time_constant);
+  double gust_sigma = config_.gust_sigma * std::sqrt(1.0 - gust_decay * gust_decay);
+  double model_dt = config_.dt / std::max(config_.model_substeps, 1);
+  int64_t steps = static_cast<int64_t>(std::llround(config_.duration / config_.dt));
+
+  for (int64_t k = 0; k < steps; ++k) {
+    double t = release_time + k * config_.dt;
+
+    // Run the autopilot on the measurements, in the order the nodes pass their messages along.
+    measure(t, sensors);
+    estimator_->estimate(sensors, estimate);
+
+    PathManagerCore::Input manager_input;
+    manager_input.pn = estimate.pn;
+    manager_input.pe = estimate.pe;
+    manager_input.h = estimate.h;
+    manager_input.chi = estimate.chi;
+    manager_->manage(manager_input, path);
+
+    PathFollowerCore::Input follower_input;
+    follower_input.p_type = path.flag ? PathType::LINE : PathType::ORBIT;
+    follower_input.va_d = path.va_d;
+    for (int i = 0; i < 3; ++i) {
+      follower_input.r_path[i] = path.r[i];
+      follower_input.q_path[i] = path.q[i];
+      follower_input.c_orbit[i] = path.c[i];
+    }
+    follower_input.rho_orbit = path.rho;
+    follower_input.lam_orbit = path.lamda;
+    follower_input.pn = estimate.pn;
+    follower_input.pe = estimate.pe;
+    follower_input.h = estimate.h;
+    follower_input.va = estimate.va;
+    follower_input.chi = estimate.chi;
+    follower_input.psi = estimate.psi;
+    follower_->update(follower_input, commands);
+
+    ControllerCore::Input controller_input{};
+    controller_input.Ts = config_.dt;
+    controller_input.h = estimate.h;
+    controller_input.va = estimate.va;
+    controller_input.phi = estimate.phi;
+    controller_input.theta = estimate.theta;
+    controller_input.chi = estimate.chi;
+    controller_input.p = estimate.p;
+    controller_input.q = estimate.q;
+    controller_input.r = estimate.r;
+    controller_input.va_c = commands.va_c;
+    controller_input.h_c = commands.h_c;
+    controller_input.chi_c = commands.chi_c;
+    controller_input.phi_ff = commands.phi_ff;
+    controller_->control(controller_input, efforts);
+    controller_->convert_to_pwm(efforts);
+
+    // Non-finite efforts are zeroed, the same as the controller node does before publishing. The
+    // controller gives the elevator positive nose up, the opposite of the model.
+    controls.delta_e = std::isfinite(efforts.delta_e) ? -efforts.delta_e : 0.0;
+    controls.delta_a = std::isfinite(efforts.delta_a) ? efforts.delta_a : 0.0;
+    controls.delta_r = std::isfinite(efforts.delta_r) ? efforts.delta_r : 0.0;
+    controls.delta_t = std::isfinite(efforts.delta_t) ? efforts.delta_t : 0.0;
+
+    if (manager_->current_waypoint() != current_waypoint) {
+      current_waypoint = manager_->current_waypoint();
+      summary.waypoints_reached++;
+    }
+
+    const FixedWingModel::State & x = model_.state();
+    if (t - release_time >= config_.metrics_start) {
+      double h = -x(FixedWingModel::PD);
+      altitude_error.add(h - commands.h_c);
+      airspeed_error.add(model_.airspeed() - commands.va_c);
+      position_estimate_error.add(
+        std::hypot(estimate.pn - x(FixedWingModel::PN), estimate.pe - x(FixedWingModel::PE)));
+      altitude_estimate_error.add(estimate.h - h);
+      roll_estimate_error.add(wrap(estimate.phi - x(FixedWingModel::PHI)) * kRadToDeg);
+      pitch_estimate_error.add(wrap(estimate.theta - x(FixedWingModel::THETA)) * kRadToDeg);
+    }
+    summary.max_roll =
+      std::max(summary.max_roll, std::abs(wrap(x(FixedWingModel::PHI))) * kRadToDeg);
+
+    // Fly the aircraft to the next period of the autopilot.
+    for (int i = 0; i < 3; ++i) {
+      gust_(i) = gust_decay * gust_(i) + gust_sigma * normal_(rng_);
+    }
+    for (int i = 0; i < std::max(config_.model_substeps, 1); ++i) {
+      model_.step(controls, config_.wind + gust_, model_dt);
+    }
+    summary.flight_time = (k + 1) * config_.dt;
+
+    if (model_.state()(FixedWingModel::PD) > 0.0 || !model_.state().allFinite()) {
+      summary.crashed = true;
+      break;
+    }
+  }
+
+  summary.rms_altitude_error = altitude_error.rms();
+  summary.max_altitude_error = altitude_error.max;
+  summary.rms_airspeed_error = airspeed_error.rms();
+  summary.rms_position_estimate_error = position_estimate_error.rms();
+  summary.max_position_estimate_error = position_estimate_error.max;
+  summary.rms_altitude_estimate_error = altitude_estimate_error.rms();
+  summary.rms_roll_estimate_error = roll_estimate_error.rms();
+  summary.rms_pitch_estimate_error = pitch_estimate_error.rms();
+  return summary;
+}
+
+} // namespace rosplane
@@ -0,0 +1,308 @@
+/**
+ * @file monte_carlo_main.cpp
+ *
+ * Flies many headless simulations of the autopilot over randomized wind, gusts, sensor noise and
+ * missions, spread over a pool of threads. Each run is a function of the seed and its index, so
+ * a run can be repeated alone or compared between changes to the parameters or the algorithms.
+ * One line of results per run is written as CSV, and a summary of all runs to stderr.
+ *
+ * Example:
+ *   ros2 run rosplane_sim rosplane_monte_carlo --runs 500 --params anaconda_autopilot_params.yaml
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rclcpp/logger.hpp>
+#include <rcutils/logging.h>
+
+#include "headless_sim.hpp"
+
+namespace
+{
+
+using namespace rosplane;
+
+struct Options
+{
+  int runs = 100;
+  unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+  uint64_t seed = 0;
+  double duration = 120.0;
+  std::string params_file;
+  ControllerType controller = ControllerType::SUCCESSIVE_LOOP;
+  double max_wind = 5.0;        /**< Largest steady wind speed (m/s) */
+  double max_gust = 1.0;        /**< Largest standard deviation of the gusts (m/s) */
+  double max_noise_scale = 2.0; /**< Largest multiple of the nominal sensor noise */
+  int waypoints = 4;
+  double mission_radius = 200.0; /**< Distance of the waypoints from the origin (m) */
+  bool dubins = false;
+  std::string output;
+  bool verbose = false;
+};
+
+void print_usage(const char * name)
+{
+  std::cerr << "Usage: " << name << " [options]\n"
+            << "  --runs N                Number of runs (default 100)\n"
+            << "  --threads N             Number of threads (default one per core)\n"
+            << "  --seed N                Seed of the randomized runs (default 0)\n"
+            << "  --duration S            Simulated time of each run (default 120 s)\n"
+            << "  --params FILE           ROS2 parameter file of the autopilot\n"
+            << "  --controller TYPE       successive_loop or total_energy\n"
+            << "  --max-wind V            Largest steady wind (default 5 m/s)\n"
+            << "  --max-gust V            Largest gust standard deviation (default 1 m/s)\n"
+            << "  --max-noise-scale K     Largest multiple of the sensor noise (default 2)\n"
+            << "  --waypoints N           Waypoints in each mission (default 4)\n"
+            << "  --mission-radius R      Distance of the waypoints (default 200 m)\n"
+            << "  --dubins                Give a course at each waypoint for Dubins paths\n"
+            << "  --output FILE           CSV file of the results (default stdout)\n"
+            << "  --verbose               Keep the log messages of the autopilot\n";
+}
+
+/**
+ * @brief Reads the command line into the options.
+ *
+ * @return False if an argument is unknown or missing its value.
+ */
+bool parse_args(int argc, char ** argv, Options & options)
+{
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--dubins") {
+      options.dubins = true;
+    } else if (arg == "--verbose") {
+      options.verbose = true;
+    } else if (arg == "--help" || arg == "-h" || !has_value) {
+      return false;
+    } else {
+      std::string value = argv[++i];
+      try {
+        if (arg == "--runs") {
+          options.runs = std::stoi(value);
+        } else if (arg == "--threads") {
+          options.threads = static_cast<unsigned int>(std::max(std::stoi(value), 1));
+        } else if (arg == "--seed") {
+          options.seed = std::stoull(value);
+        } else if (arg == "--duration") {
+          options.duration = std::stod(value);
+        } else if (arg == "--params") {
+          options.params_file = value;
+        } else if (arg == "--controller") {
+          if (value == "successive_loop") {
+            options.controller = ControllerType::SUCCESSIVE_LOOP;
+          } else if (value == "total_energy") {
+            options.controller = ControllerType::TOTAL_ENERGY;
+          } else {
+            return false;
+          }
+        } else if (arg == "--max-wind") {
+          options.max_wind = std::stod(value);
+        } else if (arg == "--max-gust") {
+          options.max_gust = std::stod(value);
+        } else if (arg == "--max-noise-scale") {
+          options.max_noise_scale = std::stod(value);
+        } else if (arg == "--waypoints") {
+          options.waypoints = std::max(std::stoi(value), 2);
+        } else if (arg == "--mission-radius") {
+          options.mission_radius = std::stod(value);
+        } else if (arg == "--output") {
+          options.output = value;
+        } else {
+          return false;
+        }
+      } catch (const std::exception &) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Randomizes the conditions and the mission of one run. The randomness comes only from
+ * the seed and the index of the run, so the configuration does not depend on the threads.
+ */
+SimConfig make_config(const Options & options, const ParamOverrides & params, int index)
+{
+  std::seed_seq seq{static_cast<uint32_t>(options.seed), static_cast<uint32_t>(options.seed >> 32),
+                    static_cast<uint32_t>(index)};
+  std::mt19937_64 rng(seq);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  SimConfig config;
+  config.seed = rng();
+  config.duration = options.duration;
+  config.controller = options.controller;
+  config.params = params;
+
+  double wind_speed = options.max_wind * unit(rng);
+  double wind_direction = 2.0 * M_PI * unit(rng);
+  config.wind = Eigen::Vector3d(wind_speed * cos(wind_direction),
+                                wind_speed * sin(wind_direction), 0.0);
+  config.gust_sigma = options.max_gust * unit(rng);
+  config.noise_scale = options.max_noise_scale * unit(rng);
+  for (int i = 0; i < 3; ++i) {
+    config.gyro_bias(i) = (2.0 * unit(rng) - 1.0) * M_PI / 180.0;
+  }
+  config.initial_heading = 2.0 * M_PI * unit(rng) - M_PI;
+
+  // An irregular polygon around the origin, flown toward the first waypoint from the start.
+  for (int i = 0; i < options.waypoints; ++i) {
+    double angle =
+      config.initial_heading + 2.0 * M_PI * (i + 0.5 * (unit(rng) - 0.5)) / options.waypoints;
+    double radius = options.mission_radius * (0.5 + 0.5 * unit(rng));
+
+    PathManagerCore::Waypoint waypoint;
+    waypoint.w[0] = radius * cos(angle);
+    waypoint.w[1] = radius * sin(angle);
+    waypoint.w[2] = -(config.initial_altitude + 20.0 * (unit(rng) - 0.5));
+    waypoint.chi_d = 0.0f;
+    waypoint.use_chi = options.dubins;
+    waypoint.va_d = config.initial_airspeed;
+    config.waypoints.push_back(waypoint);
+  }
+
+  // With Dubins paths, arrive at each waypoint on the course to the next one.
+  for (int i = 0; i < options.waypoints; ++i) {
+    const PathManagerCore::Waypoint & next = config.waypoints[(i + 1) % options.waypoints];
+    PathManagerCore::Waypoint & waypoint = config.waypoints[i];
+    waypoint.chi_d = atan2(next.w[1] - waypoint.w[1], next.w[0] - waypoint.w[0]);
+  }
+
+  return config;
+}
+
+void write_csv(std::ostream & out, const std::vector<RunSummary> & summaries)
+{
+  out << "run,seed,crashed,flight_time,waypoints_reached,rms_altitude_error,max_altitude_error,"
+         "rms_airspeed_error,rms_position_estimate_error,max_position_estimate_error,"
+         "rms_altitude_estimate_error,rms_roll_estimate_error,rms_pitch_estimate_error,max_roll\n";
+  for (size_t i = 0; i < summaries.size(); ++i) {
+    const RunSummary & s = summaries[i];
+    out << i << ',' << s.seed << ',' << s.crashed << ',' << s.flight_time << ','
+        << s.waypoints_reached << ',' << s.rms_altitude_error << ',' << s.max_altitude_error << ','
+        << s.rms_airspeed_error << ',' << s.rms_position_estimate_error << ','
+        << s.max_position_estimate_error << ',' << s.rms_altitude_estimate_error << ','
+        << s.rms_roll_estimate_error << ',' << s.rms_pitch_estimate_error << ',' << s.max_roll
+        << '\n';
+  }
+}
+
+void print_aggregate(const std::vector<RunSummary> & summaries, double wall_time)
+{
+  int crashes = 0;
+  double sum_altitude = 0.0, sum_airspeed = 0.0, sum_position = 0.0, sum_roll = 0.0;
+  double worst_altitude = 0.0, worst_position = 0.0, simulated_time = 0.0;
+  for (const RunSummary & s : summaries) {
+    crashes += s.crashed;
+    sum_altitude += s.rms_altitude_error;
+    sum_airspeed += s.rms_airspeed_error;
+    sum_position += s.rms_position_estimate_error;
+    sum_roll += s.rms_roll_estimate_error;
+    worst_altitude = std::max(worst_altitude, s.max_altitude_error);
+    worst_position = std::max(worst_position, s.max_position_estimate_error);
+    simulated_time += s.flight_time;
+  }
+
+  double n = std::max<double>(summaries.size(), 1.0);
+  std::cerr << summaries.size() << " runs, " << crashes << " crashed, " << simulated_time
+            << " s simulated in " << wall_time << " s\n"
+            << "  mean RMS altitude error:          " << sum_altitude / n << " m (worst "
+            << worst_altitude << " m)\n"
+            << "  mean RMS airspeed error:          " << sum_airspeed / n << " m/s\n"
+            << "  mean RMS position estimate error: " << sum_position / n << " m (worst "
+            << worst_position << " m)\n"
+            << "  mean RMS roll estimate error:     " << sum_roll / n << " deg\n";
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parse_args(argc, argv, options) || options.runs < 0) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // The cores log through rclcpp without a node. Their start up messages from every run would
+  // bury the results, so only warnings are kept unless asked for.
+  rcutils_logging_initialize();
+  if (!options.verbose) {
+    rclcpp::get_logger("headless_sim").set_level(rclcpp::Logger::Level::Warn);
+  }
+
+  ParamOverrides params;
+  if (!options.params_file.empty()) {
+    if (!std::ifstream(options.params_file)) {
+      std::cerr << "Could not open " << options.params_file << '\n';
+      return 1;
+    }
+    params = ParamManager::load_overrides(options.params_file);
+  }
+
+  std::vector<RunSummary> summaries(options.runs);
+  std::atomic<int> next_run{0};
+  std::exception_ptr error;
+  std::atomic_flag error_set = ATOMIC_FLAG_INIT;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < std::min<unsigned int>(options.threads, options.runs); ++t) {
+    workers.emplace_back([&]() {
+      for (int i = next_run++; i < options.runs; i = next_run++) {
+        try {
+          HeadlessSim sim(make_config(options, params, i));
+          summaries[i] = sim.run();
+        } catch (...) {
+          if (!error_set.test_and_set()) {
+            error = std::current_exception();
+          }
+          next_run = options.runs;
+        }
+      }
+    });
+  }
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+  double wall_time =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (error) {
+    try {
+      std::rethrow_exception(error);
+    } catch (const std::exception & e) {
+      std::cerr << "A run failed: " << e.what() << '\n';
+    } catch (...) {
+      std::cerr << "A run failed\n";
+    }
+    return 1;
+  }
+
+  if (options.output.empty()) {
+    write_csv(std::cout, summaries);
+  } else {
+    std::ofstream file(options.output);
+    if (!file) {
+      std::cerr << "Could not open " << options.output << '\n';
+      return 1;
+    }
+    write_csv(file, summaries);
+  }
+  print_aggregate(summaries, wall_time);
+
+  return 0;
+}
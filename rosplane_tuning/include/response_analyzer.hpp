@@ -0,0 +1,120 @@
+/**
+ * @file response_analyzer.hpp
+ *
+ * ROS2 node that measures how a layer of the controller follows its command while it is tuned.
+ */
+
+#ifndef TUNING_RESPONSE_ANALYZER_HPP
+#define TUNING_RESPONSE_ANALYZER_HPP
+
+#include <string>
+#include <vector>
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
+#include <rcl_interfaces/msg/set_parameters_result.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+#include "response_metrics.hpp"
+#include "rosplane_msgs/msg/controller_commands.hpp"
+#include "rosplane_msgs/msg/controller_internals.hpp"
+#include "rosplane_msgs/msg/state.hpp"
+
+namespace rosplane
+{
+/**
+ * This class compares the command of one controller with the estimated state as they arrive.
+ * In step mode it reports the rise time, overshoot, settling time, steady state error and a
+ * bandwidth estimate of every step, such as those of the step and square signals of the signal
+ * generator. In sweep mode it reports the gain over each half cycle of a chirp, and the bandwidth
+ * once the gain drops below -3 dB, so one sweep covers the range of frequencies in one flight.
+ * The results are logged and published on the diagnostics topic.
+ */
+class TuningResponseAnalyzer : public rclcpp::Node
+{
+public:
+  /// Constructor for response analyzer.
+  TuningResponseAnalyzer();
+
+private:
+  /// This defines what controller the command and response are taken from.
+  enum class ControllerOutput
+  {
+    ROLL,
+    PITCH,
+    ALTITUDE,
+    COURSE,
+    AIRSPEED
+  };
+
+  // Parameters
+  ControllerOutput controller_output_; ///< Controller to analyze.
+  bool sweep_;                         ///< Whether to analyze a sweep rather than steps.
+  double step_threshold_;              ///< Smallest change in the command counted as a step.
+  double settling_band_;               ///< Settling band as a fraction of the step.
+  double response_window_s_;           ///< Longest time a step response is measured for.
+
+  // Internal values
+  bool has_command_;                     ///< Flag for when a command has been received.
+  double command_;                       ///< Latest command of the analyzed controller.
+  StepResponseAnalyzer step_analyzer_;   ///< Measures the step responses.
+  SweepResponseAnalyzer sweep_analyzer_; ///< Measures the gain of a sweep.
+
+  /// Estimated state ROS message subscription.
+  rclcpp::Subscription<rosplane_msgs::msg::State>::SharedPtr state_subscription_;
+  /// Controller internals ROS message subscription, for the roll and pitch commands.
+  rclcpp::Subscription<rosplane_msgs::msg::ControllerInternals>::SharedPtr internals_subscription_;
+  /// Controller command ROS message subscription, for the altitude, course and airspeed commands.
+  rclcpp::Subscription<rosplane_msgs::msg::ControllerCommands>::SharedPtr command_subscription_;
+
+  /// Results publisher.
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_publisher_;
+
+  /// ROS parameter change callback handler.
+  OnSetParametersCallbackHandle::SharedPtr param_callback_handle_;
+
+  /// Callback to measure the response to the latest command.
+  void state_callback(const rosplane_msgs::msg::State::SharedPtr msg);
+  /// Callback to store the roll or pitch command.
+  void internals_callback(const rosplane_msgs::msg::ControllerInternals::SharedPtr msg);
+  /// Callback to store the altitude, course or airspeed command.
+  void command_callback(const rosplane_msgs::msg::ControllerCommands::SharedPtr msg);
+
+  /// Callback for parameter changes. Rejects all of the changes if any of them is invalid.
+  rcl_interfaces::msg::SetParametersResult
+  param_callback(const std::vector<rclcpp::Parameter> & params);
+
+  /**
+   * @brief Checks a new value of a parameter.
+   *
+   * @param param The parameter with its new value.
+   * @return An empty string if the value is valid, otherwise the reason it is not.
+   */
+  std::string validate_param(const rclcpp::Parameter & param) const;
+
+  /**
+   * @brief Stores a new value of a parameter in the class, which must have been validated.
+   *
+   * @param param The parameter with its new value.
+   */
+  void apply_param(const rclcpp::Parameter & param);
+
+  /**
+   * @brief Logs and publishes a result.
+   *
+   * @param name The name of the result.
+   * @param message A summary of the result.
+   * @param keys The names of the values.
+   * @param values The values, in the units of the controller output and seconds.
+   */
+  void publish_result(const std::string & name, const std::string & message,
+                      const std::vector<std::string> & keys, const std::vector<double> & values);
+
+  /// The name of the analyzed controller output.
+  std::string output_name() const;
+
+  /// Starts the analysis over, for when the analyzed controller or its settings change.
+  void reset();
+};
+} // namespace rosplane
+
+#endif // TUNING_RESPONSE_ANALYZER_HPP
@@ -0,0 +1,122 @@
+/**
+ * @file response_metrics.hpp
+ *
+ * Online measures of how a control loop follows its command, for the response analyzer.
+ */
+
+#ifndef TUNING_RESPONSE_METRICS_HPP
+#define TUNING_RESPONSE_METRICS_HPP
+
+namespace rosplane
+{
+/// The measures of one step response. Values that could not be measured are NaN.
+struct StepResponse
+{
+  double step_size;          ///< Change in the command.
+  double rise_time;          ///< Time to go from 10% to 90% of the step, in seconds.
+  double overshoot_percent;  ///< Peak past the command, as a percent of the step.
+  double settling_time;      ///< Time after the step to stay within the settling band, in seconds.
+  double steady_state_error; ///< Command minus response at the end of the window.
+  double bandwidth_hz;       ///< Bandwidth of a first order system with the same rise time.
+};
+
+/**
+ * Measures the responses to steps in a command. A step is a change in the command larger than
+ * the threshold between two samples. Each response is measured from the step until the window has
+ * passed or the command steps again.
+ */
+class StepResponseAnalyzer
+{
+public:
+  /**
+   * @param step_threshold The smallest change in the command counted as a step.
+   * @param settling_band The band around the command the response settles in, as a fraction of
+   *   the step.
+   * @param window The longest time a response is measured for, in seconds.
+   */
+  StepResponseAnalyzer(double step_threshold, double settling_band, double window);
+
+  /**
+   * @brief Adds a sample of the command and response.
+   *
+   * @param time The time of the sample in seconds.
+   * @param command The commanded value.
+   * @param response The measured value.
+   * @param result Set to the measures of a response when one finishes.
+   * @return True if a response finished with this sample.
+   */
+  bool update(double time, double command, double response, StepResponse & result);
+
+  /// Drops the response being measured.
+  void reset();
+
+private:
+  /// Computes the measures of the response being measured.
+  StepResponse finish() const;
+
+  double step_threshold_; ///< Smallest change in the command counted as a step.
+  double settling_band_;  ///< Settling band as a fraction of the step.
+  double window_;         ///< Longest time a response is measured for.
+
+  bool has_previous_;       ///< Whether a previous command has been seen.
+  double previous_command_; ///< The command of the last sample.
+
+  bool active_;                ///< Whether a response is being measured.
+  double step_time_;           ///< Time of the step.
+  double initial_response_;    ///< Response at the step.
+  double target_;              ///< Command after the step.
+  double rise_start_time_;     ///< Time the response reached 10% of the step, or NaN.
+  double rise_end_time_;       ///< Time the response reached 90% of the step, or NaN.
+  double peak_;                ///< Largest fraction of the step reached.
+  double last_unsettled_time_; ///< Last time the response was outside the settling band.
+  double last_response_;       ///< Response of the last sample.
+};
+
+/// The gain measured over one half cycle of a sweep.
+struct SweepPoint
+{
+  double frequency_hz; ///< Frequency of the half cycle.
+  double gain;         ///< Peak response over peak command, about their means.
+};
+
+/**
+ * Measures the gain of a loop from a frequency sweep such as a chirp. The command is split into
+ * half cycles where it crosses its mean, and the gain of each is the peak of the response over the
+ * peak of the command. The bandwidth is the first frequency the smoothed gain drops below -3 dB at.
+ */
+class SweepResponseAnalyzer
+{
+public:
+  SweepResponseAnalyzer();
+
+  /**
+   * @brief Adds a sample of the command and response.
+   *
+   * @param time The time of the sample in seconds.
+   * @param command The commanded value.
+   * @param response The measured value.
+   * @param point Set to the gain of a half cycle when one finishes.
+   * @return True if a half cycle finished with this sample.
+   */
+  bool update(double time, double command, double response, SweepPoint & point);
+
+  /// The bandwidth found so far in Hz, or NaN if the gain has not dropped below -3 dB.
+  double bandwidth_hz() const { return bandwidth_hz_; }
+
+  /// Starts a new sweep.
+  void reset();
+
+private:
+  int samples_;          ///< Number of samples in the sweep.
+  double command_mean_;  ///< Mean of the command over the sweep.
+  double response_mean_; ///< Mean of the response over the sweep.
+  int sign_;             ///< Side of the mean the command is on, or 0 before the first cycle.
+  double crossing_time_; ///< Time of the last crossing of the mean, or NaN.
+  double command_peak_;  ///< Peak of the command in the current half cycle.
+  double response_peak_; ///< Peak of the response in the current half cycle.
+  double smoothed_gain_; ///< Low pass filtered gain of the half cycles, or NaN.
+  double bandwidth_hz_;  ///< Bandwidth found so far, or NaN.
+};
+} // namespace rosplane
+
+#endif // TUNING_RESPONSE_METRICS_HPP
@@ -42,18 +42,28 @@
 #ifndef TUNING_SIGNAL_GENERATOR_HPP
 #define TUNING_SIGNAL_GENERATOR_HPP
 
+#include <chrono>
+#include <string>
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <rcl_interfaces/msg/set_parameters_result.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <std_srvs/srv/trigger.hpp>
 
+#include "rosplane/loop_timing_probe.hpp"
 #include "rosplane_msgs/msg/controller_commands.hpp"
+#include "waveform_table.hpp"
 
 namespace rosplane
 {
 /**
  * This class is used to generate various input signals to test and tune all the control layers
- * in ROSplane. It currently supports square, sawtooth, triangle, and sine signals, and supports
- * outputting to the roll, pitch, altitude, course, and airspeed controllers.
+ * in ROSplane. It currently supports step, square, sawtooth, triangle, and sine signals, chirp and
+ * multisine sweeps for system identification, and supports outputting to the roll, pitch,
+ * altitude, course, and airspeed controllers.
+ *
+ * The signal is advanced by the time measured on a steady clock between publishes, and tracked as
+ * a count of cycles, so a late timer or a change of frequency does not shift or jump the signal.
  */
 class TuningSignalGenerator : public rclcpp::Node
 {
@@ -79,9 +89,13 @@ private:
     SQUARE,
     SAWTOOTH,
     TRIANGLE,
-    SINE
+    SINE,
+    CHIRP,
+    MULTISINE
   };
 
+  using Clock = std::chrono::steady_clock;
+
   // Parameters
   ControllerOutput controller_output_; ///< Controller to output command signals to.
   SignalType signal_type_;             ///< Signal type to output.
@@ -93,19 +107,33 @@ private:
   double default_chi_c_;               ///< Default for chi_c.
   double default_theta_c_;             ///< Default for theta_c.
   double default_phi_c_;               ///< Default for phi_c.
+  double sweep_start_hz_;              ///< Lowest frequency of the chirp and multisine.
+  double sweep_end_hz_;                ///< Highest frequency of the chirp and multisine.
+  double sweep_duration_s_;            ///< Period of the chirp and multisine.
+  int multisine_components_;           ///< Number of frequencies in the multisine.
 
   // Internal values
-  bool step_toggled_;               ///< Flag for when step signal has been toggled.
-  double initial_time_;             ///< Initial time of the signal.
-  bool is_paused_;                  ///< Flag to specify if signal should be paused.
-  double paused_time_;              ///< Amount of time that has been spent paused.
-  double single_period_start_time_; ///< Epoch time of when single period start was called.
+  bool step_toggled_;           ///< Flag for when step signal has been toggled.
+  bool is_paused_;              ///< Flag to specify if signal should be paused.
+  bool is_single_period_;       ///< Flag for when the signal stops after one period.
+  double cycles_;               ///< Number of periods the signal has run for.
+  double single_period_end_;    ///< Value of cycles_ to stop the single period at.
+  Clock::time_point last_tick_; ///< Time of the last publish on the steady clock.
+  WaveformTable waveform_;      ///< Table of the chirp or multisine.
+  bool waveform_stale_;         ///< Flag for when the table must be rebuilt for new parameters.
 
   /// Controller command ROS message publisher.
   rclcpp::Publisher<rosplane_msgs::msg::ControllerCommands>::SharedPtr command_publisher_;
 
   /// ROS timer to run timer callback, which publishes commands
   rclcpp::TimerBase::SharedPtr publish_timer_;
+  /// Timing of the publish timer callback.
+  LoopTimingProbe publish_timing_;
+
+  /// Loop timing diagnostics publisher.
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_publisher_;
+  /// ROS timer to publish the loop timing diagnostics.
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
 
   /// ROS parameter change callback handler.
   OnSetParametersCallbackHandle::SharedPtr param_callback_handle_;
@@ -123,11 +151,36 @@ private:
 
   /// Callback to publish command on topic.
   void publish_timer_callback();
+  /// Calculates the signal and publishes the command.
+  void publish_command();
+  /// Callback to publish the loop timing diagnostics.
+  void diagnostics_timer_callback();
 
-  /// Callback for parameter changes.
+  /// Callback for parameter changes. Rejects all of the changes if any of them is invalid.
   rcl_interfaces::msg::SetParametersResult
   param_callback(const std::vector<rclcpp::Parameter> & params);
 
+  /**
+   * @brief Checks a new value of a parameter.
+   *
+   * @param param The parameter with its new value.
+   * @return An empty string if the value is valid, otherwise the reason it is not.
+   */
+  std::string validate_param(const rclcpp::Parameter & param) const;
+
+  /**
+   * @brief Stores a new value of a parameter in the class, which must have been validated.
+   *
+   * @param param The parameter with its new value.
+   */
+  void apply_param(const rclcpp::Parameter & param);
+
+  /// Builds the table of the chirp or multisine, if that is the signal type and it is stale.
+  void update_waveform();
+
+  /// The time one period of the current signal takes, in seconds.
+  double period() const;
+
   /// Callback to toggle step signal.
   bool step_toggle_service_callback(const std_srvs::srv::Trigger::Request::SharedPtr & req,
                                     const std_srvs::srv::Trigger::Response::SharedPtr & res);
@@ -199,8 +252,8 @@ private:
   static double get_sine_signal(double elapsed_time, double amplitude, double frequency,
                                 double center_value);
 
-  /// Updates the parameters within the class with the latest values from ROS.
-  void update_params();
+  /// Creates the publish timer at the publish rate.
+  void create_publish_timer();
 
   /// Reset the signal generator.
   void reset();
@@ -0,0 +1,74 @@
+/**
+ * @file waveform_table.hpp
+ *
+ * Precomputed system identification waveforms for the signal generator.
+ */
+
+#ifndef TUNING_WAVEFORM_TABLE_HPP
+#define TUNING_WAVEFORM_TABLE_HPP
+
+#include <vector>
+
+namespace rosplane
+{
+/**
+ * A waveform sampled once into a table and read back with linear interpolation, so that the
+ * trigonometry of a sweep is not repeated on every publish. The waveforms are normalized to a peak
+ * magnitude of 1 and repeat after duration() seconds.
+ */
+class WaveformTable
+{
+public:
+  /// Rate the tables are sampled at, well above the rate the commands are published at.
+  static constexpr double SAMPLE_RATE_HZ = 1000.0;
+
+  /**
+   * @brief Builds an exponential chirp, a sine whose frequency sweeps from the start to the end
+   * frequency over the duration. An exponential sweep spends the same time in each octave, so the
+   * low frequencies are excited as long as the high ones. When repeated, the sweep jumps back to
+   * the start frequency.
+   *
+   * @param start_hz The frequency at the start of the sweep.
+   * @param end_hz The frequency at the end of the sweep.
+   * @param duration The length of the sweep in seconds.
+   */
+  void build_chirp(double start_hz, double end_hz, double duration);
+
+  /**
+   * @brief Builds a multisine, a sum of cosines at harmonics of 1 / duration spread evenly on a log
+   * scale between the start and end frequencies. The phases are the Schroeder phases, which keep
+   * the peak of the sum low for the power it carries.
+   *
+   * @param start_hz The lowest frequency in the sum.
+   * @param end_hz The highest frequency in the sum.
+   * @param components The number of frequencies in the sum. Fewer are used if there are not
+   *   enough harmonics between the start and end frequencies.
+   * @param duration The period of the multisine in seconds.
+   */
+  void build_multisine(double start_hz, double end_hz, int components, double duration);
+
+  /**
+   * @brief Get the value of the waveform at the given time.
+   *
+   * @param time The time since the start of the waveform in seconds. Times past the duration wrap
+   *   around to the start.
+   * @return The value of the waveform, between -1 and 1. Zero if no waveform has been built.
+   */
+  double sample(double time) const;
+
+  /// The time the waveform takes to repeat, in seconds.
+  double duration() const { return duration_; }
+
+  /// Whether a waveform has been built.
+  bool empty() const { return samples_.empty(); }
+
+private:
+  /// Allocates the table for a waveform of the given duration.
+  void resize(double duration);
+
+  std::vector<double> samples_; ///< The waveform, with a sample at both ends of the period.
+  double duration_ = 0;         ///< The period of the waveform in seconds.
+};
+} // namespace rosplane
+
+#endif // TUNING_WAVEFORM_TABLE_HPP
@@ -48,5 +48,11 @@ def generate_launch_description():
             executable='signal_generator',
             name='signal_generator',
             output = 'screen'
+        ),
+        Node(
+            package='rosplane_tuning',
+            executable='response_analyzer',
+            name='response_analyzer',
+            output = 'screen'
         )
     ])
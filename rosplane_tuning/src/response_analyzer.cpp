@@ -0,0 +1,273 @@
+/**
+ * @file response_analyzer.cpp
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "response_analyzer.hpp"
+#include "rosplane/latency_histogram.hpp"
+
+namespace rosplane
+{
+TuningResponseAnalyzer::TuningResponseAnalyzer()
+    : Node("response_analyzer")
+    , controller_output_(ControllerOutput::ROLL)
+    , sweep_(false)
+    , step_threshold_(0.05)
+    , settling_band_(0.02)
+    , response_window_s_(10)
+    , has_command_(false)
+    , command_(0)
+    , step_analyzer_(step_threshold_, settling_band_, response_window_s_)
+{
+  // The parameters are cached in the class and only change through param_callback, so the values
+  // above are the defaults.
+  this->declare_parameter("controller_output", "roll");
+  this->declare_parameter("analysis", "step");
+  this->declare_parameter("step_threshold", step_threshold_);
+  this->declare_parameter("settling_band", settling_band_);
+  this->declare_parameter("response_window_s", response_window_s_);
+
+  // Take the values given at launch, keeping the defaults in place of any that are invalid.
+  for (const auto & param : this->get_parameters(this->list_parameters({}, 1).names)) {
+    std::string reason = validate_param(param);
+    if (reason.empty()) {
+      apply_param(param);
+    } else {
+      RCLCPP_ERROR(this->get_logger(), "%s Using the default instead.", reason.c_str());
+    }
+  }
+  reset();
+
+  state_subscription_ = this->create_subscription<rosplane_msgs::msg::State>(
+    "estimated_state", 10,
+    std::bind(&TuningResponseAnalyzer::state_callback, this, std::placeholders::_1));
+  internals_subscription_ = this->create_subscription<rosplane_msgs::msg::ControllerInternals>(
+    "controller_internals", 10,
+    std::bind(&TuningResponseAnalyzer::internals_callback, this, std::placeholders::_1));
+  command_subscription_ = this->create_subscription<rosplane_msgs::msg::ControllerCommands>(
+    "controller_command", 10,
+    std::bind(&TuningResponseAnalyzer::command_callback, this, std::placeholders::_1));
+
+  diagnostics_publisher_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
+
+  param_callback_handle_ = this->add_on_set_parameters_callback(
+    std::bind(&TuningResponseAnalyzer::param_callback, this, std::placeholders::_1));
+}
+
+void TuningResponseAnalyzer::internals_callback(
+  const rosplane_msgs::msg::ControllerInternals::SharedPtr msg)
+{
+  // The inner loops follow the commands the outer loops give them, which are only published here.
+  if (controller_output_ == ControllerOutput::ROLL) {
+    command_ = msg->phi_c;
+    has_command_ = true;
+  } else if (controller_output_ == ControllerOutput::PITCH) {
+    command_ = msg->theta_c;
+    has_command_ = true;
+  }
+}
+
+void TuningResponseAnalyzer::command_callback(
+  const rosplane_msgs::msg::ControllerCommands::SharedPtr msg)
+{
+  if (controller_output_ == ControllerOutput::ALTITUDE) {
+    command_ = msg->h_c;
+    has_command_ = true;
+  } else if (controller_output_ == ControllerOutput::COURSE) {
+    command_ = msg->chi_c;
+    has_command_ = true;
+  } else if (controller_output_ == ControllerOutput::AIRSPEED) {
+    command_ = msg->va_c;
+    has_command_ = true;
+  }
+}
+
+void TuningResponseAnalyzer::state_callback(const rosplane_msgs::msg::State::SharedPtr msg)
+{
+  if (!has_command_) {
+    return;
+  }
+
+  double response = 0;
+  switch (controller_output_) {
+    case ControllerOutput::ROLL:
+      response = msg->phi;
+      break;
+    case ControllerOutput::PITCH:
+      response = msg->theta;
+      break;
+    case ControllerOutput::ALTITUDE:
+      response = -msg->position[2];
+      break;
+    case ControllerOutput::COURSE:
+      // Compare the course on the same side of the wrap as the command.
+      response = command_ + std::remainder(msg->chi - command_, 2 * M_PI);
+      break;
+    case ControllerOutput::AIRSPEED:
+      response = msg->va;
+      break;
+  }
+
+  double time = this->get_clock()->now().seconds();
+  if (sweep_) {
+    SweepPoint point;
+    if (sweep_analyzer_.update(time, command_, response, point)) {
+      char message[96];
+      std::snprintf(message, sizeof(message), "gain %.3f at %.3f Hz, bandwidth %.3f Hz",
+                    point.gain, point.frequency_hz, sweep_analyzer_.bandwidth_hz());
+      publish_result(output_name() + " sweep response", message,
+                     {"frequency_hz", "gain", "bandwidth_hz"},
+                     {point.frequency_hz, point.gain, sweep_analyzer_.bandwidth_hz()});
+    }
+  } else {
+    StepResponse result;
+    if (step_analyzer_.update(time, command_, response, result)) {
+      char message[160];
+      std::snprintf(message, sizeof(message),
+                    "step %.3f: rise %.3f s, overshoot %.1f%%, settling %.3f s, error %.3f, "
+                    "bandwidth %.3f Hz",
+                    result.step_size, result.rise_time, result.overshoot_percent,
+                    result.settling_time, result.steady_state_error, result.bandwidth_hz);
+      publish_result(output_name() + " step response", message,
+                     {"step_size", "rise_time_s", "overshoot_percent", "settling_time_s",
+                      "steady_state_error", "bandwidth_hz"},
+                     {result.step_size, result.rise_time, result.overshoot_percent,
+                      result.settling_time, result.steady_state_error, result.bandwidth_hz});
+    }
+  }
+}
+
+void TuningResponseAnalyzer::publish_result(const std::string & name, const std::string & message,
+                                            const std::vector<std::string> & keys,
+                                            const std::vector<double> & values)
+{
+  RCLCPP_INFO(this->get_logger(), "%s: %s", name.c_str(), message.c_str());
+
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.name = std::string(this->get_name()) + ": " + name;
+  status.hardware_id = this->get_name();
+  status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status.message = message;
+  for (size_t i = 0; i < keys.size() && i < values.size(); ++i) {
+    LatencyHistogram::add_value(status, keys[i], LatencyHistogram::format(values[i]));
+  }
+
+  diagnostic_msgs::msg::DiagnosticArray diagnostics_message;
+  diagnostics_message.header.stamp = this->get_clock()->now();
+  diagnostics_message.status.push_back(status);
+  diagnostics_publisher_->publish(diagnostics_message);
+}
+
+rcl_interfaces::msg::SetParametersResult
+TuningResponseAnalyzer::param_callback(const std::vector<rclcpp::Parameter> & params)
+{
+  rcl_interfaces::msg::SetParametersResult result;
+  for (const auto & param : params) {
+    result.reason = validate_param(param);
+    if (!result.reason.empty()) {
+      result.successful = false;
+      return result;
+    }
+  }
+
+  for (const auto & param : params) {
+    apply_param(param);
+  }
+  reset();
+
+  result.successful = true;
+  return result;
+}
+
+std::string TuningResponseAnalyzer::validate_param(const rclcpp::Parameter & param) const
+{
+  const std::string & name = param.get_name();
+  try {
+    if (name == "controller_output") {
+      std::string value = param.as_string();
+      if (value != "roll" && value != "pitch" && value != "altitude" && value != "course"
+          && value != "airspeed") {
+        return "Param controller_output set to invalid type " + value + "!";
+      }
+    } else if (name == "analysis") {
+      std::string value = param.as_string();
+      if (value != "step" && value != "sweep") {
+        return "Param analysis set to invalid type " + value + "!";
+      }
+    } else if (name == "step_threshold" || name == "settling_band"
+               || name == "response_window_s") {
+      if (param.as_double() <= 0) {
+        return "Param " + name + " must be greater than 0!";
+      }
+    }
+  } catch (const rclcpp::ParameterTypeException &) {
+    // The type of a parameter is only checked after the callbacks accept the change.
+    return "Param " + name + " set to the wrong type!";
+  }
+  return "";
+}
+
+void TuningResponseAnalyzer::apply_param(const rclcpp::Parameter & param)
+{
+  const std::string & name = param.get_name();
+  if (name == "controller_output") {
+    std::string value = param.as_string();
+    if (value == "roll") {
+      controller_output_ = ControllerOutput::ROLL;
+    } else if (value == "pitch") {
+      controller_output_ = ControllerOutput::PITCH;
+    } else if (value == "altitude") {
+      controller_output_ = ControllerOutput::ALTITUDE;
+    } else if (value == "course") {
+      controller_output_ = ControllerOutput::COURSE;
+    } else if (value == "airspeed") {
+      controller_output_ = ControllerOutput::AIRSPEED;
+    }
+    // The last command may be from another controller.
+    has_command_ = false;
+  } else if (name == "analysis") {
+    sweep_ = param.as_string() == "sweep";
+  } else if (name == "step_threshold") {
+    step_threshold_ = param.as_double();
+  } else if (name == "settling_band") {
+    settling_band_ = param.as_double();
+  } else if (name == "response_window_s") {
+    response_window_s_ = param.as_double();
+  }
+}
+
+std::string TuningResponseAnalyzer::output_name() const
+{
+  switch (controller_output_) {
+    case ControllerOutput::ROLL:
+      return "roll";
+    case ControllerOutput::PITCH:
+      return "pitch";
+    case ControllerOutput::ALTITUDE:
+      return "altitude";
+    case ControllerOutput::COURSE:
+      return "course";
+    case ControllerOutput::AIRSPEED:
+      return "airspeed";
+  }
+  return "";
+}
+
+void TuningResponseAnalyzer::reset()
+{
+  step_analyzer_ = StepResponseAnalyzer(step_threshold_, settling_band_, response_window_s_);
+  sweep_analyzer_.reset();
+}
+
+} // namespace rosplane
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  rclcpp::spin(std::make_shared<rosplane::TuningResponseAnalyzer>());
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file response_metrics.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "response_metrics.hpp"
+
+namespace rosplane
+{
+namespace
+{
+constexpr double NOT_MEASURED = std::numeric_limits<double>::quiet_NaN();
+
+/// Rise time and bandwidth of a first order system are related by t_r = 0.35 / f_bw.
+constexpr double RISE_TIME_BANDWIDTH_PRODUCT = 0.35;
+
+/// Weight of each new half cycle in the smoothed gain of a sweep.
+constexpr double GAIN_SMOOTHING = 0.25;
+} // namespace
+
+StepResponseAnalyzer::StepResponseAnalyzer(double step_threshold, double settling_band,
+                                           double window)
+    : step_threshold_(step_threshold)
+    , settling_band_(settling_band)
+    , window_(window)
+    , has_previous_(false)
+    , previous_command_(0)
+    , active_(false)
+    , step_time_(0)
+    , initial_response_(0)
+    , target_(0)
+    , rise_start_time_(NOT_MEASURED)
+    , rise_end_time_(NOT_MEASURED)
+    , peak_(0)
+    , last_unsettled_time_(0)
+    , last_response_(0)
+{}
+
+bool StepResponseAnalyzer::update(double time, double command, double response,
+                                  StepResponse & result)
+{
+  bool finished = false;
+  bool stepped = has_previous_ && std::abs(command - previous_command_) > step_threshold_;
+  previous_command_ = command;
+  has_previous_ = true;
+
+  // A new step or the end of the window ends the response being measured.
+  if (active_ && (stepped || time - step_time_ >= window_)) {
+    result = finish();
+    active_ = false;
+    finished = true;
+  }
+
+  if (stepped && std::abs(command - response) > step_threshold_) {
+    active_ = true;
+    step_time_ = time;
+    initial_response_ = response;
+    target_ = command;
+    rise_start_time_ = NOT_MEASURED;
+    rise_end_time_ = NOT_MEASURED;
+    peak_ = 0;
+    last_unsettled_time_ = time;
+  }
+
+  if (active_) {
+    // Progress of the response through the step, from 0 at the step to 1 at the command.
+    double progress = (response - initial_response_) / (target_ - initial_response_);
+    if (std::isnan(rise_start_time_) && progress >= 0.1) {
+      rise_start_time_ = time;
+    }
+    if (std::isnan(rise_end_time_) && progress >= 0.9) {
+      rise_end_time_ = time;
+    }
+    peak_ = std::max(peak_, progress);
+    if (std::abs(progress - 1) > settling_band_) {
+      last_unsettled_time_ = time;
+    }
+    last_response_ = response;
+  }
+
+  return finished;
+}
+
+void StepResponseAnalyzer::reset()
+{
+  has_previous_ = false;
+  active_ = false;
+}
+
+StepResponse StepResponseAnalyzer::finish() const
+{
+  StepResponse result;
+  result.step_size = target_ - initial_response_;
+  result.rise_time = rise_end_time_ - rise_start_time_;
+  result.overshoot_percent = std::max(peak_ - 1, 0.0) * 100;
+  result.steady_state_error = target_ - last_response_;
+  result.bandwidth_hz = RISE_TIME_BANDWIDTH_PRODUCT / result.rise_time;
+
+  // A response still outside the band when the window ended never settled.
+  bool settled =
+    std::abs((last_response_ - initial_response_) / result.step_size - 1) <= settling_band_;
+  result.settling_time = settled ? last_unsettled_time_ - step_time_ : NOT_MEASURED;
+  return result;
+}
+
+SweepResponseAnalyzer::SweepResponseAnalyzer()
+{
+  reset();
+}
+
+bool SweepResponseAnalyzer::update(double time, double command, double response, SweepPoint & point)
+{
+  samples_++;
+  command_mean_ += (command - command_mean_) / samples_;
+  response_mean_ += (response - response_mean_) / samples_;
+
+  double command_offset = command - command_mean_;
+  int sign = command_offset >= 0 ? 1 : -1;
+  bool finished = false;
+
+  if (sign != sign_) {
+    // The half cycles start at the first crossing, since the mean is meaningless before it.
+    if (sign_ != 0 && !std::isnan(crossing_time_) && time > crossing_time_ && command_peak_ > 0) {
+      point.frequency_hz = 1 / (2 * (time - crossing_time_));
+      point.gain = response_peak_ / command_peak_;
+      finished = true;
+
+      smoothed_gain_ = std::isnan(smoothed_gain_)
+        ? point.gain
+        : smoothed_gain_ + GAIN_SMOOTHING * (point.gain - smoothed_gain_);
+      if (std::isnan(bandwidth_hz_) && smoothed_gain_ < M_SQRT1_2) {
+        bandwidth_hz_ = point.frequency_hz;
+      }
+    }
+    if (sign_ != 0) {
+      crossing_time_ = time;
+    }
+    sign_ = sign;
+    command_peak_ = 0;
+    response_peak_ = 0;
+  }
+
+  command_peak_ = std::max(command_peak_, std::abs(command_offset));
+  response_peak_ = std::max(response_peak_, std::abs(response - response_mean_));
+  return finished;
+}
+
+void SweepResponseAnalyzer::reset()
+{
+  samples_ = 0;
+  command_mean_ = 0;
+  response_mean_ = 0;
+  sign_ = 0;
+  crossing_time_ = NOT_MEASURED;
+  command_peak_ = 0;
+  response_peak_ = 0;
+  smoothed_gain_ = NOT_MEASURED;
+  bandwidth_hz_ = NOT_MEASURED;
+}
+} // namespace rosplane
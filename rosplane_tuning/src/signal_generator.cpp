@@ -48,35 +48,64 @@ namespace rosplane
 TuningSignalGenerator::TuningSignalGenerator()
     : Node("signal_generator")
     , controller_output_(ControllerOutput::ROLL)
-    , signal_type_(SignalType::SQUARE)
-    , publish_rate_hz_(0)
-    , signal_magnitude_(0)
-    , frequency_hz_(0)
-    , initial_time_(0)
+    , signal_type_(SignalType::STEP)
+    , publish_rate_hz_(100)
+    , signal_magnitude_(1)
+    , frequency_hz_(0.2)
+    , default_va_c_(15)
+    , default_h_c_(40)
+    , default_chi_c_(0)
+    , default_theta_c_(0)
+    , default_phi_c_(0)
+    , sweep_start_hz_(0.1)
+    , sweep_end_hz_(5)
+    , sweep_duration_s_(60)
+    , multisine_components_(20)
+    , step_toggled_(false)
     , is_paused_(true)
-    , paused_time_(0)
-    , single_period_start_time_(0)
+    , is_single_period_(false)
+    , cycles_(0)
+    , single_period_end_(0)
+    , last_tick_(Clock::now())
+    , waveform_stale_(true)
 {
+  // The parameters are cached in the class and only change through param_callback, so the values
+  // above are the defaults.
   this->declare_parameter("controller_output", "roll");
   this->declare_parameter("signal_type", "step");
-  this->declare_parameter("publish_rate_hz", 100.0);
-  this->declare_parameter("signal_magnitude", 1.0);
-  this->declare_parameter("frequency_hz", 0.2);
-  this->declare_parameter("default_va_c", 15.0);
-  this->declare_parameter("default_h_c", 40.0);
-  this->declare_parameter("default_chi_c", 0.0);
-  this->declare_parameter("default_theta_c", 0.0);
-  this->declare_parameter("default_phi_c", 0.0);
-
-  update_params();
-  initial_time_ = this->get_clock()->now().seconds();
+  this->declare_parameter("publish_rate_hz", publish_rate_hz_);
+  this->declare_parameter("signal_magnitude", signal_magnitude_);
+  this->declare_parameter("frequency_hz", frequency_hz_);
+  this->declare_parameter("default_va_c", default_va_c_);
+  this->declare_parameter("default_h_c", default_h_c_);
+  this->declare_parameter("default_chi_c", default_chi_c_);
+  this->declare_parameter("default_theta_c", default_theta_c_);
+  this->declare_parameter("default_phi_c", default_phi_c_);
+  this->declare_parameter("sweep_start_hz", sweep_start_hz_);
+  this->declare_parameter("sweep_end_hz", sweep_end_hz_);
+  this->declare_parameter("sweep_duration_s", sweep_duration_s_);
+  this->declare_parameter("multisine_components", multisine_components_);
+
+  // Take the values given at launch, keeping the defaults in place of any that are invalid.
+  for (const auto & param : this->get_parameters(this->list_parameters({}, 1).names)) {
+    std::string reason = validate_param(param);
+    if (reason.empty()) {
+      apply_param(param);
+    } else {
+      RCLCPP_ERROR(this->get_logger(), "%s Using the default instead.", reason.c_str());
+    }
+  }
+  update_waveform();
 
   command_publisher_ =
     this->create_publisher<rosplane_msgs::msg::ControllerCommands>("/controller_command", 1);
 
-  publish_timer_ =
-    this->create_wall_timer(std::chrono::milliseconds(static_cast<long>(1000 / publish_rate_hz_)),
-                            std::bind(&TuningSignalGenerator::publish_timer_callback, this));
+  create_publish_timer();
+
+  diagnostics_publisher_ =
+    this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 10);
+  diagnostics_timer_ = this->create_wall_timer(
+    std::chrono::seconds(1), std::bind(&TuningSignalGenerator::diagnostics_timer_callback, this));
 
   param_callback_handle_ = this->add_on_set_parameters_callback(
     std::bind(&TuningSignalGenerator::param_callback, this, std::placeholders::_1));
@@ -105,26 +134,39 @@ TuningSignalGenerator::TuningSignalGenerator()
 
 void TuningSignalGenerator::publish_timer_callback()
 {
-  update_params();
-
-  double elapsed_time = this->get_clock()->now().seconds() - initial_time_ - paused_time_;
+  publish_timing_.tick();
+  publish_timing_.measure([this] { publish_command(); });
+}
 
-  // Check if only suppose to run for single period, pausing when complete
-  if (abs(single_period_start_time_) > 0.01
-      && (single_period_start_time_ + (1 / frequency_hz_)) <= this->get_clock()->now().seconds()) {
-    single_period_start_time_ = 0;
-    is_paused_ = true;
-  }
+void TuningSignalGenerator::diagnostics_timer_callback()
+{
+  diagnostic_msgs::msg::DiagnosticArray diagnostics_message;
+  diagnostics_message.header.stamp = this->get_clock()->now();
+  diagnostics_message.status.push_back(publish_timing_.status(
+    std::string(this->get_name()) + ": publish loop timing", this->get_name()));
+  diagnostics_publisher_->publish(diagnostics_message);
+}
 
-  // Check if step toggle needs to be reset
-  if (signal_type_ != SignalType::STEP) {
-    step_toggled_ = false;
+void TuningSignalGenerator::publish_command()
+{
+  // Advance the signal by the time that has actually passed since the last publish, so a late
+  // timer does not shift the signal.
+  Clock::time_point now = Clock::now();
+  double elapsed = std::chrono::duration<double>(now - last_tick_).count();
+  last_tick_ = now;
+  if (!is_paused_ && signal_type_ != SignalType::STEP) {
+    cycles_ += elapsed / period();
+
+    // Check if only suppose to run for single period, pausing when complete
+    if (is_single_period_ && cycles_ >= single_period_end_) {
+      cycles_ = single_period_end_;
+      is_single_period_ = false;
+      is_paused_ = true;
+    }
   }
 
-  // If paused, negate passing of time but keep publishing
-  if (is_paused_) {
-    paused_time_ += 1 / publish_rate_hz_;
-  }
+  // Time into the current period of the signal
+  double period_time = (cycles_ - std::floor(cycles_)) * period();
 
   // Get value for signal
   double amplitude = signal_magnitude_ / 2;
@@ -153,16 +195,20 @@ void TuningSignalGenerator::publish_timer_callback()
       signal_value = get_step_signal(step_toggled_, amplitude, center_value);
       break;
     case SignalType::SQUARE:
-      signal_value = get_square_signal(elapsed_time, amplitude, frequency_hz_, center_value);
+      signal_value = get_square_signal(period_time, amplitude, frequency_hz_, center_value);
       break;
     case SignalType::SAWTOOTH:
-      signal_value = get_sawtooth_signal(elapsed_time, amplitude, frequency_hz_, center_value);
+      signal_value = get_sawtooth_signal(period_time, amplitude, frequency_hz_, center_value);
       break;
     case SignalType::TRIANGLE:
-      signal_value = get_triangle_signal(elapsed_time, amplitude, frequency_hz_, center_value);
+      signal_value = get_triangle_signal(period_time, amplitude, frequency_hz_, center_value);
       break;
     case SignalType::SINE:
-      signal_value = get_sine_signal(elapsed_time, amplitude, frequency_hz_, center_value);
+      signal_value = get_sine_signal(period_time, amplitude, frequency_hz_, center_value);
+      break;
+    case SignalType::CHIRP:
+    case SignalType::MULTISINE:
+      signal_value = waveform_.sample(period_time) * amplitude + center_value;
       break;
   }
 
@@ -199,13 +245,20 @@ void TuningSignalGenerator::publish_timer_callback()
 rcl_interfaces::msg::SetParametersResult
 TuningSignalGenerator::param_callback(const std::vector<rclcpp::Parameter> & params)
 {
+  rcl_interfaces::msg::SetParametersResult result;
   for (const auto & param : params) {
-    if (param.get_name() == "controller_output" || param.get_name() == "signal_type") {
-      reset();
+    result.reason = validate_param(param);
+    if (!result.reason.empty()) {
+      result.successful = false;
+      return result;
     }
   }
 
-  rcl_interfaces::msg::SetParametersResult result;
+  for (const auto & param : params) {
+    apply_param(param);
+  }
+  update_waveform();
+
   result.successful = true;
   return result;
 }
@@ -250,7 +303,7 @@ bool TuningSignalGenerator::pause_service_callback(
   }
 
   is_paused_ = true;
-  single_period_start_time_ = 0;
+  is_single_period_ = false;
 
   res->success = true;
   return true;
@@ -267,7 +320,7 @@ bool TuningSignalGenerator::start_continuous_service_callback(
   }
 
   is_paused_ = false;
-  single_period_start_time_ = 0;
+  is_single_period_ = false;
 
   res->success = true;
   return true;
@@ -284,7 +337,8 @@ bool TuningSignalGenerator::start_single_service_callback(
   }
 
   is_paused_ = false;
-  single_period_start_time_ = this->get_clock()->now().seconds();
+  is_single_period_ = true;
+  single_period_end_ = cycles_ + 1;
 
   res->success = true;
   return true;
@@ -327,89 +381,152 @@ double TuningSignalGenerator::get_sine_signal(double elapsed_time, double amplit
   return -cos(elapsed_time * frequency * 2 * M_PI) * amplitude + center_value;
 }
 
-void TuningSignalGenerator::update_params()
+std::string TuningSignalGenerator::validate_param(const rclcpp::Parameter & param) const
 {
-  // controller_output
-  std::string controller_output_string = this->get_parameter("controller_output").as_string();
-  if (controller_output_string == "roll") {
-    controller_output_ = ControllerOutput::ROLL;
-  } else if (controller_output_string == "pitch") {
-    controller_output_ = ControllerOutput::PITCH;
-  } else if (controller_output_string == "altitude") {
-    controller_output_ = ControllerOutput::ALTITUDE;
-  } else if (controller_output_string == "course") {
-    controller_output_ = ControllerOutput::COURSE;
-  } else if (controller_output_string == "airspeed") {
-    controller_output_ = ControllerOutput::AIRSPEED;
-  } else {
-    RCLCPP_ERROR(this->get_logger(), "Param controller_output set to invalid type %s!",
-                 controller_output_string.c_str());
-  }
-
-  // signal_type
-  std::string signal_type_string = this->get_parameter("signal_type").as_string();
-  if (signal_type_string == "step") {
-    signal_type_ = SignalType::STEP;
-  } else if (signal_type_string == "square") {
-    signal_type_ = SignalType::SQUARE;
-  } else if (signal_type_string == "sawtooth") {
-    signal_type_ = SignalType::SAWTOOTH;
-  } else if (signal_type_string == "triangle") {
-    signal_type_ = SignalType::TRIANGLE;
-  } else if (signal_type_string == "sine") {
-    signal_type_ = SignalType::SINE;
-  } else {
-    RCLCPP_ERROR(this->get_logger(), "Param signal_type set to invalid type %s!",
-                 signal_type_string.c_str());
+  const std::string & name = param.get_name();
+  try {
+    if (name == "controller_output") {
+      std::string value = param.as_string();
+      if (value != "roll" && value != "pitch" && value != "altitude" && value != "course"
+          && value != "airspeed") {
+        return "Param controller_output set to invalid type " + value + "!";
+      }
+    } else if (name == "signal_type") {
+      std::string value = param.as_string();
+      if (value != "step" && value != "square" && value != "sawtooth" && value != "triangle"
+          && value != "sine" && value != "chirp" && value != "multisine") {
+        return "Param signal_type set to invalid type " + value + "!";
+      }
+    } else if (name == "publish_rate_hz" || name == "frequency_hz" || name == "sweep_start_hz"
+               || name == "sweep_end_hz" || name == "sweep_duration_s") {
+      if (param.as_double() <= 0) {
+        return "Param " + name + " must be greater than 0!";
+      }
+    } else if (name == "multisine_components") {
+      if (param.as_int() < 1) {
+        return "Param multisine_components must be at least 1!";
+      }
+    }
+  } catch (const rclcpp::ParameterTypeException &) {
+    // The type of a parameter is only checked after the callbacks accept the change.
+    return "Param " + name + " set to the wrong type!";
   }
+  return "";
+}
 
-  // publish_rate_hz
-  double publish_rate_hz_value = this->get_parameter("publish_rate_hz").as_double();
-  if (publish_rate_hz_value <= 0) {
-    RCLCPP_ERROR(this->get_logger(), "Param publish_rate_hz must be greater than 0!");
-  } else {
+void TuningSignalGenerator::apply_param(const rclcpp::Parameter & param)
+{
+  const std::string & name = param.get_name();
+  if (name == "controller_output") {
+    std::string value = param.as_string();
+    if (value == "roll") {
+      controller_output_ = ControllerOutput::ROLL;
+    } else if (value == "pitch") {
+      controller_output_ = ControllerOutput::PITCH;
+    } else if (value == "altitude") {
+      controller_output_ = ControllerOutput::ALTITUDE;
+    } else if (value == "course") {
+      controller_output_ = ControllerOutput::COURSE;
+    } else if (value == "airspeed") {
+      controller_output_ = ControllerOutput::AIRSPEED;
+    }
+    reset();
+  } else if (name == "signal_type") {
+    std::string value = param.as_string();
+    if (value == "step") {
+      signal_type_ = SignalType::STEP;
+    } else if (value == "square") {
+      signal_type_ = SignalType::SQUARE;
+    } else if (value == "sawtooth") {
+      signal_type_ = SignalType::SAWTOOTH;
+    } else if (value == "triangle") {
+      signal_type_ = SignalType::TRIANGLE;
+    } else if (value == "sine") {
+      signal_type_ = SignalType::SINE;
+    } else if (value == "chirp") {
+      signal_type_ = SignalType::CHIRP;
+    } else if (value == "multisine") {
+      signal_type_ = SignalType::MULTISINE;
+    }
+    waveform_stale_ = true;
+    reset();
+  } else if (name == "publish_rate_hz") {
     // Parameter has changed, create new timer with updated value
-    if (publish_rate_hz_ != publish_rate_hz_value) {
-      publish_rate_hz_ = publish_rate_hz_value;
-      publish_timer_ = this->create_wall_timer(
-        std::chrono::milliseconds(static_cast<long>(1000 / publish_rate_hz_)),
-        std::bind(&TuningSignalGenerator::publish_timer_callback, this));
+    if (publish_rate_hz_ != param.as_double()) {
+      publish_rate_hz_ = param.as_double();
+      if (publish_timer_) {
+        create_publish_timer();
+      }
     }
+  } else if (name == "signal_magnitude") {
+    signal_magnitude_ = param.as_double();
+  } else if (name == "frequency_hz") {
+    frequency_hz_ = param.as_double();
+  } else if (name == "default_va_c") {
+    default_va_c_ = param.as_double();
+  } else if (name == "default_h_c") {
+    default_h_c_ = param.as_double();
+  } else if (name == "default_chi_c") {
+    default_chi_c_ = param.as_double();
+  } else if (name == "default_theta_c") {
+    default_theta_c_ = param.as_double();
+  } else if (name == "default_phi_c") {
+    default_phi_c_ = param.as_double();
+  } else if (name == "sweep_start_hz") {
+    sweep_start_hz_ = param.as_double();
+    waveform_stale_ = true;
+  } else if (name == "sweep_end_hz") {
+    sweep_end_hz_ = param.as_double();
+    waveform_stale_ = true;
+  } else if (name == "sweep_duration_s") {
+    sweep_duration_s_ = param.as_double();
+    waveform_stale_ = true;
+  } else if (name == "multisine_components") {
+    multisine_components_ = static_cast<int>(param.as_int());
+    waveform_stale_ = true;
   }
+}
 
-  // signal_magnitude_
-  signal_magnitude_ = this->get_parameter("signal_magnitude").as_double();
+void TuningSignalGenerator::update_waveform()
+{
+  if (!waveform_stale_) {
+    return;
+  }
 
-  // frequency_hz
-  double frequency_hz_value = this->get_parameter("frequency_hz").as_double();
-  if (frequency_hz_value <= 0) {
-    RCLCPP_ERROR(this->get_logger(), "Param frequency_hz must be greater than 0!");
+  // Only the table of the current signal type is kept, and it is built here rather than in the
+  // publish timer so that the publishing is not held up.
+  if (signal_type_ == SignalType::CHIRP) {
+    waveform_.build_chirp(sweep_start_hz_, sweep_end_hz_, sweep_duration_s_);
+  } else if (signal_type_ == SignalType::MULTISINE) {
+    waveform_.build_multisine(sweep_start_hz_, sweep_end_hz_, multisine_components_,
+                              sweep_duration_s_);
   } else {
-    frequency_hz_ = frequency_hz_value;
+    return;
   }
+  waveform_stale_ = false;
+}
 
-  // default_va_c
-  default_va_c_ = this->get_parameter("default_va_c").as_double();
-
-  // default_h_c
-  default_h_c_ = this->get_parameter("default_h_c").as_double();
-
-  // default_chi_c
-  default_chi_c_ = this->get_parameter("default_chi_c").as_double();
-
-  // default_theta_c
-  default_theta_c_ = this->get_parameter("default_theta_c").as_double();
+double TuningSignalGenerator::period() const
+{
+  if (signal_type_ == SignalType::CHIRP || signal_type_ == SignalType::MULTISINE) {
+    return sweep_duration_s_;
+  }
+  return 1 / frequency_hz_;
+}
 
-  // default_phi_c
-  default_phi_c_ = this->get_parameter("default_phi_c").as_double();
+void TuningSignalGenerator::create_publish_timer()
+{
+  publish_timer_ =
+    this->create_wall_timer(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / publish_rate_hz_)),
+                            std::bind(&TuningSignalGenerator::publish_timer_callback, this));
+  publish_timing_.set_period(1 / publish_rate_hz_);
 }
 
 void TuningSignalGenerator::reset()
 {
-  initial_time_ = this->get_clock()->now().seconds();
-  paused_time_ = 0;
+  cycles_ = 0;
   is_paused_ = true;
-  single_period_start_time_ = 0;
+  is_single_period_ = false;
   step_toggled_ = false;
 }
 
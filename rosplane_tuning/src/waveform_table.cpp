@@ -0,0 +1,97 @@
+/**
+ * @file waveform_table.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "waveform_table.hpp"
+
+namespace rosplane
+{
+void WaveformTable::build_chirp(double start_hz, double end_hz, double duration)
+{
+  resize(duration);
+
+  // The phase is the integral of the frequency start_hz * k^(t / duration), where k is the ratio of
+  // the end and start frequencies. A ratio of 1 is a constant frequency.
+  double k = end_hz / start_hz;
+  double log_k = std::log(k);
+  size_t intervals = samples_.size() - 1;
+  for (size_t i = 0; i <= intervals; ++i) {
+    double t = duration * i / intervals;
+    double cycles = std::abs(log_k) < 1e-9
+      ? start_hz * t
+      : start_hz * duration / log_k * (std::pow(k, t / duration) - 1);
+    // Starts at the bottom of the signal, like the sine signal.
+    samples_[i] = -std::cos(2 * M_PI * cycles);
+  }
+}
+
+void WaveformTable::build_multisine(double start_hz, double end_hz, int components, double duration)
+{
+  resize(duration);
+
+  // Only harmonics of the period repeat cleanly, so spread the components over those.
+  int lowest = std::max(static_cast<int>(std::ceil(start_hz * duration)), 1);
+  int highest = std::max(static_cast<int>(std::floor(end_hz * duration)), lowest);
+  std::vector<int> harmonics;
+  components = std::max(components, 1);
+  for (int i = 0; i < components; ++i) {
+    double fraction = components > 1 ? static_cast<double>(i) / (components - 1) : 0;
+    int harmonic = static_cast<int>(
+      std::round(lowest * std::pow(static_cast<double>(highest) / lowest, fraction)));
+    if (harmonics.empty() || harmonic > harmonics.back()) {
+      harmonics.push_back(harmonic);
+    }
+  }
+
+  // Schroeder phases, -pi * k * (k - 1) / N for the kth of N components.
+  size_t n = harmonics.size();
+  std::vector<double> phases(n);
+  for (size_t k = 1; k <= n; ++k) {
+    phases[k - 1] = -M_PI * k * (k - 1) / n;
+  }
+
+  size_t intervals = samples_.size() - 1;
+  double peak = 0;
+  for (size_t i = 0; i <= intervals; ++i) {
+    double t = duration * i / intervals;
+    double value = 0;
+    for (size_t k = 0; k < n; ++k) {
+      value += std::cos(2 * M_PI * harmonics[k] / duration * t + phases[k]);
+    }
+    samples_[i] = value;
+    peak = std::max(peak, std::abs(value));
+  }
+
+  for (double & value : samples_) {
+    value /= peak;
+  }
+}
+
+double WaveformTable::sample(double time) const
+{
+  if (samples_.empty()) {
+    return 0;
+  }
+
+  double wrapped = std::fmod(time, duration_);
+  if (wrapped < 0) {
+    wrapped += duration_;
+  }
+
+  size_t intervals = samples_.size() - 1;
+  double position = wrapped / duration_ * intervals;
+  size_t index = std::min(static_cast<size_t>(position), intervals - 1);
+  double fraction = position - index;
+  return samples_[index] + fraction * (samples_[index + 1] - samples_[index]);
+}
+
+void WaveformTable::resize(double duration)
+{
+  duration_ = duration;
+  size_t intervals = std::max(static_cast<size_t>(std::ceil(duration * SAMPLE_RATE_HZ)), size_t{1});
+  samples_.assign(intervals + 1, 0);
+}
+} // namespace rosplane